@@ -0,0 +1,58 @@
+#pragma once
+// Deterministic closed-form embedder, the fast alternative to GBO.
+//
+// applyVectorToBlock only changes coefficient magnitudes, so the decoding rule
+// s1 >= s0 is a linear constraint on the vector: every unit added to a magnitude of
+// the winning region (s1 for bit 1, s0 for bit 0) or removed from one of the losing
+// region moves the margin by one. The smallest L2 change (and, the DCT being
+// orthonormal, the smallest pixel MSE) that buys a given margin spreads the change
+// evenly, except that losing magnitudes cannot go below zero (water-filling).
+#include <armadillo>
+#include <cstdint>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include "embed_defaults.h"
+
+// |DCT coefficient| at the 64 zig-zag positions of a pixel block / of a block of quantized
+// JPEG coefficients (dequantized with its table, natural order)
+void blockMagnitudes(const cv::Mat& block, double* magnitudes);
+void coefficientMagnitudes(const int16_t* coefs, const uint16_t* quant, double* magnitudes);
+
+// Winning minus losing region sum, in DCT units: how far the block is from decoding the
+// other bit; zero or negative means it already decodes the wrong one
+double decodeMargin(const double* magnitudes, unsigned char bit, int scheme = 0);
+
+/**
+ * @brief Minimal-L2 vector in the GBO search space of the scheme that raises
+ * (winning sum - losing sum) by `increase`.
+ * @param magnitudes |coefficient| for all 64 zig-zag positions of the block.
+ * @return Vector with one entry per coefficient of embeding_region[scheme]; zero when increase <= 0.
+ */
+arma::vec analyticVector(const double* magnitudes, unsigned char bit, int scheme, double increase);
+
+// Analytic vector for a pixel block / a block of quantized JPEG coefficients, without the
+// rounding fix-up; GBO uses it as a warm-start individual
+arma::vec analyticGuess(const cv::Mat& block, unsigned char bit, int scheme = 0, double margin = default_analytic_margin);
+arma::vec analyticCoefficientGuess(const int16_t* coefs, const uint16_t* quant, unsigned char bit, int scheme = 0,
+                                   double margin = default_analytic_margin);
+
+/**
+ * @brief Embeds one bit with the analytic vector and corrects for rounding.
+ * The result must decode with a margin of at least `margin` after the block is rounded
+ * to 8 bits; when pixel rounding or clipping eats part of it the shortfall is added and
+ * the vector recomputed (a few rounds at most). Blocks that already satisfy the margin
+ * are returned unchanged.
+ * @param block 8x8 block, type CV_8UC1.
+ * @return The watermarked block, type CV_8UC1.
+ */
+cv::Mat analyticEmbedBlock(const cv::Mat& block, unsigned char bit, int scheme = 0,
+                           double margin = default_analytic_margin);
+
+/**
+ * @brief Coefficient-domain counterpart of analyticEmbedBlock: the margin is checked
+ * after re-quantization with the block's table.
+ * @param coefs Quantized coefficients of one block, natural order; modified in place.
+ * @param quant Quantization table, natural order.
+ */
+void analyticEmbedCoefficients(int16_t* coefs, const uint16_t* quant, unsigned char bit, int scheme = 0,
+                               double margin = default_analytic_margin);
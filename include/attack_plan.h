@@ -0,0 +1,67 @@
+#pragma once
+// Attack plan of the dataset builder: which attacked versions of every embedded copy are made,
+// and which of them the error count tau is taken over.
+//
+// Attacks are chained, so the plan is a DAG whose nodes each take one input: the embedded copy
+// itself or an earlier node. A chain that shares a prefix with another one reuses the prefix's
+// output, so every node is computed once per copy however many chains pass through it. Nodes of
+// the same depth do not depend on each other and run in parallel.
+//
+// Plan files have one node per line, "#" starts a comment:
+//
+//   # id        attack    [param]  [<- input]
+//   contrast    contrast  1.2
+//   jpeg70      jpeg      70
+//   c_jpeg70    jpeg      70       <- contrast
+//   tau copy jpeg70 contrast c_jpeg70
+//
+// Attacks and parameters are those of the sweep (attack_sweep.h). An input must be defined on an
+// earlier line; "copy" names the embedded copy. The optional "tau" line lists the nodes tau
+// counts errors over (default: the copy and every node).
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+struct AttackNode {
+    std::string id;
+    std::string attack;     // one of sweepAttackNames()
+    double param = 0.0;
+    int input = -1;         // index of the input node; -1 = the embedded copy
+};
+
+class AttackPlan {
+public:
+    // Index that stands for the embedded copy in tauNodes()
+    static constexpr int copy = -1;
+
+    /**
+     * @brief Parses a plan in the format above.
+     * @throws std::invalid_argument naming the line of an unknown attack, a bad parameter, a
+     * duplicate id or an input that is not defined before.
+     */
+    static AttackPlan parse(const std::string& text);
+    // parse() of a file; std::runtime_error if it cannot be read
+    static AttackPlan load(const std::string& path);
+    // The builder's historical set: JPEG 70 and contrast x1.2 of the copy, tau over all three
+    static AttackPlan defaultPlan();
+
+    const std::vector<AttackNode>& nodes() const { return nodes_; }   // inputs before the nodes that read them
+    const std::vector<int>& tauNodes() const { return tau_; }
+    // Distance of every node from the copy (1 = attacks the copy)
+    const std::vector<int>& depths() const { return depths_; }
+
+    /**
+     * @brief Every node applied to one embedded copy.
+     * Depth by depth, the nodes of a depth in parallel. Outputs that only feed later nodes are
+     * released once the deepest of those has run.
+     * @param seed Noise attacks of node i draw NoiseStream(seed + i).
+     * @return The image of every tau node, in tauNodes() order.
+     */
+    std::vector<cv::Mat> evaluate(const cv::Mat& copy_image, int threads = 0, uint64_t seed = 0) const;
+
+private:
+    std::vector<AttackNode> nodes_;
+    std::vector<int> tau_;
+    std::vector<int> depths_;
+};
@@ -0,0 +1,91 @@
+#pragma once
+// Robustness curves: one watermarked image run through a grid of (attack, parameter) points.
+//
+// The standard attack list (attacks.h) measures a few fixed points. A sweep embeds once and
+// evaluates every point of the grid in parallel in memory, with what the points share computed
+// up front: the SSIM statistics of the original (SsimReference) and the forward DCT of the
+// watermarked image, so that every JPEG quality only quantizes and reconstructs (JpegImageDct).
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "gbo_api.h"
+#include "jpeg_simulator.h"
+#include "metrics.h"
+
+// One attack of the grid and the parameter values it is run at
+struct SweepAxis {
+    std::string attack;             // one of sweepAttackNames()
+    std::vector<double> params;     // one point per value; {0} for attacks without a parameter
+};
+
+// none, jpeg (quality), saltpepper (probability), speckle (deviation), gaussian, median and
+// average (kernel size), brightness (signed offset), contrast (factor), sharpen, histeq
+const std::vector<std::string>& sweepAttackNames();
+
+// Whether the attack takes a parameter; throws std::invalid_argument for an unknown name
+bool sweepAttackHasParam(const std::string& name);
+
+// The named attack on a CV_8UC1 image (attacks.h); the seed feeds the noise attacks
+cv::Mat applySweepAttack(const cv::Mat& image, const std::string& name, double param, uint64_t seed = 0);
+
+/**
+ * @brief Parses a grid: axes separated by ';', each "name", "name=v1,v2,..." or
+ * "name=start:stop:step" (stop included), e.g. "jpeg=10:100:10;median=3,5;sharpen".
+ * @throws std::invalid_argument on an unknown attack, a malformed list or range, or a
+ * parameter out of range (see validateSweepGrid).
+ */
+std::vector<SweepAxis> parseSweepGrid(const std::string& spec);
+
+// Throws std::invalid_argument for an unknown attack or a parameter it cannot take: JPEG quality
+// in [1, 100], probability in [0, 1], deviation >= 0, contrast > 0, odd kernel sizes >= 1
+// (any size >= 1 for average)
+void validateSweepGrid(const std::vector<SweepAxis>& grid);
+
+// The curves `--sweep` draws without --grid: JPEG 10-100, noise, kernels 3-11, brightness and contrast
+const char* const default_sweep_grid =
+    "none;jpeg=10:100:10;saltpepper=0.01:0.1:0.01;speckle=5:40:5;gaussian=3:11:2;median=3:11:2;"
+    "average=3:11:2;brightness=-50:50:10;contrast=0.5:1.5:0.1;sharpen;histeq";
+
+// One evaluated point: BER of the extracted watermark, quality of the attacked image against the original
+struct SweepPoint {
+    std::string attack;
+    double param = 0.0;
+    double ber = 0.0;
+    ImageQuality quality;
+};
+
+struct SweepOptions {
+    int threads = 0;        // points evaluated in parallel (parallel.h); 0 = all cores
+    // Noise attacks: every level draws the same stream, so a curve changes with the level only
+    uint64_t seed = 0;
+};
+
+class AttackSweep {
+public:
+    /**
+     * @param original The image before embedding, CV_8UC1.
+     * @param watermarked The embedded image, same size.
+     * @param bits The embedded watermark.
+     * @param config Extraction settings (scheme, classifier); threads are set per point.
+     * @throws std::invalid_argument on empty, mismatched or non-CV_8UC1 images.
+     */
+    AttackSweep(const cv::Mat& original, const cv::Mat& watermarked, const WatermarkBits& bits, const gbo::Config& config);
+
+    // The attacked image of one point
+    cv::Mat attack(const std::string& name, double param, uint64_t seed = 0) const;
+
+    // Every point of the grid, in grid order
+    std::vector<SweepPoint> run(const std::vector<SweepAxis>& grid, const SweepOptions& options = SweepOptions()) const;
+
+private:
+    cv::Mat watermarked_;
+    SsimReference reference_;
+    JpegImageDct dct_;
+    WatermarkBits bits_;
+    gbo::Config config_;
+};
+
+// CSV with the header attack,param,ber,psnr,ssim,ncc,mse and one row per point
+void writeSweepCsv(std::ostream& out, const std::vector<SweepPoint>& points);
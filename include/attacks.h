@@ -1,16 +1,59 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Random stream of the noise attacks.
+ * Counter-based: value i is a hash of (seed, i), so a batch is computed without a serial
+ * dependency between values, and the noise depends on the seed only - not on the thread or
+ * on the order in which attacks run.
+ */
+class NoiseStream {
+public:
+    explicit NoiseStream(uint64_t seed = 0);
+    // The next n values
+    void fill(uint64_t* out, size_t n);
+    // Values drawn so far
+    uint64_t position() const { return counter_; }
+
+private:
+    uint64_t key_;
+    uint64_t counter_ = 0;
+};
 
 cv::Mat brightnessIncrease(const cv::Mat& image, int value);
 cv::Mat brightnessDecrease(const cv::Mat& image, int value);
 cv::Mat contrastIncrease(const cv::Mat& image, double alpha);
 cv::Mat contrastDecrease(const cv::Mat& image, double alpha);
-cv::Mat saltPepperNoise(const cv::Mat& image, double noiseProb);
-cv::Mat speckleNoise(const cv::Mat& image, double noiseStddev);
+// Noise attacks on CV_8UC1 images; stream values are taken in row-major order.
+// Salt-pepper uses one value per pixel and sets it to 0 or 255 (even odds) with probability
+// noiseProb. Speckle adds Gaussian noise of the given deviation, one value per pair of
+// neighbouring pixels in a row (Box-Muller; an odd last pixel still takes a whole value).
+// The seed overloads run on NoiseStream(seed).
+cv::Mat saltPepperNoise(const cv::Mat& image, double noiseProb, NoiseStream& rng);
+cv::Mat saltPepperNoise(const cv::Mat& image, double noiseProb, uint64_t seed = 0);
+cv::Mat speckleNoise(const cv::Mat& image, double noiseStddev, NoiseStream& rng);
+cv::Mat speckleNoise(const cv::Mat& image, double noiseStddev, uint64_t seed = 0);
 cv::Mat histogramEqualization(const cv::Mat& image);
 cv::Mat sharpening(const cv::Mat& image);
 cv::Mat jpegCompression(const cv::Mat& image, int quality);
 cv::Mat gaussianFiltering(const cv::Mat& image, int ksize);
 cv::Mat medianFiltering(const cv::Mat& image, int ksize);
-cv::Mat averageFiltering(const cv::Mat& image, int ksize);
\ No newline at end of file
+cv::Mat averageFiltering(const cv::Mat& image, int ksize);
+
+// One attack of the evaluation suite: report name, attack function and its parameter.
+// The seed feeds the noise attacks and is ignored by the others.
+struct AttackInfo {
+    std::string name;
+    cv::Mat (*func)(const cv::Mat&, double, uint64_t);
+    double param;
+
+    cv::Mat apply(const cv::Mat& image, uint64_t seed = 0) const { return func(image, param, seed); }
+};
+
+// The attacks every evaluation report runs (main --trials, launchGBO, benchmarks)
+const std::vector<AttackInfo>& standardAttacks();
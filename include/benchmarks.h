@@ -0,0 +1,116 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Benchmarks are run with `main --bench <name> [options]`; each prints a comparison table
+// and returns the process exit code.
+
+// Coefficient-domain JPEG embedding/extraction vs. the decode -> pixel GBO -> re-encode path.
+// Options: [--image path.jpg] [--watermark path] [--quality Q] [--threads N] [--seed S] [--iterations N]
+int runJpegBenchmark(const std::vector<std::string>& args);
+
+// Cost of the native scheme classifier over every block of an image at several input
+// resolutions, against a fixed-scheme GBO embedding of the same image, then one adaptive
+// embed/extract round trip at the model file's size. Agreement is with the first of --sizes.
+// Options: [--model best_scheme_classifier.bin] [--image path] [--watermark path] [--sizes 112,32,16,8]
+//          [--input-size N] [--scheme N] [--threads N] [--seed S] [--iterations N]
+int runClassifierBenchmark(const std::vector<std::string>& args);
+
+// GBO vs. the analytic embedder on the bundled images: embed time, PSNR, SSIM, and BER
+// before and after JPEG compression.
+// Options: [--images a.png,b.png] [--watermark path] [--margin M | --margins 40,60,80] [--quality Q]
+//          [--scheme N] [--threads N] [--seed S] [--iterations N]
+int runFastEmbedBenchmark(const std::vector<std::string>& args);
+
+// Warm-start seeding strategies at reduced GBO budgets against the unseeded baseline
+// (--iterations): embed time, PSNR, and BER clean and averaged over the standard attack suite,
+// then the smallest budget per strategy that stays within the tolerances of the baseline on every image.
+// Options: [--images a.png,b.png] [--budgets 30,20,15,10,5] [--psnr-tolerance dB] [--ber-tolerance B]
+//          [--watermark path] [--scheme N] [--threads N] [--seed S] [--iterations N]
+int runWarmStartBenchmark(const std::vector<std::string>& args);
+
+// Optimizer backends (optimizer.h) on the same sample of real blocks with equal evaluation
+// budgets: share of blocks that reach the BER/PSNR target (losing/winning region sum and
+// block PSNR), median and mean evaluations until then, and the final fitness, PSNR and
+// decoding rate. The budget defaults to what --iterations GBO iterations cost. With --refine
+// STEPS, every backend is also run as a hybrid: --hybrid-evaluations (the initial population
+// and one iteration by default), then the gradient polish.
+// Options: [--image path] [--blocks 64] [--optimizers gbo,de,cmaes] [--evaluations N]
+//          [--refine STEPS] [--hybrid-evaluations 60] [--target-ratio 0.5] [--target-psnr 45]
+//          [--scheme N] [--threads N] [--seed S] [--iterations N]
+int runOptimizerBenchmark(const std::vector<std::string>& args);
+
+// Surrogate screening (OptimizerProblem::surrogate, the relaxed fitness of local_refinement.h)
+// per tolerance against the same search without it, same blocks and random streams: exact
+// evaluations per block and the share saved, mean final fitness and its change, share of
+// blocks that end worse, and decoding rate. A reseeded run without the surrogate shows how
+// much the fitness varies by chance.
+// Options: [--image path] [--blocks 64] [--tolerances 0,0.03,0.1,0.2] [--optimizer gbo|de]
+//          [--evaluations N] [--scheme N] [--threads N] [--seed S] [--iterations N]
+int runSurrogateBenchmark(const std::vector<std::string>& args);
+
+// Static chunking against work stealing (parallel.h), for one image (block loop) and for a
+// batch of copies embedded in parallel (image loop with nested block loops): wall time,
+// thread time inside tasks, tail idle time (threads out of work before their loop ended)
+// in ms and as a share of threads x wall time, and chunks stolen. Add --surrogate,
+// --block-time-budget and similar options to make the per-block cost uneven.
+// Options: [--image path] [--watermark path] [--batch 4] [--threads N] [--seed S] [--iterations N]
+//          [--method gbo|analytic] [--surrogate] [--block-time-budget MS]
+int runSchedulerBenchmark(const std::vector<std::string>& args);
+
+// Lockstep GBO (lockstep_gbo.h) against the one-block search: cost of one fitness evaluation
+// with calcFitnessValue and with the batched kernel on the same candidates (and the largest
+// difference between them), then a whole-image embedding either way: time, PSNR, clean BER
+// and exact evaluations per block.
+// Options: [--image path] [--watermark path] [--rounds 200] [--warm-start none|analytic]
+//          [--scheme N] [--threads N] [--seed S] [--iterations N] [--refine STEPS]
+int runLockstepBenchmark(const std::vector<std::string>& args);
+
+// Block scratch memory from the thread arenas (block_arena.h) against one heap block per buffer,
+// embedding the same image both ways: time, heap calls in all (glibc only) and per block,
+// resident and peak resident memory, and the arenas' own counters (buffers handed out, scope
+// resets, chunks taken from the heap, memory reserved, most handed out by one arena at once).
+// Options: [--image path] [--watermark path] [--threads N] [--seed S] [--iterations N]
+//          [--method gbo|analytic] [--optimizer NAME]
+int runArenaBenchmark(const std::vector<std::string>& args);
+
+// Image quality metrics of an image against each standard attack of it: one computePSNR,
+// computeSSIM, computeNCC and computeMSE call per pair against one computeImageQuality, per pair
+// in ms, with the largest difference between the two, and computeImageQuality without SSIM;
+// then computeSSIM against SsimReference::compare on one thread and on all cores.
+// Options: [--image path] [--rounds 5]
+int runMetricsBenchmark(const std::vector<std::string>& args);
+
+// The seeded salt-pepper and speckle attacks (attacks.h) against the previous rand() / cv::randn
+// versions, ms per call; then a batch of copies attacked in parallel, one seed each, checked
+// against the same copies attacked serially.
+// Options: [--image path] [--rounds 20] [--threads N]
+int runNoiseBenchmark(const std::vector<std::string>& args);
+
+// The in-process JPEG simulator (jpeg_simulator.h) against a cv::imencode + cv::imdecode round
+// trip per quality: ms per image on one thread and on --threads, us per block through
+// compressBlock, and pixels that differ from the codec's output (expected: none).
+// Options: [--image path] [--qualities 50,70,80,90] [--rounds 10] [--threads N]
+int runJpegAttackBenchmark(const std::vector<std::string>& args);
+
+// GBO embedding with and without the robustness term of the fitness (robust_fitness.h): embed
+// time, PSNR, BER, and BER after each of the attacks applied to the whole image.
+// Options: [--image path] [--watermark path] [--robust jpeg:70] [--robust-weight 1] [--iterations N]
+//          [--lockstep] [--scheme N] [--threads N] [--seed S]
+int runRobustBenchmark(const std::vector<std::string>& args);
+
+// The attack sweep engine (attack_sweep.h) against evaluating the same grid point by point on
+// one thread through the codec and uncached metrics: total ms of both and points whose BER
+// differs (expected: none). Embeds analytically by default to keep the run short.
+// Options: [--image path] [--watermark path] [--grid SPEC] [--method analytic] [--threads N] [--seed S]
+//          [--csv out.csv]
+int runSweepBenchmark(const std::vector<std::string>& args);
+
+// An attack plan (attack_plan.h) evaluated as a shared DAG against recomputing every tau node
+// from the copy along its own chain: attacks run, ms per copy, and tau images that differ
+// (expected: none). The default plan chains contrast, brightness, median and JPEG (30 nodes).
+// Options: [--image path] [--plan file] [--rounds 3] [--threads N]
+int runAttackPlanBenchmark(const std::vector<std::string>& args);
+
+// Dispatches to the benchmark with the given name; unknown names print the list
+int runBenchmark(const std::string& name, const std::vector<std::string>& args);
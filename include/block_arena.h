@@ -0,0 +1,98 @@
+#pragma once
+// Per-thread scratch memory for the block-level kernels.
+//
+// Scoring one candidate takes a handful of 8x8 buffers (pixel and DCT matrices, Armadillo
+// temporaries of GBO's update), tens of thousands of times per block. Taken from the heap,
+// that is a stream of small malloc/free pairs that threads contend on. The kernels instead
+// take them from the calling thread's BlockArena, a bump allocator over a few chunks that
+// are kept for the life of the thread, inside an ArenaScope that gives the memory back when
+// the kernel returns. The embedders open one scope per block, so everything a block's search
+// took is released at once when it ends.
+#include <armadillo>
+#include <cstddef>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+class BlockArena {
+public:
+    // The calling thread's arena
+    static BlockArena& local();
+
+    BlockArena();
+    ~BlockArena();
+    BlockArena(const BlockArena&) = delete;
+    BlockArena& operator=(const BlockArena&) = delete;
+
+    // 64-byte aligned memory, valid until the innermost open ArenaScope of this thread closes
+    void* allocate(size_t bytes);
+    // Continuous matrix / column vector over arena memory. Neither owns nor frees its data,
+    // neither may outlive the scope, and the vector keeps its size (Armadillo "strict" memory).
+    cv::Mat mat(int rows, int cols, int type);
+    arma::vec vec(arma::uword size);
+
+    struct Counters;    // this arena's share of ArenaStats
+
+private:
+    friend class ArenaScope;
+    struct Chunk {
+        unsigned char* data;
+        size_t size;
+    };
+    struct Mark {
+        size_t chunk;
+        size_t offset;
+        size_t heap;
+    };
+    Mark mark() const { return {chunk_, offset_, heap_.size()}; }
+    void rewind(const Mark& mark);
+    void* fromChunks(size_t bytes);
+
+    std::vector<Chunk> chunks_;
+    size_t chunk_ = 0;          // chunk the next allocation comes from
+    size_t offset_ = 0;         // bytes used in it
+    size_t before_ = 0;         // bytes of the chunks before it
+    std::vector<void*> heap_;   // arena switched off: one heap block per allocation
+    int depth_ = 0;             // open scopes
+    Counters* counters_;
+};
+
+// Gives back everything the thread's arena handed out since construction. Scopes nest; the
+// outermost one closing resets the arena (ArenaStats::resets).
+class ArenaScope {
+public:
+    ArenaScope();
+    ~ArenaScope();
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    BlockArena& arena_;
+    BlockArena::Mark mark_;
+};
+
+// Counters over all threads' arenas since the process started; diff two snapshots to measure a run
+struct ArenaStats {
+    size_t allocations = 0;     // buffers handed out
+    size_t resets = 0;          // outermost scopes closed, at least one per block
+    size_t heap_calls = 0;      // chunks (or, switched off, buffers) taken from the heap
+    size_t reserved_bytes = 0;  // chunk memory held right now
+    size_t peak_bytes = 0;      // most memory one arena had handed out at once
+};
+
+ArenaStats arenaStats();
+
+// Process-wide, on by default. Off, every allocation is its own heap block freed when its scope
+// closes, which is how the kernels used memory before; meant for benchmarks comparing the two.
+void setArenaEnabled(bool enabled);
+bool arenaEnabled();
+
+// Heap calls of the whole process, counted by the malloc family wrappers of the preload module
+// libgbo_malloc_counters.so (src/malloc_counters.cpp, glibc only). `available` is false
+// unless the process was started with it in LD_PRELOAD.
+struct MallocCounters {
+    bool available = false;
+    size_t allocations = 0;     // malloc, calloc, realloc(nullptr), posix_memalign, aligned_alloc, memalign
+    size_t frees = 0;
+};
+
+MallocCounters mallocCounters();
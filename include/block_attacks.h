@@ -0,0 +1,38 @@
+#pragma once
+// Block-level attacks for the robustness term of the embedding search (robust_fitness.h).
+// They only need the 8x8 block itself, so every candidate can be checked against them while
+// it is searched. Depends on the standard library only, like gbo_api.h.
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct BlockAttack {
+    enum class Kind {
+        Jpeg,       // quantization of the DCT with the luminance table at quality `param` (jpeg_simulator.h)
+        Gain,       // every pixel times `param`, rounded and clamped (contrast change)
+        Offset,     // `param` added to every pixel, clamped (brightness change)
+        Average,    // 3x3 box filter
+        Gaussian,   // 3x3 Gaussian filter, the [1 2 1] / 4 kernel cv::GaussianBlur uses for ksize 3
+        Sharpen,    // 3x3 Laplacian sharpening, the kernel of attacks.h
+    };
+    Kind kind = Kind::Jpeg;
+    double param = 0.0;     // quality, gain or offset; unused by the filters
+};
+
+// The robustness term costs one forward DCT per pixel-domain attack and evaluation; this
+// bounds it at a few times the clean fitness
+const size_t max_block_attacks = 4;
+
+/**
+ * @brief Parses a comma-separated attack list: "jpeg:70,gain:1.2,offset:-30,average,gaussian,sharpen".
+ * @throws std::invalid_argument on an unknown name, a missing or out-of-range parameter, or
+ * more than max_block_attacks attacks.
+ */
+std::vector<BlockAttack> parseBlockAttacks(const std::string& spec);
+
+// Throws std::invalid_argument (message prefixed with `prefix`) for more than max_block_attacks
+// attacks or a parameter out of range: JPEG quality in [1, 100], gain positive
+void validateBlockAttacks(const std::vector<BlockAttack>& attacks, const std::string& prefix);
+
+// Inverse of parseBlockAttacks for one attack, e.g. "jpeg:70"
+std::string blockAttackName(const BlockAttack& attack);
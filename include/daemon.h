@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Wire protocol of the local embed/extract daemon.
+//
+// Every message is a frame: a little-endian uint32 payload length followed by
+// the payload. Images travel inline as encoded bytes (PNG, JPEG, ...), so no
+// files are exchanged between the client and the server.
+// ---------------------------------------------------------------------------
+
+const uint8_t daemon_protocol_version = 1;
+const uint32_t daemon_max_frame_size = 64u * 1024u * 1024u;
+
+enum class DaemonOp : uint8_t {
+    Ping     = 0,
+    Embed    = 1,  // blobs: {image, watermark}        -> image: watermarked PNG; values: blocks cut short by
+                   //   the deadline, their smallest decode margin (see gbo::BudgetOverrun)
+    Extract  = 2,  // blobs: {image}                   -> image: extracted 32x32 PNG
+    Evaluate = 3   // blobs: {original, test, watermark} -> values: BER, PSNR, SSIM, NCC, MSE
+};
+
+enum class DaemonStatus : uint8_t {
+    Ok               = 0,
+    Error            = 1,
+    BadRequest       = 2,
+    DeadlineExceeded = 3,
+    Overloaded       = 4
+};
+
+struct DaemonRequest {
+    uint64_t id = 0;
+    DaemonOp op = DaemonOp::Ping;
+    int32_t scheme = 0;
+    uint32_t deadline_ms = 0;  // relative to arrival at the server, 0 = no deadline
+    std::vector<std::vector<unsigned char>> blobs;
+};
+
+struct DaemonResponse {
+    uint64_t id = 0;
+    DaemonStatus status = DaemonStatus::Ok;
+    uint64_t queue_us = 0;    // time spent waiting for a worker
+    uint64_t service_us = 0;  // time spent processing
+    std::string message;
+    std::vector<unsigned char> image;
+    std::vector<double> values;
+};
+
+const char* daemonOpName(DaemonOp op);
+const char* daemonStatusName(DaemonStatus status);
+
+std::vector<unsigned char> encodeDaemonRequest(const DaemonRequest& request);
+std::vector<unsigned char> encodeDaemonResponse(const DaemonResponse& response);
+// Both decoders return false on truncated or malformed payloads
+bool decodeDaemonRequest(const std::vector<unsigned char>& payload, DaemonRequest& request);
+bool decodeDaemonResponse(const std::vector<unsigned char>& payload, DaemonResponse& response);
+
+// Blocking frame I/O on a connected stream socket; false on EOF or error
+bool readDaemonFrame(int fd, std::vector<unsigned char>& payload);
+bool writeDaemonFrame(int fd, const std::vector<unsigned char>& payload);
+
+// ---------------------------------------------------------------------------
+// Server
+// ---------------------------------------------------------------------------
+
+struct DaemonOptions {
+    std::string socket_path = "/tmp/gbo.sock";
+    int workers = 0;              // 0 = std::thread::hardware_concurrency()
+    size_t queue_capacity = 64;   // pending requests before the server answers Overloaded
+    size_t watermark_cache = 16;  // decoded watermarks kept in memory
+};
+
+/**
+ * @brief Serves embed/extract/evaluate requests on a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * A fixed pool of worker threads is started once and kept warm for the whole
+ * lifetime of the server; connections may pipeline any number of requests.
+ *
+ * @return int Process exit code.
+ */
+int runDaemon(const DaemonOptions& options);
+
+// ---------------------------------------------------------------------------
+// Client
+// ---------------------------------------------------------------------------
+
+class DaemonClient {
+public:
+    explicit DaemonClient(const std::string& socket_path);
+    ~DaemonClient();
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    // Sends the request and waits for its response; throws std::runtime_error on I/O failure
+    DaemonResponse call(DaemonRequest request);
+
+private:
+    int fd_ = -1;
+    uint64_t next_id_ = 1;
+};
+
+std::vector<unsigned char> readFileBytes(const std::string& path);
+void writeFileBytes(const std::string& path, const std::vector<unsigned char>& bytes);
+
+struct LoadTestOptions {
+    std::string socket_path = "/tmp/gbo.sock";
+    DaemonOp op = DaemonOp::Extract;
+    int requests = 100;
+    int concurrency = 4;
+    int scheme = 0;
+    uint32_t deadline_ms = 0;
+    std::string image_path = "images/pepper.png";
+    std::string watermark_path = "images/watermark.png";
+};
+
+struct LoadTestReport {
+    int sent = 0;
+    int ok = 0;
+    int failed = 0;
+    int deadline_exceeded = 0;
+    double wall_seconds = 0.0;
+    double throughput = 0.0;       // completed requests per second
+    double latency_mean_ms = 0.0;  // client-observed round trip
+    double latency_p50_ms = 0.0;
+    double latency_p90_ms = 0.0;
+    double latency_p99_ms = 0.0;
+    double latency_max_ms = 0.0;
+    double server_queue_mean_ms = 0.0;
+    double server_service_mean_ms = 0.0;
+
+    void print() const;
+};
+
+// Runs `requests` calls spread over `concurrency` connections and measures latency and throughput
+LoadTestReport runDaemonLoadTest(const LoadTestOptions& options);
@@ -1,6 +1,9 @@
 #pragma once
 #include <opencv2/opencv.hpp>
+#include "attack_plan.h"
 #include "gbo.h"
+#include <cstdint>
+#include <string>
 #include <vector>
 #include <algorithm>
 
@@ -27,11 +30,13 @@ const std::vector<std::string> images = {
  * @param src      Grayscale source image (type CV_8UC1, size multiple of 8).
  * @param bit      Bit value to embed (must be 0 or 1).
  * @param scheme   Embedding scheme index (0 or 1) determining coefficient regions.
+ * @param seed     Non-zero: block i is searched with its own stream derived from (seed, i), so
+ *                 the result does not depend on the thread count. 0 leaves the generators unseeded.
  * @return cv::Mat Image of the same size/type as src with the embedded bit.
  *
  * @throws std::invalid_argument if input image is empty, not CV_8UC1, or size not divisible by 8.
  */
-cv::Mat embedUniformBits(const cv::Mat& src, unsigned char bit, int scheme = 0);
+cv::Mat embedUniformBits(const cv::Mat& src, unsigned char bit, int scheme = 0, uint64_t seed = 0);
 
 // Types of attacks available in attacks.h
 enum class AttackType {
@@ -56,10 +61,72 @@ enum class AttackType {
  * @param type     Attack type (see AttackType).
  * @param param1   First parameter (meaning depends on attack).
  * @param param2   Second parameter (meaning depends on attack).
+ * @param seed     Noise stream of the salt-pepper and speckle attacks (see NoiseStream).
  * @return cv::Mat Attacked image.
  */
-cv::Mat simulateAttack(const cv::Mat& src, AttackType type, double param1 = 10.0, int param2 = 3);
+cv::Mat simulateAttack(const cv::Mat& src, AttackType type, double param1 = 10.0, int param2 = 3, uint64_t seed = 0);
 
 // Build dataset using embedding and attacks
 auto buildDataset(int tau_max = 2) -> void;
 
+/**
+ * @brief Builds the dataset with the attacks of a plan (attack_plan.h).
+ * Every embedded copy goes through the plan once; a block's tau for a scheme counts the wrong
+ * bits over the plan's tau nodes of both bit copies. buildDataset(tau_max) runs AttackPlan::defaultPlan().
+ *
+ * Images are committed one at a time: their blocks and per-block tau (dataset/tau/) are staged
+ * and renamed into place, then dataset/checkpoint.txt records the image. The checkpoint is
+ * removed once the run completes. A run that does not resume first deletes Dir1/Dir2/Dirrand and
+ * tau/ of an earlier one.
+ * @param seed Every image draws its own stream, derived from the seed and its position in
+ * `images`, for the embedding and the noise attacks. 0 draws a seed; it is checkpointed.
+ * @param resume Continue the checkpointed run: committed images are skipped, blocks of an image
+ * whose commit was cut off are deleted, and the numbering, seed and streams continue as if the
+ * run had not stopped. Throws std::runtime_error without a checkpoint, or if the plan, tau_max or
+ * a non-zero seed differ from it.
+ */
+void buildDataset(const AttackPlan& plan, int tau_max = 2, uint64_t seed = 0, bool resume = false);
+
+// The images of `images` one process builds: shard `index` of `count`
+struct DatasetShard {
+    int index = 0;
+    int count = 1;
+    // false: a contiguous range of the list; true: the images whose path hashes to `index`
+    // modulo `count`, which keeps a shard's images when others are added to the list
+    bool hash = false;
+
+    bool contains(size_t image_index) const;
+};
+
+// "k/n" (range) or "hash:k/n"; throws std::invalid_argument unless 0 <= k < n
+DatasetShard parseDatasetShard(const std::string& spec);
+
+// Blocks per class
+struct DatasetCounts {
+    int dir1 = 0;
+    int dir2 = 0;
+    int dirrand = 0;
+};
+
+/**
+ * @brief Builds the shard's images into `output_dir`, for mergeDatasetShards.
+ * Blocks are named after their image and block index (Dir1/0003_000042.png) instead of a running
+ * count, so shards share no state. Checkpoints and `resume` work as in buildDataset, with
+ * `output_dir`/checkpoint.txt; once the shard is finished the checkpoint is renamed to shard.txt,
+ * which lists the shard, the corpus, tau_max, the seed, a digest of the plan and the blocks per
+ * class of every image. A directory without shard.txt is an unfinished shard. The shards of one
+ * build need the same non-zero seed.
+ */
+DatasetCounts buildDatasetShard(const AttackPlan& plan, int tau_max, const DatasetShard& shard,
+                                const std::string& output_dir, uint64_t seed = 0, bool resume = false);
+
+/**
+ * @brief Merges the shards of one build into Dir1/Dir2/Dirrand and tau/ of `output_dir`.
+ * Blocks are renumbered in image and block order, so the result is the one of
+ * buildDataset(plan, tau_max, seed) in a single process. Like a fresh build, the merge first
+ * clears whatever those directories held; nothing is touched if the shards are rejected.
+ * @throws std::runtime_error if a shard is unfinished, the shards were built with different
+ * settings or corpus, a shard is missing or given twice, a shard's files do not match its list,
+ * or `output_dir` is one of the shards.
+ */
+DatasetCounts mergeDatasetShards(const std::vector<std::string>& shard_dirs, const std::string& output_dir = "dataset");
@@ -0,0 +1,12 @@
+#pragma once
+// Defaults shared by the public API (gbo_api.h) and the engines behind it. Standard library
+// only, like gbo_api.h, so that Config can be initialised from the same constants.
+
+// Slack for surrogate screening: how much worse than the point it would replace a candidate
+// may look and still get an exact evaluation. The smallest tolerance of `--bench surrogate`
+// whose mean fitness loss stays within the noise of a reseeded run (README)
+const double default_surrogate_tolerance = 0.2;
+
+// Margin, in DCT units, that analytic embedding leaves between the two region sums. The
+// smallest margin of `--bench fast-embed` whose worst BER after JPEG 80 beats GBO's (README)
+const double default_analytic_margin = 80.0;
@@ -2,6 +2,23 @@
 #include "population.h"
 #include "random_utils.h"
 #include <cmath>
+#include <functional>
+
+// Random draws of one gradient search rule (calculate_gsr in gbo.cpp)
+struct GsrDraws {
+    double a, b, c, eps, p1, p2, q1, q2, d;
+};
+
+// Everything GBO draws for one candidate. LEO values are neutral when LEO does not fire.
+struct GboStepDraws {
+    double rho1, rho2, dm1, dm2, dm3, dm4, rho1_next, ra, rb;
+    int r[4];
+    GsrDraws gsr1, gsr2;
+    bool leo;
+    double u1, u2, u3, l2, f1, f2;
+    bool y_next;
+    int partner;
+};
 
 class GBO {
 private:
@@ -11,10 +28,26 @@ private:
     static constexpr double angle       = 1.5 * PI;
     static constexpr double PR          = 0.5; // Probability of LEO
     const int iterations                = 40;
+    friend class LockstepGbo;   // same constants, several blocks at once (lockstep_gbo.h)
 
 public:
     GBO() = default;
+    explicit GBO(int iterations) : iterations(iterations) {}
     Population population;
     double th = population.get_th();
+    std::vector<arma::vec> seeds;   // warm-start vectors placed in the initial population of the next run
+    arma::vec best;                 // best vector found by the last run
+    std::function<bool()> stop;     // polled before every candidate of evolve(); true ends the run
     cv::Mat main_loop(cv::Mat& block, int vector_size, unsigned char bit, int scheme = 0, bool verbose = false);
+    arma::vec optimize(int vector_size, const Population::FitnessFunction& fitness);
+    void evolve(Population& population, const std::function<void(int)>& after_iteration = nullptr);
+
+    /**
+     * @brief Makes the draws of one candidate from `random`, in the order of the reference GBO.
+     * evolve takes them from threadRandom(); LockstepGbo from each lane's stream, so both
+     * follow the same sequence.
+     * @param x_rand Receives LEO's random vector, n values `stride` apart, when LEO fires.
+     */
+    static void drawStep(RandomStream& random, double alpha, int population_size, int best, int current,
+                         double th, int n, double* x_rand, size_t stride, GboStepDraws& draws);
 };
\ No newline at end of file
@@ -0,0 +1,255 @@
+#pragma once
+// Public buffer-based API of libgbo.
+//
+// The functions below work directly on caller-owned 8-bit grayscale pixel
+// buffers: no file system access and no copy of the image is made. The header
+// intentionally depends on the C++ standard library only, so services can link
+// libgbo without pulling OpenCV or Armadillo into their own headers.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "block_attacks.h"
+#include "embed_defaults.h"
+#include "jpeg_coefficients.h"
+#include "watermark_bits.h"
+
+class SchemeClassifier;
+
+namespace gbo {
+
+// How embed() finds the coefficient change for a block
+enum class Method {
+    Gbo,        // iterative search with the `optimizer` backend (GBO by default)
+    Analytic,   // closed-form minimal-distortion change with rounding fix-up (analytic_embed.h)
+};
+
+// How the search is seeded (Method::Gbo only). For GBO the seeds replace a few of the
+// random individuals and the rest of the population stays random.
+enum class WarmStart {
+    None,       // all individuals random
+    Analytic,   // plus the analytic vector of the block (see analytic_embed.h)
+    Raster,     // plus the best vector of the left neighbour; rows run in parallel
+    Wavefront,  // plus the best vectors of the left and upper neighbours; anti-diagonals run in parallel
+};
+
+// Lets another thread stop a running embed() or extraction; see Config::cancellation
+class CancellationToken {
+public:
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+
+// Passed to Config::progress after every embedded block
+struct EmbedProgress {
+    size_t blocks_done = 0;
+    size_t blocks = 0;
+    size_t out_of_budget = 0;   // blocks so far whose search a deadline or cancellation cut short
+    double elapsed_ms = 0.0;    // since embed() was called
+};
+
+struct Config {
+    int scheme = 0;        // embedding scheme index (0 or 1)
+    uint64_t seed = 0;     // 0 = nondeterministic; otherwise results depend only on the seed
+    int threads = 1;       // worker threads used over blocks, 0 = hardware concurrency
+    int iterations = 40;   // GBO iteration budget per 8x8 block
+    Method method = Method::Gbo;
+    // Method::Gbo: search backend, "gbo", "de" or "cmaes" (see optimizer.h), and its fitness
+    // evaluations per block; 0 = what `iterations` GBO iterations cost, 30 * (iterations + 1)
+    std::string optimizer = "gbo";
+    size_t evaluations = 0;
+    // Method::Gbo: projected-gradient steps that polish the search result on the relaxed
+    // (pre-rounding) fitness, checked with a few exact evaluations (local_refinement.h); 0 = off.
+    // With refinement a short search (a few iterations) is usually enough.
+    int refine_steps = 0;
+    // Method::Gbo: screen candidates with the relaxed fitness and skip the exact evaluation of
+    // those predicted worse than what they would replace by more than surrogate_tolerance.
+    // The search keeps its schedule; only exact evaluations are saved (EmbedStats counts them).
+    // CMA-ES ignores it.
+    bool surrogate = false;
+    double surrogate_tolerance = default_surrogate_tolerance;
+    // Method::Gbo with optimizer "gbo", pixel images: search blocks of one scheme in groups of
+    // lockstep_lanes, one SIMD lane per block (lockstep_gbo.h). Needs warm_start None or Analytic;
+    // the surrogate is ignored and block_time_budget_ms limits the search of a whole group.
+    // Seeded results differ from the one-block search but still depend only on the seed.
+    bool lockstep = false;
+    // Method::Gbo, pixel images: attacks every candidate is checked against while it is searched
+    // (robust_fitness.h); the fitness gains robustness_weight times the worst ratio of losing to
+    // winning region sum after them. The surrogate and refinement model the clean fitness only,
+    // their exact checks include the term. Empty = off.
+    std::vector<BlockAttack> robustness_attacks;
+    double robustness_weight = 1.0;
+    // Method::Gbo: time limits, 0 = none. When one passes, the search of a block stops and keeps
+    // the best vector found so far (GBO always finishes its initial population). Blocks that
+    // start after the image deadline get the analytic embedding with `margin` instead, so the
+    // whole watermark is still written. EmbedStats::out_of_budget lists the affected blocks.
+    // A limit that fires makes the result depend on timing, whatever the seed.
+    double time_budget_ms = 0.0;        // whole image, from the call to embed()
+    double block_time_budget_ms = 0.0;  // search of one block
+    // Cancelling acts like the image deadline passing for embed(); extract() and extractBlind()
+    // throw std::runtime_error instead. The token may be shared between calls.
+    std::shared_ptr<const CancellationToken> cancellation;
+    // Called after every block, from the worker threads but never concurrently
+    std::function<void(const EmbedProgress&)> progress;
+    WarmStart warm_start = WarmStart::None;
+    double margin = default_analytic_margin;  // Analytic: |s1 - s0| every block must decode with, in DCT units
+    // When set, pixel embed/extract choose the scheme per block with this classifier
+    // (see scheme_classifier.h) and `scheme` is ignored
+    std::shared_ptr<const SchemeClassifier> classifier;
+};
+
+// A block whose search a deadline or cancellation cut short
+struct BudgetOverrun {
+    size_t block = 0;       // raster index
+    bool searched = false;  // false: started after the image deadline and embedded analytically
+    double margin = 0.0;    // winning minus losing region sum after embedding, DCT units; <= 0 decodes wrong
+};
+
+// What embed() did; the scheme counters only differ from the trivial ones in adaptive mode
+struct EmbedStats {
+    size_t blocks = 0;
+    size_t scheme_blocks[2] = {0, 0};   // blocks finally embedded with scheme 0 / 1
+    size_t reembedded = 0;              // blocks re-embedded because the extractor would pick the other scheme
+    size_t inconsistent = 0;            // blocks whose scheme the extractor still gets wrong
+    size_t evaluations = 0;             // exact fitness evaluations of the search, all blocks
+    size_t screened = 0;                // candidates the surrogate rejected without one
+    bool cancelled = false;             // Config::cancellation fired during the call
+    std::vector<BudgetOverrun> out_of_budget;   // by block index
+};
+
+// Result of extractBlind(): which scheme the image was most likely embedded with
+struct BlindExtraction {
+    int scheme = 0;             // detected scheme; the returned bits were read with it
+    double confidence = 0.0;    // 0 = no scheme explains the image better than chance, 1 = only the detected one does
+    double consistency[2] = {}; // per scheme: share of the block margin variance explained by the bit index, above chance
+    double agreement[2] = {};   // per scheme: share of blocks that agree with their bit's majority vote
+    double margin[2] = {};      // per scheme: mean |s1 - s0| / (s1 + s0) over the blocks
+};
+
+// Mutable view of a CV_8UC1-like image; stride is the distance in bytes between rows
+struct ImageView {
+    unsigned char* data = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+};
+
+struct ConstImageView {
+    const unsigned char* data = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+
+    ConstImageView() = default;
+    ConstImageView(const unsigned char* data, int width, int height, size_t stride)
+        : data(data), width(width), height(height), stride(stride) {}
+    ConstImageView(const ImageView& view)
+        : data(view.data), width(view.width), height(view.height), stride(view.stride) {}
+};
+
+// Fitness evaluations embed() lets one block's search spend: config.evaluations, or what
+// config.iterations GBO iterations cost, population_size * (iterations + 1)
+size_t blockBudget(const Config& config);
+
+/**
+ * @brief Embeds watermark bits into the image in place.
+ *
+ * The image is processed as 8x8 blocks in row-major order; block i carries
+ * bits[i % bit_count], so every bit is repeated over the image.
+ *
+ * With config.classifier set, every block uses the scheme the classifier predicts for it.
+ * The extractor only sees the watermarked block, so after embedding all blocks are
+ * classified again; a block the classifier now assigns to the other scheme is re-embedded
+ * with that scheme, which makes the extractor's choice match the embedder's.
+ *
+ * @param image      Image buffer; width and height must be multiples of 8.
+ * @param bits       One byte per bit (0 or non-zero).
+ * @param bit_count  Number of bits, at most the number of 8x8 blocks.
+ * @param config     Scheme, seed, threads, method, optimizer and its budget or margin,
+ *                   time limits, cancellation and progress reporting.
+ * @throws std::invalid_argument on invalid buffers or configuration.
+ */
+EmbedStats embed(const ImageView& image, const unsigned char* bits, size_t bit_count, const Config& config = Config());
+
+/**
+ * @brief Extracts bit_count watermark bits by majority vote over all copies of each bit.
+ *
+ * Ties are broken randomly (reproducibly when config.seed is set). With config.classifier
+ * set, every block is read with the scheme the classifier predicts for it.
+ *
+ * @param image      Watermarked image buffer; width and height must be multiples of 8.
+ * @param bits       Output, one byte per bit (0 or 1).
+ * @param bit_count  Number of bits, at most the number of 8x8 blocks.
+ * @throws std::invalid_argument on invalid buffers or configuration.
+ */
+void extract(const ConstImageView& image, unsigned char* bits, size_t bit_count, const Config& config = Config());
+
+/**
+ * @brief Extracts bit_count watermark bits without knowing the embedding scheme.
+ *
+ * Every block is transformed once and the s1/s0 region sums of both schemes are taken
+ * from the same coefficients. Under the scheme that was really used, the normalized
+ * margin (s1 - s0) / (s1 + s0) of a block is decided by the bit it carries, so copies of
+ * one bit agree with each other and disagree with copies of the opposite bit. Under the
+ * other scheme, or on an unmarked image, the margins follow the image content instead.
+ * The scheme whose margins are best explained by the bit index wins. The confidence
+ * compares the two schemes and is only meaningful when every bit has several copies.
+ * config.scheme is ignored.
+ *
+ * @param image      Watermarked image buffer; width and height must be multiples of 8.
+ * @param bits       Output, one byte per bit (0 or 1), read with the detected scheme.
+ * @param bit_count  Number of bits, at most the number of 8x8 blocks.
+ * @throws std::invalid_argument on invalid buffers or configuration, or when config.classifier is set.
+ */
+BlindExtraction extractBlind(const ConstImageView& image, unsigned char* bits, size_t bit_count,
+                             const Config& config = Config());
+
+/**
+ * @brief Embeds watermark bits directly into the luminance DCT coefficients of a JPEG.
+ *
+ * Nothing is decoded to pixels: region sums and the GBO objective are evaluated on
+ * dequantized coefficients, and every candidate is re-quantized with the file's own
+ * table. Block i of the luminance component carries bits[i % bit_count], as in embed().
+ *
+ * @param image      Coefficients read with JpegCoefficientImage; modified in place.
+ * @param bits       One byte per bit (0 or non-zero).
+ * @param bit_count  Number of bits, at most the number of luminance blocks.
+ * @param config     Scheme, seed, threads and iteration budget; adaptive (classifier) mode is not supported.
+ * @return Search statistics and the blocks that ran out of time, as for the pixel overload.
+ * @throws std::invalid_argument on invalid bits or configuration.
+ */
+EmbedStats embed(JpegCoefficientImage& image, const unsigned char* bits, size_t bit_count, const Config& config = Config());
+
+/**
+ * @brief Extracts bit_count watermark bits from the luminance coefficients of a JPEG by majority vote.
+ * @throws std::invalid_argument on invalid bits or configuration.
+ */
+void extract(const JpegCoefficientImage& image, unsigned char* bits, size_t bit_count, const Config& config = Config());
+
+// Blind extraction from the luminance coefficients of a JPEG; see the pixel overload
+BlindExtraction extractBlind(const JpegCoefficientImage& image, unsigned char* bits, size_t bit_count,
+                             const Config& config = Config());
+
+// The same functions on packed bits (watermark_bits.h): the watermark size is bits.size(),
+// and extraction votes with bit-sliced counters straight into `bits`. These do the work;
+// the byte overloads above pack or unpack around them.
+EmbedStats embed(const ImageView& image, const WatermarkBits& bits, const Config& config = Config());
+void extract(const ConstImageView& image, WatermarkBits& bits, const Config& config = Config());
+BlindExtraction extractBlind(const ConstImageView& image, WatermarkBits& bits, const Config& config = Config());
+EmbedStats embed(JpegCoefficientImage& image, const WatermarkBits& bits, const Config& config = Config());
+void extract(const JpegCoefficientImage& image, WatermarkBits& bits, const Config& config = Config());
+BlindExtraction extractBlind(const JpegCoefficientImage& image, WatermarkBits& bits, const Config& config = Config());
+
+// Convenience wrappers over complete JPEG files held in memory
+std::vector<unsigned char> embedJpeg(const std::vector<unsigned char>& jpeg, const unsigned char* bits, size_t bit_count,
+                                     const Config& config = Config());
+void extractJpeg(const std::vector<unsigned char>& jpeg, unsigned char* bits, size_t bit_count,
+                 const Config& config = Config());
+
+} // namespace gbo
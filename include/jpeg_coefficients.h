@@ -0,0 +1,50 @@
+#pragma once
+// Lossless access to the quantized DCT coefficients of a JPEG file through
+// libjpeg's coefficient API (jpeg_read_coefficients / jpeg_write_coefficients).
+// No pixel decode or re-encode takes place, so unmodified blocks are written
+// back bit-exactly and modified ones suffer no extra generation loss.
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct JpegComponent {
+    int width_in_blocks = 0;
+    int height_in_blocks = 0;
+    std::array<uint16_t, 64> quant{};   // quantization table, natural (row-major) order
+    std::vector<int16_t> coefficients;  // 64 per block, blocks in raster order, natural order inside a block
+
+    int16_t* block(int row, int col) { return &coefficients[(static_cast<size_t>(row) * width_in_blocks + col) * 64]; }
+    const int16_t* block(int row, int col) const { return &coefficients[(static_cast<size_t>(row) * width_in_blocks + col) * 64]; }
+    size_t blockCount() const { return static_cast<size_t>(width_in_blocks) * height_in_blocks; }
+};
+
+class JpegCoefficientImage {
+public:
+    static JpegCoefficientImage fromBytes(std::vector<unsigned char> bytes);
+    static JpegCoefficientImage fromFile(const std::string& path);
+
+    JpegCoefficientImage(JpegCoefficientImage&&) noexcept;
+    JpegCoefficientImage& operator=(JpegCoefficientImage&&) noexcept;
+    ~JpegCoefficientImage();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    // Re-encodes the (possibly modified) coefficients with the source's quantization
+    // tables, sampling factors and markers; entropy coding is the only work done
+    std::vector<unsigned char> encode() const;
+    void save(const std::string& path) const;
+
+    // components[0] is luminance (the only component of grayscale JPEGs)
+    std::vector<JpegComponent> components;
+
+private:
+    struct Source;
+    explicit JpegCoefficientImage(std::unique_ptr<Source> source);
+
+    std::unique_ptr<Source> source_;
+    int width_ = 0;
+    int height_ = 0;
+};
@@ -0,0 +1,78 @@
+#pragma once
+// In-process JPEG attack: what encoding an 8-bit grayscale image at some quality and decoding
+// it again does to its pixels, without the codec around it.
+//
+// Only the lossy steps are simulated: level shift, forward DCT, quantization, dequantization,
+// inverse DCT and clamping. Huffman coding is lossless and skipped. The transforms are libjpeg's
+// integer ("islow") ones, the default of both libjpeg and libjpeg-turbo, so the result is
+// pixel-for-pixel what cv::imencode + cv::imdecode return. This was checked against
+// libjpeg-turbo 2.1 for every quality on images of several sizes. Encoders set to the IFAST or
+// FLOAT DCT are not modelled.
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// Luminance table of jpeg_set_quality(quality, force_baseline = TRUE): the Annex K table
+// scaled by the IJG quality curve, natural order; quality in [1, 100]
+std::array<uint16_t, 64> jpegLuminanceTable(int quality);
+
+class JpegSimulator {
+public:
+    explicit JpegSimulator(int quality);
+    // Any baseline table, natural order (e.g. JpegComponent::quant of a real file)
+    explicit JpegSimulator(const std::array<uint16_t, 64>& quant);
+
+    const std::array<uint16_t, 64>& table() const { return quant_; }
+
+    // Level shift and integer forward DCT of one 8x8 block, natural order; the same for every table
+    static void forwardDct(const uint8_t* pixels, size_t stride, int32_t* dct);
+    // Quantization of forwardDct's output
+    void quantize(const int32_t* dct, int16_t* coefs) const;
+    // Forward DCT and quantization of one 8x8 block: the coefficients an encoder stores, natural order
+    void quantizeBlock(const uint8_t* pixels, size_t stride, int16_t* coefs) const;
+    // Dequantization, inverse DCT, level shift and clamping: the pixels a decoder returns
+    void reconstructBlock(const int16_t* coefs, uint8_t* pixels, size_t stride) const;
+    // One 8x8 block through both; in and out may be the same block
+    void compressBlock(const uint8_t* in, size_t in_stride, uint8_t* out, size_t out_stride) const;
+    cv::Mat compressBlock(const cv::Mat& block) const;   // 8x8 CV_8UC1
+
+    /**
+     * @brief The whole image through the codec.
+     * Sizes that are not multiples of 8 are padded by repeating the last column and row, as the
+     * encoder does, and the padding is dropped again.
+     * @param image CV_8UC1 image.
+     * @param threads Rows of blocks are split over this many threads (0 = all cores).
+     */
+    cv::Mat compress(const cv::Mat& image, int threads = 1) const;
+
+private:
+    std::array<uint16_t, 64> quant_;
+    // libjpeg-turbo's divisors for the DCT output (8 times the orthonormal one): q = ((|c| +
+    // correction_) * reciprocal_) >> shift_, equal to |c| / (8 quant) rounded, without a division
+    std::array<uint32_t, 64> reciprocal_;
+    std::array<uint32_t, 64> correction_;
+    std::array<int, 64> shift_;
+};
+
+/**
+ * @brief The forward DCT of a whole image, kept to compress it at many qualities.
+ * The DCT does not depend on the table, so each JpegSimulator only quantizes and reconstructs:
+ * compress(simulator) equals simulator.compress(image) at about half the cost.
+ */
+class JpegImageDct {
+public:
+    // image: CV_8UC1; edge blocks are padded as in JpegSimulator::compress
+    explicit JpegImageDct(const cv::Mat& image, int threads = 1);
+
+    cv::Mat compress(const JpegSimulator& simulator, int threads = 1) const;
+
+private:
+    int rows_, cols_;
+    int block_rows_, block_cols_;
+    std::vector<int32_t> dct_;   // 64 values per block, blocks in raster order
+};
+
+// JpegSimulator(quality).compress(image)
+cv::Mat simulateJpeg(const cv::Mat& image, int quality, int threads = 1);
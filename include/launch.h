@@ -1,5 +1,6 @@
 #pragma once
 #include "gbo.h"
+#include "gbo_api.h"
 #include "process_images.h"
 #include <string>
 #include <opencv2/opencv.hpp>
@@ -7,6 +8,21 @@
 
 void embedWatermark(std::string image_path, std::string watermark_path, std::string output_path, int scheme = 0);
 void extractWatermark(std::string watermarked_image_path, std::string extracted_watermark_path, int scheme);
+// In-memory variants used by the file-based functions above and by the pipeline
+cv::Mat embedWatermarkMat(const cv::Mat& image, const cv::Mat& watermark, int scheme = 0);
+// With `stats` set it receives what gbo::embed reported (search counters, blocks out of time)
+cv::Mat embedWatermarkMat(const cv::Mat& image, const cv::Mat& watermark, const gbo::Config& config,
+                          gbo::EmbedStats* stats = nullptr);
+cv::Mat extractWatermarkMat(const cv::Mat& watermarked_image, int scheme);
+// `side` is the side of the square watermark; embedWatermarkMat takes it from the watermark image
+cv::Mat extractWatermarkMat(const cv::Mat& watermarked_image, const gbo::Config& config, int side = watermark_side);
+// Extraction without a known scheme; the detected scheme and its confidence go to *result
+cv::Mat extractWatermarkBlindMat(const cv::Mat& watermarked_image, const gbo::Config& config,
+                                 gbo::BlindExtraction* result = nullptr, int side = watermark_side);
+// "gbo" or "analytic" (--method on the command line); throws std::invalid_argument otherwise
+gbo::Method parseEmbedMethod(const std::string& name);
+// "none", "analytic", "raster" or "wavefront" (--warm-start on the command line)
+gbo::WarmStart parseWarmStart(const std::string& name);
 // Run GBO for a single 8x8 block and print fitness value changes
 
 // Original variant with explicit paths
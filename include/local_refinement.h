@@ -0,0 +1,47 @@
+#pragma once
+// Gradient polish of an embedding vector on the continuous relaxation of the fitness.
+//
+// Up to the 8-bit rounding in applyVectorToBlock the fitness is smooth in the vector: the
+// DCT is orthonormal, so the region sums are sums of the new magnitudes |c_k| + v_k and the
+// pixel MSE is the mean squared magnitude change. Rounding is modelled as a constant MSE
+// term (uniform error per pixel), which also keeps PSNR finite. A projected-gradient descent
+// minimizes this relaxation without a single exact evaluation; the rounded result is then
+// checked with the exact fitness and moved back towards the starting vector if rounding
+// spoilt it.
+#include <armadillo>
+#include <cstdint>
+#include "optimizer.h"
+
+// Rounding to 8-bit pixels: uniform error in [-0.5, 0.5] per pixel
+const double pixel_rounding_mse = 1.0 / 12.0;
+
+// Re-quantizing the embedding region of a JPEG block: uniform error of one step per coefficient
+double coefficientRoundingMse(const uint16_t* quant, int scheme = 0);
+
+/**
+ * @brief Relaxed fitness: region sums and MSE before rounding, plus rounding_mse.
+ * @param magnitudes |coefficient| at the 64 zig-zag positions of the original block (blockMagnitudes).
+ * @param gradient When not null, receives the derivative with respect to every vector entry.
+ */
+double relaxedFitness(const double* magnitudes, unsigned char bit, int scheme, double rounding_mse,
+                      const arma::vec& vec, arma::vec* gradient = nullptr);
+
+/**
+ * @brief Projected-gradient descent with Armijo backtracking on relaxedFitness.
+ * The box is [-bound, bound], narrowed so that no magnitude crosses zero (where the
+ * relaxation has a kink and the coefficient would change sign).
+ * @return The vector after at most `steps` accepted steps.
+ */
+arma::vec refineRelaxed(const double* magnitudes, unsigned char bit, int scheme, double rounding_mse,
+                        const arma::vec& start, double bound, int steps);
+
+/**
+ * @brief Hybrid second phase: polishes the best vector of a search on the relaxation, then
+ * corrects for rounding with the exact fitness. The refined vector is tried first, then the
+ * points half and a quarter of the way from the start; the first one that beats the start wins.
+ * @param start Result of the search; start.best_fitness is its exact fitness.
+ * @param fitness Exact objective (calcFitnessValue or its coefficient-domain counterpart).
+ * @return The better of start and the corrected vector; evaluations include the exact checks.
+ */
+OptimizerResult refineVector(const double* magnitudes, unsigned char bit, int scheme, double rounding_mse,
+                             const OptimizerResult& start, double bound, int steps, const FitnessOracle& fitness);
@@ -0,0 +1,87 @@
+#pragma once
+// GBO over several blocks at once, one SIMD lane per block.
+//
+// One GBO update only touches a 22- or 25-element vector, too short to fill wide vector
+// registers, but its control flow is the same for every block. LockstepGbo therefore keeps
+// the populations of up to lockstep_lanes blocks side by side (coordinate-major, lanes
+// innermost) and runs every step for all of them together: every lane draws from its own
+// random stream, per-lane choices (random indices, the LEO branch, replacement) become
+// gathers and masked blends, and the candidates of all lanes are scored by one batched
+// pixel-domain fitness kernel (BlockBatch). The lane loops have a fixed width and are
+// written to be auto-vectorized; the file is compiled with -O3 (see CMakeLists.txt).
+#include <armadillo>
+#include <cstdint>
+#include <functional>
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "optimizer.h"
+#include "process_block.h"
+
+// Blocks advanced together: one AVX-512 register of doubles
+const int lockstep_lanes = 8;
+
+/**
+ * @brief calcFitnessValue for up to lockstep_lanes blocks of one scheme, one candidate per block.
+ * The DCT of every block is taken once; each evaluation runs the inverse transform, the
+ * rounding to 8 bits and the forward transform of all lanes together as 8x8 matrix products.
+ * Lanes beyond the given blocks repeat the last block.
+ */
+class BlockBatch {
+public:
+    /**
+     * @param blocks 1 to lockstep_lanes blocks, 8x8 CV_8UC1.
+     * @param bits The bit each block carries, one per block.
+     * @param robustness Optional attack penalty added to every lane, as in calcFitnessValue; not owned.
+     * @throws std::invalid_argument on a wrong block count, block format or scheme.
+     */
+    BlockBatch(const std::vector<cv::Mat>& blocks, const std::vector<unsigned char>& bits, int scheme = 0,
+               const BlockRobustness* robustness = nullptr);
+
+    int scheme() const { return scheme_; }
+    int dimension() const { return static_cast<int>(embeding_region[scheme_].size()); }
+
+    // fitness[lane] for the vectors stored coordinate-major: vectors[idx * lockstep_lanes + lane]
+    void evaluate(const double* vectors, double* fitness) const;
+
+private:
+    int scheme_;
+    const BlockRobustness* robustness_;
+    alignas(64) double pixels_[64][lockstep_lanes];         // original pixels, row-major
+    alignas(64) double coefficients_[64][lockstep_lanes];   // their DCT, natural order
+    alignas(64) double bits_[lockstep_lanes];
+};
+
+// One block of a lockstep run
+struct LockstepLane {
+    cv::Mat block;                  // 8x8 CV_8UC1, read only
+    unsigned char bit = 0;
+    uint64_t seed = 0;              // seeds the lane's RandomStream, as seed_thread_random does GBO's
+    std::vector<arma::vec> seeds;   // warm-start vectors, as for Population
+};
+
+class LockstepGbo {
+public:
+    LockstepGbo() = default;
+    explicit LockstepGbo(int iterations) : iterations(iterations) {}
+
+    // Polled before every step; true ends the run for all lanes, keeping their best vectors
+    std::function<bool()> stop;
+    // Attack penalty of the fitness (robust_fitness.h), for the scheme passed to run; not owned
+    const BlockRobustness* robustness = nullptr;
+
+    /**
+     * @brief Runs GBO (population, constants and update rules of gbo.h) on every lane.
+     * A lane's result only depends on its block, bit, seed and warm-start vectors, not on
+     * the other lanes, so blocks may be grouped in any way. Every lane makes its draws with
+     * GBO::drawStep, so it returns the vector GBO::main_loop finds after
+     * seed_thread_random(seed), unless two candidates tie within the batched kernel's rounding.
+     * @param lanes 1 to lockstep_lanes blocks embedded with the same scheme.
+     * @return One result per lane: best vector in the GBO box [-th, th], its fitness and
+     * evaluations spent (population_size * (iterations + 1) unless interrupted).
+     * @throws std::invalid_argument on a wrong lane count, block, scheme or seed size.
+     */
+    std::vector<OptimizerResult> run(const std::vector<LockstepLane>& lanes, int scheme = 0) const;
+
+private:
+    int iterations = 40;
+};
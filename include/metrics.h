@@ -3,10 +3,86 @@
 #include <vector>
 #include <stdexcept>
 #include <opencv2/opencv.hpp>
+#include "watermark_bits.h"
 
+// Full-reference quality of a test image against the original
+struct ImageQuality {
+    double mse = 0.0;
+    double psnr = 0.0;      // 0 for identical images
+    double ncc = 0.0;       // 0 when either image is flat
+    double ssim = 0.0;      // 11x11 Gaussian window, sigma 1.5; left 0 without MetricsEngine::Ssim
+};
+
+/**
+ * @brief Computes several metrics of one image pair together.
+ * MSE, PSNR and NCC come from one pass over the 8-bit pixels, summed in integers; SSIM reuses
+ * float buffers kept by the engine between calls, so an engine per thread compares a series of
+ * images (e.g. every attack of a sweep) without allocating. Not thread-safe.
+ */
+class MetricsEngine {
+public:
+    enum Metrics { Pixel = 1, Ssim = 2, All = Pixel | Ssim };
+
+    /**
+     * @param img1 Original image, CV_8UC1 (or any 8-bit image without SSIM).
+     * @param img2 Test image of the same size and type.
+     * @throws std::invalid_argument on a size or type mismatch.
+     */
+    ImageQuality compare(const cv::Mat& img1, const cv::Mat& img2, int metrics = All);
+
+private:
+    double ssim(const cv::Mat& img1, const cv::Mat& img2);
+
+    cv::Mat img1f_, img2f_, product_;                       // converted inputs, a product before blurring
+    cv::Mat mu1_, mu2_, sigma1_sq_, sigma2_sq_, sigma12_;   // blurred moments
+};
+
+// MetricsEngine::compare with the calling thread's engine
+ImageQuality computeImageQuality(const cv::Mat& img1, const cv::Mat& img2, int metrics = MetricsEngine::All);
+
+/**
+ * @brief SSIM against a fixed reference image whose blurred statistics are computed once.
+ * Comparing a test image blurs only its own moments, with the separable 11-tap Gaussian run
+ * over row tiles (in parallel when asked) on reflected borders, as cv::GaussianBlur does.
+ * Matches computeSSIM up to float rounding. compare() is const and may run concurrently.
+ */
+class SsimReference {
+public:
+    /**
+     * @param reference CV_8UC1 image, at least 6x6 (copied).
+     * @throws std::invalid_argument on an empty, too small or non-CV_8UC1 image.
+     */
+    explicit SsimReference(const cv::Mat& reference);
+
+    const cv::Mat& image() const { return image_; }
+
+    /**
+     * @param test CV_8UC1 image of the reference's size.
+     * @param threads Row tiles processed in parallel (parallel.h); 0 means all cores.
+     * @param block_map Optional, receives the mean SSIM of every block_size x block_size block,
+     * CV_64FC1 of ceil(rows / block_size) x ceil(cols / block_size); edge blocks average the
+     * pixels they have.
+     * @return Mean SSIM over the image.
+     * @throws std::invalid_argument on a wrong test image or block size.
+     */
+    double compare(const cv::Mat& test, int threads = 1, cv::Mat* block_map = nullptr, int block_size = 8) const;
+
+private:
+    cv::Mat image_;
+    cv::Mat padded_;            // CV_32F reference with a reflected border of the window radius
+    cv::Mat mu_, sigma_sq_;     // CV_32F blurred mean and variance of the reference
+};
+
+// computeImageQuality of the reference image against `test`, SSIM from the cached statistics
+ImageQuality computeImageQuality(const SsimReference& reference, const cv::Mat& test,
+                                 int metrics = MetricsEngine::All, int threads = 1);
+
+// Share of differing bits; the sizes must match (std::invalid_argument otherwise)
+double computeBER(const WatermarkBits& wm1, const WatermarkBits& wm2);
 double computeBER(const std::vector<unsigned char>& wm1, const std::vector<unsigned char>& wm2);
+// The functions below each compute one field of computeImageQuality; comparing a pair by
+// several of them repeats the pass over the pixels
 double computePSNR(const cv::Mat& img1, const cv::Mat& img2);
 double computeSSIM(const cv::Mat& img1, const cv::Mat& img2);
 double computeNCC(const cv::Mat& img1, const cv::Mat& img2);
 double computeMSE(const cv::Mat& img1, const cv::Mat& img2);
-
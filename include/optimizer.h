@@ -0,0 +1,95 @@
+#pragma once
+// Interchangeable minimizers for the per-block embedding search.
+//
+// A backend only sees a fitness oracle, the dimension, box bounds and an evaluation
+// budget, so GBO, differential evolution and CMA-ES can be swapped per workload and
+// compared on equal terms (same number of fitness evaluations).
+#include <armadillo>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#include "embed_defaults.h"
+
+// Objective minimised by an optimizer backend
+using FitnessOracle = std::function<double(const arma::vec&)>;
+
+struct OptimizerProblem {
+    int dimension = 0;
+    double lower = -10.0;           // box bounds, the same for every coordinate
+    double upper = 10.0;
+    size_t max_evaluations = 0;     // fitness evaluations the backend may spend
+    FitnessOracle fitness;
+    std::vector<arma::vec> seeds;   // warm-start points, evaluated first; clamped to the bounds
+    // Optional cheap model of the fitness. GBO and DE skip the exact evaluation of a candidate
+    // predicted worse than the point it would replace by more than surrogate_tolerance; such a
+    // candidate still counts towards max_evaluations, so the search follows the same schedule
+    // and only the exact work shrinks. CMA-ES ranks every sample and ignores the surrogate.
+    FitnessOracle surrogate;
+    double surrogate_tolerance = default_surrogate_tolerance;
+    // Optional deadline or cancellation check, polled before every candidate once the first
+    // evaluation is done; when it returns true the backend returns the best point so far.
+    // GBO's initial population is always evaluated in full.
+    std::function<bool()> stop;
+};
+
+struct OptimizerResult {
+    arma::vec best;
+    double best_fitness = std::numeric_limits<double>::infinity();
+    size_t evaluations = 0;     // exact evaluations actually spent
+    size_t screened = 0;        // candidates rejected by the surrogate; evaluations + screened <= max_evaluations
+    bool interrupted = false;   // `stop` ended the run before the budget was spent
+};
+
+class Optimizer {
+public:
+    virtual ~Optimizer() = default;
+    virtual std::string name() const = 0;
+    /**
+     * @brief Minimises problem.fitness inside the box without exceeding the evaluation budget.
+     * @throws std::invalid_argument on an inconsistent problem.
+     */
+    virtual OptimizerResult minimize(const OptimizerProblem& problem) = 0;
+};
+
+// Gradient-based optimizer (gbo.h): population and GBO constants as in the embedder,
+// iterations derived from the budget, [-th, th] mapped onto the problem's box
+class GboOptimizer : public Optimizer {
+public:
+    std::string name() const override { return "gbo"; }
+    OptimizerResult minimize(const OptimizerProblem& problem) override;
+};
+
+// DE/rand/1/bin
+class DifferentialEvolution : public Optimizer {
+public:
+    int population_size = 30;
+    double weight = 0.5;        // F, scale of the difference vector
+    double crossover = 0.9;     // CR, probability of taking a mutant coordinate
+
+    std::string name() const override { return "de"; }
+    OptimizerResult minimize(const OptimizerProblem& problem) override;
+};
+
+// (mu/mu_w, lambda)-CMA-ES with the default population size 4 + 3 ln(n)
+class CmaEs : public Optimizer {
+public:
+    int lambda = 0;             // offspring per generation, 0 = default
+    double initial_step = 0.3;  // sigma0 as a fraction of the box width
+
+    std::string name() const override { return "cmaes"; }
+    OptimizerResult minimize(const OptimizerProblem& problem) override;
+};
+
+// Names accepted by makeOptimizer, GBO first
+const std::vector<std::string>& optimizerNames();
+
+/**
+ * @brief Creates a backend by name ("gbo", "de" or "cmaes") with default settings.
+ * @throws std::invalid_argument for an unknown name.
+ */
+std::unique_ptr<Optimizer> makeOptimizer(const std::string& name);
+
+// The calling thread's backend of that name, created by makeOptimizer on first use
+Optimizer& threadOptimizer(const std::string& name);
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+// Number of worker threads for a requested count; 0 means hardware concurrency
+int resolveThreads(int threads);
+
+/**
+ * @brief Calls fn(i) for every i in [0, count) on up to `threads` threads.
+ * The calling thread takes part; the others come from one process-wide pool of
+ * hardware-concurrency - 1 workers, so nested calls (images -> blocks) share the cores
+ * instead of starting threads of their own. While a call runs on several threads
+ * OpenCV's own parallelism is switched off (cv::setNumThreads(1)) and restored afterwards.
+ * The first exception thrown by fn is rethrown on the calling thread; indices not started
+ * by then are skipped.
+ */
+void parallelFor(size_t count, int threads, const std::function<void(size_t)>& fn);
+
+// How parallelFor hands out indices
+enum class Schedule {
+    Static,     // one contiguous chunk per thread, as before work stealing
+    Stealing,   // the same chunks; a thread that runs out takes half of the largest remaining one
+};
+
+// Process-wide; Stealing by default. Meant for benchmarks comparing the two.
+void setSchedule(Schedule schedule);
+Schedule schedule();
+
+// Counters of the parallelFor calls that ran on more than one thread
+struct SchedulerStats {
+    size_t jobs = 0;
+    size_t tasks = 0;           // indices run
+    size_t steals = 0;          // chunks taken from another thread
+    double busy_ms = 0.0;       // thread time spent inside fn, summed over threads
+    double tail_idle_ms = 0.0;  // thread time between running out of work and the end of the call
+};
+
+SchedulerStats schedulerStats();
+void resetSchedulerStats();
@@ -0,0 +1,163 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include "gbo_api.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Fixed-capacity FIFO connecting two pipeline stages.
+ *
+ * push() blocks while the queue is full, pop() blocks while it is empty.
+ * After close() no new items are accepted and pop() returns false once the
+ * remaining items are drained.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        max_depth_ = std::max(max_depth_, items_.size());
+        depth_sum_ += items_.size();
+        ++pushes_;
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Non-blocking push; false if the queue is full or closed
+    bool tryPush(T item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_ || items_.size() >= capacity_) {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        max_depth_ = std::max(max_depth_, items_.size());
+        depth_sum_ += items_.size();
+        ++pushes_;
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+    size_t capacity() const { return capacity_; }
+    size_t maxDepth() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return max_depth_;
+    }
+    // Mean queue depth observed right after each push
+    double meanDepth() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pushes_ > 0 ? static_cast<double>(depth_sum_) / pushes_ : 0.0;
+    }
+
+private:
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_full_, not_empty_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    size_t max_depth_ = 0;
+    size_t depth_sum_ = 0;
+    size_t pushes_ = 0;
+};
+
+// Per-stage counters of the image pipeline
+struct StageStats {
+    std::string name;
+    size_t items = 0;           // items that left the stage
+    size_t failures = 0;        // items that failed inside the stage
+    double busy_seconds = 0.0;  // time spent doing the stage's own work
+    double wait_seconds = 0.0;  // time blocked on the input or output queue
+    size_t queue_capacity = 0;  // capacity of the stage's input queue (0 for the source stage)
+    size_t queue_depth = 0;     // current depth of the input queue
+    size_t queue_max_depth = 0;
+    double queue_mean_depth = 0.0;
+
+    double throughput() const { return busy_seconds > 0.0 ? items / busy_seconds : 0.0; }
+};
+
+struct PipelineReport {
+    std::vector<StageStats> stages;  // decode, process, encode
+    size_t completed = 0;
+    size_t total = 0;
+    double wall_seconds = 0.0;
+    std::vector<std::string> errors;
+
+    void print(std::ostream& os) const;
+};
+
+struct PipelineJob {
+    std::string input_path;
+    std::string output_path;
+};
+
+struct PipelineOptions {
+    size_t queue_capacity = 2;
+    // Images in the process stage at once; their block loops share one worker pool (parallel.h),
+    // so several images in flight keep cores busy while one image finishes its slowest blocks
+    int images_in_flight = 1;
+    // Called from the encode stage after every written image with a snapshot of all stages;
+    // an exception it throws stops the pipeline and is rethrown by runImagePipeline
+    std::function<void(const PipelineReport&)> on_progress;
+};
+
+/**
+ * @brief Runs decode -> process -> encode as three stages connected by bounded queues,
+ *        so codec work on neighbouring images overlaps with processing of the current one.
+ *        With options.images_in_flight > 1 the process stage works on several images at once
+ *        and results may reach the encode stage out of order.
+ *
+ * @param jobs     Input/output path pairs, processed in order.
+ * @param process  Transformation of a decoded CV_8UC1 image into the image to write; a
+ *                 std::exception it throws fails only that job.
+ * @param options  Queue capacity, images in flight and optional progress observer.
+ * @return PipelineReport Final per-stage statistics; failed jobs are listed in errors.
+ */
+PipelineReport runImagePipeline(const std::vector<PipelineJob>& jobs,
+                                const std::function<cv::Mat(const cv::Mat&)>& process,
+                                const PipelineOptions& options = PipelineOptions());
+
+// Embeds the watermark into every job's image (GBO runs in the process stage)
+PipelineReport runEmbedPipeline(const std::vector<PipelineJob>& jobs,
+                                const std::string& watermark_path,
+                                const gbo::Config& config = gbo::Config(),
+                                const PipelineOptions& options = PipelineOptions());
+
+// Extracts the watermark from every job's image and writes it as a 32x32 image
+PipelineReport runExtractPipeline(const std::vector<PipelineJob>& jobs,
+                                  const gbo::Config& config = gbo::Config(),
+                                  const PipelineOptions& options = PipelineOptions());
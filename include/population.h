@@ -1,5 +1,6 @@
 #pragma once
 #include <armadillo>
+#include <functional>
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include "process_block.h"
@@ -10,7 +11,11 @@ private:
     const int gbo_iterations    = 40;
     const int population_size   = 30;
     const double th             = 10.0;
+    void initialize(const std::vector<arma::vec>& seeds);
 public:
+    // Objective minimised by GBO for a candidate vector
+    using FitnessFunction = std::function<double(const arma::vec&)>;
+
     cv::Mat block; 
     int vector_size;
     int indexOfBestIndividual;
@@ -20,9 +25,22 @@ public:
     int scheme;
     std::vector<arma::vec> individuals;
     std::vector<double> fitness_values;
+    FitnessFunction fitness;
+    // Optional cheap estimate of the fitness (see setSurrogate) and the number of candidates it rejected
+    FitnessFunction surrogate;
+    double surrogate_tolerance = 0.0;
+    std::vector<double> surrogate_values;
+    size_t screened = 0;
 
     Population() = default;
-    Population(int vector_size, const cv::Mat& block, unsigned char bit, int scheme = 0);
+    // seeds (warm start) replace the first random individuals; they are clamped to [-th, th]
+    Population(int vector_size, const cv::Mat& block, unsigned char bit, int scheme = 0,
+               const std::vector<arma::vec>& seeds = {});
+    Population(int vector_size, FitnessFunction fitness, const std::vector<arma::vec>& seeds = {});
     void update(arma::vec& vec, int index);
+    // Screens candidates in update(): one predicted worse than the individual it would replace
+    // by more than `tolerance` is rejected without an exact evaluation
+    void setSurrogate(FitnessFunction surrogate, double tolerance);
     double get_th() const { return th; }
+    int get_population_size() const { return population_size; }
 };
\ No newline at end of file
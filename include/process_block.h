@@ -1,8 +1,11 @@
 #pragma once
 #include <armadillo>
+#include <cstdint>
 #include <opencv2/opencv.hpp>
 #include <vector>
 
+class BlockRobustness;
+
 const int jpeg_zigzag[64] = {
      0,  1,  5,  6, 14, 15, 27, 28,
      2,  4,  7, 13, 16, 26, 29, 42,
@@ -18,9 +21,18 @@ arma::vec matToZigzag(const cv::Mat& block);
 cv::Mat zigzagToMat(const arma::vec& zz);
 cv::Mat applyVectorToBlock(const arma::vec& vec, const cv::Mat& block, int scheme = 0);
 unsigned char getBitFromBlock(const cv::Mat& block, int scheme = 0);
-double calcFitnessValue(const cv::Mat& block, const arma::vec& vec, unsigned char bit, int scheme = 0);
+// With robustness set (robust_fitness.h, same scheme) its penalty of the marked block is added
+double calcFitnessValue(const cv::Mat& block, const arma::vec& vec, unsigned char bit, int scheme = 0,
+                        const BlockRobustness* robustness = nullptr);
 double compute_psnr(const cv::Mat& orig, const cv::Mat& test);
-double getRegionSum(const cv::Mat& dctBlock, std::vector<int> region);
+double getRegionSum(const cv::Mat& dctBlock, const std::vector<int>& region);
+
+// JPEG coefficient-domain counterparts: coefs is one block of quantized coefficients and
+// quant its quantization table, both in natural order (see jpeg_coefficients.h)
+double getCoefficientRegionSum(const int16_t* coefs, const uint16_t* quant, const std::vector<int>& region);
+unsigned char getBitFromCoefficients(const int16_t* coefs, const uint16_t* quant, int scheme = 0);
+void applyVectorToCoefficients(const arma::vec& vec, const int16_t* coefs, const uint16_t* quant, int16_t* out, int scheme = 0);
+double calcCoefficientFitnessValue(const int16_t* coefs, const uint16_t* quant, const arma::vec& vec, unsigned char bit, int scheme = 0);
 
 // Region definition updated from user-provided 8×8 masks (1 = s1, 2 = s0)
 // Scheme 0 mask:
@@ -56,4 +68,12 @@ const std::vector<std::vector<int>> s0_region = {
     /*{5, 6, 10, 11, 14, 22, 23, 48, 56, 59, 60}*/ //base case
     {14, 23, 48, 49, 52, 53, 56, 57, 58, 59, 60},
     {5, 6, 10, 11, 14, 22, 23, 26, 48, 56, 59, 60}
-};
\ No newline at end of file
+};
+// s1/s0 region sums of one block under every scheme (one entry per row of the tables above),
+// from a single DCT; used when the scheme is not known in advance
+struct SchemeRegionSums {
+    double s1[2];
+    double s0[2];
+};
+SchemeRegionSums getSchemeRegionSums(const cv::Mat& block);
+SchemeRegionSums getSchemeRegionSumsFromCoefficients(const int16_t* coefs, const uint16_t* quant);
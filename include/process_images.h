@@ -3,11 +3,12 @@
 #include <opencv2/opencv.hpp>
 #include <vector>
 #include <armadillo>
+#include "watermark_bits.h"
 
 std::vector<cv::Mat> splitImageInto8x8Blocks(const cv::Mat& image);
 
 cv::Mat assembleImageFrom8x8Blocks(const std::vector<cv::Mat>& blocks);
 
-std::vector<unsigned char> extract_watermark_bits(const cv::Mat& image);
+WatermarkBits extract_watermark_bits(const cv::Mat& image, int side = watermark_side);
 
-cv::Mat reconstruct_watermark_image(const std::vector<unsigned char>& bits);
\ No newline at end of file
+cv::Mat reconstruct_watermark_image(const WatermarkBits& bits, int side = watermark_side);
@@ -1,5 +1,6 @@
 // random_utils.h
 #pragma once
+#include <cstdint>
 #include <random>
 #include <stdexcept>
 #include <vector>
@@ -7,6 +8,31 @@
 #include <cmath>
 #include <algorithm>
 
+// One random stream: the generator and distributions behind the functions below. Every
+// thread has one (threadRandom); LockstepGbo keeps one per lane, so a lane seeded like
+// seed_thread_random draws exactly what GBO draws on that thread.
+class RandomStream {
+public:
+    explicit RandomStream(uint64_t seed = 0) { this->seed(seed); }
+    void seed(uint64_t seed);
+    // Uniform in (0, 1]
+    double uniform() { return uniform_(engine_); }
+    // Gaussian with mean 0.5 and stddev 0.15, clamped to [0, 1]
+    double gaussian();
+    // Uniform in [0, n-1]
+    int index(int n);
+    // 4 distinct indices in [0, n-1] other than best and current
+    void indices(int n, int best, int current, int* out);
+
+private:
+    std::mt19937 engine_;
+    std::uniform_real_distribution<double> uniform_{std::nextafter(0.0, 1.0), 1.0};
+    std::normal_distribution<double> normal_{0.5, 0.15};
+};
+
+// The calling thread's stream, seeded from std::random_device until seed_thread_random
+RandomStream& threadRandom();
+
 // Generates a random double in [0, 1] using uniform distribution
 double uniform_random_0_1();
 
@@ -15,6 +41,25 @@ int random_index(int N);
 
 // Generates 4 unique random indices in [0, N-1] excluding best_index and current_index
 std::vector<int> generate_random_indices(int N, int best_index, int current_index);
+// Same draws, written to out[0..3] without allocating
+void generate_random_indices(int N, int best_index, int current_index, int* out);
 
 // Generates a Gaussian random number in [0, 1] (mean=0.5, stddev=0.15)
-double gaussian_random_0_1();
\ No newline at end of file
+double gaussian_random_0_1();
+
+// SplitMix64 finalizer
+inline uint64_t splitMix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Seed of stream `index` derived from one user seed (SplitMix64 step `index + 1` from `seed`):
+// the per-block, per-image and per-value streams of the embedder, the dataset builder and the
+// noise attacks
+inline uint64_t mixSeed(uint64_t seed, uint64_t index) {
+    return splitMix64(seed + 0x9e3779b97f4a7c15ULL * (index + 1));
+}
+
+// Re-seeds the calling thread's generators (including Armadillo's) for reproducible runs
+void seed_thread_random(uint64_t seed);
\ No newline at end of file
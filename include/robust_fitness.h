@@ -0,0 +1,51 @@
+#pragma once
+// Robustness term of the embedding fitness.
+//
+// calcFitnessValue only scores the marked block itself, so whether the bit survives JPEG or a
+// contrast change is found out after embedding. BlockRobustness runs the marked block through a
+// few block-level attacks (block_attacks.h) and scores how close each attacked block comes to
+// decoding the other bit: its ratio of losing to winning region sum, below 1 while it still
+// decodes right. The worst ratio over the attacks, times a weight, is added to the fitness.
+//
+// JPEG is applied in the DCT domain to the region coefficients only and costs next to nothing.
+// The pixel-domain attacks cost one forward DCT each, reduced to the coefficients the region
+// sums read. The filters see only the block, with mirrored edges (OpenCV's default border)
+// standing in for its neighbours.
+#include <array>
+#include <vector>
+#include "block_attacks.h"
+#include "lockstep_gbo.h"
+
+class BlockRobustness {
+public:
+    /**
+     * @param attacks At most max_block_attacks attacks.
+     * @param weight Factor of the worst attacked ratio in the fitness, non-negative.
+     * @throws std::invalid_argument on an invalid attack list, weight or scheme.
+     */
+    BlockRobustness(const std::vector<BlockAttack>& attacks, double weight, int scheme = 0);
+
+    int scheme() const { return scheme_; }
+    const std::vector<BlockAttack>& attacks() const { return attacks_; }
+
+    /**
+     * @brief weight * worst attacked ratio of one marked block.
+     * @param pixels The marked block after rounding to 8 bits, 64 values, row-major.
+     * @param coefs Its DCT (cv::dct scaling), natural order.
+     */
+    double penalty(const double* pixels, const double* coefs, unsigned char bit) const;
+
+    // The same for lockstep_lanes blocks at once, lanes innermost; bits[lane] is 0.0 or 1.0
+    void penalties(const double (*pixels)[lockstep_lanes], const double (*coefs)[lockstep_lanes], const double* bits,
+                   double* out) const;
+
+    // The worst attacked ratio alone (no weight), e.g. to report how robust an embedded block is
+    double worstRatio(const cv::Mat& marked_block, unsigned char bit) const;
+
+private:
+    std::vector<BlockAttack> attacks_;
+    std::vector<std::array<double, 64>> jpeg_steps_;   // per JPEG attack: its table, natural order
+    std::vector<int> positions_;                       // natural-order positions the region sums read
+    double weight_;
+    int scheme_;
+};
@@ -0,0 +1,57 @@
+#pragma once
+// Native inference of the block scheme classifier (best_scheme_classifier.pth).
+//
+// The weights are read from the flat binary written by tools/export_classifier.py
+// (BatchNorm already folded in). The engine has no dependencies beyond the
+// standard library: activations are plain CHW float planes, and every inner loop
+// runs over contiguous memory with fixed-size kernels, so the compiler can vectorize it.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class SchemeClassifier {
+public:
+    struct Layer {
+        enum Type : uint32_t { Conv3x3 = 1, MaxPool2 = 2, AdaptiveAvgPool = 3, Linear = 4 };
+        Type type = Conv3x3;
+        int in = 0;      // input channels / features
+        int out = 0;     // output channels / features (grid size for AdaptiveAvgPool)
+        bool relu = false;
+        std::vector<float> weight;
+        std::vector<float> bias;
+    };
+
+    static SchemeClassifier load(const std::string& path);
+    static SchemeClassifier fromBytes(const std::vector<unsigned char>& bytes);
+
+    // Resolution the 8x8 blocks are resized to; the network itself is resolution independent
+    int inputSize() const { return input_size_; }
+    void setInputSize(int size);
+    float threshold() const { return threshold_; }
+    void setThreshold(float threshold) { threshold_ = threshold; }
+
+    // Multiply-accumulate operations for one block at the current input size
+    uint64_t macsPerBlock() const;
+
+    /**
+     * Probability that scheme 1 suits each block.
+     * blocks[i] points at the top-left pixel of an 8x8 grayscale block whose rows are stride bytes apart.
+     * The batch is split over `threads` workers (0 = hardware concurrency).
+     */
+    std::vector<float> predict(const std::vector<const unsigned char*>& blocks, size_t stride, int threads = 1) const;
+
+    // Scheme (0 or 1) per block: 1 when the predicted probability reaches the threshold
+    std::vector<int> classify(const std::vector<const unsigned char*>& blocks, size_t stride, int threads = 1) const;
+
+private:
+    struct Scratch;
+    float predictOne(const unsigned char* block, size_t stride, Scratch& scratch) const;
+    void preprocess(const unsigned char* block, size_t stride, std::vector<float>& out) const;
+
+    int input_size_ = 0;
+    float mean_ = 0.0f;
+    float std_ = 1.0f;
+    float threshold_ = 0.5f;
+    std::vector<Layer> layers_;
+};
@@ -0,0 +1,80 @@
+#pragma once
+// Packed watermark bits.
+//
+// A watermark is a few thousand bits that every stage after extraction (voting, BER,
+// comparison between trials) only combines word-wise, so they are kept 64 to a uint64_t
+// instead of one byte each. Depends on the standard library only, like gbo_api.h.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Side of the square watermark image used unless a caller asks for another
+const int watermark_side = 32;
+
+class WatermarkBits {
+public:
+    WatermarkBits() = default;
+    // `size` zero bits
+    explicit WatermarkBits(size_t size);
+    // One byte per bit, non-zero is 1
+    static WatermarkBits fromBytes(const unsigned char* bytes, size_t count);
+    static WatermarkBits fromBytes(const std::vector<unsigned char>& bytes) { return fromBytes(bytes.data(), bytes.size()); }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool get(size_t i) const { return (words_[i / 64] >> (i % 64)) & 1u; }
+    void set(size_t i, bool value) {
+        const uint64_t mask = uint64_t(1) << (i % 64);
+        words_[i / 64] = value ? (words_[i / 64] | mask) : (words_[i / 64] & ~mask);
+    }
+
+    // Bit i is bit i % 64 of word i / 64; the bits past size() are zero
+    const std::vector<uint64_t>& words() const { return words_; }
+    // Sets a whole word; bits past size() are cleared
+    void setWord(size_t w, uint64_t word);
+
+    // Bits [begin, begin + count)
+    WatermarkBits slice(size_t begin, size_t count) const;
+    std::vector<unsigned char> toBytes() const;
+    void toBytes(unsigned char* bytes) const;   // size() bytes, 0 or 1
+
+    size_t ones() const;
+    // Positions where the two differ (XOR + popcount); sizes must match
+    size_t differences(const WatermarkBits& other) const;
+
+    bool operator==(const WatermarkBits& other) const { return size_ == other.size_ && words_ == other.words_; }
+    bool operator!=(const WatermarkBits& other) const { return !(*this == other); }
+
+private:
+    size_t size_ = 0;
+    std::vector<uint64_t> words_;
+};
+
+/**
+ * @brief Majority vote over copies of a watermark with bit-sliced counters.
+ * The counters of 64 bits live side by side: plane k holds bit k of all their counts, so
+ * adding a copy is a ripple-carry over a few words and the final comparison of ones against
+ * copies runs on whole words as well.
+ */
+class BitVoter {
+public:
+    explicit BitVoter(size_t size);
+
+    // Counts one copy; a shorter one (the last, partial row of blocks) votes for its first bits only
+    void add(const WatermarkBits& copy);
+
+    /**
+     * @return The bits set in more than half of their copies.
+     * @param ties Optional, receives the bits set in exactly half of them (or without copies).
+     */
+    WatermarkBits majority(WatermarkBits* ties = nullptr) const;
+
+private:
+    size_t size_;
+    std::vector<std::vector<uint64_t>> ones_;     // ones_[k][w]: bit k of the ones counted for bits 64w..64w+63
+    std::vector<std::vector<uint64_t>> copies_;   // the same for the copies counted
+};
+
+// Block i of an image carries bit i % bit_count: the per-block bits cut into the copies of
+// the watermark, the last one shorter when the blocks do not divide evenly
+std::vector<WatermarkBits> watermarkCopies(const WatermarkBits& block_bits, size_t bit_count);
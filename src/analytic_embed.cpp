@@ -0,0 +1,143 @@
+#include "../include/analytic_embed.h"
+#include "../include/block_arena.h"
+#include "../include/process_block.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Rounding fix-ups allowed after the first solution
+const int max_correction_rounds = 8;
+
+// Increase of (winning sum - losing sum) still needed to reach the margin
+double missingMargin(const double* magnitudes, unsigned char bit, int scheme, double margin) {
+    return margin - decodeMargin(magnitudes, bit, scheme);
+}
+
+/**
+ * @brief Common search: solve, apply, measure the margin that survived and retry with the shortfall added.
+ * @param magnitudes Zig-zag magnitudes of the original block.
+ * @param achieved Applies a vector and returns the margin the result decodes with.
+ * @return The last vector tried.
+ */
+arma::vec solveWithCorrection(const double* magnitudes, unsigned char bit, int scheme, double margin,
+                              const std::function<double(const arma::vec&)>& achieved) {
+    double increase = missingMargin(magnitudes, bit, scheme, margin);
+    arma::vec vec = arma::zeros<arma::vec>(embeding_region[scheme].size());
+    for (int round = 0; round <= max_correction_rounds && increase > 0.0; ++round) {
+        vec = analyticVector(magnitudes, bit, scheme, increase);
+        const double shortfall = margin - achieved(vec);
+        if (shortfall <= 0.0) {
+            break;
+        }
+        // One extra unit keeps a rounding-bound block from needing every round
+        increase += shortfall + 1.0;
+    }
+    return vec;
+}
+
+} // namespace
+
+void blockMagnitudes(const cv::Mat& block, double* magnitudes) {
+    ArenaScope scope;
+    BlockArena& arena = BlockArena::local();
+    cv::Mat floatBlock = arena.mat(8, 8, CV_64FC1), dctBlock = arena.mat(8, 8, CV_64FC1);
+    block.convertTo(floatBlock, CV_64FC1);
+    cv::dct(floatBlock, dctBlock);
+    for (int k = 0; k < 64; ++k) {
+        magnitudes[k] = std::fabs(dctBlock.at<double>(jpeg_zigzag[k] / 8, jpeg_zigzag[k] % 8));
+    }
+}
+
+void coefficientMagnitudes(const int16_t* coefs, const uint16_t* quant, double* magnitudes) {
+    for (int k = 0; k < 64; ++k) {
+        magnitudes[k] = std::fabs(static_cast<double>(coefs[jpeg_zigzag[k]]) * quant[jpeg_zigzag[k]]);
+    }
+}
+
+double decodeMargin(const double* magnitudes, unsigned char bit, int scheme) {
+    const std::vector<int>& win = bit ? s1_region[scheme] : s0_region[scheme];
+    const std::vector<int>& lose = bit ? s0_region[scheme] : s1_region[scheme];
+    double margin = 0.0;
+    for (int k : win) margin += magnitudes[k];
+    for (int k : lose) margin -= magnitudes[k];
+    return margin;
+}
+
+arma::vec analyticVector(const double* magnitudes, unsigned char bit, int scheme, double increase) {
+    const std::vector<int>& region = embeding_region[scheme];
+    const std::vector<int>& lose = bit ? s0_region[scheme] : s1_region[scheme];
+    arma::vec vec = arma::zeros<arma::vec>(region.size());
+    if (increase <= 0.0) {
+        return vec;
+    }
+
+    // Every coefficient moves by the same level, losing ones at most down to zero:
+    // find level such that  win_count * level + sum(min(level, cap)) = increase
+    std::vector<double> caps;
+    for (int k : lose) caps.push_back(magnitudes[k]);
+    std::sort(caps.begin(), caps.end());
+    const size_t win_count = region.size() - lose.size();
+    double level = 0.0, capped = 0.0;
+    for (size_t i = 0; i <= caps.size(); ++i) {
+        level = (increase - capped) / static_cast<double>(win_count + caps.size() - i);
+        if (i == caps.size() || level <= caps[i]) {
+            break;
+        }
+        capped += caps[i];
+    }
+
+    for (size_t idx = 0; idx < region.size(); ++idx) {
+        const int k = region[idx];
+        const bool losing = std::find(lose.begin(), lose.end(), k) != lose.end();
+        vec(idx) = losing ? -std::min(level, magnitudes[k]) : level;
+    }
+    return vec;
+}
+
+arma::vec analyticGuess(const cv::Mat& block, unsigned char bit, int scheme, double margin) {
+    double magnitudes[64];
+    blockMagnitudes(block, magnitudes);
+    return analyticVector(magnitudes, bit, scheme, missingMargin(magnitudes, bit, scheme, margin));
+}
+
+arma::vec analyticCoefficientGuess(const int16_t* coefs, const uint16_t* quant, unsigned char bit, int scheme,
+                                   double margin) {
+    double magnitudes[64];
+    coefficientMagnitudes(coefs, quant, magnitudes);
+    return analyticVector(magnitudes, bit, scheme, missingMargin(magnitudes, bit, scheme, margin));
+}
+
+cv::Mat analyticEmbedBlock(const cv::Mat& block, unsigned char bit, int scheme, double margin) {
+    if (block.empty() || block.rows != 8 || block.cols != 8 || block.type() != CV_8UC1) {
+        throw std::invalid_argument("analyticEmbedBlock: block must be a non-empty 8x8 CV_8UC1 block");
+    }
+    double magnitudes[64];
+    blockMagnitudes(block, magnitudes);
+
+    cv::Mat result = block.clone();
+    solveWithCorrection(magnitudes, bit, scheme, margin, [&](const arma::vec& candidate) {
+        result = applyVectorToBlock(candidate, block, scheme);
+        cv::Mat resultFloat(8, 8, CV_64FC1), resultDct(8, 8, CV_64FC1);
+        result.convertTo(resultFloat, CV_64FC1);
+        cv::dct(resultFloat, resultDct);
+        const double s1 = getRegionSum(resultDct, s1_region[scheme]);
+        const double s0 = getRegionSum(resultDct, s0_region[scheme]);
+        return bit ? s1 - s0 : s0 - s1;
+    });
+    return result;
+}
+
+void analyticEmbedCoefficients(int16_t* coefs, const uint16_t* quant, unsigned char bit, int scheme, double margin) {
+    double magnitudes[64];
+    coefficientMagnitudes(coefs, quant, magnitudes);
+
+    int16_t original[64];
+    std::copy(coefs, coefs + 64, original);
+    solveWithCorrection(magnitudes, bit, scheme, margin, [&](const arma::vec& candidate) {
+        applyVectorToCoefficients(candidate, original, quant, coefs, scheme);
+        const double s1 = getCoefficientRegionSum(coefs, quant, s1_region[scheme]);
+        const double s0 = getCoefficientRegionSum(coefs, quant, s0_region[scheme]);
+        return bit ? s1 - s0 : s0 - s1;
+    });
+}
@@ -0,0 +1,149 @@
+#include "../include/attack_plan.h"
+#include "../include/attack_sweep.h"
+#include "../include/parallel.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::string lineError(size_t line, const std::string& message) {
+    return "AttackPlan: line " + std::to_string(line) + ": " + message;
+}
+
+} // namespace
+
+AttackPlan AttackPlan::parse(const std::string& text) {
+    AttackPlan plan;
+    bool has_tau = false;
+    std::stringstream lines(text);
+    size_t line_number = 0;
+    auto indexOf = [&](const std::string& id) -> int {
+        if (id == "copy") return copy;
+        for (size_t i = 0; i < plan.nodes_.size(); ++i) {
+            if (plan.nodes_[i].id == id) return static_cast<int>(i);
+        }
+        return -2;
+    };
+
+    for (std::string line; std::getline(lines, line);) {
+        line_number++;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::stringstream fields(line);
+        std::vector<std::string> tokens;
+        for (std::string token; fields >> token;) tokens.push_back(token);
+        if (tokens.empty()) continue;
+
+        if (tokens[0] == "tau") {
+            if (has_tau) {
+                throw std::invalid_argument(lineError(line_number, "more than one tau line"));
+            }
+            has_tau = true;
+            for (size_t k = 1; k < tokens.size(); ++k) {
+                const int index = indexOf(tokens[k]);
+                if (index == -2) {
+                    throw std::invalid_argument(lineError(line_number, "tau names undefined node '" + tokens[k] + "'"));
+                }
+                plan.tau_.push_back(index);
+            }
+            continue;
+        }
+
+        AttackNode node;
+        node.id = tokens[0];
+        if (tokens.size() < 2) {
+            throw std::invalid_argument(lineError(line_number, "expected: id attack [param] [<- input]"));
+        }
+        if (indexOf(node.id) != -2 || node.id == "tau") {
+            throw std::invalid_argument(lineError(line_number, "id '" + node.id + "' is already used"));
+        }
+        node.attack = tokens[1];
+        size_t next = 2;
+        try {
+            if (sweepAttackHasParam(node.attack)) {
+                if (next >= tokens.size() || tokens[next] == "<-") {
+                    throw std::invalid_argument(node.attack + " needs a parameter");
+                }
+                size_t used = 0;
+                node.param = std::stod(tokens[next], &used);
+                if (used != tokens[next].size()) {
+                    throw std::invalid_argument("bad parameter '" + tokens[next] + "'");
+                }
+                next++;
+            }
+            validateSweepGrid({{node.attack, {node.param}}});
+        } catch (const std::exception& e) {
+            throw std::invalid_argument(lineError(line_number, e.what()));
+        }
+        if (next < tokens.size()) {
+            if (tokens[next] != "<-" || next + 2 != tokens.size()) {
+                throw std::invalid_argument(lineError(line_number, "expected '<- input' after the attack"));
+            }
+            node.input = indexOf(tokens[next + 1]);
+            if (node.input == -2) {
+                throw std::invalid_argument(lineError(line_number, "input '" + tokens[next + 1] + "' is not defined above"));
+            }
+        }
+        plan.depths_.push_back(node.input == copy ? 1 : plan.depths_[node.input] + 1);
+        plan.nodes_.push_back(node);
+    }
+
+    if (!has_tau) {
+        plan.tau_.push_back(copy);
+        for (size_t i = 0; i < plan.nodes_.size(); ++i) plan.tau_.push_back(static_cast<int>(i));
+    }
+    if (plan.tau_.empty()) {
+        throw std::invalid_argument("AttackPlan: tau needs at least one node");
+    }
+    return plan;
+}
+
+AttackPlan AttackPlan::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("AttackPlan: could not read " + path);
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str());
+}
+
+AttackPlan AttackPlan::defaultPlan() {
+    return parse("jpeg70 jpeg 70\n"
+                 "contrast contrast 1.2\n");
+}
+
+std::vector<cv::Mat> AttackPlan::evaluate(const cv::Mat& copy_image, int threads, uint64_t seed) const {
+    // The deepest depth at which each output is still read: by a later node or, for tau, at the end
+    const int max_depth = depths_.empty() ? 0 : *std::max_element(depths_.begin(), depths_.end());
+    std::vector<int> last_read(nodes_.size(), 0);
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        if (nodes_[i].input != copy) last_read[nodes_[i].input] = std::max(last_read[nodes_[i].input], depths_[i]);
+    }
+    for (int index : tau_) {
+        if (index != copy) last_read[index] = max_depth + 1;
+    }
+
+    std::vector<cv::Mat> outputs(nodes_.size());
+    for (int depth = 1; depth <= max_depth; ++depth) {
+        std::vector<size_t> level;
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            if (depths_[i] == depth) level.push_back(i);
+        }
+        parallelFor(level.size(), resolveThreads(threads), [&](size_t k) {
+            const AttackNode& node = nodes_[level[k]];
+            const cv::Mat& input = node.input == copy ? copy_image : outputs[node.input];
+            outputs[level[k]] = applySweepAttack(input, node.attack, node.param, seed + level[k]);
+        });
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            if (depths_[i] <= depth && last_read[i] <= depth) outputs[i].release();
+        }
+    }
+
+    std::vector<cv::Mat> result;
+    result.reserve(tau_.size());
+    for (int index : tau_) result.push_back(index == copy ? copy_image : outputs[index]);
+    return result;
+}
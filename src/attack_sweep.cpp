@@ -0,0 +1,227 @@
+#include "../include/attack_sweep.h"
+#include "../include/attacks.h"
+#include "../include/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+enum class ParamKind { None, Quality, Probability, Deviation, Offset, Factor, OddKernel, Kernel };
+
+struct SweepAttackInfo {
+    const char* name;
+    ParamKind param;
+};
+
+const SweepAttackInfo sweep_attacks[] = {
+    {"none", ParamKind::None},
+    {"jpeg", ParamKind::Quality},
+    {"saltpepper", ParamKind::Probability},
+    {"speckle", ParamKind::Deviation},
+    {"gaussian", ParamKind::OddKernel},
+    {"median", ParamKind::OddKernel},
+    {"average", ParamKind::Kernel},
+    {"brightness", ParamKind::Offset},
+    {"contrast", ParamKind::Factor},
+    {"sharpen", ParamKind::None},
+    {"histeq", ParamKind::None},
+};
+
+const SweepAttackInfo* findAttack(const std::string& name) {
+    for (const SweepAttackInfo& info : sweep_attacks) {
+        if (name == info.name) return &info;
+    }
+    return nullptr;
+}
+
+double parseNumber(const std::string& text, const std::string& axis) {
+    char* end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    if (text.empty() || *end != '\0' || !std::isfinite(value)) {
+        throw std::invalid_argument("parseSweepGrid: bad number '" + text + "' in '" + axis + "'");
+    }
+    return value;
+}
+
+// start:stop:step with stop included; values are start + k * step so that steps do not accumulate
+std::vector<double> parseRange(const std::string& text, const std::string& axis) {
+    std::vector<std::string> parts;
+    std::stringstream fields(text);
+    for (std::string part; std::getline(fields, part, ':');) parts.push_back(part);
+    if (parts.size() != 3) {
+        throw std::invalid_argument("parseSweepGrid: range '" + text + "' must be start:stop:step");
+    }
+    const double start = parseNumber(parts[0], axis), stop = parseNumber(parts[1], axis), step = parseNumber(parts[2], axis);
+    if (!(step > 0.0) || stop < start) {
+        throw std::invalid_argument("parseSweepGrid: range '" + text + "' needs start <= stop and a positive step");
+    }
+    const double count = std::floor((stop - start) / step + 1e-9) + 1.0;
+    if (count > 10000.0) {
+        throw std::invalid_argument("parseSweepGrid: range '" + text + "' has too many points");
+    }
+    std::vector<double> values;
+    for (int k = 0; k < static_cast<int>(count); ++k) values.push_back(start + k * step);
+    return values;
+}
+
+int kernelSize(double param) {
+    return static_cast<int>(std::lround(param));
+}
+
+} // namespace
+
+const std::vector<std::string>& sweepAttackNames() {
+    static const std::vector<std::string> names = [] {
+        std::vector<std::string> all;
+        for (const SweepAttackInfo& info : sweep_attacks) all.push_back(info.name);
+        return all;
+    }();
+    return names;
+}
+
+void validateSweepGrid(const std::vector<SweepAxis>& grid) {
+    for (const SweepAxis& axis : grid) {
+        const SweepAttackInfo* info = findAttack(axis.attack);
+        if (info == nullptr) {
+            throw std::invalid_argument("validateSweepGrid: unknown attack '" + axis.attack + "'");
+        }
+        if (axis.params.empty()) {
+            throw std::invalid_argument("validateSweepGrid: '" + axis.attack + "' has no parameter values");
+        }
+        for (double param : axis.params) {
+            bool valid = std::isfinite(param);
+            switch (info->param) {
+            case ParamKind::None:
+            case ParamKind::Offset: break;
+            case ParamKind::Quality: valid = valid && param >= 1.0 && param <= 100.0; break;
+            case ParamKind::Probability: valid = valid && param >= 0.0 && param <= 1.0; break;
+            case ParamKind::Deviation: valid = valid && param >= 0.0; break;
+            case ParamKind::Factor: valid = valid && param > 0.0; break;
+            case ParamKind::OddKernel: valid = valid && kernelSize(param) >= 1 && kernelSize(param) % 2 == 1; break;
+            case ParamKind::Kernel: valid = valid && kernelSize(param) >= 1; break;
+            }
+            if (!valid) {
+                std::ostringstream message;
+                message << "validateSweepGrid: " << axis.attack << " cannot take " << param;
+                throw std::invalid_argument(message.str());
+            }
+        }
+    }
+}
+
+std::vector<SweepAxis> parseSweepGrid(const std::string& spec) {
+    std::vector<SweepAxis> grid;
+    std::stringstream axes(spec);
+    for (std::string item; std::getline(axes, item, ';');) {
+        if (item.empty()) continue;
+        const size_t equals = item.find('=');
+        SweepAxis axis;
+        axis.attack = item.substr(0, equals);
+        const SweepAttackInfo* info = findAttack(axis.attack);
+        if (info == nullptr) {
+            throw std::invalid_argument("parseSweepGrid: unknown attack '" + axis.attack + "'");
+        }
+        if ((info->param == ParamKind::None) != (equals == std::string::npos)) {
+            throw std::invalid_argument("parseSweepGrid: '" + axis.attack +
+                                        (info->param == ParamKind::None ? "' takes no parameter" : "' needs parameter values"));
+        }
+        if (equals == std::string::npos) {
+            axis.params = {0.0};
+        } else {
+            const std::string values = item.substr(equals + 1);
+            if (values.find(':') != std::string::npos) {
+                axis.params = parseRange(values, item);
+            } else {
+                std::stringstream list(values);
+                for (std::string value; std::getline(list, value, ',');) axis.params.push_back(parseNumber(value, item));
+            }
+        }
+        grid.push_back(axis);
+    }
+    validateSweepGrid(grid);
+    return grid;
+}
+
+bool sweepAttackHasParam(const std::string& name) {
+    const SweepAttackInfo* info = findAttack(name);
+    if (info == nullptr) {
+        throw std::invalid_argument("sweepAttackHasParam: unknown attack '" + name + "'");
+    }
+    return info->param != ParamKind::None;
+}
+
+cv::Mat applySweepAttack(const cv::Mat& image, const std::string& name, double param, uint64_t seed) {
+    if (name == "none") return image.clone();
+    if (name == "jpeg") return jpegCompression(image, static_cast<int>(std::lround(param)));
+    if (name == "saltpepper") return saltPepperNoise(image, param, seed);
+    if (name == "speckle") return speckleNoise(image, param, seed);
+    if (name == "gaussian") return gaussianFiltering(image, kernelSize(param));
+    if (name == "median") return medianFiltering(image, kernelSize(param));
+    if (name == "average") return averageFiltering(image, kernelSize(param));
+    if (name == "brightness") {
+        const int offset = static_cast<int>(std::lround(param));
+        return offset >= 0 ? brightnessIncrease(image, offset) : brightnessDecrease(image, -offset);
+    }
+    if (name == "contrast") return contrastIncrease(image, param);
+    if (name == "sharpen") return sharpening(image);
+    if (name == "histeq") return histogramEqualization(image);
+    throw std::invalid_argument("applySweepAttack: unknown attack '" + name + "'");
+}
+
+AttackSweep::AttackSweep(const cv::Mat& original, const cv::Mat& watermarked, const WatermarkBits& bits,
+                         const gbo::Config& config)
+    : watermarked_(watermarked.clone()), reference_(original), dct_(watermarked, config.threads), bits_(bits),
+      config_(config) {
+    if (watermarked.type() != CV_8UC1 || watermarked.size() != original.size()) {
+        throw std::invalid_argument("AttackSweep: images must be CV_8UC1 of the same size");
+    }
+}
+
+cv::Mat AttackSweep::attack(const std::string& name, double param, uint64_t seed) const {
+    // Same pixels as jpegCompression, without its forward DCT
+    if (name == "jpeg") return dct_.compress(JpegSimulator(static_cast<int>(std::lround(param))));
+    return applySweepAttack(watermarked_, name, param, seed);
+}
+
+std::vector<SweepPoint> AttackSweep::run(const std::vector<SweepAxis>& grid, const SweepOptions& options) const {
+    validateSweepGrid(grid);
+    std::vector<SweepPoint> points;
+    for (const SweepAxis& axis : grid) {
+        for (double param : axis.params) {
+            SweepPoint point;
+            point.attack = axis.attack;
+            point.param = param;
+            points.push_back(point);
+        }
+    }
+
+    // The points run in parallel; each one extracts and compares on its own thread
+    gbo::Config extraction = config_;
+    extraction.threads = 1;
+    parallelFor(points.size(), resolveThreads(options.threads), [&](size_t k) {
+        SweepPoint& point = points[k];
+        const cv::Mat attacked = attack(point.attack, point.param, options.seed);
+        WatermarkBits extracted(bits_.size());
+        gbo::extract(gbo::ConstImageView(attacked.data, attacked.cols, attacked.rows, attacked.step[0]), extracted, extraction);
+        point.ber = computeBER(bits_, extracted);
+        point.quality = computeImageQuality(reference_, attacked);
+    });
+    return points;
+}
+
+void writeSweepCsv(std::ostream& out, const std::vector<SweepPoint>& points) {
+    out << "attack,param,ber,psnr,ssim,ncc,mse\n";
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::defaultfloat << std::setprecision(8);
+    for (const SweepPoint& point : points) {
+        out << point.attack << ',' << point.param << ',' << point.ber << ',' << point.quality.psnr << ','
+            << point.quality.ssim << ',' << point.quality.ncc << ',' << point.quality.mse << '\n';
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
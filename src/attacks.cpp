@@ -1,5 +1,31 @@
 #include "../include/attacks.h"
+#include "../include/jpeg_simulator.h"
+#include "../include/random_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
+namespace {
+
+// Noise values are drawn a row at a time, this many per batch
+const int noise_batch = 256;
+
+void checkNoiseInput(const cv::Mat& image, const std::string& name) {
+    if (image.empty() || image.type() != CV_8UC1) {
+        throw std::invalid_argument(name + ": image must be a non-empty CV_8UC1 matrix");
+    }
+}
+
+} // namespace
+
+NoiseStream::NoiseStream(uint64_t seed) : key_(mixSeed(seed, 0)) {}
+
+void NoiseStream::fill(uint64_t* out, size_t n) {
+    // Value i of the stream is mixSeed(key, i): independent of how it is batched
+    const uint64_t base = key_ + 0x9e3779b97f4a7c15ULL * counter_;
+    for (size_t i = 0; i < n; ++i) out[i] = mixSeed(base, i);
+    counter_ += n;
+}
 
 // Brightness Increase
 cv::Mat brightnessIncrease(const cv::Mat& image, int value) {
@@ -30,35 +56,66 @@ cv::Mat contrastDecrease(const cv::Mat& image, double alpha) {
 }
 
 // Salt-Pepper Noise
-cv::Mat saltPepperNoise(const cv::Mat& image, double noiseProb) {
-    cv::Mat result = image.clone();
-    int numPixels = result.rows * result.cols;
-    for (int i = 0; i < numPixels; i++) {
-        if (rand() % 100 < noiseProb * 100) {
-            int row = rand() % result.rows;
-            int col = rand() % result.cols;
-            if (rand() % 2 == 0) {
-                result.at<uchar>(row, col) = 0;  // Salt
-            }
-            else {
-                result.at<uchar>(row, col) = 255;  // Pepper
+cv::Mat saltPepperNoise(const cv::Mat& image, double noiseProb, NoiseStream& rng) {
+    checkNoiseInput(image, "saltPepperNoise");
+    // A pixel is hit when the low 32 bits of its value fall below the threshold; bit 32 picks 0 or 255
+    const uint64_t threshold = static_cast<uint64_t>(std::clamp(noiseProb, 0.0, 1.0) * 4294967296.0);
+    cv::Mat result(image.size(), CV_8UC1);
+    uint64_t values[noise_batch];
+    for (int y = 0; y < image.rows; ++y) {
+        const uchar* src = image.ptr<uchar>(y);
+        uchar* dst = result.ptr<uchar>(y);
+        for (int x0 = 0; x0 < image.cols; x0 += noise_batch) {
+            const int n = std::min(noise_batch, image.cols - x0);
+            rng.fill(values, n);
+            for (int i = 0; i < n; ++i) {
+                const uchar noise = static_cast<uchar>(0 - ((values[i] >> 32) & 1u));
+                dst[x0 + i] = (values[i] & 0xffffffffu) < threshold ? noise : src[x0 + i];
             }
         }
     }
     return result;
 }
 
+cv::Mat saltPepperNoise(const cv::Mat& image, double noiseProb, uint64_t seed) {
+    NoiseStream rng(seed);
+    return saltPepperNoise(image, noiseProb, rng);
+}
+
 // Speckle Noise
-cv::Mat speckleNoise(const cv::Mat& image, double noiseStddev) {
-    cv::Mat noise = cv::Mat(image.size(), CV_64F);
-    randn(noise, 0, noiseStddev);  // Generate Gaussian noise
-    cv::Mat result;
-    image.convertTo(result, CV_64F);
-    result = result + noise;
-    result.convertTo(result, image.type());
+cv::Mat speckleNoise(const cv::Mat& image, double noiseStddev, NoiseStream& rng) {
+    checkNoiseInput(image, "speckleNoise");
+    const float sigma = static_cast<float>(noiseStddev);
+    cv::Mat result(image.size(), CV_8UC1);
+    uint64_t values[noise_batch];
+    float noise[2 * noise_batch];
+    for (int y = 0; y < image.rows; ++y) {
+        const uchar* src = image.ptr<uchar>(y);
+        uchar* dst = result.ptr<uchar>(y);
+        for (int x0 = 0; x0 < image.cols; x0 += 2 * noise_batch) {
+            const int n = std::min(2 * noise_batch, image.cols - x0);
+            const int pairs = (n + 1) / 2;
+            rng.fill(values, pairs);
+            // Box-Muller in float: one value gives the noise of two neighbouring pixels
+            for (int i = 0; i < pairs; ++i) {
+                const float u1 = (static_cast<float>(values[i] >> 40) + 0.5f) * (1.0f / 16777216.0f);
+                const float u2 = static_cast<float>((values[i] >> 8) & 0xffffffu) * (1.0f / 16777216.0f);
+                const float r = sigma * std::sqrt(-2.0f * std::log(u1));
+                const float angle = 6.28318531f * u2;
+                noise[2 * i] = r * std::cos(angle);
+                noise[2 * i + 1] = r * std::sin(angle);
+            }
+            for (int i = 0; i < n; ++i) dst[x0 + i] = cv::saturate_cast<uchar>(src[x0 + i] + noise[i]);
+        }
+    }
     return result;
 }
 
+cv::Mat speckleNoise(const cv::Mat& image, double noiseStddev, uint64_t seed) {
+    NoiseStream rng(seed);
+    return speckleNoise(image, noiseStddev, rng);
+}
+
 // Histogram Equalization
 cv::Mat histogramEqualization(const cv::Mat& image) {
     cv::Mat result;
@@ -79,6 +136,10 @@ cv::Mat sharpening(const cv::Mat& image) {
 
 // JPEG Compression
 cv::Mat jpegCompression(const cv::Mat& image, int quality) {
+    if (image.type() == CV_8UC1 && !image.empty()) {
+        // Same pixels as the codec round trip below (see jpeg_simulator.h); imencode clamps the quality
+        return simulateJpeg(image, std::clamp(quality, 1, 100));
+    }
     std::vector<int> compression_params = { cv::IMWRITE_JPEG_QUALITY, quality };
     std::vector<uchar> encoded_image;
     cv::imencode(".jpg", image, encoded_image, compression_params);
@@ -104,4 +165,24 @@ cv::Mat averageFiltering(const cv::Mat& image, int ksize) {
     cv::Mat result;
     cv::blur(image, result, cv::Size(ksize, ksize));
     return result;
-}
\ No newline at end of file
+}
+
+const std::vector<AttackInfo>& standardAttacks() {
+    static const std::vector<AttackInfo> attacks = {
+        {"Brightness +30", [](const cv::Mat &img, double v, uint64_t){return brightnessIncrease(img, static_cast<int>(v));}, 30},
+        {"Brightness -30", [](const cv::Mat &img, double v, uint64_t){return brightnessDecrease(img, static_cast<int>(v));}, 30},
+        {"Contrast *1.2",   [](const cv::Mat &img, double v, uint64_t){return contrastIncrease(img, v);}, 1.2},
+        {"Contrast *0.8",   [](const cv::Mat &img, double v, uint64_t){return contrastDecrease(img, v);}, 0.8},
+        {"Salt&Pepper 5%", [](const cv::Mat &img, double v, uint64_t seed){return saltPepperNoise(img, v, seed);}, 0.05},
+        {"Speckle 20",      [](const cv::Mat &img, double v, uint64_t seed){return speckleNoise(img, v, seed);}, 20},
+        {"Histogram Eq",    [](const cv::Mat &img, double, uint64_t){return histogramEqualization(img);}, 0},
+        {"Sharpen",         [](const cv::Mat &img, double, uint64_t){return sharpening(img);}, 0},
+        {"JPEG q=70",       [](const cv::Mat &img, double v, uint64_t){return jpegCompression(img, static_cast<int>(v));}, 70},
+        {"JPEG q=80",       [](const cv::Mat &img, double v, uint64_t){return jpegCompression(img, static_cast<int>(v));}, 80},
+        {"JPEG q=90",       [](const cv::Mat &img, double v, uint64_t){return jpegCompression(img, static_cast<int>(v));}, 90},
+        {"Gaussian k=3",    [](const cv::Mat &img, double v, uint64_t){return gaussianFiltering(img, static_cast<int>(v));}, 3},
+        {"Median k=3",      [](const cv::Mat &img, double v, uint64_t){return medianFiltering(img, static_cast<int>(v));}, 3},
+        {"Average k=3",     [](const cv::Mat &img, double v, uint64_t){return averageFiltering(img, static_cast<int>(v));}, 3}
+    };
+    return attacks;
+}
@@ -0,0 +1,1512 @@
+#include "../include/benchmarks.h"
+#include "../include/analytic_embed.h"
+#include "../include/attacks.h"
+#include "../include/attack_plan.h"
+#include "../include/attack_sweep.h"
+#include "../include/block_arena.h"
+#include "../include/dataset_builder.h"
+#include "../include/daemon.h"
+#include "../include/gbo_api.h"
+#include "../include/jpeg_coefficients.h"
+#include "../include/jpeg_simulator.h"
+#include "../include/launch.h"
+#include "../include/local_refinement.h"
+#include "../include/lockstep_gbo.h"
+#include "../include/metrics.h"
+#include "../include/optimizer.h"
+#include "../include/parallel.h"
+#include "../include/population.h"
+#include "../include/process_block.h"
+#include "../include/process_images.h"
+#include "../include/random_utils.h"
+#include "../include/scheme_classifier.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <sstream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// "--key value" pairs; bare flags map to an empty string
+class BenchArgs {
+public:
+    explicit BenchArgs(const std::vector<std::string>& args) {
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (args[i].rfind("--", 0) != 0) {
+                throw std::invalid_argument("unexpected argument: " + args[i]);
+            }
+            const std::string key = args[i].substr(2);
+            const bool has_value = i + 1 < args.size() && args[i + 1].rfind("--", 0) != 0;
+            values_[key] = has_value ? args[++i] : "";
+        }
+    }
+
+    std::string get(const std::string& key, const std::string& fallback) const {
+        auto it = values_.find(key);
+        return it == values_.end() ? fallback : it->second;
+    }
+    int getInt(const std::string& key, int fallback) const {
+        auto it = values_.find(key);
+        return it == values_.end() ? fallback : std::atoi(it->second.c_str());
+    }
+    uint64_t getSeed(const std::string& key, uint64_t fallback) const {
+        auto it = values_.find(key);
+        return it == values_.end() ? fallback : std::strtoull(it->second.c_str(), nullptr, 10);
+    }
+    bool has(const std::string& key) const { return values_.count(key) != 0; }
+
+private:
+    std::map<std::string, std::string> values_;
+};
+
+gbo::Config configFromArgs(const BenchArgs& args) {
+    gbo::Config config;
+    config.scheme = args.getInt("scheme", 0);
+    config.threads = std::max(0, args.getInt("threads", 0));
+    config.seed = args.getSeed("seed", 1);
+    config.iterations = std::max(1, args.getInt("iterations", 40));
+    config.method = parseEmbedMethod(args.get("method", "gbo"));
+    if (args.has("margin")) config.margin = std::atof(args.get("margin", "").c_str());
+    config.warm_start = parseWarmStart(args.get("warm-start", "none"));
+    config.optimizer = args.get("optimizer", "gbo");
+    config.evaluations = static_cast<size_t>(args.getSeed("evaluations", 0));
+    config.surrogate = args.has("surrogate");
+    if (args.has("surrogate-tolerance")) config.surrogate_tolerance = std::atof(args.get("surrogate-tolerance", "").c_str());
+    config.time_budget_ms = std::max(0.0, std::atof(args.get("time-budget", "0").c_str()));
+    config.block_time_budget_ms = std::max(0.0, std::atof(args.get("block-time-budget", "0").c_str()));
+    config.lockstep = args.has("lockstep");
+    if (args.has("robust")) config.robustness_attacks = parseBlockAttacks(args.get("robust", ""));
+    config.robustness_weight = std::max(0.0, std::atof(args.get("robust-weight", "1").c_str()));
+    return config;
+}
+
+struct JpegPathResult {
+    std::string name;
+    double read_ms = 0.0;
+    double embed_ms = 0.0;
+    double write_ms = 0.0;
+    double extract_ms = 0.0;
+    size_t bytes = 0;
+    double psnr = 0.0;
+    double ber = 0.0;
+
+    double totalEmbedMs() const { return read_ms + embed_ms + write_ms; }
+};
+
+void printJpegResults(const std::vector<JpegPathResult>& results) {
+    std::cout << std::left << std::setw(14) << "path" << std::right
+              << std::setw(10) << "read ms" << std::setw(11) << "embed ms" << std::setw(10) << "write ms"
+              << std::setw(10) << "total ms" << std::setw(12) << "extract ms" << std::setw(10) << "bytes"
+              << std::setw(9) << "PSNR" << std::setw(8) << "BER" << std::endl;
+    std::cout << std::fixed;
+    for (const auto& r : results) {
+        std::cout << std::left << std::setw(14) << r.name << std::right << std::setprecision(2)
+                  << std::setw(10) << r.read_ms << std::setw(11) << r.embed_ms << std::setw(10) << r.write_ms
+                  << std::setw(10) << r.totalEmbedMs() << std::setw(12) << r.extract_ms << std::setw(10) << r.bytes
+                  << std::setw(9) << r.psnr << std::setw(8) << std::setprecision(4) << r.ber << std::endl;
+    }
+}
+
+// "112,32,16" -> {112, 32, 16}
+std::vector<int> parseIntList(const std::string& text) {
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) values.push_back(std::atoi(item.c_str()));
+    }
+    return values;
+}
+
+// "a,b,c" -> {"a", "b", "c"}
+std::vector<std::string> parseNameList(const std::string& text) {
+    std::vector<std::string> names;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) names.push_back(item);
+    }
+    return names;
+}
+
+// Up to `wanted` 8x8 blocks spread evenly over the image, in raster order
+std::vector<cv::Rect> sampleBlocks(const cv::Mat& image, int wanted) {
+    const int blocks_per_row = image.cols / 8;
+    const size_t total = static_cast<size_t>(blocks_per_row) * (image.rows / 8);
+    const size_t count = std::min(total, static_cast<size_t>(std::max(1, wanted)));
+    std::vector<cv::Rect> rects;
+    for (size_t k = 0; k < count; ++k) {
+        const size_t index = k * total / count;
+        rects.emplace_back(static_cast<int>(index % blocks_per_row) * 8, static_cast<int>(index / blocks_per_row) * 8, 8, 8);
+    }
+    return rects;
+}
+
+// Losing over winning region sum of a marked block: below 1 it decodes to `bit`, lower is more robust
+double losingRatio(const cv::Mat& block, unsigned char bit, int scheme) {
+    cv::Mat floatBlock, dctBlock;
+    block.convertTo(floatBlock, CV_64FC1);
+    cv::dct(floatBlock, dctBlock);
+    const double s1 = getRegionSum(dctBlock, s1_region[scheme]);
+    const double s0 = getRegionSum(dctBlock, s0_region[scheme]);
+    return bit ? s0 / s1 : s1 / s0;
+}
+
+// A "Field:   123 kB" line of /proc/self/status in kB, -1 where there is none (not Linux)
+long statusKb(const std::string& field) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind(field + ":", 0) == 0) return std::atol(line.c_str() + field.size() + 1);
+    }
+    return -1;
+}
+
+// Starts a new VmHWM measurement; false where the kernel does not support it
+bool resetPeakRss() {
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.flush();
+    return static_cast<bool>(clear_refs);
+}
+
+// A block attack applied to the whole image, as the extractor would receive it
+cv::Mat attackImage(const cv::Mat& image, const BlockAttack& attack) {
+    cv::Mat out;
+    switch (attack.kind) {
+    case BlockAttack::Kind::Jpeg: return jpegCompression(image, static_cast<int>(std::lround(attack.param)));
+    case BlockAttack::Kind::Gain: image.convertTo(out, -1, attack.param, 0.0); return out;
+    case BlockAttack::Kind::Offset: image.convertTo(out, -1, 1.0, attack.param); return out;
+    case BlockAttack::Kind::Average: return averageFiltering(image, 3);
+    case BlockAttack::Kind::Gaussian: return gaussianFiltering(image, 3);
+    case BlockAttack::Kind::Sharpen: return sharpening(image);
+    }
+    return image.clone();
+}
+
+} // namespace
+
+int runJpegBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const gbo::Config config = configFromArgs(args);
+        const int quality = args.getInt("quality", 90);
+
+        // Both paths start from the same JPEG bytes
+        std::vector<unsigned char> jpeg;
+        if (args.has("image")) {
+            jpeg = readFileBytes(args.get("image", ""));
+        } else {
+            cv::Mat source = cv::imread("images/pepper.png", cv::IMREAD_GRAYSCALE);
+            if (source.empty() || !cv::imencode(".jpg", source, jpeg, {cv::IMWRITE_JPEG_QUALITY, quality})) {
+                throw std::runtime_error("could not prepare the default JPEG from images/pepper.png");
+            }
+        }
+        const std::string watermark_path = args.get("watermark", "images/watermark.png");
+        cv::Mat watermark = cv::imread(watermark_path, cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::runtime_error("Could not open or find the watermark: " + watermark_path);
+        }
+        const WatermarkBits bits = extract_watermark_bits(watermark);
+
+        cv::Mat original = cv::imdecode(jpeg, cv::IMREAD_GRAYSCALE);
+        if (original.empty()) {
+            throw std::runtime_error("input is not a readable JPEG");
+        }
+        // The pixel path needs whole blocks
+        original = original(cv::Rect(0, 0, original.cols / 8 * 8, original.rows / 8 * 8)).clone();
+
+        std::cout << "JPEG benchmark: " << original.cols << "x" << original.rows << ", " << jpeg.size()
+                  << " bytes, scheme " << config.scheme << ", " << config.iterations << " iterations, "
+                  << (config.threads == 0 ? std::string("all") : std::to_string(config.threads)) << " threads"
+                  << (args.has("image") ? "" : ", re-encode quality " + std::to_string(quality)) << std::endl;
+
+        auto quality_of = [&](const std::vector<unsigned char>& output, JpegPathResult& r) {
+            cv::Mat decoded = cv::imdecode(output, cv::IMREAD_GRAYSCALE);
+            r.bytes = output.size();
+            r.psnr = computePSNR(original, decoded(cv::Rect(0, 0, original.cols, original.rows)));
+        };
+
+        // Pixel path: decode -> GBO on pixel blocks -> re-encode
+        JpegPathResult pixel;
+        pixel.name = "pixel";
+        {
+            Clock::time_point t0 = Clock::now();
+            cv::Mat decoded = cv::imdecode(jpeg, cv::IMREAD_GRAYSCALE);
+            decoded = decoded(cv::Rect(0, 0, original.cols, original.rows)).clone();
+            pixel.read_ms = millisecondsSince(t0);
+
+            t0 = Clock::now();
+            cv::Mat marked = embedWatermarkMat(decoded, watermark, config);
+            pixel.embed_ms = millisecondsSince(t0);
+
+            t0 = Clock::now();
+            std::vector<unsigned char> output;
+            cv::imencode(".jpg", marked, output, {cv::IMWRITE_JPEG_QUALITY, quality});
+            pixel.write_ms = millisecondsSince(t0);
+            quality_of(output, pixel);
+
+            t0 = Clock::now();
+            cv::Mat reread = cv::imdecode(output, cv::IMREAD_GRAYSCALE);
+            cv::Mat extracted = extractWatermarkMat(reread, config);
+            pixel.extract_ms = millisecondsSince(t0);
+            pixel.ber = computeBER(bits, extract_watermark_bits(extracted));
+        }
+
+        // Coefficient path: entropy decode -> GBO on quantized coefficients -> entropy encode
+        JpegPathResult coefficient;
+        coefficient.name = "coefficient";
+        {
+            Clock::time_point t0 = Clock::now();
+            JpegCoefficientImage image = JpegCoefficientImage::fromBytes(jpeg);
+            coefficient.read_ms = millisecondsSince(t0);
+
+            t0 = Clock::now();
+            gbo::embed(image, bits, config);
+            coefficient.embed_ms = millisecondsSince(t0);
+
+            t0 = Clock::now();
+            std::vector<unsigned char> output = image.encode();
+            coefficient.write_ms = millisecondsSince(t0);
+            quality_of(output, coefficient);
+
+            t0 = Clock::now();
+            WatermarkBits extracted(bits.size());
+            gbo::extract(JpegCoefficientImage::fromBytes(output), extracted, config);
+            coefficient.extract_ms = millisecondsSince(t0);
+            coefficient.ber = computeBER(bits, extracted);
+        }
+
+        printJpegResults({pixel, coefficient});
+        std::cout << std::setprecision(2) << "Embedding speed-up: " << pixel.totalEmbedMs() / coefficient.totalEmbedMs()
+                  << "x, extraction speed-up: " << pixel.extract_ms / coefficient.extract_ms << "x" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runClassifierBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        gbo::Config config = configFromArgs(args);
+        const std::string model_path = args.get("model", "best_scheme_classifier.bin");
+        SchemeClassifier classifier = SchemeClassifier::load(model_path);
+        // The file stores the size the engine runs at; agreement is measured against the first size,
+        // by default the 112x112 training resolution
+        const int model_size = classifier.inputSize();
+        std::vector<int> sizes = parseIntList(args.get("sizes", "112,32,16,8"));
+        if (sizes.empty()) {
+            throw std::runtime_error("--sizes needs at least one size");
+        }
+
+        const std::string image_path = args.get("image", "images/lenna.png");
+        cv::Mat image = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + image_path);
+        }
+        image = image(cv::Rect(0, 0, image.cols / 8 * 8, image.rows / 8 * 8)).clone();
+        const std::string watermark_path = args.get("watermark", "images/watermark.png");
+        cv::Mat watermark = cv::imread(watermark_path, cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::runtime_error("Could not open or find the watermark: " + watermark_path);
+        }
+        const WatermarkBits bits = extract_watermark_bits(watermark);
+
+        std::vector<const unsigned char*> blocks;
+        for (int y = 0; y < image.rows; y += 8) {
+            for (int x = 0; x < image.cols; x += 8) blocks.push_back(image.ptr(y) + x);
+        }
+
+        std::cout << "Classifier benchmark: " << image_path << " (" << blocks.size() << " blocks), model "
+                  << model_path << " at " << model_size << "x" << model_size << ", "
+                  << (config.threads == 0 ? std::string("all") : std::to_string(config.threads)) << " threads"
+                  << std::endl;
+
+        // Reference cost: one fixed-scheme GBO embedding of the same image
+        cv::Mat fixed = image.clone();
+        Clock::time_point t0 = Clock::now();
+        gbo::embed(gbo::ImageView{fixed.data, fixed.cols, fixed.rows, fixed.step}, bits, config);
+        const double gbo_ms = millisecondsSince(t0);
+        std::cout << std::fixed << std::setprecision(2) << "GBO embedding (scheme " << config.scheme << ", "
+                  << config.iterations << " iterations): " << gbo_ms << " ms, " << 1000.0 * gbo_ms / blocks.size()
+                  << " us/block" << std::endl;
+
+        std::cout << std::setw(6) << "size" << std::setw(12) << "MMAC/block" << std::setw(12) << "total ms"
+                  << std::setw(12) << "us/block" << std::setw(12) << "% of GBO" << std::setw(12) << "scheme 1"
+                  << std::setw(14) << "agree w/ " + std::to_string(sizes.front()) << std::endl;
+        std::vector<int> reference;
+        for (int size : sizes) {
+            classifier.setInputSize(size);
+            t0 = Clock::now();
+            std::vector<int> schemes = classifier.classify(blocks, image.step, config.threads);
+            const double ms = millisecondsSince(t0);
+            if (reference.empty()) reference = schemes;
+            size_t ones = 0, agree = 0;
+            for (size_t i = 0; i < schemes.size(); ++i) {
+                ones += schemes[i];
+                if (!reference.empty() && reference[i] == schemes[i]) agree++;
+            }
+            std::cout << std::setw(6) << size << std::setw(12) << classifier.macsPerBlock() / 1e6 << std::setw(12) << ms
+                      << std::setw(12) << 1000.0 * ms / blocks.size() << std::setw(11) << 100.0 * ms / gbo_ms << "%"
+                      << std::setw(11) << 100.0 * ones / schemes.size() << "%";
+            if (reference.empty()) {
+                std::cout << std::setw(14) << "-";
+            } else {
+                std::cout << std::setw(13) << 100.0 * agree / schemes.size() << "%";
+            }
+            std::cout << std::endl;
+        }
+
+        // End-to-end adaptive embedding at the requested (default: the model file's) resolution
+        classifier.setInputSize(args.getInt("input-size", model_size));
+        config.classifier = std::make_shared<const SchemeClassifier>(classifier);
+        cv::Mat adaptive = image.clone();
+        t0 = Clock::now();
+        gbo::EmbedStats stats = gbo::embed(gbo::ImageView{adaptive.data, adaptive.cols, adaptive.rows, adaptive.step},
+                                           bits, config);
+        const double adaptive_ms = millisecondsSince(t0);
+        WatermarkBits extracted(bits.size());
+        t0 = Clock::now();
+        gbo::extract(gbo::ConstImageView(adaptive.data, adaptive.cols, adaptive.rows, adaptive.step), extracted, config);
+        const double extract_ms = millisecondsSince(t0);
+
+        std::cout << "Adaptive embedding at " << classifier.inputSize() << "x" << classifier.inputSize() << ": "
+                  << adaptive_ms << " ms (" << adaptive_ms / gbo_ms << "x fixed scheme), schemes 0/1 = "
+                  << stats.scheme_blocks[0] << "/" << stats.scheme_blocks[1] << ", re-embedded " << stats.reembedded
+                  << ", inconsistent " << stats.inconsistent << std::endl;
+        std::cout << "Adaptive extraction: " << extract_ms << " ms, PSNR " << computePSNR(image, adaptive)
+                  << " (fixed scheme " << computePSNR(image, fixed) << "), BER " << std::setprecision(4)
+                  << computeBER(bits, extracted) << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runFastEmbedBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        gbo::Config config = configFromArgs(args);
+        const int quality = args.getInt("quality", 80);
+        // --margins compares several margins against one GBO run; the default is --margin alone
+        std::vector<double> margins;
+        for (const std::string& item : parseNameList(args.get("margins", std::to_string(config.margin)))) {
+            margins.push_back(std::atof(item.c_str()));
+            if (!(margins.back() > 0.0)) {
+                throw std::invalid_argument("margins must be positive");
+            }
+        }
+        std::vector<std::string> paths = images;
+        if (args.has("images")) {
+            paths.clear();
+            std::stringstream list(args.get("images", ""));
+            std::string path;
+            while (std::getline(list, path, ',')) paths.push_back(path);
+        }
+        const std::string watermark_path = args.get("watermark", "images/watermark.png");
+        cv::Mat watermark = cv::imread(watermark_path, cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::runtime_error("Could not open or find the watermark: " + watermark_path);
+        }
+        const WatermarkBits bits = extract_watermark_bits(watermark);
+
+        std::cout << "Fast-embed benchmark: GBO (" << config.iterations << " iterations) vs analytic, scheme "
+                  << config.scheme << ", " << (config.threads == 0 ? std::string("all") : std::to_string(config.threads))
+                  << " threads, BER after JPEG q=" << quality << std::endl;
+        std::cout << std::left << std::setw(28) << "image" << std::setw(14) << "method" << std::right
+                  << std::setw(12) << "embed ms" << std::setw(9) << "PSNR" << std::setw(8) << "SSIM"
+                  << std::setw(8) << "BER" << std::setw(10) << "BER jpeg" << std::endl;
+
+        // Run 0 is GBO, run 1 + k the analytic embedder with margins[k]
+        const size_t runs = margins.size() + 1;
+        std::vector<std::string> labels = {"gbo"};
+        for (double margin : margins) {
+            std::ostringstream label;
+            label << "analytic " << margin;
+            labels.push_back(label.str());
+        }
+        std::vector<double> total_ms(runs, 0.0), total_psnr(runs, 0.0), worst_ber_jpeg(runs, 0.0);
+        size_t measured = 0;
+        for (const std::string& path : paths) {
+            cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+            if (image.empty()) {
+                std::cerr << "Skipping unreadable image " << path << std::endl;
+                continue;
+            }
+            image = image(cv::Rect(0, 0, image.cols / 8 * 8, image.rows / 8 * 8)).clone();
+            for (size_t m = 0; m < runs; ++m) {
+                gbo::Config run = config;
+                run.method = m == 0 ? gbo::Method::Gbo : gbo::Method::Analytic;
+                if (m > 0) run.margin = margins[m - 1];
+                Clock::time_point t0 = Clock::now();
+                cv::Mat marked = embedWatermarkMat(image, watermark, run);
+                const double ms = millisecondsSince(t0);
+                const double psnr = computePSNR(image, marked);
+                const double ber = computeBER(bits, extract_watermark_bits(extractWatermarkMat(marked, run)));
+                cv::Mat compressed = jpegCompression(marked, quality);
+                const double ber_jpeg = computeBER(bits, extract_watermark_bits(extractWatermarkMat(compressed, run)));
+                total_ms[m] += ms;
+                total_psnr[m] += psnr;
+                worst_ber_jpeg[m] = std::max(worst_ber_jpeg[m], ber_jpeg);
+
+                std::cout << std::left << std::setw(28) << std::filesystem::path(path).filename().string()
+                          << std::setw(14) << labels[m] << std::right << std::fixed
+                          << std::setprecision(2) << std::setw(12) << ms << std::setw(9) << psnr
+                          << std::setprecision(4) << std::setw(8) << computeSSIM(image, marked)
+                          << std::setw(8) << ber << std::setw(10) << ber_jpeg << std::endl;
+            }
+            measured++;
+        }
+        if (measured == 0) {
+            throw std::runtime_error("no readable images");
+        }
+        std::cout << "Over " << measured << " images:" << std::endl;
+        for (size_t m = 0; m < runs; ++m) {
+            std::cout << "  " << std::left << std::setw(14) << labels[m] << std::right << std::setprecision(2)
+                      << "mean embed " << total_ms[m] / measured << " ms";
+            if (m > 0) std::cout << " (" << total_ms[0] / total_ms[m] << "x faster)";
+            std::cout << ", mean PSNR " << total_psnr[m] / measured << " dB, worst BER jpeg " << std::setprecision(4)
+                      << worst_ber_jpeg[m] << std::endl;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runWarmStartBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const gbo::Config base = configFromArgs(args);
+        const std::vector<int> budgets = parseIntList(args.get("budgets", "30,20,15,10,5"));
+        const double psnr_tolerance = std::atof(args.get("psnr-tolerance", "0.1").c_str());
+        const double ber_tolerance = std::atof(args.get("ber-tolerance", "0.005").c_str());
+        std::vector<std::string> paths = images;
+        if (args.has("images")) {
+            paths.clear();
+            std::stringstream list(args.get("images", ""));
+            for (std::string path; std::getline(list, path, ',');) paths.push_back(path);
+        }
+        const std::string watermark_path = args.get("watermark", "images/watermark.png");
+        cv::Mat watermark = cv::imread(watermark_path, cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::runtime_error("Could not open or find the watermark: " + watermark_path);
+        }
+        const WatermarkBits bits = extract_watermark_bits(watermark);
+        const std::vector<AttackInfo>& attacks = standardAttacks();
+
+        struct Variant {
+            std::string name;
+            gbo::WarmStart warm_start;
+            int iterations;
+            bool supported = true;  // kept the baseline quality on every image so far
+        };
+        std::vector<Variant> variants = {{"none", gbo::WarmStart::None, base.iterations}};
+        const std::pair<const char*, gbo::WarmStart> strategies[] = {
+            {"none", gbo::WarmStart::None}, {"analytic", gbo::WarmStart::Analytic},
+            {"raster", gbo::WarmStart::Raster}, {"wavefront", gbo::WarmStart::Wavefront}};
+        for (int budget : budgets) {
+            for (const auto& strategy : strategies) variants.push_back({strategy.first, strategy.second, std::max(1, budget)});
+        }
+
+        std::cout << "Warm-start benchmark: scheme " << base.scheme << ", seed " << base.seed << ", "
+                  << (base.threads == 0 ? std::string("all") : std::to_string(base.threads)) << " threads, BER averaged over "
+                  << attacks.size() << " attacks" << std::endl;
+        size_t measured = 0;
+        for (const std::string& path : paths) {
+            cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+            if (image.empty()) {
+                std::cerr << "Skipping unreadable image " << path << std::endl;
+                continue;
+            }
+            ++measured;
+            image = image(cv::Rect(0, 0, image.cols / 8 * 8, image.rows / 8 * 8)).clone();
+            std::cout << path << std::endl;
+            std::cout << std::left << std::setw(12) << "warm start" << std::right << std::setw(7) << "iters"
+                      << std::setw(12) << "embed ms" << std::setw(9) << "PSNR" << std::setw(8) << "BER"
+                      << std::setw(12) << "attack BER" << std::setw(12) << "worst BER" << std::endl;
+            double baseline_psnr = 0.0, baseline_ber = 0.0, baseline_attack_ber = 0.0;
+            for (size_t v = 0; v < variants.size(); ++v) {
+                Variant& variant = variants[v];
+                gbo::Config config = base;
+                config.warm_start = variant.warm_start;
+                config.iterations = variant.iterations;
+                Clock::time_point t0 = Clock::now();
+                cv::Mat marked = embedWatermarkMat(image, watermark, config);
+                const double ms = millisecondsSince(t0);
+                const double psnr = computePSNR(image, marked);
+                const double ber = computeBER(bits, extract_watermark_bits(extractWatermarkMat(marked, config)));
+                double attack_sum = 0.0, attack_worst = 0.0;
+                for (const AttackInfo& attack : attacks) {
+                    cv::Mat attacked = attack.apply(marked);
+                    const double attack_ber = computeBER(bits, extract_watermark_bits(extractWatermarkMat(attacked, config)));
+                    attack_sum += attack_ber;
+                    attack_worst = std::max(attack_worst, attack_ber);
+                }
+                const double attack_ber = attack_sum / attacks.size();
+                if (v == 0) {
+                    baseline_psnr = psnr;
+                    baseline_ber = ber;
+                    baseline_attack_ber = attack_ber;
+                } else if (psnr < baseline_psnr - psnr_tolerance || ber > baseline_ber + ber_tolerance ||
+                           attack_ber > baseline_attack_ber + ber_tolerance) {
+                    variant.supported = false;
+                }
+                std::cout << std::left << std::setw(12) << variant.name << std::right << std::setw(7) << variant.iterations
+                          << std::fixed << std::setprecision(2) << std::setw(12) << ms << std::setw(9) << psnr
+                          << std::setprecision(4) << std::setw(8) << ber << std::setw(12) << attack_ber
+                          << std::setw(12) << attack_worst << std::endl;
+            }
+        }
+        if (measured == 0) {
+            throw std::runtime_error("no readable images");
+        }
+
+        // The budget a strategy supports: the smallest one that stayed within the tolerances of the
+        // baseline on every image
+        std::cout << "Smallest budget within " << std::setprecision(2) << psnr_tolerance << " dB PSNR and "
+                  << std::setprecision(4) << ber_tolerance << " BER of the baseline (" << base.iterations
+                  << " iterations) on all " << measured << " images:" << std::endl;
+        for (const auto& strategy : strategies) {
+            int supported = 0;
+            for (size_t v = 1; v < variants.size(); ++v) {
+                if (variants[v].name == strategy.first && variants[v].supported &&
+                    (supported == 0 || variants[v].iterations < supported)) {
+                    supported = variants[v].iterations;
+                }
+            }
+            std::cout << "  " << std::left << std::setw(10) << strategy.first << std::right
+                      << (supported > 0 ? std::to_string(supported) + " iterations" : std::string("none")) << std::endl;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runOptimizerBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const gbo::Config config = configFromArgs(args);
+        const size_t population_size = static_cast<size_t>(Population().get_population_size());
+        const size_t budget = gbo::blockBudget(config);
+        const int refine_steps = std::max(0, args.getInt("refine", 0));
+        const size_t hybrid_budget = static_cast<size_t>(args.getSeed("hybrid-evaluations", 2 * population_size));
+        const double th = Population().get_th();
+        const double target_ratio = std::atof(args.get("target-ratio", "0.5").c_str());
+        const double target_psnr = std::atof(args.get("target-psnr", "45").c_str());
+        const std::vector<std::string> names = parseNameList(args.get("optimizers", "gbo,de,cmaes"));
+        const std::string path = args.get("image", "images/lenna.png");
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        if (config.scheme < 0 || config.scheme >= static_cast<int>(embeding_region.size())) {
+            throw std::invalid_argument("invalid scheme index");
+        }
+
+        // Neighbours in the sample carry opposite bits
+        const std::vector<cv::Rect> rects = sampleBlocks(image, args.getInt("blocks", 64));
+        const size_t count = rects.size();
+        const int scheme = config.scheme;
+        const int vector_size = static_cast<int>(embeding_region[scheme].size());
+
+        // Every backend alone with the full budget, then (with --refine) with a short budget
+        // followed by the gradient polish of local_refinement.h
+        struct Variant {
+            std::string name;
+            std::string backend;
+            size_t budget;
+            int refine_steps;
+        };
+        std::vector<Variant> variants;
+        for (const std::string& name : names) {
+            makeOptimizer(name);  // rejects unknown names before the run
+            variants.push_back({name, name, budget, 0});
+        }
+        if (refine_steps > 0) {
+            for (const std::string& name : names) variants.push_back({name + "+refine", name, hybrid_budget, refine_steps});
+        }
+
+        std::cout << "Optimizer benchmark: " << count << " blocks of " << path << ", scheme " << scheme << ", "
+                  << budget << " evaluations per block (" << hybrid_budget << " + refinement of " << refine_steps
+                  << " steps for the hybrids), target: losing/winning sum <= " << target_ratio
+                  << " and block PSNR >= " << target_psnr << " dB" << std::endl;
+        std::cout << std::left << std::setw(14) << "backend" << std::right << std::setw(8) << "spent"
+                  << std::setw(10) << "reached" << std::setw(14) << "median evals" << std::setw(12) << "mean evals"
+                  << std::setw(10) << "fitness" << std::setw(9) << "PSNR" << std::setw(10) << "decoded"
+                  << std::setw(12) << "ms/block" << std::endl;
+
+        struct BlockRun {
+            size_t spent = 0;
+            size_t to_target = 0;   // evaluation that first met the target, 0 = never
+            double fitness = 0.0;
+            double psnr = 0.0;
+            bool decoded = false;
+        };
+        std::string cheapest;
+        double cheapest_reached = -1.0, cheapest_median = 0.0;
+        for (const Variant& variant : variants) {
+            std::vector<BlockRun> runs(count);
+            Clock::time_point t0 = Clock::now();
+            parallelFor(count, resolveThreads(config.threads), [&](size_t k) {
+                // Every backend sees the same random stream per block
+                seed_thread_random(config.seed + k);
+                const cv::Mat block = image(rects[k]);
+                const unsigned char bit = static_cast<unsigned char>(k % 2);
+                BlockRun& run = runs[k];
+
+                const FitnessOracle fitness = [&](const arma::vec& vec) {
+                    ++run.spent;
+                    if (run.to_target == 0) {
+                        const cv::Mat marked = applyVectorToBlock(vec, block, scheme);
+                        if (losingRatio(marked, bit, scheme) <= target_ratio && compute_psnr(block, marked) >= target_psnr) {
+                            run.to_target = run.spent;
+                        }
+                    }
+                    return calcFitnessValue(block, vec, bit, scheme);
+                };
+                OptimizerProblem problem;
+                problem.dimension = vector_size;
+                problem.lower = -th;
+                problem.upper = th;
+                problem.max_evaluations = variant.budget;
+                problem.fitness = fitness;
+                OptimizerResult result = threadOptimizer(variant.backend).minimize(problem);
+                if (variant.refine_steps > 0) {
+                    double magnitudes[64];
+                    blockMagnitudes(block, magnitudes);
+                    result = refineVector(magnitudes, bit, scheme, pixel_rounding_mse, result, th, variant.refine_steps, fitness);
+                }
+                const cv::Mat marked = applyVectorToBlock(result.best, block, scheme);
+                run.fitness = result.best_fitness;
+                run.psnr = compute_psnr(block, marked);
+                run.decoded = getBitFromBlock(marked, scheme) == bit;
+            });
+            const double ms = millisecondsSince(t0);
+
+            std::vector<double> to_target;
+            double spent = 0.0, fitness = 0.0, psnr = 0.0;
+            size_t decoded = 0;
+            for (const BlockRun& run : runs) {
+                if (run.to_target != 0) to_target.push_back(static_cast<double>(run.to_target));
+                spent += run.spent;
+                fitness += run.fitness;
+                psnr += run.psnr;
+                if (run.decoded) decoded++;
+            }
+            std::sort(to_target.begin(), to_target.end());
+            const double reached = static_cast<double>(to_target.size()) / count;
+            const double median = to_target.empty() ? 0.0 : to_target[to_target.size() / 2];
+            double mean = 0.0;
+            for (double evaluations : to_target) mean += evaluations;
+            if (!to_target.empty()) mean /= to_target.size();
+
+            std::cout << std::left << std::setw(14) << variant.name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(8) << spent / count << std::setw(9) << 100.0 * reached << "%" << std::setw(14) << median
+                      << std::setw(12) << mean << std::setprecision(4) << std::setw(10) << fitness / count
+                      << std::setprecision(2) << std::setw(9) << psnr / count << std::setw(9) << 100.0 * decoded / count
+                      << "%" << std::setw(12) << ms / count << std::endl;
+            if (reached > cheapest_reached || (reached == cheapest_reached && median < cheapest_median)) {
+                cheapest = variant.name;
+                cheapest_reached = reached;
+                cheapest_median = median;
+            }
+        }
+        if (cheapest_reached > 0.0) {
+            std::cout << "Cheapest: " << cheapest << " (target met on " << std::setprecision(1) << 100.0 * cheapest_reached
+                      << "% of the blocks, median " << cheapest_median << " evaluations)" << std::endl;
+        } else {
+            std::cout << "No backend met the target within its budget" << std::endl;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runSurrogateBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const gbo::Config config = configFromArgs(args);
+        const size_t budget = gbo::blockBudget(config);
+        const double th = Population().get_th();
+        std::vector<double> tolerances;
+        for (const std::string& item : parseNameList(args.get("tolerances", "0,0.03,0.1,0.2"))) {
+            tolerances.push_back(std::atof(item.c_str()));
+        }
+        const std::string path = args.get("image", "images/lenna.png");
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        if (config.scheme < 0 || config.scheme >= static_cast<int>(embeding_region.size())) {
+            throw std::invalid_argument("invalid scheme index");
+        }
+        makeOptimizer(config.optimizer);  // rejects an unknown name before the run
+        const std::vector<cv::Rect> rects = sampleBlocks(image, args.getInt("blocks", 64));
+        const size_t count = rects.size();
+        const int scheme = config.scheme;
+
+        struct BlockRun {
+            size_t evaluations = 0;
+            size_t screened = 0;
+            double fitness = 0.0;
+            bool decoded = false;
+        };
+        // One pass over the sample; tolerance < 0 runs without the surrogate
+        auto run = [&](double tolerance, uint64_t seed_offset, double* ms) {
+            std::vector<BlockRun> runs(count);
+            Clock::time_point t0 = Clock::now();
+            parallelFor(count, resolveThreads(config.threads), [&](size_t k) {
+                seed_thread_random(config.seed + seed_offset + k);
+                const cv::Mat block = image(rects[k]);
+                const unsigned char bit = static_cast<unsigned char>(k % 2);
+                double magnitudes[64];
+                blockMagnitudes(block, magnitudes);
+
+                OptimizerProblem problem;
+                problem.dimension = static_cast<int>(embeding_region[scheme].size());
+                problem.lower = -th;
+                problem.upper = th;
+                problem.max_evaluations = budget;
+                problem.fitness = [&](const arma::vec& vec) { return calcFitnessValue(block, vec, bit, scheme); };
+                if (tolerance >= 0.0) {
+                    problem.surrogate = [&](const arma::vec& vec) {
+                        return relaxedFitness(magnitudes, bit, scheme, pixel_rounding_mse, vec);
+                    };
+                    problem.surrogate_tolerance = tolerance;
+                }
+                const OptimizerResult result = threadOptimizer(config.optimizer).minimize(problem);
+                runs[k].evaluations = result.evaluations;
+                runs[k].screened = result.screened;
+                runs[k].fitness = result.best_fitness;
+                runs[k].decoded = getBitFromBlock(applyVectorToBlock(result.best, block, scheme), scheme) == bit;
+            });
+            *ms = millisecondsSince(t0);
+            return runs;
+        };
+
+        std::cout << "Surrogate benchmark: " << count << " blocks of " << path << ", scheme " << scheme << ", "
+                  << config.optimizer << " with " << budget << " candidates per block" << std::endl;
+        std::cout << std::left << std::setw(12) << "surrogate" << std::right << std::setw(12) << "exact evals"
+                  << std::setw(9) << "saved" << std::setw(10) << "fitness" << std::setw(11) << "vs exact"
+                  << std::setw(9) << "worse" << std::setw(10) << "decoded" << std::setw(12) << "ms/block" << std::endl;
+
+        double baseline_ms = 0.0;
+        const std::vector<BlockRun> baseline = run(-1.0, 0, &baseline_ms);
+        auto print = [&](const std::string& label, const std::vector<BlockRun>& runs, double ms) {
+            double evaluations = 0.0, fitness = 0.0, delta = 0.0;
+            size_t worse = 0, decoded = 0;
+            for (size_t k = 0; k < count; ++k) {
+                evaluations += runs[k].evaluations;
+                fitness += runs[k].fitness;
+                delta += runs[k].fitness - baseline[k].fitness;
+                if (runs[k].fitness > baseline[k].fitness) worse++;
+                if (runs[k].decoded) decoded++;
+            }
+            double baseline_evaluations = 0.0;
+            for (const BlockRun& b : baseline) baseline_evaluations += b.evaluations;
+            std::cout << std::left << std::setw(12) << label << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << evaluations / count << std::setw(8)
+                      << 100.0 * (1.0 - evaluations / baseline_evaluations) << "%" << std::setprecision(4)
+                      << std::setw(10) << fitness / count << std::showpos << std::setw(11) << delta / count
+                      << std::noshowpos << std::setprecision(1) << std::setw(8) << 100.0 * worse / count << "%"
+                      << std::setw(9) << 100.0 * decoded / count << "%" << std::setprecision(2) << std::setw(12)
+                      << ms / count << std::endl;
+        };
+        print("off", baseline, baseline_ms);
+        // Same search with other random streams: how much the fitness moves by chance alone
+        // (each run finishes before its time is read: argument evaluation order is unspecified)
+        double reseeded_ms = 0.0;
+        const std::vector<BlockRun> reseeded = run(-1.0, count, &reseeded_ms);
+        print("off, reseed", reseeded, reseeded_ms);
+        for (double tolerance : tolerances) {
+            if (tolerance < 0.0) {
+                throw std::invalid_argument("tolerances must be non-negative");
+            }
+            double ms = 0.0;
+            std::ostringstream label;
+            label << "tol " << tolerance;
+            const std::vector<BlockRun> runs = run(tolerance, 0, &ms);
+            print(label.str(), runs, ms);
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runSchedulerBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const gbo::Config config = configFromArgs(args);
+        const size_t batch = static_cast<size_t>(std::max(1, args.getInt("batch", 4)));
+        const std::string path = args.get("image", "images/lenna.png");
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        cv::Mat watermark = cv::imread(args.get("watermark", "images/watermark.png"), cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::runtime_error("Could not open or find the watermark");
+        }
+        const int threads = resolveThreads(config.threads);
+
+        std::cout << "Scheduler benchmark: " << path << ", " << threads << " threads, batch of " << batch
+                  << " images with nested block loops" << std::endl;
+        std::cout << std::left << std::setw(8) << "job" << std::setw(10) << "schedule" << std::right
+                  << std::setw(12) << "wall ms" << std::setw(12) << "busy ms" << std::setw(14) << "tail idle ms"
+                  << std::setw(11) << "tail idle" << std::setw(9) << "steals" << std::endl;
+
+        const Schedule previous = schedule();
+        for (const bool whole_batch : {false, true}) {
+            for (const Schedule mode : {Schedule::Static, Schedule::Stealing}) {
+                setSchedule(mode);
+                resetSchedulerStats();
+                Clock::time_point t0 = Clock::now();
+                if (whole_batch) {
+                    parallelFor(batch, threads, [&](size_t) { embedWatermarkMat(image, watermark, config); });
+                } else {
+                    embedWatermarkMat(image, watermark, config);
+                }
+                const double ms = millisecondsSince(t0);
+                const SchedulerStats stats = schedulerStats();
+                std::cout << std::left << std::setw(8) << (whole_batch ? "batch" : "image") << std::setw(10)
+                          << (mode == Schedule::Static ? "static" : "stealing") << std::right << std::fixed
+                          << std::setprecision(1) << std::setw(12) << ms << std::setw(12) << stats.busy_ms
+                          << std::setw(14) << stats.tail_idle_ms << std::setw(10)
+                          << 100.0 * stats.tail_idle_ms / (threads * ms) << "%" << std::setw(9) << stats.steals
+                          << std::endl;
+            }
+        }
+        setSchedule(previous);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runLockstepBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        gbo::Config config = configFromArgs(args);
+        const std::string path = args.get("image", "images/lenna.png");
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        image = image(cv::Rect(0, 0, image.cols / 8 * 8, image.rows / 8 * 8)).clone();
+        cv::Mat watermark = cv::imread(args.get("watermark", "images/watermark.png"), cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::runtime_error("Could not open or find the watermark");
+        }
+        if (config.scheme < 0 || config.scheme >= static_cast<int>(embeding_region.size())) {
+            throw std::invalid_argument("invalid scheme index");
+        }
+        const int scheme = config.scheme;
+        const int rounds = std::max(1, args.getInt("rounds", 200));
+
+        // Fitness kernel: the same candidates scored one block at a time and lockstep_lanes at a time
+        const std::vector<cv::Rect> rects = sampleBlocks(image, lockstep_lanes);
+        std::vector<cv::Mat> blocks;
+        std::vector<unsigned char> bits;
+        for (size_t k = 0; k < rects.size(); ++k) {
+            blocks.push_back(image(rects[k]));
+            bits.push_back(static_cast<unsigned char>(k % 2));
+        }
+        const BlockBatch batch(blocks, bits, scheme);
+        const int n = batch.dimension();
+        const double th = Population().get_th();
+        std::vector<arma::vec> candidates(blocks.size(), arma::vec(n));
+        std::vector<double> lanes(static_cast<size_t>(n) * lockstep_lanes, 0.0);
+        for (size_t k = 0; k < blocks.size(); ++k) {
+            for (int idx = 0; idx < n; ++idx) {
+                candidates[k](idx) = th * std::sin(1.7 * idx + 0.9 * k);
+                lanes[idx * lockstep_lanes + k] = candidates[k](idx);
+            }
+        }
+        double scalar_sum = 0.0, batch_sum = 0.0, max_difference = 0.0;
+        Clock::time_point t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (size_t k = 0; k < blocks.size(); ++k) scalar_sum += calcFitnessValue(blocks[k], candidates[k], bits[k], scheme);
+        }
+        const double scalar_ms = millisecondsSince(t0);
+        double fitness[lockstep_lanes];
+        t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            batch.evaluate(lanes.data(), fitness);
+            for (size_t k = 0; k < blocks.size(); ++k) batch_sum += fitness[k];
+        }
+        const double batch_ms = millisecondsSince(t0);
+        for (size_t k = 0; k < blocks.size(); ++k) {
+            max_difference = std::max(max_difference, std::fabs(fitness[k] - calcFitnessValue(blocks[k], candidates[k], bits[k], scheme)));
+        }
+        const double evaluations = static_cast<double>(rounds) * blocks.size();
+        std::cout << "Lockstep benchmark: " << path << ", scheme " << scheme << ", " << lockstep_lanes << " lanes" << std::endl;
+        std::cout << std::fixed << std::setprecision(3) << "Fitness kernel: calcFitnessValue " << 1000.0 * scalar_ms / evaluations
+                  << " us/eval, BlockBatch " << 1000.0 * batch_ms / evaluations << " us/eval ("
+                  << std::setprecision(1) << scalar_ms / batch_ms << "x), max difference " << std::scientific
+                  << std::setprecision(1) << max_difference << std::fixed << " (checksums " << std::setprecision(3)
+                  << scalar_sum / evaluations << ", " << batch_sum / evaluations << ")" << std::endl;
+
+        // Whole image with the one-block search and with lockstep groups
+        const WatermarkBits watermark_bits = extract_watermark_bits(watermark);
+        std::cout << std::left << std::setw(10) << "search" << std::right << std::setw(12) << "embed ms"
+                  << std::setw(9) << "PSNR" << std::setw(8) << "BER" << std::setw(14) << "evals/block" << std::endl;
+        double ms[2] = {0.0, 0.0};
+        for (const bool lockstep : {false, true}) {
+            gbo::Config run = config;
+            run.lockstep = lockstep;
+            gbo::EmbedStats stats;
+            t0 = Clock::now();
+            cv::Mat marked = embedWatermarkMat(image, watermark, run, &stats);
+            ms[lockstep] = millisecondsSince(t0);
+            const double ber = computeBER(watermark_bits, extract_watermark_bits(extractWatermarkMat(marked, run)));
+            std::cout << std::left << std::setw(10) << (lockstep ? "lockstep" : "block") << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(12) << ms[lockstep] << std::setw(9) << computePSNR(image, marked)
+                      << std::setprecision(4) << std::setw(8) << ber << std::setprecision(1) << std::setw(14)
+                      << static_cast<double>(stats.evaluations) / stats.blocks << std::endl;
+        }
+        std::cout << std::setprecision(2) << "Lockstep speed-up: " << ms[0] / ms[1] << "x" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runArenaBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const gbo::Config config = configFromArgs(args);
+        const std::string path = args.get("image", "images/lenna.png");
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        cv::Mat watermark = cv::imread(args.get("watermark", "images/watermark.png"), cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::runtime_error("Could not open or find the watermark");
+        }
+        const size_t blocks = static_cast<size_t>(image.cols / 8) * (image.rows / 8);
+
+        std::cout << "Arena benchmark: " << path << ", " << resolveThreads(config.threads) << " threads, "
+                  << blocks << " blocks" << std::endl;
+        if (!mallocCounters().available) {
+            std::cout << "(heap calls are only counted with LD_PRELOAD=libgbo_malloc_counters.so on glibc)" << std::endl;
+        }
+        std::cout << std::left << std::setw(8) << "arena" << std::right << std::setw(12) << "embed ms"
+                  << std::setw(14) << "mallocs" << std::setw(14) << "mallocs/block" << std::setw(12) << "RSS MB"
+                  << std::setw(12) << "peak MB" << std::setw(14) << "arena allocs" << std::setw(10) << "resets"
+                  << std::setw(12) << "arena heap" << std::setw(14) << "reserved KB" << std::setw(10) << "peak KB"
+                  << std::endl;
+
+        const bool previous = arenaEnabled();
+        double ms[2] = {0.0, 0.0};
+        double mallocs_per_block[2] = {-1.0, -1.0};
+        long peak_kb[2] = {-1, -1};
+        for (const bool enabled : {false, true}) {
+            setArenaEnabled(enabled);
+            const bool peak_reset = resetPeakRss();
+            const ArenaStats arena_before = arenaStats();
+            const MallocCounters heap_before = mallocCounters();
+            Clock::time_point t0 = Clock::now();
+            embedWatermarkMat(image, watermark, config);
+            ms[enabled] = millisecondsSince(t0);
+            const MallocCounters heap_after = mallocCounters();
+            const ArenaStats arena_after = arenaStats();
+            const long rss = statusKb("VmRSS"), peak = statusKb("VmHWM");
+
+            std::cout << std::left << std::setw(8) << (enabled ? "on" : "off") << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(12) << ms[enabled];
+            if (heap_after.available) {
+                const size_t mallocs = heap_after.allocations - heap_before.allocations;
+                mallocs_per_block[enabled] = static_cast<double>(mallocs) / blocks;
+                std::cout << std::setw(14) << mallocs << std::setw(14) << mallocs_per_block[enabled];
+            } else {
+                std::cout << std::setw(14) << "n/a" << std::setw(14) << "n/a";
+            }
+            std::cout << std::setw(12) << (rss < 0 ? 0.0 : rss / 1024.0);
+            if (peak < 0 || !peak_reset) {
+                std::cout << std::setw(12) << "n/a";
+            } else {
+                peak_kb[enabled] = peak;
+                std::cout << std::setw(12) << peak / 1024.0;
+            }
+            std::cout << std::setw(14) << arena_after.allocations - arena_before.allocations << std::setw(10)
+                      << arena_after.resets - arena_before.resets << std::setw(12)
+                      << arena_after.heap_calls - arena_before.heap_calls << std::setw(14)
+                      << arena_after.reserved_bytes / 1024.0 << std::setw(10) << arena_after.peak_bytes / 1024.0
+                      << std::endl;
+        }
+        setArenaEnabled(previous);
+        std::cout << std::setprecision(2) << "Arena speed-up: " << ms[0] / ms[1] << "x";
+        if (mallocs_per_block[0] > 0.0 && mallocs_per_block[1] >= 0.0) {
+            std::cout << ", heap calls per block: " << std::setprecision(1) << mallocs_per_block[0] << " -> "
+                      << mallocs_per_block[1] << " (" << 100.0 * (1.0 - mallocs_per_block[1] / mallocs_per_block[0])
+                      << "% fewer)";
+        }
+        if (peak_kb[0] >= 0 && peak_kb[1] >= 0) {
+            std::cout << ", peak RSS: " << std::setprecision(1) << peak_kb[0] / 1024.0 << " -> " << peak_kb[1] / 1024.0
+                      << " MB";
+        }
+        std::cout << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runMetricsBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const std::string path = args.get("image", "images/lenna.png");
+        const cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        const int rounds = std::max(1, args.getInt("rounds", 5));
+        std::vector<cv::Mat> attacked;
+        for (const AttackInfo& attack : standardAttacks()) attacked.push_back(attack.apply(image));
+
+        // One call per metric, as the evaluation loops used to do, against one computeImageQuality
+        double max_difference = 0.0;
+        Clock::time_point t0 = Clock::now();
+        std::vector<ImageQuality> separate(attacked.size());
+        for (int r = 0; r < rounds; ++r) {
+            for (size_t k = 0; k < attacked.size(); ++k) {
+                separate[k].psnr = computePSNR(image, attacked[k]);
+                separate[k].ssim = computeSSIM(image, attacked[k]);
+                separate[k].ncc = computeNCC(image, attacked[k]);
+                separate[k].mse = computeMSE(image, attacked[k]);
+            }
+        }
+        const double separate_ms = millisecondsSince(t0);
+        t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (size_t k = 0; k < attacked.size(); ++k) {
+                const ImageQuality fused = computeImageQuality(image, attacked[k]);
+                max_difference = std::max({max_difference, std::fabs(fused.psnr - separate[k].psnr),
+                                           std::fabs(fused.ssim - separate[k].ssim),
+                                           std::fabs(fused.ncc - separate[k].ncc), std::fabs(fused.mse - separate[k].mse)});
+            }
+        }
+        const double fused_ms = millisecondsSince(t0);
+        const double comparisons = static_cast<double>(rounds) * attacked.size();
+        t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const cv::Mat& test : attacked) computeImageQuality(image, test, MetricsEngine::Pixel);
+        }
+        const double pixel_ms = millisecondsSince(t0);
+
+        // SSIM alone: computeSSIM against the cached reference statistics, on one thread and on all
+        t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (const cv::Mat& test : attacked) computeSSIM(image, test);
+        }
+        const double ssim_ms = millisecondsSince(t0);
+        t0 = Clock::now();
+        const SsimReference reference(image);
+        const double reference_ms = millisecondsSince(t0);
+        double cached_ms[2] = {0.0, 0.0}, ssim_difference = 0.0;
+        for (const int threads : {1, 0}) {
+            t0 = Clock::now();
+            for (int r = 0; r < rounds; ++r) {
+                for (size_t k = 0; k < attacked.size(); ++k) {
+                    const double cached = reference.compare(attacked[k], threads);
+                    ssim_difference = std::max(ssim_difference, std::fabs(cached - separate[k].ssim));
+                }
+            }
+            cached_ms[threads == 0] = millisecondsSince(t0);
+        }
+
+        std::cout << "Metrics benchmark: " << path << " (" << image.cols << "x" << image.rows << "), "
+                  << attacked.size() << " attacks x " << rounds << " rounds" << std::endl;
+        std::cout << std::fixed << std::setprecision(3) << "Per image pair: separate functions " << separate_ms / comparisons
+                  << " ms, computeImageQuality " << fused_ms / comparisons << " ms (" << std::setprecision(2)
+                  << separate_ms / fused_ms << "x), without SSIM " << std::setprecision(3) << pixel_ms / comparisons
+                  << " ms; max difference " << std::scientific << std::setprecision(1) << max_difference << std::fixed
+                  << std::endl;
+        std::cout << std::setprecision(3) << "SSIM per image pair: computeSSIM " << ssim_ms / comparisons
+                  << " ms, SsimReference " << cached_ms[0] / comparisons << " ms (" << std::setprecision(2)
+                  << ssim_ms / cached_ms[0] << "x), on " << resolveThreads(0) << " threads " << std::setprecision(3)
+                  << cached_ms[1] / comparisons << " ms (" << std::setprecision(2) << ssim_ms / cached_ms[1]
+                  << "x); reference statistics " << std::setprecision(3) << reference_ms << " ms once; max difference "
+                  << std::scientific << std::setprecision(1) << ssim_difference << std::fixed << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runNoiseBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const std::string path = args.get("image", "images/lenna.png");
+        const cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        const int rounds = std::max(1, args.getInt("rounds", 20));
+        const int threads = args.getInt("threads", 0);
+
+        // The previous generators: rand() three times per hit, and cv::randn into a CV_64F image
+        auto legacy_salt_pepper = [](const cv::Mat& img, double prob) {
+            cv::Mat result = img.clone();
+            for (int i = 0; i < result.rows * result.cols; i++) {
+                if (rand() % 100 < prob * 100) {
+                    int row = rand() % result.rows;
+                    int col = rand() % result.cols;
+                    result.at<uchar>(row, col) = rand() % 2 == 0 ? 0 : 255;
+                }
+            }
+            return result;
+        };
+        auto legacy_speckle = [](const cv::Mat& img, double stddev) {
+            cv::Mat noise(img.size(), CV_64F), result;
+            cv::randn(noise, 0, stddev);
+            img.convertTo(result, CV_64F);
+            result = result + noise;
+            result.convertTo(result, img.type());
+            return result;
+        };
+        struct Row {
+            const char* name;
+            std::function<cv::Mat()> legacy, seeded;
+        };
+        const Row rows[] = {
+            {"salt-pepper 5%", [&] { return legacy_salt_pepper(image, 0.05); }, [&] { return saltPepperNoise(image, 0.05); }},
+            {"speckle 20", [&] { return legacy_speckle(image, 20.0); }, [&] { return speckleNoise(image, 20.0); }},
+        };
+
+        std::cout << "Noise benchmark: " << path << " (" << image.cols << "x" << image.rows << "), " << rounds
+                  << " rounds, ms per call" << std::endl;
+        std::cout << std::left << std::setw(16) << "attack" << std::right << std::setw(10) << "previous"
+                  << std::setw(10) << "seeded" << std::setw(10) << "speed-up" << std::endl;
+        for (const Row& row : rows) {
+            Clock::time_point t0 = Clock::now();
+            for (int r = 0; r < rounds; ++r) row.legacy();
+            const double legacy_ms = millisecondsSince(t0) / rounds;
+            t0 = Clock::now();
+            for (int r = 0; r < rounds; ++r) row.seeded();
+            const double seeded_ms = millisecondsSince(t0) / rounds;
+            std::cout << std::left << std::setw(16) << row.name << std::right << std::fixed << std::setprecision(3)
+                      << std::setw(10) << legacy_ms << std::setw(10) << seeded_ms << std::setprecision(2)
+                      << std::setw(9) << legacy_ms / seeded_ms << "x" << std::endl;
+        }
+
+        // One seed per copy: the copies attacked in parallel must match the serial ones
+        std::vector<cv::Mat> serial(rounds), parallel(rounds);
+        for (int r = 0; r < rounds; ++r) serial[r] = speckleNoise(saltPepperNoise(image, 0.05, r), 20.0, r);
+        Clock::time_point t0 = Clock::now();
+        parallelFor(rounds, resolveThreads(threads), [&](size_t r) {
+            parallel[r] = speckleNoise(saltPepperNoise(image, 0.05, r), 20.0, r);
+        });
+        const double parallel_ms = millisecondsSince(t0);
+        bool identical = true;
+        for (int r = 0; r < rounds; ++r) identical = identical && cv::countNonZero(serial[r] != parallel[r]) == 0;
+        std::cout << std::setprecision(3) << rounds << " seeded copies on " << resolveThreads(threads) << " threads: "
+                  << parallel_ms << " ms, " << (identical ? "identical to" : "DIFFERENT from") << " the serial run"
+                  << std::endl;
+        return identical ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runJpegAttackBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const std::string path = args.get("image", "images/lenna.png");
+        const cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        const std::vector<int> qualities = parseIntList(args.get("qualities", "50,70,80,90"));
+        const int rounds = std::max(1, args.getInt("rounds", 10));
+        const int threads = args.getInt("threads", 0);
+
+        std::cout << "JPEG attack benchmark: " << path << " (" << image.cols << "x" << image.rows << "), " << rounds
+                  << " rounds, ms per image" << std::endl;
+        std::cout << std::setw(8) << "quality" << std::setw(10) << "codec" << std::setw(11) << "simulator"
+                  << std::setw(10) << "speed-up" << std::setw(12) << "threads ms" << std::setw(12) << "block us"
+                  << std::setw(12) << "mismatches" << std::endl;
+        int total_mismatches = 0;
+        for (int quality : qualities) {
+            const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, quality};
+            cv::Mat decoded;
+            Clock::time_point t0 = Clock::now();
+            for (int r = 0; r < rounds; ++r) {
+                std::vector<uchar> encoded;
+                cv::imencode(".jpg", image, encoded, params);
+                decoded = cv::imdecode(encoded, cv::IMREAD_GRAYSCALE);
+            }
+            const double codec_ms = millisecondsSince(t0) / rounds;
+
+            const JpegSimulator simulator(quality);
+            cv::Mat simulated;
+            t0 = Clock::now();
+            for (int r = 0; r < rounds; ++r) simulated = simulator.compress(image);
+            const double simulator_ms = millisecondsSince(t0) / rounds;
+            t0 = Clock::now();
+            for (int r = 0; r < rounds; ++r) simulator.compress(image, threads);
+            const double threaded_ms = millisecondsSince(t0) / rounds;
+
+            // One block at a time, as a fitness function would call it
+            const std::vector<cv::Mat> blocks = splitImageInto8x8Blocks(image);
+            t0 = Clock::now();
+            for (const cv::Mat& block : blocks) simulator.compressBlock(block);
+            const double block_us = 1000.0 * millisecondsSince(t0) / std::max<size_t>(1, blocks.size());
+
+            const int mismatches = cv::countNonZero(decoded != simulated);
+            total_mismatches += mismatches;
+            std::cout << std::setw(8) << quality << std::fixed << std::setprecision(3) << std::setw(10) << codec_ms
+                      << std::setw(11) << simulator_ms << std::setprecision(2) << std::setw(9) << codec_ms / simulator_ms
+                      << "x" << std::setprecision(3) << std::setw(12) << threaded_ms << std::setw(12) << block_us
+                      << std::setw(12) << mismatches << std::endl;
+        }
+        std::cout << "Threads: " << resolveThreads(threads) << "; mismatches are pixels that differ from cv::imdecode"
+                  << std::endl;
+        return total_mismatches == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runRobustBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        gbo::Config config = configFromArgs(args);
+        if (config.robustness_attacks.empty()) config.robustness_attacks = parseBlockAttacks("jpeg:70");
+        const std::string path = args.get("image", "images/lenna.png");
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        image = image(cv::Rect(0, 0, image.cols / 8 * 8, image.rows / 8 * 8)).clone();
+        const std::string watermark_path = args.get("watermark", "images/watermark.png");
+        cv::Mat watermark = cv::imread(watermark_path, cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::runtime_error("Could not open or find the watermark: " + watermark_path);
+        }
+        const WatermarkBits bits = extract_watermark_bits(watermark);
+
+        std::cout << "Robust-fitness benchmark: " << path << ", GBO (" << config.iterations << " iterations"
+                  << (config.lockstep ? ", lockstep" : "") << "), weight " << config.robustness_weight << std::endl;
+        std::cout << std::left << std::setw(8) << "fitness" << std::right << std::setw(12) << "embed ms" << std::setw(9)
+                  << "PSNR" << std::setw(8) << "BER";
+        for (const BlockAttack& attack : config.robustness_attacks) std::cout << std::setw(14) << blockAttackName(attack);
+        std::cout << std::endl;
+        for (int robust = 0; robust < 2; ++robust) {
+            gbo::Config run = config;
+            if (!robust) run.robustness_attacks.clear();
+            Clock::time_point t0 = Clock::now();
+            const cv::Mat marked = embedWatermarkMat(image, watermark, run);
+            const double ms = millisecondsSince(t0);
+            std::cout << std::left << std::setw(8) << (robust ? "robust" : "clean") << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(12) << ms << std::setw(9) << computePSNR(image, marked)
+                      << std::setprecision(4) << std::setw(8)
+                      << computeBER(bits, extract_watermark_bits(extractWatermarkMat(marked, run)));
+            for (const BlockAttack& attack : config.robustness_attacks) {
+                const cv::Mat attacked = attackImage(marked, attack);
+                std::cout << std::setw(14) << computeBER(bits, extract_watermark_bits(extractWatermarkMat(attacked, run)));
+            }
+            std::cout << std::endl;
+        }
+        std::cout << "Columns after BER: BER once the whole image went through that attack" << std::endl;
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runSweepBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        gbo::Config config = configFromArgs(args);
+        config.method = parseEmbedMethod(args.get("method", "analytic"));
+        const std::string path = args.get("image", "images/lenna.png");
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        cv::Mat watermark = cv::imread(args.get("watermark", "images/watermark.png"), cv::IMREAD_GRAYSCALE);
+        if (image.empty() || watermark.empty()) {
+            throw std::runtime_error("Could not open the image or the watermark");
+        }
+        image = image(cv::Rect(0, 0, image.cols / 8 * 8, image.rows / 8 * 8)).clone();
+        const std::vector<SweepAxis> grid = parseSweepGrid(args.get("grid", default_sweep_grid));
+        const WatermarkBits bits = extract_watermark_bits(watermark, watermark.rows);
+        const cv::Mat marked = embedWatermarkMat(image, watermark, config);
+
+        // Point by point the way the attack reports do it: full codec path, fresh SSIM statistics
+        gbo::Config serial_config = config;
+        serial_config.threads = 1;
+        Clock::time_point t0 = Clock::now();
+        std::vector<double> serial_ber;
+        const AttackSweep sweep(image, marked, bits, serial_config);
+        for (const SweepAxis& axis : grid) {
+            for (double param : axis.params) {
+                const cv::Mat attacked = axis.attack == "jpeg" ? jpegCompression(marked, static_cast<int>(std::lround(param)))
+                                                               : sweep.attack(axis.attack, param, config.seed);
+                serial_ber.push_back(computeBER(bits, extract_watermark_bits(extractWatermarkMat(attacked, serial_config))));
+                computeImageQuality(image, attacked);
+            }
+        }
+        const double serial_ms = millisecondsSince(t0);
+
+        SweepOptions options;
+        options.threads = config.threads;
+        options.seed = config.seed;
+        t0 = Clock::now();
+        const AttackSweep engine(image, marked, bits, config);
+        const std::vector<SweepPoint> points = engine.run(grid, options);
+        const double sweep_ms = millisecondsSince(t0);
+
+        size_t differing = 0;
+        for (size_t k = 0; k < points.size(); ++k) differing += points[k].ber != serial_ber[k];
+        std::cout << std::fixed << std::setprecision(2) << "Sweep benchmark: " << path << ", " << points.size()
+                  << " points" << std::endl
+                  << "point by point: " << serial_ms << " ms; sweep engine on " << resolveThreads(config.threads)
+                  << " threads: " << sweep_ms << " ms (" << serial_ms / sweep_ms << "x); points with another BER: "
+                  << differing << std::endl;
+        if (args.has("csv")) {
+            std::ofstream csv(args.get("csv", ""));
+            writeSweepCsv(csv, points);
+        }
+        return differing == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runAttackPlanBenchmark(const std::vector<std::string>& arg_list) {
+    try {
+        BenchArgs args(arg_list);
+        const std::string path = args.get("image", "images/lenna.png");
+        const cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            throw std::runtime_error("Could not open or find the image: " + path);
+        }
+        const int threads = args.getInt("threads", 0);
+        const int rounds = std::max(1, args.getInt("rounds", 3));
+
+        // Without --plan: contrast x brightness x JPEG chains, tau over the JPEG leaves
+        std::string text;
+        if (args.has("plan")) {
+            std::ifstream file(args.get("plan", ""));
+            text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        } else {
+            std::ostringstream plan, tau;
+            tau << "tau copy";
+            for (double contrast : {0.8, 1.2}) {
+                const std::string c = "c" + std::to_string(static_cast<int>(contrast * 10));
+                plan << c << " contrast " << contrast << "\n";
+                for (int offset : {-20, 20}) {
+                    const std::string b = c + "_b" + std::to_string(offset + 100);
+                    plan << b << " brightness " << offset << " <- " << c << "\n";
+                    plan << b << "_median median 3 <- " << b << "\n";
+                    for (int quality : {50, 60, 70, 80, 90}) {
+                        const std::string j = b + "_q" + std::to_string(quality);
+                        plan << j << " jpeg " << quality << " <- " << b << "_median\n";
+                        tau << " " << j;
+                    }
+                }
+            }
+            text = plan.str() + tau.str() + "\n";
+        }
+        const AttackPlan plan = AttackPlan::parse(text);
+        const std::vector<AttackNode>& nodes = plan.nodes();
+
+        // Every tau node recomputed from the copy along its own chain, one after another
+        std::vector<cv::Mat> chained;
+        size_t chain_attacks = 0;
+        Clock::time_point t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            chained.clear();
+            for (int index : plan.tauNodes()) {
+                std::vector<int> chain;
+                for (int i = index; i != AttackPlan::copy; i = nodes[i].input) chain.push_back(i);
+                cv::Mat current = image;
+                for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+                    current = applySweepAttack(current, nodes[*it].attack, nodes[*it].param, static_cast<uint64_t>(*it));
+                }
+                chained.push_back(current);
+                if (r == 0) chain_attacks += chain.size();
+            }
+        }
+        const double chain_ms = millisecondsSince(t0) / rounds;
+
+        std::vector<cv::Mat> shared;
+        t0 = Clock::now();
+        for (int r = 0; r < rounds; ++r) shared = plan.evaluate(image, threads, 0);
+        const double plan_ms = millisecondsSince(t0) / rounds;
+
+        size_t differing = 0;
+        for (size_t k = 0; k < shared.size(); ++k) differing += cv::countNonZero(shared[k] != chained[k]) != 0;
+        std::cout << std::fixed << std::setprecision(2) << "Attack plan benchmark: " << path << ", " << nodes.size()
+                  << " nodes, tau over " << plan.tauNodes().size() << std::endl
+                  << "separate chains: " << chain_attacks << " attacks, " << chain_ms << " ms" << std::endl
+                  << "shared DAG on " << resolveThreads(threads) << " threads: " << nodes.size() << " attacks, " << plan_ms
+                  << " ms (" << chain_ms / plan_ms << "x); tau images that differ: " << differing << std::endl;
+        return differing == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+int runBenchmark(const std::string& name, const std::vector<std::string>& args) {
+    static const std::map<std::string, std::function<int(const std::vector<std::string>&)>> benchmarks = {
+        {"arena", runArenaBenchmark},
+        {"attack-plan", runAttackPlanBenchmark},
+        {"classifier", runClassifierBenchmark},
+        {"fast-embed", runFastEmbedBenchmark},
+        {"jpeg", runJpegBenchmark},
+        {"jpeg-attack", runJpegAttackBenchmark},
+        {"lockstep", runLockstepBenchmark},
+        {"metrics", runMetricsBenchmark},
+        {"noise", runNoiseBenchmark},
+        {"optimizers", runOptimizerBenchmark},
+        {"robust", runRobustBenchmark},
+        {"scheduler", runSchedulerBenchmark},
+        {"surrogate", runSurrogateBenchmark},
+        {"sweep", runSweepBenchmark},
+        {"warm-start", runWarmStartBenchmark},
+    };
+    auto it = benchmarks.find(name);
+    if (it == benchmarks.end()) {
+        std::cerr << "Unknown benchmark '" << name << "'. Available:";
+        for (const auto& kv : benchmarks) std::cerr << " " << kv.first;
+        std::cerr << std::endl;
+        return 1;
+    }
+    return it->second(args);
+}
@@ -0,0 +1,191 @@
+#include "../include/block_arena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+namespace {
+
+const size_t alignment = 64;
+// Enough for the scratch of one block's search with room to spare; bigger requests get a chunk of their own
+const size_t chunk_size = 64 * 1024;
+
+std::atomic<bool> enabled{true};
+
+size_t roundUp(size_t bytes) {
+    return (std::max<size_t>(bytes, 1) + alignment - 1) / alignment * alignment;
+}
+
+void* alignedHeap(size_t bytes) {
+    void* data = std::aligned_alloc(alignment, roundUp(bytes));
+    if (data == nullptr) {
+        throw std::bad_alloc();
+    }
+    return data;
+}
+
+} // namespace
+
+// Only the owning thread writes; arenaStats() reads from any thread
+struct BlockArena::Counters {
+    std::atomic<size_t> allocations{0}, resets{0}, heap_calls{0}, reserved_bytes{0}, peak_bytes{0};
+
+    void add(std::atomic<size_t>& counter, size_t amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+namespace {
+
+// Live arenas, plus what the arenas of finished threads counted
+struct Registry {
+    std::mutex mutex;
+    std::vector<const BlockArena::Counters*> live;
+    ArenaStats retired;
+};
+
+// Never destroyed: arenas of pool threads joined during static destruction still report here
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+} // namespace
+
+BlockArena& BlockArena::local() {
+    static thread_local BlockArena arena;
+    return arena;
+}
+
+BlockArena::BlockArena() : counters_(new Counters()) {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.live.push_back(counters_);
+}
+
+BlockArena::~BlockArena() {
+    for (void* data : heap_) std::free(data);
+    for (const Chunk& chunk : chunks_) std::free(chunk.data);
+    Registry& r = registry();
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.live.erase(std::remove(r.live.begin(), r.live.end(), counters_), r.live.end());
+        r.retired.allocations += counters_->allocations;
+        r.retired.resets += counters_->resets;
+        r.retired.heap_calls += counters_->heap_calls;
+        r.retired.peak_bytes = std::max<size_t>(r.retired.peak_bytes, counters_->peak_bytes);
+    }
+    delete counters_;
+}
+
+void* BlockArena::allocate(size_t bytes) {
+    counters_->add(counters_->allocations, 1);
+    if (!enabled.load(std::memory_order_relaxed)) {
+        heap_.push_back(alignedHeap(bytes));
+        counters_->add(counters_->heap_calls, 1);
+        return heap_.back();
+    }
+    return fromChunks(roundUp(bytes));
+}
+
+void* BlockArena::fromChunks(size_t bytes) {
+    // Move on to the next chunk that fits; a new one goes right after the current chunk, so
+    // the chunks behind it stay in order for the next rewind
+    while (chunks_.empty() || offset_ + bytes > chunks_[chunk_].size) {
+        if (!chunks_.empty() && chunk_ + 1 < chunks_.size() && bytes <= chunks_[chunk_ + 1].size) {
+            before_ += chunks_[chunk_].size;
+            chunk_++;
+            offset_ = 0;
+            continue;
+        }
+        const size_t size = std::max(chunk_size, bytes);
+        Chunk chunk{static_cast<unsigned char*>(alignedHeap(size)), size};
+        counters_->add(counters_->heap_calls, 1);
+        counters_->add(counters_->reserved_bytes, size);
+        if (chunks_.empty()) {
+            chunks_.push_back(chunk);
+        } else {
+            before_ += chunks_[chunk_].size;
+            chunks_.insert(chunks_.begin() + static_cast<std::ptrdiff_t>(chunk_ + 1), chunk);
+            chunk_++;
+        }
+        offset_ = 0;
+    }
+    void* data = chunks_[chunk_].data + offset_;
+    offset_ += bytes;
+    if (before_ + offset_ > counters_->peak_bytes.load(std::memory_order_relaxed)) {
+        counters_->peak_bytes.store(before_ + offset_, std::memory_order_relaxed);
+    }
+    return data;
+}
+
+void BlockArena::rewind(const Mark& mark) {
+    while (heap_.size() > mark.heap) {
+        std::free(heap_.back());
+        heap_.pop_back();
+    }
+    if (chunks_.empty()) {
+        return;
+    }
+    while (chunk_ > mark.chunk) {
+        chunk_--;
+        before_ -= chunks_[chunk_].size;
+    }
+    offset_ = mark.offset;
+}
+
+cv::Mat BlockArena::mat(int rows, int cols, int type) {
+    const size_t bytes = static_cast<size_t>(rows) * cols * CV_ELEM_SIZE(type);
+    return cv::Mat(rows, cols, type, allocate(bytes));
+}
+
+arma::vec BlockArena::vec(arma::uword size) {
+    double* data = static_cast<double*>(allocate(size * sizeof(double)));
+    return arma::vec(data, size, false, true);
+}
+
+ArenaScope::ArenaScope() : arena_(BlockArena::local()), mark_(arena_.mark()) {
+    arena_.depth_++;
+}
+
+ArenaScope::~ArenaScope() {
+    arena_.rewind(mark_);
+    if (--arena_.depth_ == 0) {
+        arena_.counters_->add(arena_.counters_->resets, 1);
+    }
+}
+
+ArenaStats arenaStats() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    ArenaStats stats = r.retired;
+    for (const BlockArena::Counters* counters : r.live) {
+        stats.allocations += counters->allocations;
+        stats.resets += counters->resets;
+        stats.heap_calls += counters->heap_calls;
+        stats.reserved_bytes += counters->reserved_bytes;
+        stats.peak_bytes = std::max<size_t>(stats.peak_bytes, counters->peak_bytes);
+    }
+    return stats;
+}
+
+void setArenaEnabled(bool value) {
+    enabled = value;
+}
+
+bool arenaEnabled() {
+    return enabled;
+}
+
+// Defined by src/malloc_counters.cpp when libgbo_malloc_counters.so is preloaded
+extern "C" void gbo_malloc_counters(size_t* allocations, size_t* frees) __attribute__((weak));
+
+MallocCounters mallocCounters() {
+    MallocCounters counters;
+    if (gbo_malloc_counters != nullptr) {
+        counters.available = true;
+        gbo_malloc_counters(&counters.allocations, &counters.frees);
+    }
+    return counters;
+}
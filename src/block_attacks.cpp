@@ -0,0 +1,85 @@
+#include "../include/block_attacks.h"
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+struct AttackName {
+    const char* name;
+    BlockAttack::Kind kind;
+    bool has_param;
+};
+
+const AttackName attack_names[] = {
+    {"jpeg", BlockAttack::Kind::Jpeg, true},
+    {"gain", BlockAttack::Kind::Gain, true},
+    {"offset", BlockAttack::Kind::Offset, true},
+    {"average", BlockAttack::Kind::Average, false},
+    {"gaussian", BlockAttack::Kind::Gaussian, false},
+    {"sharpen", BlockAttack::Kind::Sharpen, false},
+};
+
+} // namespace
+
+void validateBlockAttacks(const std::vector<BlockAttack>& attacks, const std::string& prefix) {
+    if (attacks.size() > max_block_attacks) {
+        throw std::invalid_argument(prefix + "at most " + std::to_string(max_block_attacks) + " block attacks");
+    }
+    for (const BlockAttack& attack : attacks) {
+        if (attack.kind == BlockAttack::Kind::Jpeg && !(attack.param >= 1.0 && attack.param <= 100.0)) {
+            throw std::invalid_argument(prefix + "JPEG quality must be in [1, 100]");
+        }
+        if (attack.kind == BlockAttack::Kind::Gain && !(attack.param > 0.0)) {
+            throw std::invalid_argument(prefix + "gain must be positive");
+        }
+        if (!std::isfinite(attack.param)) {
+            throw std::invalid_argument(prefix + "attack parameters must be finite");
+        }
+    }
+}
+
+std::vector<BlockAttack> parseBlockAttacks(const std::string& spec) {
+    std::vector<BlockAttack> attacks;
+    std::stringstream list(spec);
+    for (std::string item; std::getline(list, item, ',');) {
+        if (item.empty()) continue;
+        const size_t colon = item.find(':');
+        const std::string name = item.substr(0, colon);
+        const AttackName* found = nullptr;
+        for (const AttackName& entry : attack_names) {
+            if (name == entry.name) found = &entry;
+        }
+        if (found == nullptr) {
+            throw std::invalid_argument("parseBlockAttacks: unknown attack '" + name + "'");
+        }
+        if (found->has_param != (colon != std::string::npos)) {
+            throw std::invalid_argument("parseBlockAttacks: '" + name + (found->has_param ? "' needs a parameter" : "' takes no parameter"));
+        }
+        BlockAttack attack;
+        attack.kind = found->kind;
+        if (found->has_param) {
+            const std::string value = item.substr(colon + 1);
+            char* end = nullptr;
+            attack.param = std::strtod(value.c_str(), &end);
+            if (value.empty() || *end != '\0') {
+                throw std::invalid_argument("parseBlockAttacks: bad parameter in '" + item + "'");
+            }
+        }
+        attacks.push_back(attack);
+    }
+    validateBlockAttacks(attacks, "parseBlockAttacks: ");
+    return attacks;
+}
+
+std::string blockAttackName(const BlockAttack& attack) {
+    for (const AttackName& entry : attack_names) {
+        if (entry.kind != attack.kind) continue;
+        if (!entry.has_param) return entry.name;
+        std::ostringstream out;
+        out << entry.name << ':' << attack.param;
+        return out.str();
+    }
+    return "unknown";
+}
@@ -0,0 +1,177 @@
+#include "../include/daemon.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+DaemonClient::DaemonClient(const std::string& socket_path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("DaemonClient: invalid socket path: " + socket_path);
+    }
+    socket_path.copy(addr.sun_path, socket_path.size());
+
+    fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd_ < 0) {
+        throw std::runtime_error("DaemonClient: could not create socket");
+    }
+    if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd_);
+        throw std::runtime_error("DaemonClient: could not connect to " + socket_path);
+    }
+}
+
+DaemonClient::~DaemonClient() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+DaemonResponse DaemonClient::call(DaemonRequest request) {
+    request.id = next_id_++;
+    if (!writeDaemonFrame(fd_, encodeDaemonRequest(request))) {
+        throw std::runtime_error("DaemonClient: could not send request");
+    }
+    std::vector<unsigned char> payload;
+    DaemonResponse response;
+    if (!readDaemonFrame(fd_, payload) || !decodeDaemonResponse(payload, response)) {
+        throw std::runtime_error("DaemonClient: connection closed or malformed response");
+    }
+    if (response.id != request.id && response.status != DaemonStatus::BadRequest) {
+        throw std::runtime_error("DaemonClient: response id mismatch");
+    }
+    return response;
+}
+
+std::vector<unsigned char> readFileBytes(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Could not open or find the file: " + path);
+    }
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFileBytes(const std::string& path, const std::vector<unsigned char>& bytes) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Could not write the file: " + path);
+    }
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+void LoadTestReport::print() const {
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Requests: " << sent << " (ok " << ok << ", failed " << failed
+              << ", deadline exceeded " << deadline_exceeded << ")" << std::endl;
+    std::cout << "Wall time: " << wall_seconds << " s, throughput: " << throughput << " req/s" << std::endl;
+    std::cout << "Latency ms  mean:" << latency_mean_ms << "  p50:" << latency_p50_ms
+              << "  p90:" << latency_p90_ms << "  p99:" << latency_p99_ms
+              << "  max:" << latency_max_ms << std::endl;
+    std::cout << "Server ms   queue mean:" << server_queue_mean_ms
+              << "  service mean:" << server_service_mean_ms << std::endl;
+}
+
+LoadTestReport runDaemonLoadTest(const LoadTestOptions& options) {
+    using Clock = std::chrono::steady_clock;
+
+    DaemonRequest request;
+    request.op = options.op;
+    request.scheme = options.scheme;
+    request.deadline_ms = options.deadline_ms;
+    switch (options.op) {
+        case DaemonOp::Ping:
+            break;
+        case DaemonOp::Embed:
+            request.blobs = {readFileBytes(options.image_path), readFileBytes(options.watermark_path)};
+            break;
+        case DaemonOp::Extract:
+            request.blobs = {readFileBytes(options.image_path)};
+            break;
+        case DaemonOp::Evaluate: {
+            std::vector<unsigned char> image = readFileBytes(options.image_path);
+            request.blobs = {image, image, readFileBytes(options.watermark_path)};
+            break;
+        }
+    }
+
+    LoadTestReport report;
+    std::mutex report_mutex;
+    std::vector<double> latencies;
+    double queue_sum_ms = 0.0, service_sum_ms = 0.0;
+    std::atomic<int> next{0};
+
+    const int concurrency = std::max(1, options.concurrency);
+    const Clock::time_point start = Clock::now();
+    std::vector<std::thread> clients;
+    for (int c = 0; c < concurrency; ++c) {
+        clients.emplace_back([&] {
+            std::vector<double> local;
+            int ok = 0, failed = 0, late = 0;
+            double queue_ms = 0.0, service_ms = 0.0;
+            try {
+                DaemonClient client(options.socket_path);
+                while (next.fetch_add(1) < options.requests) {
+                    Clock::time_point t0 = Clock::now();
+                    DaemonResponse response = client.call(request);
+                    local.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+                    queue_ms += response.queue_us / 1000.0;
+                    service_ms += response.service_us / 1000.0;
+                    if (response.status == DaemonStatus::Ok) {
+                        ++ok;
+                    } else if (response.status == DaemonStatus::DeadlineExceeded) {
+                        ++late;
+                    } else {
+                        ++failed;
+                    }
+                }
+            } catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(report_mutex);
+                std::cerr << "Load test client error: " << e.what() << std::endl;
+                ++failed;
+            }
+            std::lock_guard<std::mutex> lock(report_mutex);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+            report.ok += ok;
+            report.failed += failed;
+            report.deadline_exceeded += late;
+            queue_sum_ms += queue_ms;
+            service_sum_ms += service_ms;
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    report.wall_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    report.sent = static_cast<int>(latencies.size());
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            size_t idx = static_cast<size_t>(p * (latencies.size() - 1) + 0.5);
+            return latencies[std::min(idx, latencies.size() - 1)];
+        };
+        double sum = 0.0;
+        for (double l : latencies) sum += l;
+        report.latency_mean_ms = sum / latencies.size();
+        report.latency_p50_ms = percentile(0.50);
+        report.latency_p90_ms = percentile(0.90);
+        report.latency_p99_ms = percentile(0.99);
+        report.latency_max_ms = latencies.back();
+        report.server_queue_mean_ms = queue_sum_ms / latencies.size();
+        report.server_service_mean_ms = service_sum_ms / latencies.size();
+    }
+    if (report.wall_seconds > 0.0) {
+        report.throughput = report.ok / report.wall_seconds;
+    }
+    return report;
+}
@@ -0,0 +1,207 @@
+#include "../include/daemon.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+class Writer {
+public:
+    void u8(uint8_t v) { buf.push_back(v); }
+    void u32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) buf.push_back(static_cast<unsigned char>(v >> (8 * i)));
+    }
+    void u64(uint64_t v) {
+        for (int i = 0; i < 8; ++i) buf.push_back(static_cast<unsigned char>(v >> (8 * i)));
+    }
+    void f64(double v) {
+        uint64_t bits;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u64(bits);
+    }
+    void bytes(const unsigned char* data, size_t size) {
+        u32(static_cast<uint32_t>(size));
+        buf.insert(buf.end(), data, data + size);
+    }
+
+    std::vector<unsigned char> buf;
+};
+
+class Reader {
+public:
+    explicit Reader(const std::vector<unsigned char>& data) : data_(data) {}
+
+    bool u8(uint8_t& v) {
+        if (!has(1)) return false;
+        v = data_[pos_++];
+        return true;
+    }
+    bool u32(uint32_t& v) {
+        if (!has(4)) return false;
+        v = 0;
+        for (int i = 0; i < 4; ++i) v |= static_cast<uint32_t>(data_[pos_++]) << (8 * i);
+        return true;
+    }
+    bool u64(uint64_t& v) {
+        if (!has(8)) return false;
+        v = 0;
+        for (int i = 0; i < 8; ++i) v |= static_cast<uint64_t>(data_[pos_++]) << (8 * i);
+        return true;
+    }
+    bool f64(double& v) {
+        uint64_t bits;
+        if (!u64(bits)) return false;
+        std::memcpy(&v, &bits, sizeof(v));
+        return true;
+    }
+    bool bytes(std::vector<unsigned char>& out) {
+        uint32_t size;
+        if (!u32(size) || !has(size)) return false;
+        out.assign(data_.begin() + pos_, data_.begin() + pos_ + size);
+        pos_ += size;
+        return true;
+    }
+    bool done() const { return pos_ == data_.size(); }
+
+private:
+    bool has(size_t n) const { return data_.size() - pos_ >= n; }
+
+    const std::vector<unsigned char>& data_;
+    size_t pos_ = 0;
+};
+
+bool readAll(int fd, unsigned char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::recv(fd, data, size, 0);
+        if (n == 0) return false;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const unsigned char* data, size_t size) {
+    while (size > 0) {
+        // MSG_NOSIGNAL: a client that disconnected must not kill the server with SIGPIPE
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+const char* daemonOpName(DaemonOp op) {
+    switch (op) {
+        case DaemonOp::Ping:     return "ping";
+        case DaemonOp::Embed:    return "embed";
+        case DaemonOp::Extract:  return "extract";
+        case DaemonOp::Evaluate: return "evaluate";
+    }
+    return "unknown";
+}
+
+const char* daemonStatusName(DaemonStatus status) {
+    switch (status) {
+        case DaemonStatus::Ok:               return "ok";
+        case DaemonStatus::Error:            return "error";
+        case DaemonStatus::BadRequest:       return "bad request";
+        case DaemonStatus::DeadlineExceeded: return "deadline exceeded";
+        case DaemonStatus::Overloaded:       return "overloaded";
+    }
+    return "unknown";
+}
+
+std::vector<unsigned char> encodeDaemonRequest(const DaemonRequest& request) {
+    Writer w;
+    w.u8(daemon_protocol_version);
+    w.u8(static_cast<uint8_t>(request.op));
+    w.u32(static_cast<uint32_t>(request.scheme));
+    w.u32(request.deadline_ms);
+    w.u64(request.id);
+    w.u32(static_cast<uint32_t>(request.blobs.size()));
+    for (const auto& blob : request.blobs) {
+        w.bytes(blob.data(), blob.size());
+    }
+    return w.buf;
+}
+
+bool decodeDaemonRequest(const std::vector<unsigned char>& payload, DaemonRequest& request) {
+    Reader r(payload);
+    uint8_t version, op;
+    uint32_t scheme, blob_count;
+    if (!r.u8(version) || version != daemon_protocol_version) return false;
+    if (!r.u8(op) || op > static_cast<uint8_t>(DaemonOp::Evaluate)) return false;
+    if (!r.u32(scheme) || !r.u32(request.deadline_ms) || !r.u64(request.id) || !r.u32(blob_count)) return false;
+    request.op = static_cast<DaemonOp>(op);
+    request.scheme = static_cast<int32_t>(scheme);
+    if (blob_count > 16) return false;
+    request.blobs.assign(blob_count, {});
+    for (auto& blob : request.blobs) {
+        if (!r.bytes(blob)) return false;
+    }
+    return r.done();
+}
+
+std::vector<unsigned char> encodeDaemonResponse(const DaemonResponse& response) {
+    Writer w;
+    w.u8(daemon_protocol_version);
+    w.u8(static_cast<uint8_t>(response.status));
+    w.u64(response.id);
+    w.u64(response.queue_us);
+    w.u64(response.service_us);
+    w.bytes(reinterpret_cast<const unsigned char*>(response.message.data()), response.message.size());
+    w.bytes(response.image.data(), response.image.size());
+    w.u32(static_cast<uint32_t>(response.values.size()));
+    for (double v : response.values) {
+        w.f64(v);
+    }
+    return w.buf;
+}
+
+bool decodeDaemonResponse(const std::vector<unsigned char>& payload, DaemonResponse& response) {
+    Reader r(payload);
+    uint8_t version, status;
+    uint32_t value_count;
+    std::vector<unsigned char> message;
+    if (!r.u8(version) || version != daemon_protocol_version) return false;
+    if (!r.u8(status) || status > static_cast<uint8_t>(DaemonStatus::Overloaded)) return false;
+    if (!r.u64(response.id) || !r.u64(response.queue_us) || !r.u64(response.service_us)) return false;
+    if (!r.bytes(message) || !r.bytes(response.image) || !r.u32(value_count)) return false;
+    response.status = static_cast<DaemonStatus>(status);
+    response.message.assign(message.begin(), message.end());
+    if (value_count > 1024) return false;
+    response.values.assign(value_count, 0.0);
+    for (double& v : response.values) {
+        if (!r.f64(v)) return false;
+    }
+    return r.done();
+}
+
+bool readDaemonFrame(int fd, std::vector<unsigned char>& payload) {
+    unsigned char header[4];
+    if (!readAll(fd, header, sizeof(header))) return false;
+    uint32_t size = 0;
+    for (int i = 0; i < 4; ++i) size |= static_cast<uint32_t>(header[i]) << (8 * i);
+    if (size > daemon_max_frame_size) return false;
+    payload.resize(size);
+    return size == 0 || readAll(fd, payload.data(), size);
+}
+
+bool writeDaemonFrame(int fd, const std::vector<unsigned char>& payload) {
+    if (payload.size() > daemon_max_frame_size) return false;
+    unsigned char header[4];
+    uint32_t size = static_cast<uint32_t>(payload.size());
+    for (int i = 0; i < 4; ++i) header[i] = static_cast<unsigned char>(size >> (8 * i));
+    return writeAll(fd, header, sizeof(header)) && writeAll(fd, payload.data(), payload.size());
+}
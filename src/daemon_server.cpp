@@ -0,0 +1,477 @@
+#include "../include/daemon.h"
+#include "../include/launch.h"
+#include "../include/metrics.h"
+#include "../include/pipeline.h"
+#include "../include/process_block.h"
+#include "../include/process_images.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Share of a request's remaining time that an embed may spend searching
+const double embed_deadline_share = 0.9;
+
+std::atomic<bool> stop_requested{false};
+
+void onStopSignal(int) {
+    stop_requested = true;
+}
+
+uint64_t microseconds(Clock::duration d) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+}
+
+struct Connection {
+    explicit Connection(int fd) : fd(fd) {}
+    ~Connection() { ::close(fd); }
+
+    // Responses may be produced by several workers at once; frames must not interleave
+    void send(const DaemonResponse& response) {
+        std::vector<unsigned char> payload = encodeDaemonResponse(response);
+        std::lock_guard<std::mutex> lock(write_mutex);
+        writeDaemonFrame(fd, payload);
+    }
+
+    const int fd;
+    std::mutex write_mutex;
+};
+
+struct Job {
+    DaemonRequest request;
+    std::shared_ptr<Connection> connection;
+    Clock::time_point arrived;
+};
+
+// LRU cache of decoded watermarks keyed by their encoded bytes. Services usually
+// embed the same few watermarks, so the decode is paid once per watermark.
+class WatermarkCache {
+public:
+    explicit WatermarkCache(size_t capacity) : capacity_(capacity) {}
+
+    cv::Mat get(const std::vector<unsigned char>& bytes) {
+        std::string_view view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        size_t key = std::hash<std::string_view>{}(view);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = index_.find(key);
+            if (it != index_.end() && it->second->bytes == bytes) {
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return it->second->watermark;
+            }
+        }
+
+        cv::Mat watermark = cv::imdecode(bytes, cv::IMREAD_GRAYSCALE);
+        if (watermark.empty()) {
+            throw std::invalid_argument("could not decode watermark");
+        }
+        if (capacity_ == 0) {
+            return watermark;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+        entries_.push_front({key, bytes, watermark});
+        index_[key] = entries_.begin();
+        if (entries_.size() > capacity_) {
+            index_.erase(entries_.back().key);
+            entries_.pop_back();
+        }
+        return watermark;
+    }
+
+private:
+    struct Entry {
+        size_t key;
+        std::vector<unsigned char> bytes;
+        cv::Mat watermark;
+    };
+
+    const size_t capacity_;
+    std::mutex mutex_;
+    std::list<Entry> entries_;
+    std::unordered_map<size_t, std::list<Entry>::iterator> index_;
+};
+
+cv::Mat decodeImage(const std::vector<unsigned char>& bytes, const char* what) {
+    cv::Mat image = cv::imdecode(bytes, cv::IMREAD_GRAYSCALE);
+    if (image.empty()) {
+        throw std::invalid_argument(std::string("could not decode ") + what);
+    }
+    return image;
+}
+
+std::vector<unsigned char> encodePng(const cv::Mat& image) {
+    std::vector<unsigned char> bytes;
+    if (!cv::imencode(".png", image, bytes)) {
+        throw std::runtime_error("could not encode result image");
+    }
+    return bytes;
+}
+
+// Cancels the token of every request still running when its deadline passes, so that
+// extraction stops midway instead of finishing work the caller has given up on
+class DeadlineWatch {
+public:
+    using Key = std::pair<Clock::time_point, uint64_t>;
+
+    DeadlineWatch() : thread_([this] { run(); }) {}
+
+    ~DeadlineWatch() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        changed_.notify_all();
+        thread_.join();
+    }
+
+    Key add(Clock::time_point deadline, std::shared_ptr<gbo::CancellationToken> token) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Key key(deadline, next_id_++);
+        pending_.emplace(key, std::move(token));
+        changed_.notify_all();
+        return key;
+    }
+
+    // Does nothing when the deadline has already fired
+    void remove(const Key& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.erase(key);
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            if (pending_.empty()) {
+                changed_.wait(lock);
+            } else if (Clock::now() >= pending_.begin()->first.first) {
+                pending_.begin()->second->cancel();
+                pending_.erase(pending_.begin());
+            } else {
+                changed_.wait_until(lock, pending_.begin()->first.first);
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::map<Key, std::shared_ptr<gbo::CancellationToken>> pending_;
+    uint64_t next_id_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+class Server {
+public:
+    explicit Server(const DaemonOptions& options)
+        : options_(options), queue_(options.queue_capacity), cache_(options.watermark_cache) {}
+
+    void startWorkers() {
+        int count = options_.workers > 0 ? options_.workers
+                                         : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        for (int i = 0; i < count; ++i) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    int workerCount() const { return static_cast<int>(workers_.size()); }
+
+    void acceptConnection(int fd) {
+        auto connection = std::make_shared<Connection>(fd);
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                              [](const std::weak_ptr<Connection>& c) { return c.expired(); }),
+                               connections_.end());
+            connections_.push_back(connection);
+            ++active_readers_;
+        }
+        std::thread([this, connection] {
+            readerLoop(connection);
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            --active_readers_;
+            readers_done_.notify_all();
+        }).detach();
+    }
+
+    // Stops reading new requests, answers everything already queued and joins the workers
+    void shutdown() {
+        {
+            std::unique_lock<std::mutex> lock(connections_mutex_);
+            for (auto& weak : connections_) {
+                if (auto connection = weak.lock()) {
+                    ::shutdown(connection->fd, SHUT_RD);
+                }
+            }
+            readers_done_.wait(lock, [this] { return active_readers_ == 0; });
+        }
+        queue_.close();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+private:
+    void readerLoop(const std::shared_ptr<Connection>& connection) {
+        std::vector<unsigned char> payload;
+        while (readDaemonFrame(connection->fd, payload)) {
+            Job job;
+            job.arrived = Clock::now();
+            job.connection = connection;
+            if (!decodeDaemonRequest(payload, job.request)) {
+                DaemonResponse response;
+                response.status = DaemonStatus::BadRequest;
+                response.message = "malformed request";
+                connection->send(response);
+                continue;
+            }
+            uint64_t id = job.request.id;
+            if (!queue_.tryPush(std::move(job))) {
+                DaemonResponse response;
+                response.id = id;
+                response.status = DaemonStatus::Overloaded;
+                response.message = "request queue is full";
+                connection->send(response);
+            }
+        }
+    }
+
+    void workerLoop() {
+        // Warm up the per-thread state (RNG, DCT tables) before the first request arrives
+        cv::Mat warm(8, 8, CV_8UC1, cv::Scalar(128));
+        getBitFromBlock(warm, 0);
+
+        Job job;
+        while (queue_.pop(job)) {
+            DaemonResponse response = handle(job);
+            job.connection->send(response);
+            job.connection.reset();
+        }
+    }
+
+    DaemonResponse handle(const Job& job) {
+        const DaemonRequest& request = job.request;
+        DaemonResponse response;
+        response.id = request.id;
+
+        const Clock::time_point start = Clock::now();
+        response.queue_us = microseconds(start - job.arrived);
+        const bool has_deadline = request.deadline_ms > 0;
+        const Clock::time_point deadline = job.arrived + std::chrono::milliseconds(request.deadline_ms);
+        if (has_deadline && start >= deadline) {
+            response.status = DaemonStatus::DeadlineExceeded;
+            response.message = "deadline expired while queued";
+            return response;
+        }
+
+        gbo::Config config;
+        config.scheme = request.scheme;
+        DeadlineWatch::Key watched;
+        if (has_deadline) {
+            auto token = std::make_shared<gbo::CancellationToken>();
+            config.cancellation = token;
+            watched = deadlines_.add(deadline, std::move(token));
+        }
+        auto expired = [&] { return config.cancellation && config.cancellation->cancelled(); };
+
+        try {
+            if (request.scheme < 0 || request.scheme >= static_cast<int>(embeding_region.size())) {
+                throw std::invalid_argument("invalid scheme index");
+            }
+            switch (request.op) {
+                case DaemonOp::Ping:
+                    response.message = "pong";
+                    response.values = {static_cast<double>(workerCount()), static_cast<double>(queue_.size())};
+                    break;
+                case DaemonOp::Embed: {
+                    requireBlobs(request, 2);
+                    cv::Mat image = decodeImage(request.blobs[0], "image");
+                    cv::Mat watermark = cache_.get(request.blobs[1]);
+                    if (has_deadline) {
+                        // The search gets most of what the deadline leaves, the rest covers the PNG encode
+                        // and blocks finishing their initial population; late blocks are embedded analytically
+                        const double remaining_ms = std::chrono::duration<double, std::milli>(deadline - Clock::now()).count();
+                        config.time_budget_ms = std::max(1.0, embed_deadline_share * remaining_ms);
+                    }
+                    gbo::EmbedStats stats;
+                    response.image = encodePng(embedWatermarkMat(image, watermark, config, &stats));
+                    double smallest_margin = 0.0;
+                    for (size_t k = 0; k < stats.out_of_budget.size(); ++k) {
+                        const double margin = stats.out_of_budget[k].margin;
+                        smallest_margin = k == 0 ? margin : std::min(smallest_margin, margin);
+                    }
+                    response.values = {static_cast<double>(stats.out_of_budget.size()), smallest_margin};
+                    break;
+                }
+                case DaemonOp::Extract: {
+                    requireBlobs(request, 1);
+                    cv::Mat image = decodeImage(request.blobs[0], "image");
+                    response.image = encodePng(extractWatermarkMat(image, config));
+                    break;
+                }
+                case DaemonOp::Evaluate: {
+                    requireBlobs(request, 3);
+                    cv::Mat original = decodeImage(request.blobs[0], "original image");
+                    cv::Mat test = decodeImage(request.blobs[1], "test image");
+                    cv::Mat watermark = cache_.get(request.blobs[2]);
+                    cv::Mat extracted = extractWatermarkMat(test, config);
+                    if (expired()) {
+                        throw std::runtime_error("evaluate: cancelled");
+                    }
+                    const ImageQuality quality = computeImageQuality(original, test);
+                    response.values = {
+                        computeBER(extract_watermark_bits(watermark), extract_watermark_bits(extracted)),
+                        quality.psnr,
+                        quality.ssim,
+                        quality.ncc,
+                        quality.mse
+                    };
+                    break;
+                }
+            }
+        } catch (const std::invalid_argument& e) {
+            response.status = DaemonStatus::BadRequest;
+            response.message = e.what();
+        } catch (const std::exception& e) {
+            response.status = DaemonStatus::Error;
+            response.message = e.what();
+        }
+        if (has_deadline) {
+            deadlines_.remove(watched);
+        }
+        if (expired() && response.status == DaemonStatus::Error) {
+            // Extraction threw because the watch cancelled it
+            response.status = DaemonStatus::DeadlineExceeded;
+            response.message = "deadline expired while processing";
+        }
+
+        const Clock::time_point end = Clock::now();
+        response.service_us = microseconds(end - start);
+        if (response.status == DaemonStatus::Ok && has_deadline && end > deadline) {
+            // The caller has given up on this request, so the late result is dropped
+            response.status = DaemonStatus::DeadlineExceeded;
+            response.message = "deadline expired while processing";
+            response.image.clear();
+            response.values.clear();
+        }
+        return response;
+    }
+
+    static void requireBlobs(const DaemonRequest& request, size_t count) {
+        if (request.blobs.size() != count) {
+            throw std::invalid_argument(std::string(daemonOpName(request.op)) + " expects " +
+                                        std::to_string(count) + " images, got " +
+                                        std::to_string(request.blobs.size()));
+        }
+    }
+
+    DaemonOptions options_;
+    BoundedQueue<Job> queue_;
+    WatermarkCache cache_;
+    DeadlineWatch deadlines_;
+    std::vector<std::thread> workers_;
+
+    std::mutex connections_mutex_;
+    std::condition_variable readers_done_;
+    std::vector<std::weak_ptr<Connection>> connections_;
+    int active_readers_ = 0;
+};
+
+// A socket file that still accepts connections belongs to a running server
+bool socketInUse(const sockaddr_un& addr) {
+    int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0) {
+        return false;
+    }
+    const bool connected = ::connect(probe, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::close(probe);
+    return connected;
+}
+
+} // namespace
+
+int runDaemon(const DaemonOptions& options) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (options.socket_path.empty() || options.socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: invalid socket path: " << options.socket_path << std::endl;
+        return 1;
+    }
+    options.socket_path.copy(addr.sun_path, options.socket_path.size());
+
+    // Only a stale socket left by a server that is gone may be replaced
+    struct stat existing{};
+    if (::lstat(options.socket_path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) {
+            std::cerr << "Error: " << options.socket_path << " exists and is not a socket" << std::endl;
+            return 1;
+        }
+        if (socketInUse(addr)) {
+            std::cerr << "Error: another server is listening on " << options.socket_path << std::endl;
+            return 1;
+        }
+        ::unlink(options.socket_path.c_str());
+    }
+
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "Error: could not create socket" << std::endl;
+        return 1;
+    }
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd, 64) < 0) {
+        std::cerr << "Error: could not listen on " << options.socket_path << std::endl;
+        ::close(listen_fd);
+        return 1;
+    }
+
+    stop_requested = false;
+    struct sigaction action{};
+    action.sa_handler = onStopSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    Server server(options);
+    server.startWorkers();
+    std::cout << "GBO daemon listening on " << options.socket_path
+              << " with " << server.workerCount() << " workers" << std::endl;
+
+    while (!stop_requested) {
+        pollfd pfd{listen_fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0) {
+            continue;
+        }
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd >= 0) {
+            server.acceptConnection(fd);
+        }
+    }
+
+    std::cout << "Shutting down GBO daemon..." << std::endl;
+    ::close(listen_fd);
+    server.shutdown();
+    ::unlink(options.socket_path.c_str());
+    return 0;
+}
@@ -1,10 +1,12 @@
 #include "../include/dataset_builder.h"
+#include "../include/parallel.h"
 #include "../include/process_block.h"
 #include <stdexcept>
 #include "../include/attacks.h"
 #include "../include/process_images.h"
+#include "../include/random_utils.h"
 
-cv::Mat embedUniformBits(const cv::Mat& src, unsigned char bit, int scheme) {
+cv::Mat embedUniformBits(const cv::Mat& src, unsigned char bit, int scheme, uint64_t seed) {
     if (src.empty()) {
         throw std::invalid_argument("embedUniformBits: empty input image");
     }
@@ -23,21 +25,24 @@ cv::Mat embedUniformBits(const cv::Mat& src, unsigned char bit, int scheme) {
 
     const int vector_size = static_cast<int>(embeding_region[scheme].size());
     cv::Mat dst = src.clone();
-    GBO optimizer;
+    const int blocks_per_row = src.cols / 8;
+    const size_t block_count = static_cast<size_t>(blocks_per_row) * (src.rows / 8);
 
-    for (int y = 0; y < src.rows; y += 8) {
-        for (int x = 0; x < src.cols; x += 8) {
-            cv::Rect roi(x, y, 8, 8);
-            cv::Mat block = src(roi);
-            cv::Mat embedded_block = optimizer.main_loop(block, vector_size, bit, scheme);
-            embedded_block.copyTo(dst(roi));
+    parallelFor(block_count, resolveThreads(0), [&](size_t i) {
+        cv::Rect roi(static_cast<int>(i % blocks_per_row) * 8, static_cast<int>(i / blocks_per_row) * 8, 8, 8);
+        cv::Mat block = src(roi);
+        if (seed != 0) {
+            seed_thread_random(mixSeed(seed, i));
         }
-    }
+        GBO optimizer;
+        cv::Mat embedded_block = optimizer.main_loop(block, vector_size, bit, scheme);
+        embedded_block.copyTo(dst(roi));
+    });
     return dst;
 }
 
 
-cv::Mat simulateAttack(const cv::Mat& src, AttackType type, double param1, int param2) {
+cv::Mat simulateAttack(const cv::Mat& src, AttackType type, double param1, int param2, uint64_t seed) {
     if (src.empty()) {
         throw std::invalid_argument("simulateAttack: empty input image");
     }
@@ -55,9 +60,9 @@ cv::Mat simulateAttack(const cv::Mat& src, AttackType type, double param1, int p
         case AttackType::ContrastDecrease:
             return contrastDecrease(src, param1);
         case AttackType::SaltPepperNoise:
-            return saltPepperNoise(src, param1 / 100.0); // param1 as percentage
+            return saltPepperNoise(src, param1 / 100.0, seed); // param1 as percentage
         case AttackType::SpeckleNoise:
-            return speckleNoise(src, param1);
+            return speckleNoise(src, param1, seed);
         case AttackType::HistogramEqualization:
             return histogramEqualization(src);
         case AttackType::Sharpening:
@@ -75,8 +80,6 @@ cv::Mat simulateAttack(const cv::Mat& src, AttackType type, double param1, int p
     }
 }
 
-const std::vector<AttackType> attacks = {AttackType::JPEGCompression, AttackType::ContrastIncrease};
-
 struct ISB { // Image, Scheme and Bit
     cv::Mat image;
     int scheme;
@@ -85,135 +88,530 @@ struct ISB { // Image, Scheme and Bit
     ISB(cv::Mat img, int s, unsigned char b ) : image(img), scheme(s), bit(b) {}
 };
 
-struct BSB { // Block, Scheme and Bit
-    cv::Mat block;
-    int scheme;
-    unsigned char bit;
-
-    BSB(cv::Mat blk, int s, unsigned char b) : block(blk), scheme(s), bit(b) {}
-};
 
 #include <iostream>
 #include <iomanip>
 #include <filesystem>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
 #include <random>
-#include <unordered_map>
+#include <set>
+#include <sstream>
+#include <tuple>
 
-void buildDataset(int tau_max) {
-    std::filesystem::create_directories("dataset/Dir1");
-    std::filesystem::create_directories("dataset/Dir2");
-    std::filesystem::create_directories("dataset/Dirrand");
-    
-    int dir1_count = 0, dir2_count = 0, dirrand_count = 0;
+namespace {
+
+// Dir1, Dir2 and Dirrand in this order
+const char* const class_dirs[] = {"Dir1", "Dir2", "Dirrand"};
+
+uint64_t fnv1a(uint64_t hash, const std::string& text) {
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+const uint64_t fnv_offset = 0xcbf29ce484222325ULL;
+
+std::string hexDigest(uint64_t value) {
+    std::ostringstream out;
+    out << std::hex << std::setw(16) << std::setfill('0') << value;
+    return out.str();
+}
+
+// What every shard of one build must share besides the shard count
+std::string corpusDigest() {
+    uint64_t hash = fnv_offset;
+    for (const auto& path : images) hash = fnv1a(hash, path + '\n');
+    return std::to_string(images.size()) + " " + hexDigest(hash);
+}
+
+std::string planDigest(const AttackPlan& plan) {
+    std::ostringstream text;
+    text << std::setprecision(17);
+    for (const AttackNode& node : plan.nodes()) {
+        text << node.id << ' ' << node.attack << ' ' << node.param << ' ' << node.input << '\n';
+    }
+    for (int tau : plan.tauNodes()) text << tau << ' ';
+    return hexDigest(fnv1a(fnv_offset, text.str()));
+}
+
+// Steps 1-5 for one image: tau of both schemes for every block, row-major
+std::vector<std::array<int, amount_of_schemes>> blockTaus(const AttackPlan& plan, const cv::Mat& original_img,
+                                                          size_t image_index, uint64_t seed) {
+    // Every image draws from its own stream, so its blocks do not depend on which images run with it
+    const uint64_t image_seed = mixSeed(seed, image_index);
+
+    // Шаг 1: Создаем 4 копии изображения для каждого класса (I0^1, I1^1, I0^2, I1^2)
+    // Копии строятся параллельно, блоки внутри каждой копии делят с ними общий пул потоков
+    std::vector<cv::Mat> embedded(2 * amount_of_schemes);
+    parallelFor(embedded.size(), resolveThreads(0), [&](size_t k) {
+        embedded[k] = embedUniformBits(original_img, static_cast<unsigned char>(k % 2), static_cast<int>(k / 2),
+                                       mixSeed(image_seed, k));
+    });
+    std::vector<ISB> image_copies;
+    for (size_t k = 0; k < embedded.size(); ++k) {
+        image_copies.emplace_back(embedded[k], static_cast<int>(k / 2), static_cast<unsigned char>(k % 2));
+    }
+    std::cout << "Generated embedded copies for both schemes" << std::endl;
+
+    // Шаг 3: Прогоняем каждую копию через план атак; каждый узел считается один раз на копию,
+    // независимые узлы - параллельно. Возвращаются изображения узлов, по которым считается tau
+    std::vector<std::vector<cv::Mat>> attacked(image_copies.size());
+    parallelFor(image_copies.size(), resolveThreads(0), [&](size_t k) {
+        attacked[k] = plan.evaluate(image_copies[k].image, 0, mixSeed(image_seed, image_copies.size() + k));
+    });
+    std::cout << "Evaluated the attack plan: " << plan.nodes().size() << " nodes, tau over "
+              << plan.tauNodes().size() << " of them per copy" << std::endl;
+
+    // Шаг 4-5: Для каждого блока считаем ошибки извлечения по схемам (tau от 0 до 2 * число узлов tau)
+    const int blocks_per_row = original_img.cols / 8;
+    const size_t total_blocks_in_image = static_cast<size_t>(blocks_per_row) * (original_img.rows / 8);
+    std::vector<std::array<int, amount_of_schemes>> taus(total_blocks_in_image);
+    parallelFor(total_blocks_in_image, resolveThreads(0), [&](size_t block_idx) {
+        const cv::Rect roi(static_cast<int>(block_idx % blocks_per_row) * 8, static_cast<int>(block_idx / blocks_per_row) * 8, 8, 8);
+        std::array<int, amount_of_schemes> errors{};
+        for (size_t k = 0; k < image_copies.size(); ++k) {
+            for (const cv::Mat& image : attacked[k]) {
+                if (getBitFromBlock(image(roi), image_copies[k].scheme) != image_copies[k].bit) {
+                    errors[image_copies[k].scheme]++;
+                }
+            }
+        }
+        taus[block_idx] = errors;
+    });
+    return taus;
+}
+
+// Шаг 6-7: Классификация блока согласно алгоритму из PDF (индекс в class_dirs)
+int blockClass(const std::array<int, amount_of_schemes>& tau, int tau_max) {
+    const int tau1 = tau[0];  // ошибки для схемы 0
+    const int tau2 = tau[1];  // ошибки для схемы 1
+    if (tau1 < tau_max) {
+        return 0;   // Класс 1
+    } else if (tau2 <= tau_max && tau_max <= tau1) {
+        return 1;   // Класс 2
+    }
+    return 2;       // Неопределенные
+}
+
+// Runs blockTaus over the shard's images that are not in `done` (blocks per class of the images
+// a resumed run committed before) and hands every image to store(image_index, original_img, taus)
+template <typename Store>
+void buildImages(const AttackPlan& plan, uint64_t seed, const DatasetShard& shard,
+                 const std::map<size_t, std::array<int, 3>>& done, Store store) {
     size_t total_blocks_estimate = 0;
-    
-    for (const auto& img_path : images) {
-        cv::Mat tmp = cv::imread(img_path, cv::IMREAD_GRAYSCALE);
+    for (size_t i = 0; i < images.size(); ++i) {
+        if (!shard.contains(i)) continue;
+        cv::Mat tmp = cv::imread(images[i], cv::IMREAD_GRAYSCALE);
         if (tmp.empty()) continue;
         total_blocks_estimate += (tmp.rows / 8) * (tmp.cols / 8);
     }
-    
+
     size_t processed_blocks = 0;
-    int image_index = 0;
-    
-    for (const auto& image_path : images) {
-        std::cout << "\n\n[" << ++image_index << "/" << images.size() << "] Processing image: " << image_path << std::endl;
-        
+    for (size_t image_index = 0; image_index < images.size(); ++image_index) {
+        if (!shard.contains(image_index)) continue;
+        const std::string& image_path = images[image_index];
+        const auto committed = done.find(image_index);
+        if (committed != done.end()) {
+            processed_blocks += committed->second[0] + committed->second[1] + committed->second[2];
+            std::cout << "[" << image_index + 1 << "/" << images.size() << "] Committed before: " << image_path << std::endl;
+            continue;
+        }
+        std::cout << "\n\n[" << image_index + 1 << "/" << images.size() << "] Processing image: " << image_path << std::endl;
+
         cv::Mat original_img = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
         if (original_img.empty()) {
             std::cout << "Error: Could not load image " << image_path << std::endl;
             continue;
         }
-        
-        // Шаг 1: Создаем 4 копии изображения для каждого класса (I0^1, I1^1, I0^2, I1^2)
-        std::vector<ISB> image_copies;
-        for (int scheme = 0; scheme < 2; ++scheme) {
-            cv::Mat img_bit0 = embedUniformBits(original_img, 0, scheme);
-            cv::Mat img_bit1 = embedUniformBits(original_img, 1, scheme);
-            image_copies.emplace_back(img_bit0, scheme, 0);
-            image_copies.emplace_back(img_bit1, scheme, 1);
-        }
-        std::cout << "Generated embedded copies for both schemes" << std::endl;
-        
-        // Шаг 3: Атакуем каждую копию отдельно (JPEG70 или Увеличение контрастности)
-        int original_copies_count = image_copies.size();
-        for (int i = 0; i < original_copies_count; ++i) {
-            // JPEG70 атака
-            cv::Mat jpeg_attacked = simulateAttack(image_copies[i].image, AttackType::JPEGCompression, 70);
-            image_copies.emplace_back(jpeg_attacked, image_copies[i].scheme, image_copies[i].bit);
-            
-            // Увеличение контрастности
-            cv::Mat contrast_attacked = simulateAttack(image_copies[i].image, AttackType::ContrastIncrease, 1.2);
-            image_copies.emplace_back(contrast_attacked, image_copies[i].scheme, image_copies[i].bit);
-        }
-        std::cout << "Generated attacked copies: JPEG70 and Contrast increase (separately)" << std::endl;
-        
-        // Шаг 4: Делим все копии на блоки 8x8
-        std::vector<std::vector<BSB>> block_groups;
-        for (const auto& img_copy : image_copies) {
-            std::vector<cv::Mat> blocks_8x8 = splitImageInto8x8Blocks(img_copy.image);
-            std::vector<BSB> blocks_with_info;
-            for (const auto& block : blocks_8x8) {
-                blocks_with_info.emplace_back(block, img_copy.scheme, img_copy.bit);
+
+        const std::vector<std::array<int, amount_of_schemes>> taus = blockTaus(plan, original_img, image_index, seed);
+        store(image_index, original_img, taus);
+
+        // One line per committed image: the output is meant for logs of long runs as much as for a terminal
+        processed_blocks += taus.size();
+        double perc = 100.0 * static_cast<double>(processed_blocks) / static_cast<double>(total_blocks_estimate);
+        std::cout << "Building dataset: " << std::fixed << std::setprecision(1) << perc << "% (image committed)" << std::endl;
+    }
+}
+
+cv::Mat blockOf(const cv::Mat& image, size_t block_idx) {
+    const int blocks_per_row = image.cols / 8;
+    return image(cv::Rect(static_cast<int>(block_idx % blocks_per_row) * 8, static_cast<int>(block_idx / blocks_per_row) * 8, 8, 8));
+}
+
+void createClassDirs(const std::string& output_dir) {
+    for (const char* dir : class_dirs) {
+        std::filesystem::create_directories(output_dir + "/" + dir);
+    }
+}
+
+void printSummary(int tau_max, const DatasetCounts& counts) {
+    std::cout << "\n\nDataset building complete (tau_max = " << tau_max << "):" << std::endl;
+    std::cout << "  Dir1 (Scheme 1): " << counts.dir1 << " blocks" << std::endl;
+    std::cout << "  Dir2 (Scheme 2): " << counts.dir2 << " blocks" << std::endl;
+    std::cout << "  Dirrand (Undefined): " << counts.dirrand << " blocks" << std::endl;
+
+    double total = counts.dir1 + counts.dir2 + counts.dirrand;
+    if (total > 0) {
+        std::cout << "\nDistribution:" << std::endl;
+        std::cout << "  Dir1: " << std::fixed << std::setprecision(1) << (counts.dir1/total*100) << "%" << std::endl;
+        std::cout << "  Dir2: " << std::fixed << std::setprecision(1) << (counts.dir2/total*100) << "%" << std::endl;
+        std::cout << "  Dirrand: " << std::fixed << std::setprecision(1) << (counts.dirrand/total*100) << "%" << std::endl;
+
+        if (counts.dirrand/total > 0.3) {
+            std::cout << "\nWarning: High percentage of undefined blocks (>30%). Consider adjusting tau_max." << std::endl;
+        }
+    }
+}
+
+int& countOf(DatasetCounts& counts, int block_class) {
+    return block_class == 0 ? counts.dir1 : block_class == 1 ? counts.dir2 : counts.dirrand;
+}
+
+// shard.txt of one shard directory, or checkpoint.txt of a build in progress
+struct ShardManifest {
+    DatasetShard shard;
+    std::string header;                                 // every line but the images'
+    std::string settings;                               // the same without the shard index
+    int tau_max = 0;
+    uint64_t seed = 0;
+    std::map<size_t, std::array<int, 3>> images;        // blocks per class of every built image
+};
+
+// What a resumed run and every shard of one build must share
+std::string manifestHeader(const AttackPlan& plan, int tau_max, const DatasetShard& shard, uint64_t seed) {
+    std::ostringstream header;
+    header << "shard " << shard.index << ' ' << shard.count << ' ' << (shard.hash ? "hash" : "range") << '\n'
+           << "corpus " << corpusDigest() << '\n'
+           << "tau_max " << tau_max << '\n'
+           << "seed " << seed << '\n'
+           << "plan " << planDigest(plan) << '\n';
+    return header.str();
+}
+
+// `prefix` names the caller in errors
+ShardManifest readManifest(const std::string& path, const std::string& prefix) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error(prefix + "cannot read " + path);
+    }
+    const std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    // A line without its newline was cut off by a crash while it was appended: that image is not committed
+    std::istringstream lines(text.substr(0, text.rfind('\n') + 1));
+    ShardManifest manifest;
+    bool has_shard = false;
+    for (std::string line; std::getline(lines, line);) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "image") {
+            size_t index = 0;
+            std::array<int, 3> counts{};
+            if (!(fields >> index >> counts[0] >> counts[1] >> counts[2])) {
+                throw std::runtime_error(prefix + "bad line '" + line + "' in " + path);
+            }
+            manifest.images[index] = counts;
+            continue;
+        }
+        if (key.empty()) continue;
+        manifest.header += line + "\n";
+        if (key == "shard") {
+            std::string mode;
+            has_shard = static_cast<bool>(fields >> manifest.shard.index >> manifest.shard.count >> mode);
+            manifest.shard.hash = mode == "hash";
+            manifest.settings += "shards " + std::to_string(manifest.shard.count) + " " + mode + "\n";
+            continue;
+        }
+        if (key == "tau_max") fields >> manifest.tau_max;
+        if (key == "seed") fields >> manifest.seed;
+        manifest.settings += line + "\n";
+    }
+    if (!has_shard) {
+        throw std::runtime_error(prefix + path + " names no shard");
+    }
+    return manifest;
+}
+
+void writeFileAtomically(const std::string& path, const std::string& text, const std::string& prefix) {
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary);
+        out << text;
+        if (!out) {
+            throw std::runtime_error(prefix + "cannot write " + temporary);
+        }
+    }
+    std::filesystem::rename(temporary, path);
+}
+
+/**
+ * Builds the shard's images into output_dir with a checkpoint, image by image. A fresh run
+ * first deletes Dir1/Dir2/Dirrand and tau/ of any earlier run in output_dir.
+ *
+ * checkpoint.txt holds the manifest header and gets one "image" line appended per committed
+ * image. An image is committed by writing its blocks and its tau file into .staging/, renaming
+ * them into place and appending its line; the checkpointed counters then continue the block
+ * numbering. A resumed run skips the listed images and first deletes what an interrupted commit
+ * left, i.e. every block file that committed(class, file stem, counts, committed images) rejects.
+ * name(image_index, block_idx, number) is the stem of a block's file; number is the running
+ * count of its class.
+ */
+template <typename Name, typename Committed>
+DatasetCounts buildWithCheckpoint(const AttackPlan& plan, int tau_max, const DatasetShard& shard, const std::string& output_dir,
+                                  uint64_t seed, bool resume, const std::string& prefix, Name name, Committed committed) {
+    namespace fs = std::filesystem;
+    const std::string checkpoint = output_dir + "/checkpoint.txt";
+    const std::string staging = output_dir + "/.staging";
+    ShardManifest state;
+    DatasetCounts counts;
+    if (resume) {
+        if (!fs::exists(checkpoint)) {
+            throw std::runtime_error(prefix + "no checkpoint to resume in " + output_dir);
+        }
+        state = readManifest(checkpoint, prefix);
+        if (seed != 0 && seed != state.seed) {
+            throw std::runtime_error(prefix + "the checkpoint was built with seed " + std::to_string(state.seed));
+        }
+        // The seed is the whole random state: every image's streams are derived from it
+        seed = state.seed;
+        if (state.header != manifestHeader(plan, tau_max, shard, seed)) {
+            throw std::runtime_error(prefix + "the plan, tau_max, shard or image list differ from the checkpointed run");
+        }
+        for (const auto& [image_index, image_counts] : state.images) {
+            counts.dir1 += image_counts[0];
+            counts.dir2 += image_counts[1];
+            counts.dirrand += image_counts[2];
+        }
+        // Rewritten without a line a crash may have cut off, so that appending continues cleanly
+        std::ostringstream restored;
+        restored << state.header;
+        for (const auto& [image_index, image_counts] : state.images) {
+            restored << "image " << image_index << ' ' << image_counts[0] << ' ' << image_counts[1] << ' ' << image_counts[2] << '\n';
+        }
+        writeFileAtomically(checkpoint, restored.str(), prefix);
+
+        fs::remove_all(staging);
+        for (int block_class = 0; block_class < 3; ++block_class) {
+            const fs::path dir = output_dir + "/" + class_dirs[block_class];
+            if (!fs::exists(dir)) continue;
+            std::vector<fs::path> stale;
+            for (const auto& entry : fs::directory_iterator(dir)) {
+                if (entry.path().extension() == ".png" && !committed(block_class, entry.path().stem().string(), counts, state.images)) {
+                    stale.push_back(entry.path());
+                }
+            }
+            for (const fs::path& path : stale) fs::remove(path);
+        }
+        std::cout << "Resuming: " << state.images.size() << " images committed, seed " << seed << std::endl;
+    } else {
+        if (seed == 0) {
+            // Resuming continues the same streams, so an unseeded run draws its seed and checkpoints it
+            std::random_device device;
+            seed = (static_cast<uint64_t>(device()) << 32 | device()) | 1;
+        }
+        // Blocks of an earlier run would mix with this one's: other classes, other numbering
+        for (const char* dir : class_dirs) fs::remove_all(output_dir + "/" + dir);
+        fs::remove_all(output_dir + "/tau");
+        fs::remove_all(staging);
+        fs::create_directories(output_dir);
+        writeFileAtomically(checkpoint, manifestHeader(plan, tau_max, shard, seed), prefix);
+    }
+    createClassDirs(output_dir);
+    createClassDirs(staging);
+    fs::create_directories(output_dir + "/tau");
+
+    std::ofstream journal(checkpoint, std::ios::app);
+    buildImages(plan, seed, shard, state.images,
+                [&](size_t image_index, const cv::Mat& original_img, const std::vector<std::array<int, amount_of_schemes>>& taus) {
+        std::ostringstream tau_name;
+        tau_name << std::setfill('0') << std::setw(4) << image_index << ".txt";
+        std::ostringstream tau_text;
+        std::array<int, 3> image_counts{};
+        std::vector<std::pair<std::string, std::string>> files;     // staged path, final path
+        for (size_t block_idx = 0; block_idx < taus.size(); ++block_idx) {
+            const int block_class = blockClass(taus[block_idx], tau_max);
+            const std::string file = std::string(class_dirs[block_class]) + "/" +
+                                     name(image_index, block_idx, countOf(counts, block_class)++) + ".png";
+            cv::imwrite(staging + "/" + file, blockOf(original_img, block_idx));
+            files.emplace_back(staging + "/" + file, output_dir + "/" + file);
+            image_counts[block_class]++;
+            tau_text << taus[block_idx][0] << ' ' << taus[block_idx][1] << '\n';
+        }
+        writeFileAtomically(staging + "/" + tau_name.str(), tau_text.str(), prefix);
+        files.emplace_back(staging + "/" + tau_name.str(), output_dir + "/tau/" + tau_name.str());
+
+        for (const auto& [staged, final_path] : files) fs::rename(staged, final_path);
+        journal << "image " << image_index << ' ' << image_counts[0] << ' ' << image_counts[1] << ' ' << image_counts[2] << '\n'
+                << std::flush;
+        if (!journal) {
+            throw std::runtime_error(prefix + "cannot append to " + checkpoint);
+        }
+    });
+    journal.close();
+    fs::remove_all(staging);
+    return counts;
+}
+
+} // namespace
+
+bool DatasetShard::contains(size_t image_index) const {
+    if (hash) {
+        return image_index < images.size() && fnv1a(fnv_offset, images[image_index]) % count == static_cast<uint64_t>(index);
+    }
+    return image_index * count / images.size() == static_cast<size_t>(index);
+}
+
+DatasetShard parseDatasetShard(const std::string& spec) {
+    DatasetShard shard;
+    std::string range = spec;
+    if (range.rfind("hash:", 0) == 0) {
+        shard.hash = true;
+        range = range.substr(5);
+    }
+    const size_t slash = range.find('/');
+    try {
+        size_t used = 0;
+        shard.index = std::stoi(range.substr(0, slash), &used);
+        if (slash == std::string::npos || used != slash) throw std::invalid_argument(spec);
+        shard.count = std::stoi(range.substr(slash + 1), &used);
+        if (used != range.size() - slash - 1) throw std::invalid_argument(spec);
+    } catch (const std::exception&) {
+        throw std::invalid_argument("parseDatasetShard: '" + spec + "' is not k/n or hash:k/n");
+    }
+    if (shard.count < 1 || shard.index < 0 || shard.index >= shard.count) {
+        throw std::invalid_argument("parseDatasetShard: '" + spec + "' needs 0 <= k < n");
+    }
+    return shard;
+}
+
+void buildDataset(int tau_max) {
+    buildDataset(AttackPlan::defaultPlan(), tau_max);
+}
+
+void buildDataset(const AttackPlan& plan, int tau_max, uint64_t seed, bool resume) {
+    // Blocks are numbered per class in image and block order; the checkpointed counters continue it
+    const DatasetCounts counts = buildWithCheckpoint(plan, tau_max, DatasetShard(), "dataset", seed, resume, "buildDataset: ",
+        [](size_t, size_t, int number) { return "block_" + std::to_string(number); },
+        [](int block_class, const std::string& stem, DatasetCounts& committed, const std::map<size_t, std::array<int, 3>>&) {
+            return stem.rfind("block_", 0) == 0 && std::atoi(stem.c_str() + 6) < countOf(committed, block_class);
+        });
+    std::filesystem::remove("dataset/checkpoint.txt");
+    printSummary(tau_max, counts);
+}
+
+DatasetCounts buildDatasetShard(const AttackPlan& plan, int tau_max, const DatasetShard& shard,
+                                const std::string& output_dir, uint64_t seed, bool resume) {
+    const std::string manifest = output_dir + "/shard.txt", checkpoint = output_dir + "/checkpoint.txt";
+    if (resume && !std::filesystem::exists(checkpoint) && std::filesystem::exists(manifest)) {
+        // A finished shard resumes as a checkpoint with every image committed
+        std::filesystem::rename(manifest, checkpoint);
+    } else {
+        // A manifest left from an earlier run would mark the shard finished while it is rebuilt
+        std::filesystem::remove(manifest);
+    }
+    const DatasetCounts counts = buildWithCheckpoint(plan, tau_max, shard, output_dir, seed, resume, "buildDatasetShard: ",
+        [](size_t image_index, size_t block_idx, int) {
+            std::ostringstream name;
+            name << std::setfill('0') << std::setw(4) << image_index << '_' << std::setw(6) << block_idx;
+            return name.str();
+        },
+        [](int, const std::string& stem, DatasetCounts&, const std::map<size_t, std::array<int, 3>>& committed) {
+            return committed.count(std::strtoul(stem.c_str(), nullptr, 10)) != 0;
+        });
+
+    // The finished checkpoint is the shard's manifest; the rename marks the shard finished
+    std::filesystem::rename(checkpoint, manifest);
+    printSummary(tau_max, counts);
+    return counts;
+}
+
+DatasetCounts mergeDatasetShards(const std::vector<std::string>& shard_dirs, const std::string& output_dir) {
+    if (shard_dirs.empty()) {
+        throw std::runtime_error("mergeDatasetShards: no shards");
+    }
+    std::vector<ShardManifest> manifests;
+    std::set<int> indices;
+    for (const std::string& dir : shard_dirs) {
+        manifests.push_back(readManifest(dir + "/shard.txt", "mergeDatasetShards: "));
+        const ShardManifest& manifest = manifests.back();
+        if (manifest.settings != manifests.front().settings) {
+            throw std::runtime_error("mergeDatasetShards: " + dir + " was built with other settings than " + shard_dirs.front());
+        }
+        if (!indices.insert(manifest.shard.index).second) {
+            throw std::runtime_error("mergeDatasetShards: shard " + std::to_string(manifest.shard.index) + " is given twice");
+        }
+    }
+    if (static_cast<int>(indices.size()) != manifests.front().shard.count) {
+        throw std::runtime_error("mergeDatasetShards: " + std::to_string(indices.size()) + " of " +
+                                 std::to_string(manifests.front().shard.count) + " shards given");
+    }
+
+    // The blocks of every class in the order a single run writes them: by image, then by block.
+    // Everything is checked before the output is touched, so a rejected merge leaves it as it was.
+    std::vector<std::tuple<size_t, size_t, std::filesystem::path>> blocks[3];
+    std::vector<std::pair<std::filesystem::path, std::string>> taus;     // shard file, name in tau/
+    for (size_t s = 0; s < shard_dirs.size(); ++s) {
+        for (int block_class = 0; block_class < 3; ++block_class) {
+            std::map<size_t, int> found;
+            for (const auto& entry : std::filesystem::directory_iterator(shard_dirs[s] + "/" + class_dirs[block_class])) {
+                const std::string name = entry.path().stem().string();
+                const size_t underscore = name.find('_');
+                if (entry.path().extension() != ".png" || underscore == std::string::npos) continue;
+                const size_t image_index = std::stoul(name.substr(0, underscore));
+                blocks[block_class].emplace_back(image_index, std::stoul(name.substr(underscore + 1)), entry.path());
+                found[image_index]++;
             }
-            block_groups.push_back(blocks_with_info);
-        }
-        
-        // Шаг 5-7: Классификация блоков по новому алгоритму
-        // Теперь у нас 12 групп блоков: 4 схемы×биты (оригинал) + 4 JPEG + 4 контраст
-        // Для каждой схемы: 6 вариантов (без атаки 0, без атаки 1, JPEG 0, JPEG 1, контраст 0, контраст 1)
-        int total_blocks_in_image = block_groups[0].size();
-        for (int block_idx = 0; block_idx < total_blocks_in_image; ++block_idx) {
-            // Подсчитываем ошибки для каждой схемы (tau может быть от 0 до 6)
-            std::vector<int> scheme_errors(2, 0);
-            
-            for (const auto& group : block_groups) {
-                unsigned char extracted_bit = getBitFromBlock(group[block_idx].block, group[block_idx].scheme);
-                if (extracted_bit != group[block_idx].bit) {
-                    scheme_errors[group[block_idx].scheme]++;
+            for (const auto& [image_index, image_counts] : manifests[s].images) {
+                const auto it = found.find(image_index);
+                if ((it == found.end() ? 0 : it->second) != image_counts[block_class]) {
+                    throw std::runtime_error("mergeDatasetShards: " + shard_dirs[s] + "/" + class_dirs[block_class] +
+                                             " does not hold the blocks shard.txt lists for image " + std::to_string(image_index));
                 }
+                found.erase(image_index);
+            }
+            if (!found.empty()) {
+                throw std::runtime_error("mergeDatasetShards: " + shard_dirs[s] + "/" + class_dirs[block_class] +
+                                         " holds blocks of image " + std::to_string(found.begin()->first) +
+                                         ", which shard.txt does not list");
             }
-            
-            int tau1 = scheme_errors[0];  // ошибки для схемы 0 (от 0 до 6)
-            int tau2 = scheme_errors[1];  // ошибки для схемы 1 (от 0 до 6)
-            
-            // Классификация согласно алгоритму из PDF
-            cv::Mat original_block = splitImageInto8x8Blocks(original_img)[block_idx];
-            std::string output_path;
-            
-            if (tau1 < tau_max) {
-                // Класс 1
-                output_path = "dataset/Dir1/block_" + std::to_string(dir1_count++) + ".png";
-            } else if (tau2 <= tau_max && tau_max <= tau1) {
-                // Класс 2  
-                output_path = "dataset/Dir2/block_" + std::to_string(dir2_count++) + ".png";
-            } else {
-                // Неопределенные
-                output_path = "dataset/Dirrand/block_" + std::to_string(dirrand_count++) + ".png";
+        }
+        for (const auto& entry : manifests[s].images) {
+            std::ostringstream tau_name;
+            tau_name << std::setfill('0') << std::setw(4) << entry.first << ".txt";
+            const std::filesystem::path tau = shard_dirs[s] + "/tau/" + tau_name.str();
+            if (!std::filesystem::is_regular_file(tau)) {
+                throw std::runtime_error("mergeDatasetShards: " + tau.string() + " is missing");
             }
-            
-            cv::imwrite(output_path, original_block);
-            
-            processed_blocks++;
-            double perc = 100.0 * static_cast<double>(processed_blocks) / static_cast<double>(total_blocks_estimate);
-            std::cout << "\rBuilding dataset: " << std::fixed << std::setprecision(1) << perc << "%" << std::flush;
+            taus.emplace_back(tau, tau_name.str());
+        }
+        if (std::filesystem::exists(output_dir) && std::filesystem::equivalent(shard_dirs[s], output_dir)) {
+            throw std::runtime_error("mergeDatasetShards: " + output_dir + " is one of the shards");
         }
     }
-    
-    std::cout << "\n\nDataset building complete (tau_max = " << tau_max << "):" << std::endl;
-    std::cout << "  Dir1 (Scheme 1): " << dir1_count << " blocks" << std::endl;
-    std::cout << "  Dir2 (Scheme 2): " << dir2_count << " blocks" << std::endl;
-    std::cout << "  Dirrand (Undefined): " << dirrand_count << " blocks" << std::endl;
-    
-    double total = dir1_count + dir2_count + dirrand_count;
-    if (total > 0) {
-        std::cout << "\nDistribution:" << std::endl;
-        std::cout << "  Dir1: " << std::fixed << std::setprecision(1) << (dir1_count/total*100) << "%" << std::endl;
-        std::cout << "  Dir2: " << std::fixed << std::setprecision(1) << (dir2_count/total*100) << "%" << std::endl;
-        std::cout << "  Dirrand: " << std::fixed << std::setprecision(1) << (dirrand_count/total*100) << "%" << std::endl;
-        
-        if (dirrand_count/total > 0.3) {
-            std::cout << "\nWarning: High percentage of undefined blocks (>30%). Consider adjusting tau_max." << std::endl;
+
+    // Blocks of an earlier build would keep numbers past this one's, as in buildDataset
+    for (const char* dir : class_dirs) std::filesystem::remove_all(output_dir + "/" + dir);
+    std::filesystem::remove_all(output_dir + "/tau");
+    createClassDirs(output_dir);
+    std::filesystem::create_directories(output_dir + "/tau");
+
+    DatasetCounts counts;
+    for (int block_class = 0; block_class < 3; ++block_class) {
+        std::sort(blocks[block_class].begin(), blocks[block_class].end());
+        for (const auto& block : blocks[block_class]) {
+            const int number = countOf(counts, block_class)++;
+            std::filesystem::copy_file(std::get<2>(block),
+                                       output_dir + "/" + class_dirs[block_class] + "/block_" + std::to_string(number) + ".png");
         }
     }
-}
\ No newline at end of file
+    for (const auto& [tau, name] : taus) {
+        std::filesystem::copy_file(tau, output_dir + "/tau/" + name);
+    }
+    printSummary(manifests.front().tau_max, counts);
+    return counts;
+}
@@ -1,82 +1,121 @@
 #include "gbo.h"
 #include <iostream>
+#include "block_arena.h"
 #include "process_block.h"
 #include "debug_log.h"
 
 
-static arma::vec calculate_gsr(double rho2, const arma::vec& best_x, const arma::vec& worst_x, const arma::vec& current_x, const arma::vec& xr1, const arma::vec& dm, const arma::vec& xm, unsigned char flag, int N){
-    int vec_size = best_x.n_elem;
-    arma::vec gsr(vec_size), del_x(vec_size), delta(vec_size), step(vec_size), xs(vec_size), yp(vec_size), yq(vec_size);
-    double a = uniform_random_0_1();
-    double b = static_cast<double>(random_index(N));
-    double c = uniform_random_0_1();
-    double eps =  0.01 * uniform_random_0_1();
+// Writes the gradient search rule into `gsr`; the temporaries come from the thread's arena
+static void calculate_gsr(arma::vec& gsr, double rho2, const arma::vec& best_x, const arma::vec& worst_x, const arma::vec& current_x, const arma::vec& xr1, const arma::vec& dm, const arma::vec& xm, unsigned char flag, const GsrDraws& r){
+    const arma::uword vec_size = best_x.n_elem;
+    ArenaScope scope;
+    BlockArena& arena = BlockArena::local();
+    arma::vec del_x = arena.vec(vec_size), delta = arena.vec(vec_size), step = arena.vec(vec_size), xs = arena.vec(vec_size), yp = arena.vec(vec_size), yq = arena.vec(vec_size);
 
-    delta = 2.0 * a * arma::abs(xm - current_x + eps);
+    delta = 2.0 * r.a * arma::abs(xm - current_x + r.eps);
     step = 0.5 * (best_x - xr1 + delta);
-    del_x = b * arma::abs(step);
-    gsr = (c * rho2 * 2.0 * (del_x % current_x)) / (best_x - worst_x + eps);
+    del_x = r.b * arma::abs(step);
+    gsr = (r.c * rho2 * 2.0 * (del_x % current_x)) / (best_x - worst_x + r.eps);
     xs = flag == 1? current_x : best_x;
     xs = xs - gsr + dm;
 
-    double p1 = uniform_random_0_1();
-    double p2 = uniform_random_0_1();
-    double q1 = uniform_random_0_1();
-    double q2 = uniform_random_0_1();
-    double d = gaussian_random_0_1();
-
-    yp = p1 * (0.5 * (xs + current_x) + p2 * del_x);
-    yq = q1 * (0.5 * (xs + current_x) - q2 * del_x);
-    gsr = (d * rho2 * 2.0 * (del_x % current_x)) / (yp - yq + eps);
-    
+    yp = r.p1 * (0.5 * (xs + current_x) + r.p2 * del_x);
+    yq = r.q1 * (0.5 * (xs + current_x) - r.q2 * del_x);
+    gsr = (r.d * rho2 * 2.0 * (del_x % current_x)) / (yp - yq + r.eps);
+}
 
-    return gsr;
+static void draw_gsr(RandomStream& random, int N, GsrDraws& r) {
+    r.a = random.uniform();
+    r.b = static_cast<double>(random.index(N));
+    r.c = random.uniform();
+    r.eps = 0.01 * random.uniform();
+    r.p1 = random.uniform();
+    r.p2 = random.uniform();
+    r.q1 = random.uniform();
+    r.q2 = random.uniform();
+    r.d = random.gaussian();
 }
 
-cv::Mat GBO::main_loop(cv::Mat& block, int vector_size, unsigned char bit, int scheme, bool verbose) {
-    Population population(vector_size, block, bit, scheme);
-    if (verbose) {
-        std::cout << "Initial population (size=" << population.individuals.size() << ")" << std::endl;
-        for (size_t idx = 0; idx < population.individuals.size(); ++idx) {
-            std::cout << "Ind " << idx << " fitness=" << population.fitness_values[idx] << " : ";
-            for (size_t j = 0; j < population.individuals[idx].n_elem; ++j) {
-                std::cout << population.individuals[idx](j);
-                if (j + 1 < population.individuals[idx].n_elem) std::cout << " ";
-            }
-            std::cout << std::endl;
-        }
+void GBO::drawStep(RandomStream& random, double alpha, int population_size, int best, int current,
+                   double th, int n, double* x_rand, size_t stride, GboStepDraws& draws) {
+    draws.rho1 = alpha * (2.0 * random.uniform() - 1.0);
+    draws.rho2 = alpha * (2.0 * random.uniform() - 1.0);
+    draws.dm1 = random.uniform();
+    random.indices(population_size, best, current, draws.r);
+    draw_gsr(random, population_size, draws.gsr1);
+    draws.dm2 = random.uniform();
+    draws.dm3 = random.uniform();
+    draw_gsr(random, population_size, draws.gsr2);
+    draws.dm4 = random.uniform();
+    draws.rho1_next = alpha * (2.0 * random.uniform() - 1.0);
+    draws.ra = random.uniform();
+    draws.rb = random.uniform();
+
+    //LEO
+    draws.leo = random.uniform() < PR;
+    draws.u1 = draws.u2 = draws.u3 = draws.l2 = draws.f1 = draws.f2 = 0.0;
+    draws.y_next = true;
+    draws.partner = 0;
+    if (draws.leo) {
+        double L1 = (random.uniform() < 0.5) ? 0.0 : 1.0;
+        draws.u1 = L1 * 2.0 * random.uniform() + (1.0 - L1);
+        draws.u2 = L1 * random.uniform() + (1.0 - L1);
+        draws.u3 = L1 * random.uniform() + (1.0 - L1);
+        random.uniform();   // nu2 of the reference GBO, unused
+        draws.partner = random.index(population_size);
+        for (int idx = 0; idx < n; ++idx) x_rand[idx * stride] = 2.0 * th * random.uniform() - th;
+        draws.l2 = (random.uniform() < 0.5) ? 0.0 : 1.0;
+        draws.y_next = random.uniform() < 0.5;
+        draws.f1 = 2.0 * random.uniform() - 1.0;
+        draws.f2 = 2.0 * random.uniform() - 1.0;
     }
+}
+
+/**
+ * @brief Runs the GBO iterations on an initialised population.
+ * @param population Population to evolve; its best individual is the result.
+ * @param after_iteration Optional callback invoked with the iteration index after each iteration.
+ * The run ends early, keeping the best individual so far, once `stop` returns true.
+ */
+void GBO::evolve(Population& population, const std::function<void(int)>& after_iteration) {
+    const int vector_size = population.vector_size;
+    const int population_size = static_cast<int>(population.individuals.size());
+    RandomStream& random = threadRandom();
+    GboStepDraws draws;
     for (int m = 0; m < GBO::iterations; ++m) {
         double betta = GBO::betta_min + (GBO::betta_max - GBO::betta_min) * std::pow(1.0 - std::pow(static_cast<double>(m + 1) / static_cast<double>(GBO::iterations), 3.0), 2.0);
         double alpha = std::fabs(betta * std::sin(GBO::angle + std::sin(GBO::angle * betta)));
 
-        for (int current_vector = 0; current_vector < population.individuals.size(); ++current_vector) {
-            double rho1 = alpha * (2.0 * uniform_random_0_1() - 1.0);
-            double rho2 = alpha * (2.0 * uniform_random_0_1() - 1.0);
-            double dm_rand = uniform_random_0_1();
-            std::vector<int> random_indices = generate_random_indices(population.individuals.size(), population.indexOfBestIndividual, current_vector);
+        for (int current_vector = 0; current_vector < population_size; ++current_vector) {
+            if (stop && stop()) {
+                return;
+            }
 
-            arma::vec x1(vector_size), x2(vector_size), x3(vector_size), xm(vector_size), dm(vector_size), gsr(vector_size), x_next(vector_size);
+            // One candidate's vectors, given back to the arena when it has been scored
+            ArenaScope candidate_scope;
+            BlockArena& arena = BlockArena::local();
+            arma::vec x1 = arena.vec(vector_size), x2 = arena.vec(vector_size), x3 = arena.vec(vector_size), xm = arena.vec(vector_size), dm = arena.vec(vector_size), gsr = arena.vec(vector_size), x_next = arena.vec(vector_size), x_rand = arena.vec(vector_size);
+            drawStep(random, alpha, population_size, population.indexOfBestIndividual, current_vector, th, vector_size, x_rand.memptr(), 1, draws);
+            const int* random_indices = draws.r;
+            const arma::vec& best_x = population.individuals[population.indexOfBestIndividual];
+            double rho1 = draws.rho1;
 
             xm = 0.25 * (population.individuals[random_indices[0]] + population.individuals[random_indices[1]] + population.individuals[random_indices[2]] + population.individuals[random_indices[3]]);
-            dm = dm_rand * rho1 * (population.individuals[population.indexOfBestIndividual] - population.individuals[random_indices[0]]);
-            gsr = calculate_gsr(rho2, population.individuals[population.indexOfBestIndividual], population.worstIndividual, population.individuals[current_vector], population.individuals[random_indices[0]], dm, xm, 1, population.individuals.size());
+            dm = draws.dm1 * rho1 * (best_x - population.individuals[random_indices[0]]);
+            calculate_gsr(gsr, draws.rho2, best_x, population.worstIndividual, population.individuals[current_vector], population.individuals[random_indices[0]], dm, xm, 1, draws.gsr1);
 
-            dm_rand = uniform_random_0_1();
-            dm = dm_rand * rho1 * (population.individuals[population.indexOfBestIndividual] - population.individuals[random_indices[0]]);
+            dm = draws.dm2 * rho1 * (best_x - population.individuals[random_indices[0]]);
             x1 = population.individuals[current_vector] + dm - gsr;
 
-            dm_rand = uniform_random_0_1();
-            dm = dm_rand * rho1 * (population.individuals[random_indices[0]] - population.individuals[random_indices[1]]);
-            gsr = calculate_gsr(rho2, population.individuals[population.indexOfBestIndividual], population.worstIndividual, population.individuals[current_vector], population.individuals[random_indices[0]], dm, xm, 2, population.individuals.size());
+            dm = draws.dm3 * rho1 * (population.individuals[random_indices[0]] - population.individuals[random_indices[1]]);
+            calculate_gsr(gsr, draws.rho2, best_x, population.worstIndividual, population.individuals[current_vector], population.individuals[random_indices[0]], dm, xm, 2, draws.gsr2);
 
-            dm_rand = uniform_random_0_1();
-            dm = dm_rand * rho1 * (population.individuals[random_indices[0]] - population.individuals[random_indices[1]]);
-            x2 = population.individuals[population.indexOfBestIndividual] + dm - gsr;
+            dm = draws.dm4 * rho1 * (population.individuals[random_indices[0]] - population.individuals[random_indices[1]]);
+            x2 = best_x + dm - gsr;
 
-            rho1 = alpha * (2.0 * uniform_random_0_1() - 1.0);
-            double ra = uniform_random_0_1();
-            double rb = uniform_random_0_1();
+            rho1 = draws.rho1_next;
+            double ra = draws.ra;
+            double rb = draws.rb;
 
             x3 = population.individuals[current_vector] - rho1 * (x2 - x1);
             x_next = ra * (rb * x1 + (1 - rb) * x2) + (1 - ra) * x3;
@@ -84,34 +123,57 @@ cv::Mat GBO::main_loop(cv::Mat& block, int vector_size, unsigned char bit, int s
 
             //LEO
 
-            if (uniform_random_0_1() < PR) {
-                double L1 = (uniform_random_0_1() < 0.5) ? 0.0 : 1.0;
-                double u1 = L1 * 2.0 * uniform_random_0_1() + (1.0 - L1);
-                double u2 = L1 * uniform_random_0_1() + (1.0 - L1);
-                double u3 = L1 * uniform_random_0_1() + (1.0 - L1);
-                double nu2 = uniform_random_0_1();
-
-                arma::vec x_mk(vector_size), x_p(vector_size), x_rand(vector_size), Y(vector_size);
-                x_p = population.individuals[random_index(population.individuals.size())];
-                x_rand.randu(vector_size);
-                x_rand = 2.0 * th * x_rand - th;
-
-                double L2 = (uniform_random_0_1() < 0.5) ? 0.0 : 1.0;
+            if (draws.leo) {
+                arma::vec x_mk = arena.vec(vector_size), Y = arena.vec(vector_size);
+                const arma::vec& x_p = population.individuals[draws.partner];
 
-                x_mk = L2 * x_p + (1.0 - L2) * x_rand;
-                Y = uniform_random_0_1() < 0.5 ? x_next : population.individuals[population.indexOfBestIndividual];
+                x_mk = draws.l2 * x_p + (1.0 - draws.l2) * x_rand;
+                Y = draws.y_next ? x_next : best_x;
 
-                double f1 = 2.0 * uniform_random_0_1() - 1.0;
-                double f2 = 2.0 * uniform_random_0_1() - 1.0;
-
-                x_next = Y + f1 * (u1 * population.individuals[population.indexOfBestIndividual] - u2 * x_mk) + f2 * rho1 * (u3 * (x2 -x1) + u2 * (population.individuals[random_indices[0]] - population.individuals[random_indices[1]])) * 0.5;
+                x_next = Y + draws.f1 * (draws.u1 * best_x - draws.u2 * x_mk) + draws.f2 * rho1 * (draws.u3 * (x2 -x1) + draws.u2 * (population.individuals[random_indices[0]] - population.individuals[random_indices[1]])) * 0.5;
                 x_next.clamp(-1.0 * th, th);
             }
 
             population.update(x_next, current_vector);
             
         }
-        if (verbose) {
+        if (after_iteration) {
+            after_iteration(m);
+        }
+    }
+}
+
+/**
+ * @brief Minimises an arbitrary objective with GBO.
+ * @param vector_size Dimension of the search space.
+ * @param fitness Objective to minimise.
+ * @return arma::vec The best vector found.
+ */
+arma::vec GBO::optimize(int vector_size, const Population::FitnessFunction& fitness) {
+    ArenaScope run_scope;
+    Population population(vector_size, fitness, seeds);
+    evolve(population);
+    best = population.individuals[population.indexOfBestIndividual];
+    return best;
+}
+
+cv::Mat GBO::main_loop(cv::Mat& block, int vector_size, unsigned char bit, int scheme, bool verbose) {
+    ArenaScope run_scope;
+    Population population(vector_size, block, bit, scheme, seeds);
+    if (verbose) {
+        std::cout << "Initial population (size=" << population.individuals.size() << ")" << std::endl;
+        for (size_t idx = 0; idx < population.individuals.size(); ++idx) {
+            std::cout << "Ind " << idx << " fitness=" << population.fitness_values[idx] << " : ";
+            for (size_t j = 0; j < population.individuals[idx].n_elem; ++j) {
+                std::cout << population.individuals[idx](j);
+                if (j + 1 < population.individuals[idx].n_elem) std::cout << " ";
+            }
+            std::cout << std::endl;
+        }
+    }
+    std::function<void(int)> print_iteration;
+    if (verbose) {
+        print_iteration = [&](int m) {
             cv::Mat best_block = applyVectorToBlock(population.individuals[population.indexOfBestIndividual], block, scheme);
             double psnr_iter = compute_psnr(block, best_block);
             cv::Mat floatMat;
@@ -124,9 +186,11 @@ cv::Mat GBO::main_loop(cv::Mat& block, int vector_size, unsigned char bit, int s
                       << " fitness=" << population.fitness_values[population.indexOfBestIndividual]
                       << " s1=" << s1_iter << " s0=" << s0_iter
                       << " psnr=" << psnr_iter << std::endl;
-        }
+        };
     }
-    cv::Mat result_block = applyVectorToBlock(population.individuals[population.indexOfBestIndividual], block, scheme);
+    evolve(population, print_iteration);
+    best = population.individuals[population.indexOfBestIndividual];
+    cv::Mat result_block = applyVectorToBlock(best, block, scheme);
 
     if (verbose) {
         int changed_px = cv::countNonZero(block != result_block);
@@ -0,0 +1,779 @@
+#include "../include/gbo_api.h"
+#include "../include/analytic_embed.h"
+#include "../include/block_arena.h"
+#include "../include/local_refinement.h"
+#include "../include/lockstep_gbo.h"
+#include "../include/optimizer.h"
+#include "../include/parallel.h"
+#include "../include/population.h"
+#include "../include/process_block.h"
+#include "../include/random_utils.h"
+#include "../include/robust_fitness.h"
+#include "../include/scheme_classifier.h"
+#include "../include/watermark_bits.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <random>
+#include <thread>
+
+namespace gbo {
+
+namespace {
+
+void validateConfig(const Config& config, const std::string& prefix) {
+    if (config.scheme < 0 || config.scheme >= static_cast<int>(embeding_region.size())) {
+        throw std::invalid_argument(prefix + "invalid scheme index");
+    }
+    if (config.iterations <= 0) {
+        throw std::invalid_argument(prefix + "iterations must be positive");
+    }
+    if (config.threads < 0) {
+        throw std::invalid_argument(prefix + "threads must be non-negative");
+    }
+    if (config.refine_steps < 0) {
+        throw std::invalid_argument(prefix + "refine_steps must be non-negative");
+    }
+    if (!(config.time_budget_ms >= 0.0) || !(config.block_time_budget_ms >= 0.0)) {
+        throw std::invalid_argument(prefix + "time budgets must be non-negative");
+    }
+    if (config.surrogate && !(config.surrogate_tolerance >= 0.0)) {
+        throw std::invalid_argument(prefix + "surrogate_tolerance must be non-negative");
+    }
+    if (config.method == Method::Analytic && !(config.margin > 0.0)) {
+        throw std::invalid_argument(prefix + "margin must be positive");
+    }
+    if (config.lockstep && config.method == Method::Gbo) {
+        if (config.optimizer != "gbo") {
+            throw std::invalid_argument(prefix + "lockstep search needs the gbo optimizer");
+        }
+        if (config.warm_start == WarmStart::Raster || config.warm_start == WarmStart::Wavefront) {
+            throw std::invalid_argument(prefix + "lockstep search does not take neighbour warm starts");
+        }
+    }
+    validateBlockAttacks(config.robustness_attacks, prefix);
+    if (!(config.robustness_weight >= 0.0)) {
+        throw std::invalid_argument(prefix + "robustness_weight must be non-negative");
+    }
+    const std::vector<std::string>& optimizers = optimizerNames();
+    if (std::find(optimizers.begin(), optimizers.end(), config.optimizer) == optimizers.end()) {
+        throw std::invalid_argument(prefix + "unknown optimizer '" + config.optimizer + "'");
+    }
+    if (config.optimizer == "gbo" && config.evaluations != 0 &&
+        config.evaluations < static_cast<size_t>(Population().get_population_size())) {
+        throw std::invalid_argument(prefix + "evaluations must cover GBO's initial population");
+    }
+}
+
+// GBO iterations the budget pays for, as GboOptimizer counts them
+int gboIterations(const Config& config) {
+    const size_t population_size = static_cast<size_t>(Population().get_population_size());
+    return static_cast<int>((blockBudget(config) - population_size) / population_size);
+}
+
+// Config::lockstep: the blocks of every scheme in raster order, cut into groups of lockstep_lanes
+std::vector<std::vector<size_t>> lockstepGroups(const std::vector<int>& schemes) {
+    std::vector<std::vector<size_t>> groups;
+    for (int scheme = 0; scheme < static_cast<int>(embeding_region.size()); ++scheme) {
+        std::vector<size_t> group;
+        for (size_t i = 0; i < schemes.size(); ++i) {
+            if (schemes[i] != scheme) continue;
+            group.push_back(i);
+            if (group.size() == static_cast<size_t>(lockstep_lanes)) {
+                groups.push_back(std::move(group));
+                group.clear();
+            }
+        }
+        if (!group.empty()) groups.push_back(std::move(group));
+    }
+    return groups;
+}
+
+// Whether searchVector reads the block magnitudes
+bool needsMagnitudes(const Config& config) {
+    return config.refine_steps > 0 || config.surrogate;
+}
+
+// Searches the vector of one block with the configured backend, in GBO's box [-th, th], screening
+// candidates with the relaxed fitness when surrogate is set, then polishes the result on it when
+// refine_steps is set; magnitudes (blockMagnitudes or coefficientMagnitudes) are only read in
+// those cases. An interrupted search (`stop`) is not polished.
+OptimizerResult searchVector(const Config& config, int scheme, unsigned char bit, std::vector<arma::vec> seeds,
+                             const FitnessOracle& fitness, const double* magnitudes, double rounding_mse,
+                             std::function<bool()> stop) {
+    const double th = Population().get_th();
+    OptimizerProblem problem;
+    problem.dimension = static_cast<int>(embeding_region[scheme].size());
+    problem.lower = -th;
+    problem.upper = th;
+    problem.max_evaluations = blockBudget(config);
+    problem.fitness = fitness;
+    problem.seeds = std::move(seeds);
+    problem.stop = std::move(stop);
+    if (config.surrogate) {
+        problem.surrogate = [=](const arma::vec& vec) {
+            return relaxedFitness(magnitudes, bit, scheme, rounding_mse, vec);
+        };
+        problem.surrogate_tolerance = config.surrogate_tolerance;
+    }
+    OptimizerResult found = threadOptimizer(config.optimizer).minimize(problem);
+    if (config.refine_steps > 0 && !found.interrupted) {
+        found = refineVector(magnitudes, bit, scheme, rounding_mse, found, th, config.refine_steps, fitness);
+    }
+    return found;
+}
+
+bool cancelled(const Config& config) {
+    return config.cancellation && config.cancellation->cancelled();
+}
+
+// Time limits, cancellation and progress reporting of one embed() call
+class EmbedBudget {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    EmbedBudget(const Config& config, size_t blocks)
+        : config_(config), blocks_(blocks), start_(Clock::now()),
+          deadline_(config.time_budget_ms > 0.0 ? start_ + toDuration(config.time_budget_ms) : Clock::time_point::max()) {}
+
+    // The image deadline has passed or the caller cancelled: blocks not started yet skip the search
+    bool expired() const {
+        return cancelled(config_) || Clock::now() >= deadline_;
+    }
+
+    // Stop predicate for the search of a block starting now; empty when nothing limits it
+    std::function<bool()> blockStop() const {
+        if (config_.time_budget_ms <= 0.0 && config_.block_time_budget_ms <= 0.0 && !config_.cancellation) {
+            return nullptr;
+        }
+        Clock::time_point deadline = deadline_;
+        if (config_.block_time_budget_ms > 0.0) {
+            deadline = std::min(deadline, Clock::now() + toDuration(config_.block_time_budget_ms));
+        }
+        return [this, deadline] {
+            return cancelled(config_) || Clock::now() >= deadline;
+        };
+    }
+
+    // Records an embedded block, replacing what an earlier embedding of it recorded.
+    // Re-embeddings (counted = false) do not advance the progress.
+    void finish(size_t block, bool counted, const BudgetOverrun* overrun) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (overrun != nullptr) {
+            overruns_[block] = *overrun;
+        } else {
+            overruns_.erase(block);
+        }
+        if (counted) done_++;
+        if (config_.progress) {
+            EmbedProgress progress;
+            progress.blocks_done = done_;
+            progress.blocks = blocks_;
+            progress.out_of_budget = overruns_.size();
+            progress.elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+            config_.progress(progress);
+        }
+    }
+
+    void report(EmbedStats& stats) const {
+        stats.cancelled = cancelled(config_);
+        for (const auto& entry : overruns_) stats.out_of_budget.push_back(entry.second);
+    }
+
+private:
+    static Clock::duration toDuration(double ms) {
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(ms));
+    }
+
+    const Config& config_;
+    const size_t blocks_;
+    const Clock::time_point start_;
+    const Clock::time_point deadline_;
+    std::mutex mutex_;
+    size_t done_ = 0;
+    std::map<size_t, BudgetOverrun> overruns_;
+};
+
+void validateBits(const void* bits, size_t bit_count, size_t blocks, const std::string& prefix) {
+    if (bits == nullptr) {
+        throw std::invalid_argument(prefix + "null buffer");
+    }
+    if (bit_count == 0 || bit_count > blocks) {
+        throw std::invalid_argument(prefix + "bit_count must be in [1, number of 8x8 blocks]");
+    }
+}
+
+void validate(const ConstImageView& image, const void* bits, size_t bit_count, const Config& config, const char* fn) {
+    const std::string prefix = std::string(fn) + ": ";
+    if (image.data == nullptr) {
+        throw std::invalid_argument(prefix + "null buffer");
+    }
+    if (image.width <= 0 || image.height <= 0 || image.width % 8 != 0 || image.height % 8 != 0) {
+        throw std::invalid_argument(prefix + "image size must be a positive multiple of 8");
+    }
+    if (image.stride < static_cast<size_t>(image.width)) {
+        throw std::invalid_argument(prefix + "stride is smaller than the image width");
+    }
+    const size_t blocks = static_cast<size_t>(image.width / 8) * static_cast<size_t>(image.height / 8);
+    validateBits(bits, bit_count, blocks, prefix);
+    validateConfig(config, prefix);
+}
+
+void requireLuminance(const JpegCoefficientImage& image, const Config& config, const char* fn) {
+    if (image.components.empty()) {
+        throw std::invalid_argument(std::string(fn) + ": JPEG has no components");
+    }
+    if (config.classifier) {
+        throw std::invalid_argument(std::string(fn) + ": per-block scheme selection works on pixel blocks only");
+    }
+}
+
+cv::Mat wrap(const ConstImageView& image) {
+    // Header only: the pixels stay in the caller's buffer
+    return cv::Mat(image.height, image.width, CV_8UC1, const_cast<unsigned char*>(image.data), image.stride);
+}
+
+cv::Rect blockRect(size_t index, int blocks_per_row) {
+    const int row = static_cast<int>(index / blocks_per_row);
+    const int col = static_cast<int>(index % blocks_per_row);
+    return cv::Rect(col * 8, row * 8, 8, 8);
+}
+
+// Top-left pixel of every block, in block order, as the classifier expects them
+std::vector<const unsigned char*> blockPointers(const ConstImageView& image) {
+    std::vector<const unsigned char*> blocks;
+    blocks.reserve(static_cast<size_t>(image.width / 8) * (image.height / 8));
+    for (int y = 0; y < image.height; y += 8) {
+        for (int x = 0; x < image.width; x += 8) {
+            blocks.push_back(image.data + y * image.stride + x);
+        }
+    }
+    return blocks;
+}
+
+// Scheme of every block: the configured one, or the classifier's prediction
+std::vector<int> blockSchemes(const ConstImageView& image, const Config& config) {
+    if (!config.classifier) {
+        return std::vector<int>(static_cast<size_t>(image.width / 8) * (image.height / 8), config.scheme);
+    }
+    return config.classifier->classify(blockPointers(image), image.stride, resolveThreads(config.threads));
+}
+
+// Visits every block so that the neighbours a warm start reads from are finished first
+void forEachBlock(int rows, int cols, WarmStart warm_start, int threads, const std::function<void(size_t)>& fn) {
+    if (warm_start == WarmStart::Raster) {
+        parallelFor(rows, threads, [&](size_t row) {
+            for (int col = 0; col < cols; ++col) fn(row * cols + col);
+        });
+    } else if (warm_start == WarmStart::Wavefront) {
+        for (int diagonal = 0; diagonal < rows + cols - 1; ++diagonal) {
+            const int first_row = std::max(0, diagonal - cols + 1);
+            const int last_row = std::min(rows - 1, diagonal);
+            parallelFor(last_row - first_row + 1, threads, [&](size_t k) {
+                const int row = first_row + static_cast<int>(k);
+                fn(static_cast<size_t>(row) * cols + (diagonal - row));
+            });
+        }
+    } else {
+        parallelFor(static_cast<size_t>(rows) * cols, threads, fn);
+    }
+}
+
+// Best vectors of already embedded neighbours; a neighbour that carries the opposite bit
+// pushes the regions the other way, so its vector is mirrored
+void addNeighbourSeeds(std::vector<arma::vec>& seeds, size_t index, int cols, const Config& config,
+                       const std::vector<arma::vec>& best_vectors, const std::vector<int>& schemes,
+                       const WatermarkBits& bits) {
+    if (config.warm_start != WarmStart::Raster && config.warm_start != WarmStart::Wavefront) {
+        return;
+    }
+    const size_t bit_count = bits.size();
+    const bool bit = bits.get(index % bit_count);
+    auto add = [&](size_t neighbour) {
+        if (schemes[neighbour] == schemes[index] && !best_vectors[neighbour].is_empty()) {
+            const bool same = bits.get(neighbour % bit_count) == bit;
+            seeds.push_back(same ? best_vectors[neighbour] : arma::vec(-best_vectors[neighbour]));
+        }
+    };
+    if (index % cols != 0) add(index - 1);
+    if (config.warm_start == WarmStart::Wavefront && index >= static_cast<size_t>(cols)) add(index - cols);
+}
+
+// Majority vote over the copies of every bit; block i carries bit i % bit_count
+WatermarkBits voteBits(const WatermarkBits& block_bits, size_t bit_count, const Config& config) {
+    BitVoter voter(bit_count);
+    for (const WatermarkBits& copy : watermarkCopies(block_bits, bit_count)) voter.add(copy);
+    WatermarkBits ties;
+    WatermarkBits bits = voter.majority(&ties);
+
+    // Ties are broken in bit order, one draw each
+    std::mt19937_64 tie_breaker(mixSeed(config.seed, block_bits.size()));
+    for (size_t w = 0; w < ties.words().size(); ++w) {
+        for (size_t j = w * 64; ties.words()[w] != 0 && j < std::min(bit_count, w * 64 + 64); ++j) {
+            if (!ties.get(j)) continue;
+            if (config.seed != 0) {
+                bits.set(j, (tie_breaker() & 1u) != 0);
+            } else {
+                bits.set(j, uniform_random_0_1() >= 0.5);
+            }
+        }
+    }
+    return bits;
+}
+
+// Extraction has nothing to fall back on: a cancelled call throws instead of returning partial bits
+void throwIfCancelled(const Config& config, const char* fn) {
+    if (cancelled(config)) {
+        throw std::runtime_error(std::string(fn) + ": cancelled");
+    }
+}
+
+// The bit read from every block, 64 blocks per task so that no two tasks share a word.
+// Tasks starting after a cancellation skip their blocks, then the call throws.
+WatermarkBits readBlockBits(size_t block_count, const Config& config, const char* fn,
+                            const std::function<bool(size_t)>& read) {
+    WatermarkBits block_bits(block_count);
+    parallelFor(block_bits.words().size(), resolveThreads(config.threads), [&](size_t w) {
+        if (cancelled(config)) return;
+        uint64_t word = 0;
+        for (size_t i = w * 64; i < std::min(block_count, w * 64 + 64); ++i) {
+            if (read(i)) word |= uint64_t(1) << (i % 64);
+        }
+        block_bits.setWord(w, word);
+    });
+    throwIfCancelled(config, fn);
+    return block_bits;
+}
+
+// Chooses the scheme from the per-block region sums of both schemes and writes the bits
+// read with it. For each scheme the block margins are grouped by the bit they carry: the
+// share of their variance between groups (R^2) is near 1 for the embedding scheme and near
+// its chance level (groups - 1) / (blocks - 1) otherwise.
+BlindExtraction detectScheme(const std::vector<SchemeRegionSums>& sums, WatermarkBits& bits, size_t bit_count,
+                             const Config& config) {
+    const size_t blocks = sums.size();
+    const double chance = blocks > 1 ? static_cast<double>(bit_count - 1) / (blocks - 1) : 1.0;
+    BlindExtraction result;
+    WatermarkBits voted[2];
+
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        std::vector<double> margins(blocks);
+        WatermarkBits block_bits(blocks);
+        std::vector<double> group_sum(bit_count, 0.0);
+        std::vector<size_t> group_size(bit_count, 0);
+        double total = 0.0;
+        for (size_t i = 0; i < blocks; ++i) {
+            const double s1 = sums[i].s1[scheme], s0 = sums[i].s0[scheme];
+            margins[i] = (s1 - s0) / (s1 + s0);
+            block_bits.set(i, s1 >= s0);
+            group_sum[i % bit_count] += margins[i];
+            group_size[i % bit_count]++;
+            total += margins[i];
+            result.margin[scheme] += std::fabs(margins[i]);
+        }
+        const double mean = total / blocks;
+        double ss_total = 0.0, ss_between = 0.0;
+        for (size_t i = 0; i < blocks; ++i) ss_total += (margins[i] - mean) * (margins[i] - mean);
+        for (size_t j = 0; j < bit_count; ++j) {
+            const double d = group_sum[j] / group_size[j] - mean;
+            ss_between += group_size[j] * d * d;
+        }
+        const double r2 = ss_total > 0.0 ? ss_between / ss_total : 0.0;
+        result.consistency[scheme] = chance < 1.0 ? std::max(0.0, (r2 - chance) / (1.0 - chance)) : 0.0;
+        result.margin[scheme] /= blocks;
+
+        voted[scheme] = voteBits(block_bits, bit_count, config);
+        size_t disagreeing = 0;
+        for (const WatermarkBits& copy : watermarkCopies(block_bits, bit_count)) {
+            disagreeing += copy.differences(voted[scheme].slice(0, copy.size()));
+        }
+        result.agreement[scheme] = static_cast<double>(blocks - disagreeing) / blocks;
+    }
+
+    // Without repeated bits nothing separates the schemes but the margin size
+    const bool by_consistency = result.consistency[0] != result.consistency[1];
+    result.scheme = by_consistency ? (result.consistency[1] > result.consistency[0] ? 1 : 0)
+                                   : (result.margin[1] > result.margin[0] ? 1 : 0);
+    const double best = result.consistency[result.scheme];
+    result.confidence = best > 0.0 ? (best - result.consistency[1 - result.scheme]) / best : 0.0;
+    bits = std::move(voted[result.scheme]);
+    return result;
+}
+
+void requireSchemeFree(const Config& config, const char* fn) {
+    if (config.classifier) {
+        throw std::invalid_argument(std::string(fn) + ": blind extraction does not use a classifier");
+    }
+}
+
+} // namespace
+
+size_t blockBudget(const Config& config) {
+    if (config.evaluations != 0) {
+        return config.evaluations;
+    }
+    const size_t population_size = static_cast<size_t>(Population().get_population_size());
+    return population_size * (static_cast<size_t>(config.iterations) + 1);
+}
+
+EmbedStats embed(const ImageView& image, const WatermarkBits& bits, const Config& config) {
+    const size_t bit_count = bits.size();
+    validate(image, &bits, bit_count, config, "gbo::embed");
+
+    cv::Mat pixels = wrap(image);
+    const int blocks_per_row = image.width / 8;
+    const size_t block_count = static_cast<size_t>(blocks_per_row) * (image.height / 8);
+    const int threads = resolveThreads(config.threads);
+
+    std::vector<int> schemes = blockSchemes(image, config);
+    std::vector<arma::vec> best_vectors(block_count);
+    std::atomic<size_t> evaluations{0}, screened{0};
+    EmbedBudget budget(config, block_count);
+
+    // One robustness term per scheme, shared read-only by all workers
+    std::vector<std::unique_ptr<BlockRobustness>> robustness(embeding_region.size());
+    if (config.method == Method::Gbo && !config.robustness_attacks.empty()) {
+        for (size_t scheme = 0; scheme < robustness.size(); ++scheme) {
+            robustness[scheme] = std::make_unique<BlockRobustness>(config.robustness_attacks, config.robustness_weight,
+                                                                   static_cast<int>(scheme));
+        }
+    }
+
+    // Writes the vector found for block i and records the search
+    auto finishSearch = [&](size_t i, int scheme, size_t salt, const OptimizerResult& found) {
+        cv::Mat block = pixels(blockRect(i, blocks_per_row));
+        const unsigned char bit = bits.get(i % bit_count) ? 1 : 0;
+        evaluations += found.evaluations;
+        screened += found.screened;
+        best_vectors[i] = found.best;
+        applyVectorToBlock(best_vectors[i], block, scheme).copyTo(block);
+        BudgetOverrun overrun;
+        if (found.interrupted) {
+            double magnitudes[64];
+            blockMagnitudes(block, magnitudes);
+            overrun.block = i;
+            overrun.searched = true;
+            overrun.margin = decodeMargin(magnitudes, bit, scheme);
+        }
+        budget.finish(i, salt == 0, found.interrupted ? &overrun : nullptr);
+    };
+
+    // A re-embedding (salt != 0) uses its own random stream and no neighbour seeds:
+    // the neighbours may be re-embedded concurrently
+    auto embedBlock = [&](size_t i, int scheme, size_t salt) {
+        ArenaScope block_scope;     // the search's scratch memory, released all at once
+        if (config.seed != 0) {
+            // Seeding per block keeps the result independent of the thread count
+            seed_thread_random(mixSeed(config.seed, i + salt));
+        }
+        cv::Mat block = pixels(blockRect(i, blocks_per_row));
+        unsigned char bit = bits.get(i % bit_count) ? 1 : 0;
+        if (config.method == Method::Analytic) {
+            analyticEmbedBlock(block, bit, scheme, config.margin).copyTo(block);
+            budget.finish(i, salt == 0, nullptr);
+            return;
+        }
+        if (budget.expired()) {
+            analyticEmbedBlock(block, bit, scheme, config.margin).copyTo(block);
+            double magnitudes[64];
+            blockMagnitudes(block, magnitudes);
+            BudgetOverrun overrun;
+            overrun.block = i;
+            overrun.margin = decodeMargin(magnitudes, bit, scheme);
+            budget.finish(i, salt == 0, &overrun);
+            return;
+        }
+        std::vector<arma::vec> seeds;
+        if (config.warm_start != WarmStart::None) {
+            seeds.push_back(analyticGuess(block, bit, scheme));
+            if (salt == 0) addNeighbourSeeds(seeds, i, blocks_per_row, config, best_vectors, schemes, bits);
+        }
+        double magnitudes[64];
+        if (needsMagnitudes(config)) blockMagnitudes(block, magnitudes);
+        const BlockRobustness* attacks = robustness[scheme].get();
+        finishSearch(i, scheme, salt,
+                     searchVector(config, scheme, bit, std::move(seeds),
+                                  [&](const arma::vec& vec) { return calcFitnessValue(block, vec, bit, scheme, attacks); },
+                                  magnitudes, pixel_rounding_mse, budget.blockStop()));
+    };
+
+    // Config::lockstep: one LockstepGbo run per group of blocks; a group that starts after the
+    // image deadline goes through embedBlock and its analytic fallback. Block i draws from
+    // mixSeed(seed, i) in whichever group and lane it lands.
+    const uint64_t lane_seed = config.seed != 0 ? config.seed : (static_cast<uint64_t>(std::random_device{}()) << 32) ^ std::random_device{}();
+    auto embedGroup = [&](const std::vector<size_t>& group) {
+        const int scheme = schemes[group.front()];
+        if (budget.expired()) {
+            for (size_t i : group) embedBlock(i, scheme, 0);
+            return;
+        }
+        std::vector<LockstepLane> lanes(group.size());
+        for (size_t k = 0; k < group.size(); ++k) {
+            const size_t i = group[k];
+            lanes[k].block = pixels(blockRect(i, blocks_per_row));
+            lanes[k].bit = bits.get(i % bit_count) ? 1 : 0;
+            lanes[k].seed = mixSeed(lane_seed, i);
+            if (config.warm_start == WarmStart::Analytic) lanes[k].seeds.push_back(analyticGuess(lanes[k].block, lanes[k].bit, scheme));
+        }
+        LockstepGbo engine(gboIterations(config));
+        engine.stop = budget.blockStop();
+        engine.robustness = robustness[scheme].get();
+        const std::vector<OptimizerResult> found = engine.run(lanes, scheme);
+        for (size_t k = 0; k < group.size(); ++k) {
+            OptimizerResult result = found[k];
+            if (config.refine_steps > 0 && !result.interrupted) {
+                const cv::Mat& block = lanes[k].block;
+                const unsigned char bit = lanes[k].bit;
+                double magnitudes[64];
+                blockMagnitudes(block, magnitudes);
+                result = refineVector(magnitudes, bit, scheme, pixel_rounding_mse, result, Population().get_th(),
+                                      config.refine_steps,
+                                      [&](const arma::vec& vec) {
+                                          return calcFitnessValue(block, vec, bit, scheme, engine.robustness);
+                                      });
+            }
+            finishSearch(group[k], scheme, 0, result);
+        }
+    };
+
+    cv::Mat original = config.classifier ? pixels.clone() : cv::Mat();
+    if (config.method == Method::Gbo && config.lockstep) {
+        const std::vector<std::vector<size_t>> groups = lockstepGroups(schemes);
+        parallelFor(groups.size(), threads, [&](size_t g) { embedGroup(groups[g]); });
+    } else {
+        const WarmStart order = config.method == Method::Gbo ? config.warm_start : WarmStart::None;
+        forEachBlock(image.height / 8, blocks_per_row, order, threads, [&](size_t i) { embedBlock(i, schemes[i], 0); });
+    }
+
+    EmbedStats stats;
+    stats.blocks = block_count;
+    if (config.classifier) {
+        // The extractor classifies the watermarked block, not the original one
+        std::vector<int> seen = blockSchemes(image, config);
+        std::vector<size_t> mismatched;
+        for (size_t i = 0; i < block_count; ++i) {
+            if (seen[i] != schemes[i]) mismatched.push_back(i);
+        }
+        parallelFor(mismatched.size(), threads, [&](size_t k) {
+            const size_t i = mismatched[k];
+            original(blockRect(i, blocks_per_row)).copyTo(pixels(blockRect(i, blocks_per_row)));
+            schemes[i] = seen[i];
+            embedBlock(i, schemes[i], block_count);
+        });
+        stats.reembedded = mismatched.size();
+
+        if (!mismatched.empty()) {
+            const std::vector<const unsigned char*> all = blockPointers(image);
+            std::vector<const unsigned char*> recheck;
+            for (size_t i : mismatched) recheck.push_back(all[i]);
+            const std::vector<int> again = config.classifier->classify(recheck, image.stride, threads);
+            for (size_t k = 0; k < mismatched.size(); ++k) {
+                if (again[k] != schemes[mismatched[k]]) stats.inconsistent++;
+            }
+        }
+    }
+    for (int scheme : schemes) stats.scheme_blocks[scheme]++;
+    stats.evaluations = evaluations;
+    stats.screened = screened;
+    budget.report(stats);
+    return stats;
+}
+
+void extract(const ConstImageView& image, WatermarkBits& bits, const Config& config) {
+    validate(image, &bits, bits.size(), config, "gbo::extract");
+
+    cv::Mat pixels = wrap(image);
+    const int blocks_per_row = image.width / 8;
+    const size_t block_count = static_cast<size_t>(blocks_per_row) * (image.height / 8);
+
+    const std::vector<int> schemes = blockSchemes(image, config);
+    const WatermarkBits block_bits = readBlockBits(block_count, config, "gbo::extract", [&](size_t i) {
+        return getBitFromBlock(pixels(blockRect(i, blocks_per_row)), schemes[i]) != 0;
+    });
+    bits = voteBits(block_bits, bits.size(), config);
+}
+
+void extract(const ConstImageView& image, unsigned char* bits, size_t bit_count, const Config& config) {
+    if (bits == nullptr) {
+        throw std::invalid_argument("gbo::extract: null buffer");
+    }
+    WatermarkBits packed(bit_count);
+    extract(image, packed, config);
+    packed.toBytes(bits);
+}
+
+BlindExtraction extractBlind(const ConstImageView& image, WatermarkBits& bits, const Config& config) {
+    validate(image, &bits, bits.size(), config, "gbo::extractBlind");
+    requireSchemeFree(config, "gbo::extractBlind");
+
+    cv::Mat pixels = wrap(image);
+    const int blocks_per_row = image.width / 8;
+    const size_t block_count = static_cast<size_t>(blocks_per_row) * (image.height / 8);
+
+    std::vector<SchemeRegionSums> sums(block_count);
+    parallelFor(block_count, resolveThreads(config.threads), [&](size_t i) {
+        if (!cancelled(config)) sums[i] = getSchemeRegionSums(pixels(blockRect(i, blocks_per_row)));
+    });
+    throwIfCancelled(config, "gbo::extractBlind");
+    return detectScheme(sums, bits, bits.size(), config);
+}
+
+BlindExtraction extractBlind(const ConstImageView& image, unsigned char* bits, size_t bit_count, const Config& config) {
+    if (bits == nullptr) {
+        throw std::invalid_argument("gbo::extractBlind: null buffer");
+    }
+    WatermarkBits packed(bit_count);
+    const BlindExtraction result = extractBlind(image, packed, config);
+    packed.toBytes(bits);
+    return result;
+}
+
+EmbedStats embed(JpegCoefficientImage& image, const WatermarkBits& bits, const Config& config) {
+    const char* fn = "gbo::embed(JPEG)";
+    const size_t bit_count = bits.size();
+    requireLuminance(image, config, fn);
+    if (config.lockstep && config.method == Method::Gbo) {
+        throw std::invalid_argument(std::string(fn) + ": lockstep search works on pixel blocks only");
+    }
+    if (!config.robustness_attacks.empty() && config.method == Method::Gbo) {
+        throw std::invalid_argument(std::string(fn) + ": robustness attacks work on pixel blocks only");
+    }
+    JpegComponent& luma = image.components[0];
+    validateBits(&bits, bit_count, luma.blockCount(), std::string(fn) + ": ");
+    validateConfig(config, std::string(fn) + ": ");
+
+    const uint16_t* quant = luma.quant.data();
+    const double rounding_mse = coefficientRoundingMse(quant, config.scheme);
+    const std::vector<int> schemes(luma.blockCount(), config.scheme);
+    std::vector<arma::vec> best_vectors(luma.blockCount());
+    std::atomic<size_t> evaluations{0}, screened{0};
+    EmbedBudget budget(config, luma.blockCount());
+    const WarmStart order = config.method == Method::Gbo ? config.warm_start : WarmStart::None;
+    forEachBlock(luma.height_in_blocks, luma.width_in_blocks, order, resolveThreads(config.threads), [&](size_t i) {
+        ArenaScope block_scope;
+        if (config.seed != 0) {
+            seed_thread_random(mixSeed(config.seed, i));
+        }
+        int16_t* coefs = &luma.coefficients[i * 64];
+        unsigned char bit = bits.get(i % bit_count) ? 1 : 0;
+        if (config.method == Method::Analytic) {
+            analyticEmbedCoefficients(coefs, quant, bit, config.scheme, config.margin);
+            budget.finish(i, true, nullptr);
+            return;
+        }
+        BudgetOverrun overrun;
+        overrun.block = i;
+        bool out_of_budget = budget.expired();
+        if (out_of_budget) {
+            analyticEmbedCoefficients(coefs, quant, bit, config.scheme, config.margin);
+        } else {
+            std::vector<arma::vec> seeds;
+            if (config.warm_start != WarmStart::None) {
+                seeds.push_back(analyticCoefficientGuess(coefs, quant, bit, config.scheme));
+                addNeighbourSeeds(seeds, i, luma.width_in_blocks, config, best_vectors, schemes, bits);
+            }
+            double magnitudes[64];
+            if (needsMagnitudes(config)) coefficientMagnitudes(coefs, quant, magnitudes);
+            const OptimizerResult found = searchVector(config, config.scheme, bit, std::move(seeds), [&](const arma::vec& vec) {
+                return calcCoefficientFitnessValue(coefs, quant, vec, bit, config.scheme);
+            }, magnitudes, rounding_mse, budget.blockStop());
+            evaluations += found.evaluations;
+            screened += found.screened;
+            best_vectors[i] = found.best;
+            applyVectorToCoefficients(best_vectors[i], coefs, quant, coefs, config.scheme);
+            out_of_budget = found.interrupted;
+            overrun.searched = true;
+        }
+        if (out_of_budget) {
+            double magnitudes[64];
+            coefficientMagnitudes(coefs, quant, magnitudes);
+            overrun.margin = decodeMargin(magnitudes, bit, config.scheme);
+        }
+        budget.finish(i, true, out_of_budget ? &overrun : nullptr);
+    });
+
+    EmbedStats stats;
+    stats.blocks = luma.blockCount();
+    stats.scheme_blocks[config.scheme] = stats.blocks;
+    stats.evaluations = evaluations;
+    stats.screened = screened;
+    budget.report(stats);
+    return stats;
+}
+
+void extract(const JpegCoefficientImage& image, WatermarkBits& bits, const Config& config) {
+    const char* fn = "gbo::extract(JPEG)";
+    requireLuminance(image, config, fn);
+    const JpegComponent& luma = image.components[0];
+    validateBits(&bits, bits.size(), luma.blockCount(), std::string(fn) + ": ");
+    validateConfig(config, std::string(fn) + ": ");
+
+    const WatermarkBits block_bits = readBlockBits(luma.blockCount(), config, fn, [&](size_t i) {
+        return getBitFromCoefficients(&luma.coefficients[i * 64], luma.quant.data(), config.scheme) != 0;
+    });
+    bits = voteBits(block_bits, bits.size(), config);
+}
+
+void extract(const JpegCoefficientImage& image, unsigned char* bits, size_t bit_count, const Config& config) {
+    if (bits == nullptr) {
+        throw std::invalid_argument("gbo::extract(JPEG): null buffer");
+    }
+    WatermarkBits packed(bit_count);
+    extract(image, packed, config);
+    packed.toBytes(bits);
+}
+
+BlindExtraction extractBlind(const JpegCoefficientImage& image, WatermarkBits& bits, const Config& config) {
+    const char* fn = "gbo::extractBlind(JPEG)";
+    requireLuminance(image, config, fn);
+    const JpegComponent& luma = image.components[0];
+    validateBits(&bits, bits.size(), luma.blockCount(), std::string(fn) + ": ");
+    validateConfig(config, std::string(fn) + ": ");
+
+    std::vector<SchemeRegionSums> sums(luma.blockCount());
+    parallelFor(sums.size(), resolveThreads(config.threads), [&](size_t i) {
+        if (!cancelled(config)) sums[i] = getSchemeRegionSumsFromCoefficients(&luma.coefficients[i * 64], luma.quant.data());
+    });
+    throwIfCancelled(config, fn);
+    return detectScheme(sums, bits, bits.size(), config);
+}
+
+BlindExtraction extractBlind(const JpegCoefficientImage& image, unsigned char* bits, size_t bit_count, const Config& config) {
+    if (bits == nullptr) {
+        throw std::invalid_argument("gbo::extractBlind(JPEG): null buffer");
+    }
+    WatermarkBits packed(bit_count);
+    const BlindExtraction result = extractBlind(image, packed, config);
+    packed.toBytes(bits);
+    return result;
+}
+
+EmbedStats embed(const ImageView& image, const unsigned char* bits, size_t bit_count, const Config& config) {
+    if (bits == nullptr) {
+        throw std::invalid_argument("gbo::embed: null buffer");
+    }
+    return embed(image, WatermarkBits::fromBytes(bits, bit_count), config);
+}
+
+EmbedStats embed(JpegCoefficientImage& image, const unsigned char* bits, size_t bit_count, const Config& config) {
+    if (bits == nullptr) {
+        throw std::invalid_argument("gbo::embed(JPEG): null buffer");
+    }
+    return embed(image, WatermarkBits::fromBytes(bits, bit_count), config);
+}
+
+std::vector<unsigned char> embedJpeg(const std::vector<unsigned char>& jpeg, const unsigned char* bits, size_t bit_count,
+                                     const Config& config) {
+    JpegCoefficientImage image = JpegCoefficientImage::fromBytes(jpeg);
+    embed(image, bits, bit_count, config);
+    return image.encode();
+}
+
+void extractJpeg(const std::vector<unsigned char>& jpeg, unsigned char* bits, size_t bit_count, const Config& config) {
+    extract(JpegCoefficientImage::fromBytes(jpeg), bits, bit_count, config);
+}
+
+} // namespace gbo
@@ -0,0 +1,193 @@
+#include "../include/jpeg_coefficients.h"
+#include <algorithm>
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <jpeglib.h>
+
+namespace {
+
+// libjpeg reports fatal errors through error_exit, which must not return;
+// we jump back to the calling function and turn the message into an exception there
+struct ErrorManager {
+    jpeg_error_mgr pub;
+    std::jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void onJpegError(j_common_ptr cinfo) {
+    ErrorManager* err = reinterpret_cast<ErrorManager*>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, err->message);
+    std::longjmp(err->jump, 1);
+}
+
+void onJpegWarning(j_common_ptr, int) {
+    // Corrupt-data warnings are not fatal for coefficient access
+}
+
+void installErrorManager(ErrorManager& err) {
+    jpeg_std_error(&err.pub);
+    err.pub.error_exit = onJpegError;
+    err.pub.emit_message = onJpegWarning;
+    err.message[0] = '\0';
+}
+
+bool isMarker(const jpeg_saved_marker_ptr marker, int code, const char* tag) {
+    const size_t len = std::strlen(tag) + 1;
+    return marker->marker == code && marker->data_length >= len && std::memcmp(marker->data, tag, len) == 0;
+}
+
+} // namespace
+
+// Keeps the decompressor alive after jpeg_read_coefficients: its coefficient
+// arrays and parameters are what jpeg_write_coefficients writes back
+struct JpegCoefficientImage::Source {
+    std::vector<unsigned char> bytes;
+    jpeg_decompress_struct cinfo{};
+    ErrorManager err{};
+    jvirt_barray_ptr* arrays = nullptr;
+    std::vector<JpegComponent> components;
+    bool created = false;
+
+    ~Source() {
+        if (created) {
+            jpeg_destroy_decompress(&cinfo);
+        }
+    }
+};
+
+JpegCoefficientImage::JpegCoefficientImage(std::unique_ptr<Source> source) : source_(std::move(source)) {}
+JpegCoefficientImage::JpegCoefficientImage(JpegCoefficientImage&&) noexcept = default;
+JpegCoefficientImage& JpegCoefficientImage::operator=(JpegCoefficientImage&&) noexcept = default;
+JpegCoefficientImage::~JpegCoefficientImage() = default;
+
+/**
+ * @brief Reads the quantized DCT coefficients of every component without decoding pixels.
+ * @param bytes Complete JPEG file contents.
+ * @return JpegCoefficientImage Coefficients and the state needed to write them back.
+ * @throws std::runtime_error if the data is not a readable JPEG.
+ */
+JpegCoefficientImage JpegCoefficientImage::fromBytes(std::vector<unsigned char> bytes) {
+    if (bytes.empty()) {
+        throw std::runtime_error("JpegCoefficientImage: empty input");
+    }
+    auto source = std::make_unique<Source>();
+    source->bytes = std::move(bytes);
+    Source& src = *source;
+
+    src.cinfo.err = &src.err.pub;
+    installErrorManager(src.err);
+    if (setjmp(src.err.jump)) {
+        throw std::runtime_error(std::string("JpegCoefficientImage: ") + src.err.message);
+    }
+    jpeg_create_decompress(&src.cinfo);
+    src.created = true;
+    jpeg_mem_src(&src.cinfo, src.bytes.data(), static_cast<unsigned long>(src.bytes.size()));
+    jpeg_save_markers(&src.cinfo, JPEG_COM, 0xFFFF);
+    for (int m = 0; m < 16; ++m) {
+        jpeg_save_markers(&src.cinfo, JPEG_APP0 + m, 0xFFFF);
+    }
+    jpeg_read_header(&src.cinfo, TRUE);
+    src.arrays = jpeg_read_coefficients(&src.cinfo);
+
+    // Filled through the heap-allocated source so nothing is constructed between setjmp and a possible longjmp
+    src.components.resize(src.cinfo.num_components);
+    for (int c = 0; c < src.cinfo.num_components; ++c) {
+        const jpeg_component_info& info = src.cinfo.comp_info[c];
+        JpegComponent& comp = src.components[c];
+        comp.width_in_blocks = static_cast<int>(info.width_in_blocks);
+        comp.height_in_blocks = static_cast<int>(info.height_in_blocks);
+        if (info.quant_table == nullptr) {
+            throw std::runtime_error("JpegCoefficientImage: missing quantization table");
+        }
+        for (int k = 0; k < 64; ++k) {
+            comp.quant[k] = static_cast<uint16_t>(info.quant_table->quantval[k]);
+        }
+        comp.coefficients.resize(comp.blockCount() * 64);
+        for (int row = 0; row < comp.height_in_blocks; ++row) {
+            JBLOCKARRAY rows = (*src.cinfo.mem->access_virt_barray)(
+                reinterpret_cast<j_common_ptr>(&src.cinfo), src.arrays[c], row, 1, FALSE);
+            for (int col = 0; col < comp.width_in_blocks; ++col) {
+                std::copy(rows[0][col], rows[0][col] + 64, comp.block(row, col));
+            }
+        }
+    }
+
+    JpegCoefficientImage image(std::move(source));
+    image.width_ = static_cast<int>(src.cinfo.image_width);
+    image.height_ = static_cast<int>(src.cinfo.image_height);
+    image.components = std::move(src.components);
+    return image;
+}
+
+JpegCoefficientImage JpegCoefficientImage::fromFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Could not open or find the image: " + path);
+    }
+    return fromBytes(std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+}
+
+/**
+ * @brief Writes the coefficients back as a JPEG file without any pixel round trip.
+ * @return std::vector<unsigned char> The encoded JPEG.
+ * @throws std::runtime_error if libjpeg fails.
+ */
+std::vector<unsigned char> JpegCoefficientImage::encode() const {
+    Source& src = *source_;
+    if (setjmp(src.err.jump)) {
+        throw std::runtime_error(std::string("JpegCoefficientImage: ") + src.err.message);
+    }
+    for (int c = 0; c < static_cast<int>(components.size()); ++c) {
+        const JpegComponent& comp = components[c];
+        for (int row = 0; row < comp.height_in_blocks; ++row) {
+            JBLOCKARRAY rows = (*src.cinfo.mem->access_virt_barray)(
+                reinterpret_cast<j_common_ptr>(&src.cinfo), src.arrays[c], row, 1, TRUE);
+            for (int col = 0; col < comp.width_in_blocks; ++col) {
+                std::copy(comp.block(row, col), comp.block(row, col) + 64, rows[0][col]);
+            }
+        }
+    }
+
+    jpeg_compress_struct dst{};
+    ErrorManager err{};
+    dst.err = &err.pub;
+    installErrorManager(err);
+    unsigned char* buffer = nullptr;
+    unsigned long size = 0;
+    if (setjmp(err.jump)) {
+        jpeg_destroy_compress(&dst);
+        std::free(buffer);
+        throw std::runtime_error(std::string("JpegCoefficientImage: ") + err.message);
+    }
+    jpeg_create_compress(&dst);
+    jpeg_mem_dest(&dst, &buffer, &size);
+    jpeg_copy_critical_parameters(&src.cinfo, &dst);
+    dst.optimize_coding = TRUE;
+    jpeg_write_coefficients(&dst, src.arrays);
+    for (jpeg_saved_marker_ptr marker = src.cinfo.marker_list; marker != nullptr; marker = marker->next) {
+        // The compressor writes its own JFIF / Adobe headers
+        if (dst.write_JFIF_header && isMarker(marker, JPEG_APP0, "JFIF")) continue;
+        if (dst.write_Adobe_marker && isMarker(marker, JPEG_APP0 + 14, "Adobe")) continue;
+        jpeg_write_marker(&dst, marker->marker, marker->data, marker->data_length);
+    }
+    jpeg_finish_compress(&dst);
+
+    std::vector<unsigned char> out(buffer, buffer + size);
+    jpeg_destroy_compress(&dst);
+    std::free(buffer);
+    return out;
+}
+
+void JpegCoefficientImage::save(const std::string& path) const {
+    std::vector<unsigned char> bytes = encode();
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Could not write image: " + path);
+    }
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
@@ -0,0 +1,316 @@
+#include "../include/jpeg_simulator.h"
+#include "../include/parallel.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Annex K luminance table, natural order
+const uint16_t standard_luminance[64] = {
+    16,  11,  10,  16,  24,  40,  51,  61,
+    12,  12,  14,  19,  26,  58,  60,  55,
+    14,  13,  16,  24,  40,  57,  69,  56,
+    14,  17,  22,  29,  51,  87,  80,  62,
+    18,  22,  37,  56,  68, 109, 103,  77,
+    24,  35,  55,  64,  81, 104, 113,  92,
+    49,  64,  78,  87, 103, 121, 120, 101,
+    72,  92,  95,  98, 112, 100, 103,  99
+};
+
+// Fixed-point constants of jfdctint.c / jidctint.c
+const int const_bits = 13;
+const int pass1_bits = 2;
+const int64_t fix_0_298631336 = 2446;
+const int64_t fix_0_390180644 = 3196;
+const int64_t fix_0_541196100 = 4433;
+const int64_t fix_0_765366865 = 6270;
+const int64_t fix_0_899976223 = 7373;
+const int64_t fix_1_175875602 = 9633;
+const int64_t fix_1_501321110 = 12299;
+const int64_t fix_1_847759065 = 15137;
+const int64_t fix_1_961570560 = 16069;
+const int64_t fix_2_053119869 = 16819;
+const int64_t fix_2_562915447 = 20995;
+const int64_t fix_3_072711026 = 25172;
+
+inline int64_t descale(int64_t x, int n) {
+    return (x + (int64_t(1) << (n - 1))) >> n;
+}
+
+/**
+ * @brief One 1-D pass of jpeg_fdct_islow over 8 values `step` apart.
+ * The first pass (rows) keeps pass1_bits of extra precision, the second (columns) removes it.
+ */
+void fdctPass(int32_t* d, int step, bool first) {
+    const int64_t tmp0 = d[0] + d[7 * step], tmp7 = d[0] - d[7 * step];
+    const int64_t tmp1 = d[step] + d[6 * step], tmp6 = d[step] - d[6 * step];
+    const int64_t tmp2 = d[2 * step] + d[5 * step], tmp5 = d[2 * step] - d[5 * step];
+    const int64_t tmp3 = d[3 * step] + d[4 * step], tmp4 = d[3 * step] - d[4 * step];
+
+    // Even part
+    const int64_t tmp10 = tmp0 + tmp3, tmp13 = tmp0 - tmp3;
+    const int64_t tmp11 = tmp1 + tmp2, tmp12 = tmp1 - tmp2;
+    const int shift = first ? const_bits - pass1_bits : const_bits + pass1_bits;
+    if (first) {
+        d[0] = static_cast<int32_t>((tmp10 + tmp11) * (1 << pass1_bits));
+        d[4 * step] = static_cast<int32_t>((tmp10 - tmp11) * (1 << pass1_bits));
+    } else {
+        d[0] = static_cast<int32_t>(descale(tmp10 + tmp11, pass1_bits));
+        d[4 * step] = static_cast<int32_t>(descale(tmp10 - tmp11, pass1_bits));
+    }
+    const int64_t z = (tmp12 + tmp13) * fix_0_541196100;
+    d[2 * step] = static_cast<int32_t>(descale(z + tmp13 * fix_0_765366865, shift));
+    d[6 * step] = static_cast<int32_t>(descale(z - tmp12 * fix_1_847759065, shift));
+
+    // Odd part
+    const int64_t z5 = (tmp4 + tmp6 + tmp5 + tmp7) * fix_1_175875602;
+    const int64_t z1 = -(tmp4 + tmp7) * fix_0_899976223;
+    const int64_t z2 = -(tmp5 + tmp6) * fix_2_562915447;
+    const int64_t z3 = -(tmp4 + tmp6) * fix_1_961570560 + z5;
+    const int64_t z4 = -(tmp5 + tmp7) * fix_0_390180644 + z5;
+    d[7 * step] = static_cast<int32_t>(descale(tmp4 * fix_0_298631336 + z1 + z3, shift));
+    d[5 * step] = static_cast<int32_t>(descale(tmp5 * fix_2_053119869 + z2 + z4, shift));
+    d[3 * step] = static_cast<int32_t>(descale(tmp6 * fix_3_072711026 + z2 + z3, shift));
+    d[step] = static_cast<int32_t>(descale(tmp7 * fix_1_501321110 + z1 + z4, shift));
+}
+
+/**
+ * @brief One 1-D pass of jpeg_idct_islow over 8 values `step` apart, written to out[k * out_step].
+ * `shift` is const_bits - pass1_bits for the columns and const_bits + pass1_bits + 3 for the rows.
+ */
+void idctPass(const int64_t* in, int step, int shift, int64_t* out, int out_step) {
+    // Even part
+    int64_t z2 = in[2 * step], z3 = in[6 * step];
+    const int64_t z1 = (z2 + z3) * fix_0_541196100;
+    const int64_t tmp2e = z1 - z3 * fix_1_847759065;
+    const int64_t tmp3e = z1 + z2 * fix_0_765366865;
+    z2 = in[0];
+    z3 = in[4 * step];
+    const int64_t tmp0e = (z2 + z3) * (int64_t(1) << const_bits);
+    const int64_t tmp1e = (z2 - z3) * (int64_t(1) << const_bits);
+    const int64_t tmp10 = tmp0e + tmp3e, tmp13 = tmp0e - tmp3e;
+    const int64_t tmp11 = tmp1e + tmp2e, tmp12 = tmp1e - tmp2e;
+
+    // Odd part
+    int64_t tmp0 = in[7 * step], tmp1 = in[5 * step], tmp2 = in[3 * step], tmp3 = in[step];
+    const int64_t z5 = (tmp0 + tmp2 + tmp1 + tmp3) * fix_1_175875602;
+    const int64_t o1 = -(tmp0 + tmp3) * fix_0_899976223;
+    const int64_t o2 = -(tmp1 + tmp2) * fix_2_562915447;
+    const int64_t o3 = -(tmp0 + tmp2) * fix_1_961570560 + z5;
+    const int64_t o4 = -(tmp1 + tmp3) * fix_0_390180644 + z5;
+    tmp0 = tmp0 * fix_0_298631336 + o1 + o3;
+    tmp1 = tmp1 * fix_2_053119869 + o2 + o4;
+    tmp2 = tmp2 * fix_3_072711026 + o2 + o3;
+    tmp3 = tmp3 * fix_1_501321110 + o1 + o4;
+
+    out[0] = descale(tmp10 + tmp3, shift);
+    out[7 * out_step] = descale(tmp10 - tmp3, shift);
+    out[out_step] = descale(tmp11 + tmp2, shift);
+    out[6 * out_step] = descale(tmp11 - tmp2, shift);
+    out[2 * out_step] = descale(tmp12 + tmp1, shift);
+    out[5 * out_step] = descale(tmp12 - tmp1, shift);
+    out[3 * out_step] = descale(tmp13 + tmp0, shift);
+    out[4 * out_step] = descale(tmp13 - tmp0, shift);
+}
+
+// libjpeg's post-IDCT range limit: the level shift and clamping, indexed by value & 1023
+// (values far outside [-512, 511] wrap around, as they do in the decoder)
+struct RangeLimit {
+    uint8_t table[1024];
+
+    RangeLimit() {
+        for (int v = 0; v < 1024; ++v) {
+            if (v < 128) table[v] = static_cast<uint8_t>(v + 128);
+            else if (v < 512) table[v] = 255;
+            else if (v < 896) table[v] = 0;
+            else table[v] = static_cast<uint8_t>(v - 896);
+        }
+    }
+};
+
+const RangeLimit range_limit;
+
+void checkImage(const cv::Mat& image, const char* fn) {
+    if (image.empty() || image.type() != CV_8UC1) {
+        throw std::invalid_argument(std::string(fn) + ": image must be a non-empty CV_8UC1 matrix");
+    }
+}
+
+// The 8x8 block at (y0, x0) with the last column and row repeated past the image edge
+void padEdgeBlock(const cv::Mat& image, int y0, int x0, uint8_t* padded) {
+    for (int y = 0; y < 8; ++y) {
+        const uint8_t* src = image.ptr<uint8_t>(std::min(y0 + y, image.rows - 1));
+        for (int x = 0; x < 8; ++x) padded[y * 8 + x] = src[std::min(x0 + x, image.cols - 1)];
+    }
+}
+
+// The part of a padded block that lies inside the image
+void storeEdgeBlock(const uint8_t* padded, int y0, int x0, cv::Mat& image) {
+    for (int y = 0; y < 8 && y0 + y < image.rows; ++y) {
+        uint8_t* dst = image.ptr<uint8_t>(y0 + y);
+        for (int x = 0; x < 8 && x0 + x < image.cols; ++x) dst[x0 + x] = padded[y * 8 + x];
+    }
+}
+
+// Position of the highest set bit, counting from 1
+int highestBit(uint32_t value) {
+    int bit = 0;
+    for (; value != 0; value >>= 1) bit++;
+    return bit;
+}
+
+} // namespace
+
+std::array<uint16_t, 64> jpegLuminanceTable(int quality) {
+    if (quality < 1 || quality > 100) {
+        throw std::invalid_argument("jpegLuminanceTable: quality must be in [1, 100], got " + std::to_string(quality));
+    }
+    const long scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+    std::array<uint16_t, 64> table{};
+    for (int i = 0; i < 64; ++i) {
+        const long value = (standard_luminance[i] * scale + 50) / 100;
+        table[i] = static_cast<uint16_t>(std::clamp(value, 1L, 255L));
+    }
+    return table;
+}
+
+JpegSimulator::JpegSimulator(int quality) : JpegSimulator(jpegLuminanceTable(quality)) {}
+
+JpegSimulator::JpegSimulator(const std::array<uint16_t, 64>& quant) : quant_(quant) {
+    // compute_reciprocal of jcdctmgr.c for the divisor quant << 3 and 16-bit DCT values
+    for (int i = 0; i < 64; ++i) {
+        if (quant_[i] == 0 || quant_[i] > 255) {
+            throw std::invalid_argument("JpegSimulator: quantization values must be in [1, 255]");
+        }
+        const uint32_t divisor = static_cast<uint32_t>(quant_[i]) << 3;
+        int r = 16 + highestBit(divisor) - 1;
+        uint32_t fq = (uint32_t(1) << r) / divisor;
+        const uint32_t fr = (uint32_t(1) << r) % divisor;
+        uint32_t c = divisor / 2;
+        if (fr == 0) {
+            fq >>= 1;
+            r--;
+        } else if (fr <= divisor / 2) {
+            c++;
+        } else {
+            fq++;
+        }
+        reciprocal_[i] = fq;
+        correction_[i] = c;
+        shift_[i] = r;
+    }
+}
+
+void JpegSimulator::forwardDct(const uint8_t* pixels, size_t stride, int32_t* dct) {
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) dct[y * 8 + x] = static_cast<int32_t>(pixels[y * stride + x]) - 128;
+    }
+    for (int y = 0; y < 8; ++y) fdctPass(dct + y * 8, 1, true);
+    for (int x = 0; x < 8; ++x) fdctPass(dct + x, 8, false);
+}
+
+void JpegSimulator::quantize(const int32_t* dct, int16_t* coefs) const {
+    for (int i = 0; i < 64; ++i) {
+        const uint32_t magnitude = static_cast<uint32_t>(dct[i] < 0 ? -dct[i] : dct[i]);
+        const int32_t q = static_cast<int32_t>(((magnitude + correction_[i]) * reciprocal_[i]) >> shift_[i]);
+        coefs[i] = static_cast<int16_t>(dct[i] < 0 ? -q : q);
+    }
+}
+
+void JpegSimulator::quantizeBlock(const uint8_t* pixels, size_t stride, int16_t* coefs) const {
+    int32_t data[64];
+    forwardDct(pixels, stride, data);
+    quantize(data, coefs);
+}
+
+void JpegSimulator::reconstructBlock(const int16_t* coefs, uint8_t* pixels, size_t stride) const {
+    int64_t dequantized[64], workspace[64], row[8];
+    for (int i = 0; i < 64; ++i) dequantized[i] = static_cast<int64_t>(coefs[i]) * quant_[i];
+    for (int x = 0; x < 8; ++x) idctPass(dequantized + x, 8, const_bits - pass1_bits, workspace + x, 8);
+    for (int y = 0; y < 8; ++y) {
+        idctPass(workspace + y * 8, 1, const_bits + pass1_bits + 3, row, 1);
+        for (int x = 0; x < 8; ++x) pixels[y * stride + x] = range_limit.table[row[x] & 1023];
+    }
+}
+
+void JpegSimulator::compressBlock(const uint8_t* in, size_t in_stride, uint8_t* out, size_t out_stride) const {
+    int16_t coefs[64];
+    quantizeBlock(in, in_stride, coefs);
+    reconstructBlock(coefs, out, out_stride);
+}
+
+cv::Mat JpegSimulator::compressBlock(const cv::Mat& block) const {
+    if (block.rows != 8 || block.cols != 8 || block.type() != CV_8UC1) {
+        throw std::invalid_argument("JpegSimulator::compressBlock: expected an 8x8 CV_8UC1 block");
+    }
+    cv::Mat out(8, 8, CV_8UC1);
+    compressBlock(block.ptr<uint8_t>(0), block.step, out.ptr<uint8_t>(0), out.step);
+    return out;
+}
+
+cv::Mat JpegSimulator::compress(const cv::Mat& image, int threads) const {
+    checkImage(image, "JpegSimulator::compress");
+    cv::Mat result(image.size(), CV_8UC1);
+    const int block_rows = (image.rows + 7) / 8, block_cols = (image.cols + 7) / 8;
+    parallelFor(block_rows, resolveThreads(threads), [&](size_t by) {
+        const int y0 = static_cast<int>(by) * 8;
+        for (int bx = 0; bx < block_cols; ++bx) {
+            const int x0 = bx * 8;
+            if (y0 + 8 <= image.rows && x0 + 8 <= image.cols) {
+                compressBlock(image.ptr<uint8_t>(y0) + x0, image.step, result.ptr<uint8_t>(y0) + x0, result.step);
+                continue;
+            }
+            // Edge block: repeat the last column and row, keep only the part inside the image
+            uint8_t padded[64];
+            padEdgeBlock(image, y0, x0, padded);
+            compressBlock(padded, 8, padded, 8);
+            storeEdgeBlock(padded, y0, x0, result);
+        }
+    });
+    return result;
+}
+
+JpegImageDct::JpegImageDct(const cv::Mat& image, int threads)
+    : rows_(image.rows), cols_(image.cols), block_rows_((image.rows + 7) / 8), block_cols_((image.cols + 7) / 8) {
+    checkImage(image, "JpegImageDct");
+    dct_.resize(static_cast<size_t>(block_rows_) * block_cols_ * 64);
+    parallelFor(block_rows_, resolveThreads(threads), [&](size_t by) {
+        const int y0 = static_cast<int>(by) * 8;
+        for (int bx = 0; bx < block_cols_; ++bx) {
+            const int x0 = bx * 8;
+            int32_t* dct = dct_.data() + (by * block_cols_ + bx) * 64;
+            if (y0 + 8 <= rows_ && x0 + 8 <= cols_) {
+                JpegSimulator::forwardDct(image.ptr<uint8_t>(y0) + x0, image.step, dct);
+            } else {
+                uint8_t padded[64];
+                padEdgeBlock(image, y0, x0, padded);
+                JpegSimulator::forwardDct(padded, 8, dct);
+            }
+        }
+    });
+}
+
+cv::Mat JpegImageDct::compress(const JpegSimulator& simulator, int threads) const {
+    cv::Mat result(rows_, cols_, CV_8UC1);
+    parallelFor(block_rows_, resolveThreads(threads), [&](size_t by) {
+        const int y0 = static_cast<int>(by) * 8;
+        for (int bx = 0; bx < block_cols_; ++bx) {
+            const int x0 = bx * 8;
+            int16_t coefs[64];
+            simulator.quantize(dct_.data() + (by * block_cols_ + bx) * 64, coefs);
+            if (y0 + 8 <= rows_ && x0 + 8 <= cols_) {
+                simulator.reconstructBlock(coefs, result.ptr<uint8_t>(y0) + x0, result.step);
+            } else {
+                uint8_t padded[64];
+                simulator.reconstructBlock(coefs, padded, 8);
+                storeEdgeBlock(padded, y0, x0, result);
+            }
+        }
+    });
+    return result;
+}
+
+cv::Mat simulateJpeg(const cv::Mat& image, int quality, int threads) {
+    return JpegSimulator(quality).compress(image, threads);
+}
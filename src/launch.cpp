@@ -5,6 +5,34 @@
 #include <iomanip>
 #include <algorithm>
 
+/**
+ * @brief Embeds a square binary watermark (32x32 as a rule) into a grayscale image.
+ * @param image Cover image, type CV_8UC1, size a multiple of 8 with at least one block per watermark bit.
+ * @param watermark Square watermark image, type CV_8UC1.
+ * @param config Scheme, seed, thread count and iteration budget (see gbo_api.h).
+ * @param stats Optional, receives the statistics of gbo::embed.
+ * @return cv::Mat The watermarked image, type CV_8UC1.
+ */
+cv::Mat embedWatermarkMat(const cv::Mat& image, const cv::Mat& watermark, const gbo::Config& config,
+                          gbo::EmbedStats* stats) {
+    if (image.empty() || image.type() != CV_8UC1) {
+        throw std::runtime_error("Image must be a non-empty CV_8UC1 image");
+    }
+    const WatermarkBits watermark_bits = extract_watermark_bits(watermark, watermark.rows);
+
+    cv::Mat result_image = image.clone();
+    gbo::ImageView view{result_image.data, result_image.cols, result_image.rows, result_image.step[0]};
+    gbo::EmbedStats result = gbo::embed(view, watermark_bits, config);
+    if (stats != nullptr) *stats = std::move(result);
+    return result_image;
+}
+
+cv::Mat embedWatermarkMat(const cv::Mat& image, const cv::Mat& watermark, int scheme) {
+    gbo::Config config;
+    config.scheme = scheme;
+    return embedWatermarkMat(image, watermark, config);
+}
+
 void embedWatermark(std::string image_path, std::string watermark_path, std::string output_path, int scheme) {
     cv::Mat image = cv::imread(image_path, CV_8UC1);
     if (image.empty()) {
@@ -16,136 +44,61 @@ void embedWatermark(std::string image_path, std::string watermark_path, std::str
         throw std::runtime_error("Could not open or find the watermark: " + watermark_path);
     }
 
-    std::vector<cv::Mat> blocks = splitImageInto8x8Blocks(image);
-    std::vector<cv::Mat> new_blocks;
-
-    std::vector<unsigned char> watermark_bits = extract_watermark_bits(watermark);
-
-    // Debug/tracing modes have been removed for production build.
-    const bool debug = false;
-    const bool traceUnchanged = false;
-    const bool traceFailed = false;
-
-    for (size_t i = 0; i < blocks.size(); ++i) {
-        GBO gbo;
-        unsigned char target_bit = watermark_bits[i % watermark_bits.size()];
-        cv::Mat new_block = gbo.main_loop(blocks[i], embeding_region[scheme].size(), target_bit, scheme);
-        // Debug: verify embedding success
-        if (debug || traceUnchanged || traceFailed) {
-            unsigned char extracted_bit = getBitFromBlock(new_block, scheme);
-            bool identical = cv::countNonZero(blocks[i] != new_block) == 0;
-            if (identical && traceUnchanged) {
-                // Block was not modified at all
-                cv::Mat floatOld;
-                blocks[i].convertTo(floatOld, CV_64FC1);
-                cv::Mat dctOld;
-                cv::dct(floatOld, dctOld);
-                double s1_old = getRegionSum(dctOld, s1_region[scheme]);
-                double s0_old = getRegionSum(dctOld, s0_region[scheme]);
-
-                // For consistency compute PSNR (will be high if identical)
-                double psnr_val = compute_psnr(blocks[i], new_block);
-
-                std::cout << "[DEBUG] Unchanged block " << i
-                          << " bit=" << static_cast<int>(target_bit)
-                          << " s1=" << s1_old << " s0=" << s0_old
-                          << " psnr=" << psnr_val << std::endl;
-
-                // Additionally run GBO with verbose to trace fitness evolution
-                std::cout << "[DEBUG] Fitness evolution for block " << i << std::endl;
-                GBO gbo_trace;
-                cv::Mat traced_block = gbo_trace.main_loop(blocks[i], embeding_region[scheme].size(), target_bit, scheme, true);
-
-                // Compute region sums after GBO attempt
-                cv::Mat tracedFloat;
-                traced_block.convertTo(tracedFloat, CV_64FC1);
-                cv::Mat dctTraced;
-                cv::dct(tracedFloat, dctTraced);
-                double s1_traced = getRegionSum(dctTraced, s1_region[scheme]);
-                double s0_traced = getRegionSum(dctTraced, s0_region[scheme]);
-
-                double psnr_after = compute_psnr(blocks[i], traced_block);
-                std::cout << "[DEBUG] After GBO: new_s1=" << s1_traced << " new_s0=" << s0_traced
-                          << " psnr_after=" << psnr_after << std::endl;
-
-                std::cout << "[DEBUG] Trace complete. Exiting." << std::endl;
-                std::exit(0);
-            }
-            if (traceFailed && extracted_bit != target_bit) {
-                std::cout << "[TRACE_FAILED] Block " << i << " target=" << static_cast<int>(target_bit)
-                          << " extracted=" << static_cast<int>(extracted_bit) << std::endl;
-                std::cout << "[TRACE_FAILED] Per-iteration metrics:" << std::endl;
-                GBO gbo_trace;
-                cv::Mat traced_block = gbo_trace.main_loop(blocks[i], embeding_region[scheme].size(), target_bit, scheme, true);
-
-                // Print DCT coefficients before and after
-                auto printDCT = [&](const cv::Mat &mat, const std::string &label){
-                    std::cout << label << std::endl;
-                    for (int r = 0; r < 8; ++r) {
-                        for (int c = 0; c < 8; ++c) {
-                            // Determine zigzag index for (r,c)
-                            int linear = r * 8 + c;
-                            int zz_idx = 0;
-                            for (; zz_idx < 64; ++zz_idx) {
-                                if (jpeg_zigzag[zz_idx] == linear) break;
-                            }
-                            bool isEmbed = std::find(embeding_region[scheme].begin(), embeding_region[scheme].end(), zz_idx) != embeding_region[scheme].end();
-                            if (isEmbed) std::cout << "\033[32m"; // green
-                            std::cout << std::setw(9) << std::fixed << std::setprecision(2) << mat.at<double>(r, c);
-                            if (isEmbed) std::cout << "\033[0m";
-                        }
-                        std::cout << std::endl;
-                    }
-                };
-
-                cv::Mat origF, dctOrig;
-                blocks[i].convertTo(origF, CV_64FC1);
-                cv::dct(origF, dctOrig);
+    cv::Mat result_image = embedWatermarkMat(image, watermark, scheme);
+    cv::imwrite(output_path, result_image);
+}
 
-                cv::Mat tracedF, dctTraced;
-                traced_block.convertTo(tracedF, CV_64FC1);
-                cv::dct(tracedF, dctTraced);
+/**
+ * @brief Extracts the side x side watermark from a watermarked image by majority vote over its copies.
+ * @param watermarked_image Watermarked image, type CV_8UC1.
+ * @return cv::Mat The extracted watermark, side x side, type CV_8UC1.
+ */
+cv::Mat extractWatermarkMat(const cv::Mat& watermarked_image, const gbo::Config& config, int side) {
+    if (watermarked_image.empty() || watermarked_image.type() != CV_8UC1) {
+        throw std::runtime_error("Image must be a non-empty CV_8UC1 image");
+    }
+    WatermarkBits extracted_bits(static_cast<size_t>(std::max(0, side)) * std::max(0, side));
+    gbo::ConstImageView view(watermarked_image.data, watermarked_image.cols, watermarked_image.rows, watermarked_image.step[0]);
+    gbo::extract(view, extracted_bits, config);
+    return reconstruct_watermark_image(extracted_bits, side);
+}
 
-                printDCT(dctOrig,  "[TRACE_FAILED] DCT ORIGINAL:");
-                printDCT(dctTraced,"[TRACE_FAILED] DCT MODIFIED:");
+cv::Mat extractWatermarkMat(const cv::Mat& watermarked_image, int scheme) {
+    gbo::Config config;
+    config.scheme = scheme;
+    return extractWatermarkMat(watermarked_image, config);
+}
 
-                std::cout << "[TRACE_FAILED] Trace complete. Exiting." << std::endl;
-                std::exit(0);
-            }
-            if (!identical && debug && extracted_bit != target_bit) {
-                // Compute old region sums
-                cv::Mat oldFloat;
-                blocks[i].convertTo(oldFloat, CV_64FC1);
-                cv::Mat dctOld;
-                cv::dct(oldFloat, dctOld);
-                double s1_old = getRegionSum(dctOld, s1_region[scheme]);
-                double s0_old = getRegionSum(dctOld, s0_region[scheme]);
-
-                // Compute new region sums
-                cv::Mat newFloat;
-                new_block.convertTo(newFloat, CV_64FC1);
-                cv::Mat dctNew;
-                cv::dct(newFloat, dctNew);
-                double s1_new = getRegionSum(dctNew, s1_region[scheme]);
-                double s0_new = getRegionSum(dctNew, s0_region[scheme]);
-
-                // Compute PSNR between original and modified block
-                double psnr_val = compute_psnr(blocks[i], new_block);
-
-                std::cout << "[DEBUG] Mismatch at block " << i
-                          << " target=" << static_cast<int>(target_bit)
-                          << " extracted=" << static_cast<int>(extracted_bit)
-                          << " old_s1=" << s1_old << " old_s0=" << s0_old
-                          << " new_s1=" << s1_new << " new_s0=" << s0_new
-                          << " psnr=" << psnr_val << std::endl;
-            }
-        }
-        new_blocks.push_back(new_block);
+/**
+ * @brief Extracts the side x side watermark when the embedding scheme is unknown (see gbo::extractBlind).
+ * @param watermarked_image Watermarked image, type CV_8UC1.
+ * @param result Optional output for the detected scheme and confidence.
+ * @return cv::Mat The extracted watermark, side x side, type CV_8UC1.
+ */
+cv::Mat extractWatermarkBlindMat(const cv::Mat& watermarked_image, const gbo::Config& config,
+                                 gbo::BlindExtraction* result, int side) {
+    if (watermarked_image.empty() || watermarked_image.type() != CV_8UC1) {
+        throw std::runtime_error("Image must be a non-empty CV_8UC1 image");
     }
+    WatermarkBits extracted_bits(static_cast<size_t>(std::max(0, side)) * std::max(0, side));
+    gbo::ConstImageView view(watermarked_image.data, watermarked_image.cols, watermarked_image.rows, watermarked_image.step[0]);
+    gbo::BlindExtraction detection = gbo::extractBlind(view, extracted_bits, config);
+    if (result != nullptr) *result = detection;
+    return reconstruct_watermark_image(extracted_bits, side);
+}
 
-    cv::Mat result_image = assembleImageFrom8x8Blocks(new_blocks);
-    result_image.convertTo(result_image, CV_8UC1);
-    cv::imwrite(output_path, result_image);
+gbo::Method parseEmbedMethod(const std::string& name) {
+    if (name == "gbo") return gbo::Method::Gbo;
+    if (name == "analytic") return gbo::Method::Analytic;
+    throw std::invalid_argument("unknown embedding method: " + name + " (expected gbo or analytic)");
+}
+
+gbo::WarmStart parseWarmStart(const std::string& name) {
+    if (name == "none") return gbo::WarmStart::None;
+    if (name == "analytic") return gbo::WarmStart::Analytic;
+    if (name == "raster") return gbo::WarmStart::Raster;
+    if (name == "wavefront") return gbo::WarmStart::Wavefront;
+    throw std::invalid_argument("unknown warm start: " + name + " (expected none, analytic, raster or wavefront)");
 }
 
 void extractWatermark(std::string watermarked_image_path, std::string extracted_watermark_path, int scheme) {
@@ -155,24 +108,7 @@ void extractWatermark(std::string watermarked_image_path, std::string extracted_
     }
     watermarked_image.convertTo(watermarked_image, CV_8UC1);
 
-    std::vector<cv::Mat> blocks = splitImageInto8x8Blocks(watermarked_image);
-    std::vector<unsigned char> extracted_bits(1024, 0);
-    for (size_t i = 0; i < blocks.size(); ++i) {
-        unsigned char bit = getBitFromBlock(blocks[i], scheme);
-        extracted_bits[i % 1024] += bit;
-    }
-
-    for (auto& bit : extracted_bits) {
-        if (bit >= 3) { 
-            bit = 1;
-        } else if (bit <= 1) {
-            bit = 0;
-        } else if (bit == 2) {
-            bit = uniform_random_0_1() < 0.5 ? 0 : 1; 
-        }
-    }
-
-    cv::Mat extracted_watermark = reconstruct_watermark_image(extracted_bits);
+    cv::Mat extracted_watermark = extractWatermarkMat(watermarked_image, scheme);
     cv::imwrite(extracted_watermark_path, extracted_watermark);
 }
 
@@ -194,8 +130,8 @@ void launchSingleBlockGBO(const std::string& image_path,
         cv::Mat block = image(roi).clone();
 
         // Extract first watermark bit as target bit
-        std::vector<unsigned char> wm_bits = extract_watermark_bits(watermark);
-        unsigned char bit = wm_bits.empty() ? 0 : wm_bits[0];
+        const WatermarkBits wm_bits = extract_watermark_bits(watermark);
+        unsigned char bit = wm_bits.empty() ? 0 : wm_bits.get(0);
 
         std::cout << "Running GBO for single 8x8 block (scheme=" << scheme << ")" << std::endl;
         GBO gbo;
@@ -281,37 +217,14 @@ void launchGBO(const std::string& image_path,
     };
 
     double ber_base  = computeBER(extract_watermark_bits(watermark_image), extract_watermark_bits(extracted_noattack));
-    double psnr_base = computePSNR(original_image, watermarked_image);
-    double ssim_base = computeSSIM(original_image, watermarked_image);
-    double ncc_base  = computeNCC(original_image, watermarked_image);
-    double mse_base  = computeMSE(original_image, watermarked_image);
-    printMetrics("NO ATTACK", ber_base, psnr_base, ssim_base, ncc_base, mse_base);
+    const SsimReference reference(original_image);
+    const ImageQuality base = computeImageQuality(reference, watermarked_image);
+    printMetrics("NO ATTACK", ber_base, base.psnr, base.ssim, base.ncc, base.mse);
 
     // ------------------ СПИСОК АТАК ------------------
     cv::Mat wm_img_gray = watermarked_image; // already CV_8UC1
 
-    struct AttackInfo {
-        std::string name;
-        cv::Mat (*func)(const cv::Mat &, double);
-        double param;
-    };
-
-    std::vector<AttackInfo> attacks = {
-        {"Brightness +30", [](const cv::Mat &img, double v){return brightnessIncrease(img, static_cast<int>(v));}, 30},
-        {"Brightness -30", [](const cv::Mat &img, double v){return brightnessDecrease(img, static_cast<int>(v));}, 30},
-        {"Contrast *1.2",   [](const cv::Mat &img, double v){return contrastIncrease(img, v);}, 1.2},
-        {"Contrast *0.8",   [](const cv::Mat &img, double v){return contrastDecrease(img, v);}, 0.8},
-        {"Salt&Pepper 5%", [](const cv::Mat &img, double v){return saltPepperNoise(img, v);}, 0.05},
-        {"Speckle 20",      [](const cv::Mat &img, double v){return speckleNoise(img, v);}, 20},
-        {"Histogram Eq",    [](const cv::Mat &img, double){return histogramEqualization(img);}, 0},
-        {"Sharpen",         [](const cv::Mat &img, double){return sharpening(img);}, 0},
-        {"JPEG q=70",       [](const cv::Mat &img, double v){return jpegCompression(img, static_cast<int>(v));}, 70},
-        {"JPEG q=80",       [](const cv::Mat &img, double v){return jpegCompression(img, static_cast<int>(v));}, 80},
-        {"JPEG q=90",       [](const cv::Mat &img, double v){return jpegCompression(img, static_cast<int>(v));}, 90},
-        {"Gaussian k=3",    [](const cv::Mat &img, double v){return gaussianFiltering(img, static_cast<int>(v));}, 3},
-        {"Median k=3",      [](const cv::Mat &img, double v){return medianFiltering(img, static_cast<int>(v));}, 3},
-        {"Average k=3",     [](const cv::Mat &img, double v){return averageFiltering(img, static_cast<int>(v));}, 3}
-    };
+    const std::vector<AttackInfo>& attacks = standardAttacks();
 
     auto sanitize = [](std::string s){
         for (char &c : s) {
@@ -325,7 +238,7 @@ void launchGBO(const std::string& image_path,
     std::string stem = img_path.stem().string();
 
     for (const auto &atk : attacks) {
-        cv::Mat attacked = atk.func(wm_img_gray, atk.param);
+        cv::Mat attacked = atk.apply(wm_img_gray);
         std::string attack_name_sanitized = sanitize(atk.name);
         std::string tmp_attack_path = (img_path.parent_path() / (stem + "_" + attack_name_sanitized + ".png")).string();
         std::string tmp_extr_path   = (img_path.parent_path() / ("extracted_watermark_" + stem + "_" + attack_name_sanitized + ".png")).string();
@@ -345,11 +258,8 @@ void launchGBO(const std::string& image_path,
         }
 
         double ber  = computeBER(extract_watermark_bits(watermark_image), extract_watermark_bits(extracted_wm));
-        double psnr = computePSNR(original_image, attacked);
-        double ssim = computeSSIM(original_image, attacked);
-        double ncc  = computeNCC(original_image, attacked);
-        double mse  = computeMSE(original_image, attacked);
-        printMetrics(atk.name, ber, psnr, ssim, ncc, mse);
+        const ImageQuality quality = computeImageQuality(reference, attacked);
+        printMetrics(atk.name, ber, quality.psnr, quality.ssim, quality.ncc, quality.mse);
 
     }
 
@@ -0,0 +1,140 @@
+#include "../include/local_refinement.h"
+#include "../include/process_block.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Backtracking halvings allowed per step, and the Armijo sufficient-decrease constant
+const int max_backtracks = 30;
+const double armijo = 1e-4;
+
+// Share of the way from the start to the refined vector tried by the rounding correction
+const double correction_steps[] = {1.0, 0.5, 0.25};
+
+// Same floor as getRegionSum
+const double min_region_sum = 0.001;
+
+bool inRegion(const std::vector<int>& region, int k) {
+    return std::find(region.begin(), region.end(), k) != region.end();
+}
+
+// Lower end of the box: keeps |c_k| + v_k >= 0
+arma::vec lowerBounds(const double* magnitudes, int scheme, double bound) {
+    const std::vector<int>& region = embeding_region[scheme];
+    arma::vec lower(region.size());
+    for (size_t idx = 0; idx < region.size(); ++idx) lower(idx) = std::max(-bound, -magnitudes[region[idx]]);
+    return lower;
+}
+
+arma::vec project(const arma::vec& vec, const arma::vec& lower, double bound) {
+    arma::vec out = vec;
+    for (arma::uword idx = 0; idx < out.n_elem; ++idx) out(idx) = std::min(bound, std::max(lower(idx), out(idx)));
+    return out;
+}
+
+} // namespace
+
+double coefficientRoundingMse(const uint16_t* quant, int scheme) {
+    double sum = 0.0;
+    for (int k : embeding_region[scheme]) {
+        const double step = quant[jpeg_zigzag[k]];
+        sum += step * step / 12.0;
+    }
+    return sum / 64.0;
+}
+
+double relaxedFitness(const double* magnitudes, unsigned char bit, int scheme, double rounding_mse,
+                      const arma::vec& vec, arma::vec* gradient) {
+    const std::vector<int>& region = embeding_region[scheme];
+    double s1 = 0.0, s0 = 0.0, squared_change = 0.0;
+    for (size_t idx = 0; idx < region.size(); ++idx) {
+        const int k = region[idx];
+        const double magnitude = std::fabs(magnitudes[k] + vec(idx));
+        if (inRegion(s1_region[scheme], k)) s1 += magnitude;
+        if (inRegion(s0_region[scheme], k)) s0 += magnitude;
+        squared_change += (magnitude - magnitudes[k]) * (magnitude - magnitudes[k]);
+    }
+    s1 = std::max(s1, min_region_sum);
+    s0 = std::max(s0, min_region_sum);
+    const double mse = squared_change / 64.0 + rounding_mse;
+    const double ratio = bit == 0 ? s1 / s0 : s0 / s1;
+    const double psnr = 10.0 * std::log10(255.0 * 255.0 / mse);
+
+    if (gradient != nullptr) {
+        // d ratio / d magnitude: 1 / winning sum for the losing region, -ratio / winning sum for the winning one
+        const double win = bit == 0 ? s0 : s1;
+        const std::vector<int>& lose_region = bit == 0 ? s1_region[scheme] : s0_region[scheme];
+        const std::vector<int>& win_region = bit == 0 ? s0_region[scheme] : s1_region[scheme];
+        // d (-0.01 * psnr) / d mse
+        const double psnr_term = 0.1 / (std::log(10.0) * mse);
+        gradient->set_size(region.size());
+        for (size_t idx = 0; idx < region.size(); ++idx) {
+            const int k = region[idx];
+            const double shifted = magnitudes[k] + vec(idx);
+            const double magnitude = std::fabs(shifted);
+            double d = psnr_term * 2.0 * (magnitude - magnitudes[k]) / 64.0;
+            if (inRegion(lose_region, k)) d += 1.0 / win;
+            if (inRegion(win_region, k)) d -= ratio / win;
+            (*gradient)(idx) = shifted >= 0.0 ? d : -d;
+        }
+    }
+    return ratio - 0.01 * psnr;
+}
+
+arma::vec refineRelaxed(const double* magnitudes, unsigned char bit, int scheme, double rounding_mse,
+                        const arma::vec& start, double bound, int steps) {
+    const arma::vec lower = lowerBounds(magnitudes, scheme, bound);
+    arma::vec vec = project(start, lower, bound);
+    arma::vec gradient, next_gradient;
+    double value = relaxedFitness(magnitudes, bit, scheme, rounding_mse, vec, &gradient);
+
+    // The first trial step moves the steepest coordinate by half the box
+    double step = 0.0;
+    for (int s = 0; s < steps; ++s) {
+        const double steepest = arma::abs(gradient).max();
+        if (steepest <= 0.0) {
+            break;
+        }
+        if (step == 0.0) {
+            step = 0.5 * bound / steepest;
+        }
+        bool accepted = false;
+        arma::vec next;
+        double next_value = value;
+        for (int b = 0; b < max_backtracks; ++b) {
+            next = project(vec - step * gradient, lower, bound);
+            next_value = relaxedFitness(magnitudes, bit, scheme, rounding_mse, next, &next_gradient);
+            if (next_value <= value + armijo * arma::dot(gradient, next - vec)) {
+                accepted = true;
+                break;
+            }
+            step *= 0.5;
+        }
+        if (!accepted || arma::abs(next - vec).max() < 1e-9) {
+            break;
+        }
+        vec = next;
+        value = next_value;
+        gradient = next_gradient;
+        step *= 2.0;
+    }
+    return vec;
+}
+
+OptimizerResult refineVector(const double* magnitudes, unsigned char bit, int scheme, double rounding_mse,
+                             const OptimizerResult& start, double bound, int steps, const FitnessOracle& fitness) {
+    OptimizerResult result = start;
+    const arma::vec refined = refineRelaxed(magnitudes, bit, scheme, rounding_mse, start.best, bound, steps);
+    for (double share : correction_steps) {
+        const arma::vec candidate = start.best + share * (refined - start.best);
+        const double value = fitness(candidate);
+        result.evaluations++;
+        if (value < result.best_fitness) {
+            result.best = candidate;
+            result.best_fitness = value;
+            break;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,410 @@
+#include "../include/lockstep_gbo.h"
+#include "../include/gbo.h"
+#include "../include/population.h"
+#include "../include/random_utils.h"
+#include "../include/robust_fitness.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const int L = lockstep_lanes;
+using Lanes = std::array<double, lockstep_lanes>;
+
+// Adding and subtracting 1.5 * 2^52 rounds a double to the nearest integer, ties to even, like
+// cvRound in convertTo; unlike std::nearbyint it vectorizes without SSE4.1
+const double round_magic = 6755399441055744.0;
+
+// Orthonormal 8x8 DCT-II basis, the transform cv::dct applies along each axis, and its transpose
+struct DctBasis {
+    double forward[8][8];
+    double inverse[8][8];
+
+    DctBasis() {
+        const double pi = 3.14159265358979323846;
+        for (int u = 0; u < 8; ++u) {
+            const double scale = u == 0 ? std::sqrt(1.0 / 8.0) : std::sqrt(2.0 / 8.0);
+            for (int x = 0; x < 8; ++x) {
+                forward[u][x] = scale * std::cos((2 * x + 1) * u * pi / 16.0);
+                inverse[x][u] = forward[u][x];
+            }
+        }
+    }
+};
+
+const DctBasis& dctBasis() {
+    static const DctBasis basis;
+    return basis;
+}
+
+// out = A in A^T for every lane (rows, then columns)
+void transformLanes(const double (&a)[8][8], const double (*in)[L], double (*out)[L]) {
+    alignas(64) double rows[64][L];
+    for (int r = 0; r < 8; ++r) {
+        for (int j = 0; j < 8; ++j) {
+            double* dst = rows[r * 8 + j];
+            for (int l = 0; l < L; ++l) dst[l] = 0.0;
+            for (int b = 0; b < 8; ++b) {
+                const double w = a[j][b];
+                const double* src = in[r * 8 + b];
+                for (int l = 0; l < L; ++l) dst[l] += w * src[l];
+            }
+        }
+    }
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            double* dst = out[i * 8 + j];
+            for (int l = 0; l < L; ++l) dst[l] = 0.0;
+            for (int r = 0; r < 8; ++r) {
+                const double w = a[i][r];
+                const double* src = rows[r * 8 + j];
+                for (int l = 0; l < L; ++l) dst[l] += w * src[l];
+            }
+        }
+    }
+}
+
+// Sum of |coefficient| over a region, floored like getRegionSum
+void regionSums(const double (*coefs)[L], const std::vector<int>& region, double* sums) {
+    for (int l = 0; l < L; ++l) sums[l] = 0.0;
+    for (int k : region) {
+        const double* c = coefs[jpeg_zigzag[k]];
+        for (int l = 0; l < L; ++l) sums[l] += std::fabs(c[l]);
+    }
+    for (int l = 0; l < L; ++l) sums[l] = sums[l] > 0.001 ? sums[l] : 0.001;
+}
+
+// GsrDraws of every lane
+struct GsrLanes {
+    Lanes a, b, c, eps, p1, p2, q1, q2, d;
+
+    void set(int l, const GsrDraws& r) {
+        a[l] = r.a;
+        b[l] = r.b;
+        c[l] = r.c;
+        eps[l] = r.eps;
+        p1[l] = r.p1;
+        p2[l] = r.p2;
+        q1[l] = r.q1;
+        q2[l] = r.q2;
+        d[l] = r.d;
+    }
+};
+
+// GboStepDraws of every lane, one array per value so the lane loops read them contiguously
+struct StepDraws {
+    Lanes rho1, rho2, dm1, dm2, dm3, dm4, rho1_next, ra, rb;
+    int r0[L], r1[L], r2[L], r3[L];
+    GsrLanes gsr1, gsr2;
+    bool leo[L];
+    Lanes u1, u2, u3, l2, f1, f2;
+    bool y_next[L];
+    int partner[L];
+
+    void set(int l, const GboStepDraws& s) {
+        rho1[l] = s.rho1;
+        rho2[l] = s.rho2;
+        dm1[l] = s.dm1;
+        dm2[l] = s.dm2;
+        dm3[l] = s.dm3;
+        dm4[l] = s.dm4;
+        rho1_next[l] = s.rho1_next;
+        ra[l] = s.ra;
+        rb[l] = s.rb;
+        r0[l] = s.r[0];
+        r1[l] = s.r[1];
+        r2[l] = s.r[2];
+        r3[l] = s.r[3];
+        gsr1.set(l, s.gsr1);
+        gsr2.set(l, s.gsr2);
+        leo[l] = s.leo;
+        u1[l] = s.u1;
+        u2[l] = s.u2;
+        u3[l] = s.u3;
+        l2[l] = s.l2;
+        f1[l] = s.f1;
+        f2[l] = s.f2;
+        y_next[l] = s.y_next;
+        partner[l] = s.partner;
+    }
+};
+
+// calculate_gsr of gbo.cpp on every lane; from_current selects the flag 1 variant
+void gsrLanes(int n, const Lanes& rho2, const double* best, const double* worst, const double* current,
+              const double* xr1, const double* dm, const double* xm, bool from_current, const GsrLanes& r,
+              double* gsr) {
+    for (int idx = 0; idx < n; ++idx) {
+        const int o = idx * L;
+        for (int l = 0; l < L; ++l) {
+            const double cur = current[o + l];
+            const double delta = 2.0 * r.a[l] * std::fabs(xm[o + l] - cur + r.eps[l]);
+            const double step = 0.5 * (best[o + l] - xr1[o + l] + delta);
+            const double del_x = r.b[l] * std::fabs(step);
+            const double first = (r.c[l] * rho2[l] * 2.0 * (del_x * cur)) / (best[o + l] - worst[o + l] + r.eps[l]);
+            const double xs = (from_current ? cur : best[o + l]) - first + dm[o + l];
+            const double yp = r.p1[l] * (0.5 * (xs + cur) + r.p2[l] * del_x);
+            const double yq = r.q1[l] * (0.5 * (xs + cur) - r.q2[l] * del_x);
+            gsr[o + l] = (r.d[l] * rho2[l] * 2.0 * (del_x * cur)) / (yp - yq + r.eps[l]);
+        }
+    }
+}
+
+} // namespace
+
+BlockBatch::BlockBatch(const std::vector<cv::Mat>& blocks, const std::vector<unsigned char>& bits, int scheme,
+                       const BlockRobustness* robustness)
+    : scheme_(scheme), robustness_(robustness) {
+    if (blocks.empty() || blocks.size() > static_cast<size_t>(L)) {
+        throw std::invalid_argument("BlockBatch: expected 1 to lockstep_lanes blocks");
+    }
+    if (bits.size() != blocks.size()) {
+        throw std::invalid_argument("BlockBatch: one bit per block expected");
+    }
+    if (scheme < 0 || scheme >= static_cast<int>(embeding_region.size())) {
+        throw std::invalid_argument("BlockBatch: invalid scheme index");
+    }
+    if (robustness && robustness->scheme() != scheme) {
+        throw std::invalid_argument("BlockBatch: robustness term is for another scheme");
+    }
+    for (int l = 0; l < L; ++l) {
+        const size_t source = std::min(static_cast<size_t>(l), blocks.size() - 1);
+        const cv::Mat& block = blocks[source];
+        if (block.rows != 8 || block.cols != 8 || block.type() != CV_8UC1) {
+            throw std::invalid_argument("BlockBatch: blocks must be 8x8 CV_8UC1");
+        }
+        // The starting coefficients come from cv::dct, exactly as calcFitnessValue gets them
+        cv::Mat floatBlock, dctBlock;
+        block.convertTo(floatBlock, CV_64FC1);
+        cv::dct(floatBlock, dctBlock);
+        for (int p = 0; p < 64; ++p) {
+            pixels_[p][l] = floatBlock.at<double>(p / 8, p % 8);
+            coefficients_[p][l] = dctBlock.at<double>(p / 8, p % 8);
+        }
+        bits_[l] = bits[source] ? 1.0 : 0.0;
+    }
+}
+
+void BlockBatch::evaluate(const double* vectors, double* fitness) const {
+    const DctBasis& basis = dctBasis();
+    const std::vector<int>& region = embeding_region[scheme_];
+
+    // applyVectorToBlock: shift the magnitudes of the region, keep the signs
+    alignas(64) double coefs[64][L];
+    std::memcpy(coefs, coefficients_, sizeof coefs);
+    for (size_t idx = 0; idx < region.size(); ++idx) {
+        const int pos = jpeg_zigzag[region[idx]];
+        const double* v = vectors + idx * L;
+        for (int l = 0; l < L; ++l) {
+            const double c = coefficients_[pos][l];
+            const double magnitude = std::fabs(std::fabs(c) + v[l]);
+            coefs[pos][l] = c >= 0.0 ? magnitude : -magnitude;
+        }
+    }
+
+    // Back to pixels, rounded and saturated to 8 bits
+    alignas(64) double pixels[64][L];
+    transformLanes(basis.inverse, coefs, pixels);
+    alignas(64) double squared[L] = {};
+    for (int p = 0; p < 64; ++p) {
+        for (int l = 0; l < L; ++l) {
+            const double clamped = std::min(255.0, std::max(0.0, pixels[p][l]));
+            const double rounded = (clamped + round_magic) - round_magic;
+            const double diff = rounded - pixels_[p][l];
+            pixels[p][l] = rounded;
+            squared[l] += diff * diff;
+        }
+    }
+
+    // The marked block as the extractor sees it
+    transformLanes(basis.forward, pixels, coefs);
+    alignas(64) double s1[L], s0[L];
+    regionSums(coefs, s1_region[scheme_], s1);
+    regionSums(coefs, s0_region[scheme_], s0);
+    for (int l = 0; l < L; ++l) {
+        const double mse = squared[l] / 64.0;
+        const double psnr = mse == 0.0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+        const double ratio = bits_[l] != 0.0 ? s0[l] / s1[l] : s1[l] / s0[l];
+        fitness[l] = ratio - 0.01 * psnr;
+    }
+
+    // The attacks of all lanes together, on the rounded pixels and their DCT
+    if (robustness_) {
+        alignas(64) double penalty[L];
+        robustness_->penalties(pixels, coefs, bits_, penalty);
+        for (int l = 0; l < L; ++l) fitness[l] += penalty[l];
+    }
+}
+
+/**
+ * @brief GBO::evolve on every lane at once.
+ * The vector arithmetic of a step runs over (coordinate, lane) with the lanes innermost;
+ * individuals picked per lane (random indices, best, LEO partner) are gathered into
+ * contiguous rows first, and the LEO branch and the replacement are blends under per-lane
+ * masks, so all lanes execute the same instructions.
+ */
+std::vector<OptimizerResult> LockstepGbo::run(const std::vector<LockstepLane>& lanes, int scheme) const {
+    if (lanes.empty() || lanes.size() > static_cast<size_t>(L)) {
+        throw std::invalid_argument("LockstepGbo: expected 1 to lockstep_lanes lanes");
+    }
+    std::vector<cv::Mat> blocks;
+    std::vector<unsigned char> bits;
+    for (const LockstepLane& lane : lanes) {
+        blocks.push_back(lane.block);
+        bits.push_back(lane.bit);
+    }
+    const BlockBatch batch(blocks, bits, scheme, robustness);
+    const int n = batch.dimension();
+    for (const LockstepLane& lane : lanes) {
+        for (const arma::vec& seed : lane.seeds) {
+            if (seed.n_elem != static_cast<arma::uword>(n)) {
+                throw std::invalid_argument("LockstepGbo: seed vector size does not match");
+            }
+        }
+    }
+
+    const int population_size = Population().get_population_size();
+    const double th = Population().get_th();
+    const size_t count = lanes.size();
+    auto laneOf = [&](int l) -> const LockstepLane& { return lanes[std::min(static_cast<size_t>(l), count - 1)]; };
+
+    std::array<RandomStream, L> random;
+    for (int l = 0; l < L; ++l) random[l].seed(laneOf(l).seed);
+
+    // individuals[(i * n + idx) * L + lane]
+    std::vector<double> individuals(static_cast<size_t>(population_size) * n * L);
+    auto individual = [&](int i) { return individuals.data() + static_cast<size_t>(i) * n * L; };
+    std::vector<Lanes> fitness(population_size);
+    int best[L];
+    std::vector<double> worst(static_cast<size_t>(n) * L);
+    Lanes worst_fitness;
+    size_t evaluations = 0;
+
+    // Population::initialize: seeds first, the rest uniform in [-th, th]
+    for (int i = 0; i < population_size; ++i) {
+        double* x = individual(i);
+        for (int l = 0; l < L; ++l) {
+            const std::vector<arma::vec>& seeds = laneOf(l).seeds;
+            for (int idx = 0; idx < n; ++idx) {
+                x[idx * L + l] = static_cast<size_t>(i) < seeds.size() ? std::clamp(seeds[i](idx), -th, th)
+                                                                        : 2.0 * th * random[l].uniform() - th;
+            }
+        }
+        batch.evaluate(x, fitness[i].data());
+        evaluations++;
+        for (int l = 0; l < L; ++l) {
+            if (i == 0 || fitness[i][l] < fitness[best[l]][l]) best[l] = i;
+            if (i == 0 || fitness[i][l] > worst_fitness[l]) {
+                worst_fitness[l] = fitness[i][l];
+                for (int idx = 0; idx < n; ++idx) worst[idx * L + l] = x[idx * L + l];
+            }
+        }
+    }
+
+    const size_t row = static_cast<size_t>(n) * L;
+    std::vector<double> best_x(row), xr0(row), xr1(row), xm(row), dm(row), gsr(row), x1(row), x2(row), next(row),
+        partner(row), x_rand(row);
+    GboStepDraws step;
+    StepDraws draws;
+    Lanes candidate_fitness;
+    bool interrupted = false;
+
+    for (int m = 0; m < iterations && !interrupted; ++m) {
+        const double betta = GBO::betta_min + (GBO::betta_max - GBO::betta_min) *
+            std::pow(1.0 - std::pow(static_cast<double>(m + 1) / static_cast<double>(iterations), 3.0), 2.0);
+        const double alpha = std::fabs(betta * std::sin(GBO::angle + std::sin(GBO::angle * betta)));
+
+        for (int current = 0; current < population_size; ++current) {
+            if (stop && stop()) {
+                interrupted = true;
+                break;
+            }
+            for (int l = 0; l < L; ++l) {
+                GBO::drawStep(random[l], alpha, population_size, best[l], current, th, n, x_rand.data() + l, L, step);
+                draws.set(l, step);
+            }
+
+            // Gathers: the individuals each lane picked, as contiguous rows
+            for (int idx = 0; idx < n; ++idx) {
+                const size_t o = static_cast<size_t>(idx) * L;
+                for (int l = 0; l < L; ++l) {
+                    best_x[o + l] = individual(best[l])[o + l];
+                    xr0[o + l] = individual(draws.r0[l])[o + l];
+                    xr1[o + l] = individual(draws.r1[l])[o + l];
+                    xm[o + l] = 0.25 * (xr0[o + l] + xr1[o + l] + individual(draws.r2[l])[o + l] +
+                                        individual(draws.r3[l])[o + l]);
+                    partner[o + l] = individual(draws.partner[l])[o + l];
+                }
+            }
+            const double* cur = individual(current);
+
+            for (size_t o = 0; o < row; o += L) {
+                for (int l = 0; l < L; ++l) dm[o + l] = draws.dm1[l] * draws.rho1[l] * (best_x[o + l] - xr0[o + l]);
+            }
+            gsrLanes(n, draws.rho2, best_x.data(), worst.data(), cur, xr0.data(), dm.data(), xm.data(), true,
+                     draws.gsr1, gsr.data());
+            for (size_t o = 0; o < row; o += L) {
+                for (int l = 0; l < L; ++l) {
+                    const size_t k = o + l;
+                    x1[k] = cur[k] + draws.dm2[l] * draws.rho1[l] * (best_x[k] - xr0[k]) - gsr[k];
+                    dm[k] = draws.dm3[l] * draws.rho1[l] * (xr0[k] - xr1[k]);
+                }
+            }
+            gsrLanes(n, draws.rho2, best_x.data(), worst.data(), cur, xr0.data(), dm.data(), xm.data(), false,
+                     draws.gsr2, gsr.data());
+            for (size_t o = 0; o < row; o += L) {
+                for (int l = 0; l < L; ++l) {
+                    const size_t k = o + l;
+                    x2[k] = best_x[k] + draws.dm4[l] * draws.rho1[l] * (xr0[k] - xr1[k]) - gsr[k];
+                    const double rho1 = draws.rho1_next[l];
+                    const double x3 = cur[k] - rho1 * (x2[k] - x1[k]);
+                    double x = draws.ra[l] * (draws.rb[l] * x1[k] + (1.0 - draws.rb[l]) * x2[k]) + (1.0 - draws.ra[l]) * x3;
+                    x = std::min(th, std::max(-th, x));
+
+                    // LEO, computed in every lane and kept where it fired
+                    const double x_mk = draws.l2[l] * partner[k] + (1.0 - draws.l2[l]) * x_rand[k];
+                    const double y = draws.y_next[l] ? x : best_x[k];
+                    double leo = y + draws.f1[l] * (draws.u1[l] * best_x[k] - draws.u2[l] * x_mk) +
+                                 draws.f2[l] * rho1 * (draws.u3[l] * (x2[k] - x1[k]) + draws.u2[l] * (xr0[k] - xr1[k])) * 0.5;
+                    leo = std::min(th, std::max(-th, leo));
+                    next[k] = draws.leo[l] ? leo : x;
+                }
+            }
+
+            // Population::update for every lane
+            batch.evaluate(next.data(), candidate_fitness.data());
+            evaluations++;
+            bool improved[L], worse[L];
+            for (int l = 0; l < L; ++l) {
+                improved[l] = candidate_fitness[l] < fitness[current][l];
+                worse[l] = !improved[l] && candidate_fitness[l] > worst_fitness[l];
+                if (improved[l]) {
+                    fitness[current][l] = candidate_fitness[l];
+                    if (candidate_fitness[l] < fitness[best[l]][l]) best[l] = current;
+                } else if (worse[l]) {
+                    worst_fitness[l] = candidate_fitness[l];
+                }
+            }
+            double* x = individual(current);
+            for (size_t o = 0; o < row; o += L) {
+                for (int l = 0; l < L; ++l) {
+                    x[o + l] = improved[l] ? next[o + l] : x[o + l];
+                    worst[o + l] = worse[l] ? next[o + l] : worst[o + l];
+                }
+            }
+        }
+    }
+
+    std::vector<OptimizerResult> results(count);
+    for (size_t l = 0; l < count; ++l) {
+        OptimizerResult& result = results[l];
+        result.best.set_size(n);
+        for (int idx = 0; idx < n; ++idx) result.best(idx) = individual(best[l])[idx * L + l];
+        result.best_fitness = fitness[best[l]][l];
+        result.evaluations = evaluations;
+        result.interrupted = interrupted;
+    }
+    return results;
+}
@@ -4,13 +4,21 @@
 #include "../include/launch.h"
 #include "../include/dataset_builder.h"
 #include "../include/attacks.h"
+#include "../include/attack_sweep.h"
 #include "../include/metrics.h"
 #include "../include/process_images.h"
+#include "../include/pipeline.h"
+#include "../include/daemon.h"
+#include "../include/benchmarks.h"
+#include "../include/jpeg_coefficients.h"
+#include "../include/scheme_classifier.h"
 #include <unordered_map>
 #include <limits>
 #include <algorithm>
 #include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <optional>
 
 struct MetricResult {
     double ber;
@@ -50,10 +58,555 @@ struct MetricAgg {
     }
 };
 
+// --pipeline embed|extract [--scheme N] [--threads N] [--seed S] [--iterations N]
+//            [--method gbo|analytic] [--margin M] [--warm-start none|analytic|raster|wavefront]
+//            [--optimizer gbo|de|cmaes] [--evaluations N] [--refine STEPS] [--surrogate] [--surrogate-tolerance T]
+//            [--lockstep] [--robust jpeg:70,gain:1.2,... [--robust-weight W]] [--time-budget MS] [--block-time-budget MS]
+//            [--queue N] [--images-in-flight N] [--watermark path] [--classifier model.bin] [images...]
+// Runs the staged decode/process/encode pipeline over a list of images
+// (the dataset images by default) and prints per-stage statistics.
+// With --classifier the scheme is chosen per block instead of --scheme.
+static int runPipelineCommand(int argc, char* argv[]) {
+    if (argc < 3 || (std::string(argv[2]) != "embed" && std::string(argv[2]) != "extract")) {
+        std::cerr << "Usage: main --pipeline embed|extract [--scheme N] [--threads N] [--seed S] [--iterations N] "
+                     "[--method gbo|analytic] [--margin M] [--warm-start W] [--optimizer gbo|de|cmaes] [--evaluations N] [--refine STEPS] "
+                     "[--surrogate] [--surrogate-tolerance T] [--lockstep] [--robust ATTACKS] [--robust-weight W] [--time-budget MS] [--block-time-budget MS] [--queue N] [--images-in-flight N] "
+                     "[--watermark path] [--classifier model.bin] [images...]" << std::endl;
+        return 1;
+    }
+    const bool embed = std::string(argv[2]) == "embed";
+    gbo::Config config;
+    std::string watermark_path = "images/watermark.png";
+    PipelineOptions options;
+    std::string classifier_path;
+    std::string method = "gbo";
+    std::string warm_start = "none";
+    std::string robust;
+    std::vector<std::string> inputs;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--scheme" && i + 1 < argc) {
+            config.scheme = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            config.threads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            config.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--queue" && i + 1 < argc) {
+            options.queue_capacity = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--images-in-flight" && i + 1 < argc) {
+            options.images_in_flight = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--method" && i + 1 < argc) {
+            method = argv[++i];
+        } else if (arg == "--warm-start" && i + 1 < argc) {
+            warm_start = argv[++i];
+        } else if (arg == "--margin" && i + 1 < argc) {
+            config.margin = std::atof(argv[++i]);
+        } else if (arg == "--optimizer" && i + 1 < argc) {
+            config.optimizer = argv[++i];
+        } else if (arg == "--evaluations" && i + 1 < argc) {
+            config.evaluations = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--refine" && i + 1 < argc) {
+            config.refine_steps = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--surrogate") {
+            config.surrogate = true;
+        } else if (arg == "--surrogate-tolerance" && i + 1 < argc) {
+            config.surrogate = true;
+            config.surrogate_tolerance = std::atof(argv[++i]);
+        } else if (arg == "--lockstep") {
+            config.lockstep = true;
+        } else if (arg == "--robust" && i + 1 < argc) {
+            robust = argv[++i];
+        } else if (arg == "--robust-weight" && i + 1 < argc) {
+            config.robustness_weight = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--time-budget" && i + 1 < argc) {
+            config.time_budget_ms = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--block-time-budget" && i + 1 < argc) {
+            config.block_time_budget_ms = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--watermark" && i + 1 < argc) {
+            watermark_path = argv[++i];
+        } else if (arg == "--classifier" && i + 1 < argc) {
+            classifier_path = argv[++i];
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (inputs.empty()) {
+        inputs = images;
+    }
+
+    std::vector<PipelineJob> jobs;
+    for (const auto& input : inputs) {
+        std::filesystem::path p(input);
+        std::string name = embed ? "watermarked_" + p.stem().string() + ".png"
+                                 : "extracted_watermark_" + p.stem().string() + ".png";
+        jobs.push_back({input, (p.parent_path() / name).string()});
+    }
+
+    options.on_progress = [](const PipelineReport& r) {
+        std::cout << "\rPipeline: " << r.completed + r.errors.size() << "/" << r.total
+                  << " (process queue " << r.stages[1].queue_depth << "/" << r.stages[1].queue_capacity
+                  << ", encode queue " << r.stages[2].queue_depth << "/" << r.stages[2].queue_capacity << ")"
+                  << std::flush;
+    };
+
+    try {
+        config.method = parseEmbedMethod(method);
+        config.warm_start = parseWarmStart(warm_start);
+        if (!robust.empty()) config.robustness_attacks = parseBlockAttacks(robust);
+        if (!classifier_path.empty()) {
+            config.classifier = std::make_shared<const SchemeClassifier>(SchemeClassifier::load(classifier_path));
+        }
+        PipelineReport report = embed ? runEmbedPipeline(jobs, watermark_path, config, options)
+                                      : runExtractPipeline(jobs, config, options);
+        std::cout << std::endl;
+        report.print(std::cout);
+        return report.errors.empty() ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+static DaemonOp parseDaemonOp(const std::string& name) {
+    if (name == "embed") return DaemonOp::Embed;
+    if (name == "extract") return DaemonOp::Extract;
+    if (name == "evaluate") return DaemonOp::Evaluate;
+    if (name == "ping") return DaemonOp::Ping;
+    throw std::invalid_argument("unknown operation: " + name);
+}
+
+// --serve <socket> [--workers N] [--queue N]
+static int runServeCommand(int argc, char* argv[]) {
+    DaemonOptions options;
+    if (argc > 2) options.socket_path = argv[2];
+    for (int i = 3; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--workers" && i + 1 < argc) {
+            options.workers = std::atoi(argv[++i]);
+        } else if (arg == "--queue" && i + 1 < argc) {
+            options.queue_capacity = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        }
+    }
+    return runDaemon(options);
+}
+
+// --client <socket> embed <image> <watermark> <out> | extract <image> <out> |
+//                   evaluate <original> <test> <watermark> | ping
+//          [--scheme N] [--deadline ms]
+static int runClientCommand(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: main --client <socket> embed|extract|evaluate|ping [files...] [--scheme N] [--deadline ms]" << std::endl;
+        return 1;
+    }
+    DaemonRequest request;
+    std::vector<std::string> files;
+    for (int i = 4; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--scheme" && i + 1 < argc) {
+            request.scheme = std::atoi(argv[++i]);
+        } else if (arg == "--deadline" && i + 1 < argc) {
+            request.deadline_ms = static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    try {
+        request.op = parseDaemonOp(argv[3]);
+        std::string output_path;
+        const size_t inputs = request.op == DaemonOp::Embed ? 2 : request.op == DaemonOp::Extract ? 1
+                            : request.op == DaemonOp::Evaluate ? 3 : 0;
+        const bool has_output = request.op == DaemonOp::Embed || request.op == DaemonOp::Extract;
+        if (files.size() != inputs + (has_output ? 1 : 0)) {
+            throw std::invalid_argument("wrong number of file arguments for " + std::string(argv[3]));
+        }
+        for (size_t i = 0; i < inputs; ++i) {
+            request.blobs.push_back(readFileBytes(files[i]));
+        }
+        if (has_output) output_path = files.back();
+
+        DaemonClient client(argv[2]);
+        DaemonResponse response = client.call(request);
+        std::cout << "status=" << daemonStatusName(response.status)
+                  << " queue_ms=" << response.queue_us / 1000.0
+                  << " service_ms=" << response.service_us / 1000.0;
+        if (!response.message.empty()) std::cout << " message=\"" << response.message << "\"";
+        std::cout << std::endl;
+        if (response.status != DaemonStatus::Ok) return 1;
+
+        if (has_output) {
+            writeFileBytes(output_path, response.image);
+        }
+        if (request.op == DaemonOp::Evaluate && response.values.size() == 5) {
+            std::cout << "BER : " << response.values[0] << std::endl;
+            std::cout << "PSNR: " << response.values[1] << std::endl;
+            std::cout << "SSIM: " << response.values[2] << std::endl;
+            std::cout << "NCC : " << response.values[3] << std::endl;
+            std::cout << "MSE : " << response.values[4] << std::endl;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// --load-test <socket> [--op extract] [--requests N] [--concurrency N] [--deadline ms]
+//             [--scheme N] [--image path] [--watermark path]
+static int runLoadTestCommand(int argc, char* argv[]) {
+    LoadTestOptions options;
+    if (argc > 2) options.socket_path = argv[2];
+    try {
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string arg(argv[i]);
+            std::string value(argv[i + 1]);
+            if (arg == "--op") options.op = parseDaemonOp(value);
+            else if (arg == "--requests") options.requests = std::max(1, std::atoi(value.c_str()));
+            else if (arg == "--concurrency") options.concurrency = std::max(1, std::atoi(value.c_str()));
+            else if (arg == "--deadline") options.deadline_ms = static_cast<uint32_t>(std::max(0, std::atoi(value.c_str())));
+            else if (arg == "--scheme") options.scheme = std::atoi(value.c_str());
+            else if (arg == "--image") options.image_path = value;
+            else if (arg == "--watermark") options.watermark_path = value;
+        }
+        std::cout << "Load test: " << options.requests << " x " << daemonOpName(options.op)
+                  << " over " << options.concurrency << " connections" << std::endl;
+        LoadTestReport report = runDaemonLoadTest(options);
+        report.print();
+        return report.failed == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// --jpeg embed <image.jpg> <watermark> <out.jpg> | extract <image.jpg> <out.png>
+//        [--scheme N] [--threads N] [--seed S] [--iterations N] [--method gbo|analytic] [--margin M] [--warm-start W]
+//        [--optimizer gbo|de|cmaes] [--evaluations N] [--refine STEPS] [--surrogate] [--surrogate-tolerance T]
+//        [--time-budget MS] [--block-time-budget MS]
+// Works on the quantized DCT coefficients of the JPEG; no pixel decode or re-encode
+static int runJpegCommand(int argc, char* argv[]) {
+    if (argc < 3 || (std::string(argv[2]) != "embed" && std::string(argv[2]) != "extract")) {
+        std::cerr << "Usage: main --jpeg embed <image.jpg> <watermark> <out.jpg> | extract <image.jpg> <out.png> "
+                     "[--scheme N] [--threads N] [--seed S] [--iterations N] [--method gbo|analytic] [--margin M] [--warm-start W] "
+                     "[--optimizer gbo|de|cmaes] [--evaluations N] [--refine STEPS] [--surrogate] [--surrogate-tolerance T] "
+                     "[--time-budget MS] [--block-time-budget MS]" << std::endl;
+        return 1;
+    }
+    const bool embed = std::string(argv[2]) == "embed";
+    gbo::Config config;
+    config.threads = 0;
+    std::string method = "gbo";
+    std::string warm_start = "none";
+    std::vector<std::string> files;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--scheme" && i + 1 < argc) {
+            config.scheme = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            config.threads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            config.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--method" && i + 1 < argc) {
+            method = argv[++i];
+        } else if (arg == "--warm-start" && i + 1 < argc) {
+            warm_start = argv[++i];
+        } else if (arg == "--margin" && i + 1 < argc) {
+            config.margin = std::atof(argv[++i]);
+        } else if (arg == "--optimizer" && i + 1 < argc) {
+            config.optimizer = argv[++i];
+        } else if (arg == "--evaluations" && i + 1 < argc) {
+            config.evaluations = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--refine" && i + 1 < argc) {
+            config.refine_steps = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--surrogate") {
+            config.surrogate = true;
+        } else if (arg == "--surrogate-tolerance" && i + 1 < argc) {
+            config.surrogate = true;
+            config.surrogate_tolerance = std::atof(argv[++i]);
+        } else if (arg == "--time-budget" && i + 1 < argc) {
+            config.time_budget_ms = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--block-time-budget" && i + 1 < argc) {
+            config.block_time_budget_ms = std::max(0.0, std::atof(argv[++i]));
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    try {
+        config.method = parseEmbedMethod(method);
+        config.warm_start = parseWarmStart(warm_start);
+        if (files.size() != (embed ? 3u : 2u)) {
+            throw std::invalid_argument("wrong number of file arguments for " + std::string(argv[2]));
+        }
+        JpegCoefficientImage image = JpegCoefficientImage::fromFile(files[0]);
+        if (embed) {
+            cv::Mat watermark = cv::imread(files[1], cv::IMREAD_GRAYSCALE);
+            if (watermark.empty()) {
+                throw std::runtime_error("Could not open or find the watermark: " + files[1]);
+            }
+            const WatermarkBits bits = extract_watermark_bits(watermark, watermark.rows);
+            const gbo::EmbedStats stats = gbo::embed(image, bits, config);
+            image.save(files[2]);
+            if (!stats.out_of_budget.empty()) {
+                size_t unsearched = 0, weak = 0;
+                for (const gbo::BudgetOverrun& overrun : stats.out_of_budget) {
+                    if (!overrun.searched) unsearched++;
+                    if (overrun.margin <= 0.0) weak++;
+                }
+                std::cout << stats.out_of_budget.size() << " of " << stats.blocks << " blocks ran out of time ("
+                          << unsearched << " embedded analytically, " << weak << " not decoding their bit)" << std::endl;
+            }
+        } else {
+            WatermarkBits bits(watermark_side * watermark_side);
+            gbo::extract(image, bits, config);
+            cv::imwrite(files[1], reconstruct_watermark_image(bits));
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// --extract-blind <image> <out.png> [--threads N] [--seed S]
+// Extracts the watermark without --scheme and reports which scheme was detected.
+// JPEG files (.jpg/.jpeg) are read on their DCT coefficients, like --jpeg extract.
+static int runBlindExtractCommand(int argc, char* argv[]) {
+    gbo::Config config;
+    config.threads = 0;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--threads" && i + 1 < argc) {
+            config.threads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (files.size() != 2) {
+        std::cerr << "Usage: main --extract-blind <image> <out.png> [--threads N] [--seed S]" << std::endl;
+        return 1;
+    }
+
+    try {
+        std::string extension = std::filesystem::path(files[0]).extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        gbo::BlindExtraction result;
+        if (extension == ".jpg" || extension == ".jpeg") {
+            WatermarkBits bits(watermark_side * watermark_side);
+            result = gbo::extractBlind(JpegCoefficientImage::fromFile(files[0]), bits, config);
+            cv::imwrite(files[1], reconstruct_watermark_image(bits));
+        } else {
+            cv::Mat image = cv::imread(files[0], cv::IMREAD_GRAYSCALE);
+            if (image.empty()) {
+                throw std::runtime_error("Could not open or find the image: " + files[0]);
+            }
+            cv::imwrite(files[1], extractWatermarkBlindMat(image, config, &result));
+        }
+        std::cout << "Detected scheme " << result.scheme << ", confidence " << result.confidence << std::endl;
+        for (int scheme = 0; scheme < 2; ++scheme) {
+            std::cout << "  scheme " << scheme << ": consistency " << result.consistency[scheme]
+                      << ", vote agreement " << result.agreement[scheme]
+                      << ", mean margin " << result.margin[scheme] << std::endl;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// --build-dataset [--plan attacks.plan] [--tau-max N] [--seed S] [--shard k/n|hash:k/n] [--out dir] [--resume]
+// Builds the scheme classifier dataset; the plan file lists the attacks (attack_plan.h). With
+// --shard only that part of the images is built, into --out (default dataset-shard-k-of-n), for
+// --merge-dataset. --resume continues an interrupted run from its checkpoint.
+static int runBuildDatasetCommand(int argc, char* argv[]) {
+    std::string plan_path;
+    std::string shard_spec;
+    std::string output_dir;
+    int tau_max = 2;
+    uint64_t seed = 0;
+    bool resume = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--plan" && i + 1 < argc) {
+            plan_path = argv[++i];
+        } else if (arg == "--tau-max" && i + 1 < argc) {
+            tau_max = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--shard" && i + 1 < argc) {
+            shard_spec = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else {
+            std::cerr << "Usage: main --build-dataset [--plan attacks.plan] [--tau-max N] [--seed S]"
+                         " [--shard k/n|hash:k/n] [--out dir] [--resume]" << std::endl;
+            return 1;
+        }
+    }
+    try {
+        const AttackPlan plan = plan_path.empty() ? AttackPlan::defaultPlan() : AttackPlan::load(plan_path);
+        if (shard_spec.empty()) {
+            if (!output_dir.empty()) {
+                std::cerr << "Error: --out needs --shard; a single run writes to dataset/" << std::endl;
+                return 1;
+            }
+            buildDataset(plan, tau_max, seed, resume);
+            return 0;
+        }
+        const DatasetShard shard = parseDatasetShard(shard_spec);
+        if (output_dir.empty()) {
+            output_dir = "dataset-shard-" + std::to_string(shard.index) + "-of-" + std::to_string(shard.count);
+        }
+        buildDatasetShard(plan, tau_max, shard, output_dir, seed, resume);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// --merge-dataset shard_dir... [--out dataset]
+// Merges the shards of one --build-dataset --shard run into Dir1/Dir2/Dirrand
+static int runMergeDatasetCommand(int argc, char* argv[]) {
+    std::vector<std::string> shard_dirs;
+    std::string output_dir = "dataset";
+    for (int i = 2; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--out" && i + 1 < argc) {
+            output_dir = argv[++i];
+        } else if (arg.rfind("--", 0) != 0) {
+            shard_dirs.push_back(arg);
+        } else {
+            shard_dirs.clear();
+            break;
+        }
+    }
+    if (shard_dirs.empty()) {
+        std::cerr << "Usage: main --merge-dataset shard_dir... [--out dataset]" << std::endl;
+        return 1;
+    }
+    try {
+        mergeDatasetShards(shard_dirs, output_dir);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
+// --sweep [image] [--watermark path] [--grid SPEC] [--csv out.csv] [--threads N] [--seed S]
+//         [--scheme N] [--iterations N] [--method gbo|analytic]
+// Embeds the watermark once and writes BER / PSNR / SSIM / NCC / MSE for every point of the
+// attack grid (attack_sweep.h) as CSV, to stdout without --csv.
+static int runSweepCommand(int argc, char* argv[]) {
+    gbo::Config config;
+    config.threads = 0;
+    config.seed = 1;
+    std::string image_path = "images/lenna.png";
+    std::string watermark_path = "images/watermark.png";
+    std::string grid_spec = default_sweep_grid;
+    std::string csv_path;
+    std::string method = "gbo";
+    for (int i = 2; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--watermark" && i + 1 < argc) {
+            watermark_path = argv[++i];
+        } else if (arg == "--grid" && i + 1 < argc) {
+            grid_spec = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            config.threads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--scheme" && i + 1 < argc) {
+            config.scheme = std::atoi(argv[++i]);
+        } else if (arg == "--iterations" && i + 1 < argc) {
+            config.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--method" && i + 1 < argc) {
+            method = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-') {
+            image_path = arg;
+        } else {
+            std::cerr << "Usage: main --sweep [image] [--watermark path] [--grid SPEC] [--csv out.csv] [--threads N] "
+                         "[--seed S] [--scheme N] [--iterations N] [--method gbo|analytic]" << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        config.method = parseEmbedMethod(method);
+        const std::vector<SweepAxis> grid = parseSweepGrid(grid_spec);
+        cv::Mat image = cv::imread(image_path, cv::IMREAD_GRAYSCALE);
+        cv::Mat watermark = cv::imread(watermark_path, cv::IMREAD_GRAYSCALE);
+        if (image.empty() || watermark.empty()) {
+            throw std::runtime_error("Could not read " + (image.empty() ? image_path : watermark_path));
+        }
+        image = image(cv::Rect(0, 0, image.cols / 8 * 8, image.rows / 8 * 8)).clone();
+
+        const cv::Mat watermarked = embedWatermarkMat(image, watermark, config);
+        const AttackSweep sweep(image, watermarked, extract_watermark_bits(watermark, watermark.rows), config);
+        SweepOptions options;
+        options.threads = config.threads;
+        options.seed = config.seed;
+        const std::vector<SweepPoint> points = sweep.run(grid, options);
+        if (csv_path.empty()) {
+            writeSweepCsv(std::cout, points);
+        } else {
+            std::ofstream csv(csv_path);
+            writeSweepCsv(csv, points);
+            if (!csv) {
+                throw std::runtime_error("Could not write " + csv_path);
+            }
+            std::cout << points.size() << " sweep points written to " << csv_path << std::endl;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
+
 int main(int argc, char* argv[]) {
     if (argc > 1 && std::string(argv[1]) == "--build-dataset") {
-        buildDataset();
-        return 0;
+        return runBuildDatasetCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--merge-dataset") {
+        return runMergeDatasetCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--pipeline") {
+        return runPipelineCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--serve") {
+        return runServeCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--client") {
+        return runClientCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--load-test") {
+        return runLoadTestCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--jpeg") {
+        return runJpegCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--extract-blind") {
+        return runBlindExtractCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "--sweep") {
+        return runSweepCommand(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "--bench") {
+        return runBenchmark(argv[2], std::vector<std::string>(argv + 3, argv + argc));
     }
 
     int trials = 1;
@@ -71,6 +624,8 @@ int main(int argc, char* argv[]) {
     try {
         if (trials > 1) {
             std::unordered_map<std::string, MetricAgg> agg;
+            // The original is the same in every trial: its SSIM statistics are computed once
+            std::optional<SsimReference> reference;
             for (int t = 0; t < trials; ++t) {
                 std::string wm_out    = "tmp_watermarked_" + std::to_string(t) + ".png";
                 std::string ext_base  = "tmp_extracted_base_" + std::to_string(t) + ".png";
@@ -92,41 +647,23 @@ int main(int argc, char* argv[]) {
 
                 MetricResult base;
                 base.ber  = computeBER(extract_watermark_bits(watermark_image), extract_watermark_bits(extracted_base));
-                base.psnr = computePSNR(original_image, watermarked_image);
-                base.ssim = computeSSIM(original_image, watermarked_image);
-                base.ncc  = computeNCC(original_image, watermarked_image);
-                base.mse  = computeMSE(original_image, watermarked_image);
+                if (!reference) reference.emplace(original_image);
+                const ImageQuality base_quality = computeImageQuality(*reference, watermarked_image);
+                base.psnr = base_quality.psnr;
+                base.ssim = base_quality.ssim;
+                base.ncc  = base_quality.ncc;
+                base.mse  = base_quality.mse;
 
                 agg.try_emplace("NO ATTACK", MetricAgg());
                 agg["NO ATTACK"].update(base);
 
                 // ------------ Attacks -------------
-                struct AttackInfo {
-                    std::string name;
-                    cv::Mat (*func)(const cv::Mat &, double);
-                    double param;
-                };
-
-                std::vector<AttackInfo> attacks = {
-                    {"Brightness +30", [](const cv::Mat &img, double v){return brightnessIncrease(img, static_cast<int>(v));}, 30},
-                    {"Brightness -30", [](const cv::Mat &img, double v){return brightnessDecrease(img, static_cast<int>(v));}, 30},
-                    {"Contrast *1.2",   [](const cv::Mat &img, double v){return contrastIncrease(img, v);}, 1.2},
-                    {"Contrast *0.8",   [](const cv::Mat &img, double v){return contrastDecrease(img, v);}, 0.8},
-                    {"Salt&Pepper 5%", [](const cv::Mat &img, double v){return saltPepperNoise(img, v);}, 0.05},
-                    {"Speckle 20",      [](const cv::Mat &img, double v){return speckleNoise(img, v);}, 20},
-                    {"Histogram Eq",    [](const cv::Mat &img, double){return histogramEqualization(img);}, 0},
-                    {"Sharpen",         [](const cv::Mat &img, double){return sharpening(img);}, 0},
-                    {"JPEG q=70",       [](const cv::Mat &img, double v){return jpegCompression(img, static_cast<int>(v));}, 70},
-                    {"JPEG q=80",       [](const cv::Mat &img, double v){return jpegCompression(img, static_cast<int>(v));}, 80},
-                    {"JPEG q=90",       [](const cv::Mat &img, double v){return jpegCompression(img, static_cast<int>(v));}, 90},
-                    {"Gaussian k=3",    [](const cv::Mat &img, double v){return gaussianFiltering(img, static_cast<int>(v));}, 3},
-                    {"Median k=3",      [](const cv::Mat &img, double v){return medianFiltering(img, static_cast<int>(v));}, 3},
-                    {"Average k=3",     [](const cv::Mat &img, double v){return averageFiltering(img, static_cast<int>(v));}, 3}
-                };
+                const std::vector<AttackInfo>& attacks = standardAttacks();
 
                 for (size_t idx = 0; idx < attacks.size(); ++idx) {
                     const auto &atk = attacks[idx];
-                    cv::Mat attacked = atk.func(watermarked_image, atk.param);
+                    // Each trial draws its own noise, the same on every run
+                    cv::Mat attacked = atk.apply(watermarked_image, static_cast<uint64_t>(t));
 
                     std::string attack_img_path = "tmp_attacked_" + std::to_string(t) + "_" + std::to_string(idx) + ".png";
                     std::string extracted_wm_path = "tmp_extracted_" + std::to_string(t) + "_" + std::to_string(idx) + ".png";
@@ -137,10 +674,11 @@ int main(int argc, char* argv[]) {
 
                     MetricResult m;
                     m.ber  = computeBER(extract_watermark_bits(watermark_image), extract_watermark_bits(extracted_wm));
-                    m.psnr = computePSNR(original_image, attacked);
-                    m.ssim = computeSSIM(original_image, attacked);
-                    m.ncc  = computeNCC(original_image, attacked);
-                    m.mse  = computeMSE(original_image, attacked);
+                    const ImageQuality quality = computeImageQuality(*reference, attacked);
+                    m.psnr = quality.psnr;
+                    m.ssim = quality.ssim;
+                    m.ncc  = quality.ncc;
+                    m.mse  = quality.mse;
 
                     agg.try_emplace(atk.name, MetricAgg());
                     agg[atk.name].update(m);
@@ -0,0 +1,108 @@
+// Counting wrappers around glibc's malloc family, built as the preload module
+// libgbo_malloc_counters.so (see CMakeLists.txt) so that benchmarks can report heap traffic
+// (mallocCounters() in block_arena.h) without any shipped binary carrying them. A preloaded
+// module's symbols take precedence over libc's for every shared library, OpenCV's and
+// Armadillo's allocations included. The counters are striped over cache lines so that
+// counting does not add contention of its own.
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+
+#if defined(__GLIBC__)
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* data, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* data);
+}
+
+namespace {
+
+const int stripes = 64;
+
+struct alignas(64) Stripe {
+    std::atomic<size_t> allocations{0};
+    std::atomic<size_t> frees{0};
+};
+
+Stripe counters[stripes];
+std::atomic<int> next_stripe{0};
+
+Stripe& stripe() {
+    static thread_local int index = -1;
+    if (index < 0) {
+        index = next_stripe.fetch_add(1, std::memory_order_relaxed) % stripes;
+    }
+    return counters[index];
+}
+
+void countAllocation() {
+    stripe().allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool validAlignment(size_t alignment) {
+    return alignment != 0 && (alignment & (alignment - 1)) == 0;
+}
+
+} // namespace
+
+extern "C" {
+
+void* malloc(size_t size) {
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* data, size_t size) {
+    if (data == nullptr) countAllocation();
+    return __libc_realloc(data, size);
+}
+
+void free(void* data) {
+    if (data != nullptr) stripe().frees.fetch_add(1, std::memory_order_relaxed);
+    __libc_free(data);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** data, size_t alignment, size_t size) {
+    if (!validAlignment(alignment) || alignment % sizeof(void*) != 0) {
+        return EINVAL;
+    }
+    countAllocation();
+    void* result = __libc_memalign(alignment, size);
+    if (result == nullptr) {
+        return ENOMEM;
+    }
+    *data = result;
+    return 0;
+}
+
+void gbo_malloc_counters(size_t* allocations, size_t* frees) {
+    size_t a = 0, f = 0;
+    for (const Stripe& s : counters) {
+        a += s.allocations.load(std::memory_order_relaxed);
+        f += s.frees.load(std::memory_order_relaxed);
+    }
+    *allocations = a;
+    *frees = f;
+}
+
+} // extern "C"
+#endif
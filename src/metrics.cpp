@@ -1,85 +1,341 @@
 #include "../include/metrics.h"
+#include "../include/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 
-double computeBER(const std::vector<unsigned char>& wm1, const std::vector<unsigned char>& wm2) {
-    if (wm1.size() != wm2.size())
-        throw std::invalid_argument("Watermark vectors must be the same size");
+namespace {
 
-    int errors = 0;
-    for (size_t i = 0; i < wm1.size(); ++i) {
-        if (wm1[i] != wm2[i])
-            ++errors;
+// Integer sums of one pass over two 8-bit images
+struct PixelSums {
+    uint64_t sum1 = 0, sum2 = 0;            // sum of a, of b
+    uint64_t sum11 = 0, sum22 = 0;          // of a*a, of b*b
+    uint64_t sum12 = 0, squared_diff = 0;   // of a*b, of (a-b)^2
+};
+
+// 32-bit partial sums vectorize best; 255^2 * 32768 still fits
+const size_t run_length = 32768;
+
+void accumulate(const uchar* a, const uchar* b, size_t count, PixelSums& sums) {
+    for (size_t start = 0; start < count; start += run_length) {
+        const size_t end = std::min(count, start + run_length);
+        uint32_t s1 = 0, s2 = 0, s11 = 0, s22 = 0, s12 = 0, sdd = 0;
+        for (size_t i = start; i < end; ++i) {
+            const uint32_t x = a[i], y = b[i];
+            const int32_t d = static_cast<int32_t>(x) - static_cast<int32_t>(y);
+            s1 += x;
+            s2 += y;
+            s11 += x * x;
+            s22 += y * y;
+            s12 += x * y;
+            sdd += static_cast<uint32_t>(d * d);
+        }
+        sums.sum1 += s1;
+        sums.sum2 += s2;
+        sums.sum11 += s11;
+        sums.sum22 += s22;
+        sums.sum12 += s12;
+        sums.squared_diff += sdd;
     }
+}
 
-    return static_cast<double>(errors) / wm1.size();
+PixelSums pixelSums(const cv::Mat& img1, const cv::Mat& img2) {
+    PixelSums sums;
+    const size_t row_length = static_cast<size_t>(img1.cols) * img1.channels();
+    if (img1.isContinuous() && img2.isContinuous()) {
+        accumulate(img1.data, img2.data, row_length * img1.rows, sums);
+    } else {
+        for (int y = 0; y < img1.rows; ++y) accumulate(img1.ptr<uchar>(y), img2.ptr<uchar>(y), row_length, sums);
+    }
+    return sums;
 }
 
-double computePSNR(const cv::Mat& img1, const cv::Mat& img2) {
-    double mse = computeMSE(img1, img2);
+double psnrFromMse(double mse) {
     if (mse <= 0) {
         return 0;
     }
 
     double max_pixel_value = 255.0;
-    double psnr = 10.0 * log10((max_pixel_value * max_pixel_value) / mse);
-    return psnr;
+    return 10.0 * log10((max_pixel_value * max_pixel_value) / mse);
 }
 
-double computeSSIM(const cv::Mat& img1, const cv::Mat& img2) {
-    CV_Assert(img1.size() == img2.size() && img1.type() == CV_8UC1 && img2.type() == CV_8UC1);
-
-    const double C1 = 6.5025, C2 = 58.5225;
-
+// The float path computeMSE always took, kept for images that are not 8-bit
+double floatMse(const cv::Mat& img1, const cv::Mat& img2) {
+    cv::Mat diff;
     cv::Mat img1f, img2f;
     img1.convertTo(img1f, CV_32F);
     img2.convertTo(img2f, CV_32F);
+    cv::absdiff(img1f, img2f, diff);
+    diff = diff.mul(diff);
+
+    cv::Scalar mse_scalar = cv::mean(diff);
+    int channels = img1.channels();
+    double mse;
+    if (channels == 1) {
+        mse = mse_scalar[0];
+    } else {
+        // Assume 3-channel RGB
+        mse = (mse_scalar[0] + mse_scalar[1] + mse_scalar[2]) / 3.0;
+    }
 
-    cv::Mat mu1, mu2;
-    cv::GaussianBlur(img1f, mu1, cv::Size(11, 11), 1.5);
-    cv::GaussianBlur(img2f, mu2, cv::Size(11, 11), 1.5);
+    return mse;
+}
+
+// SSIM window: 11 taps, sigma 1.5
+const int ssim_radius = 5;
+const int ssim_taps = 2 * ssim_radius + 1;
+const double ssim_sigma = 1.5;
+const double ssim_c1 = 6.5025, ssim_c2 = 58.5225;
+// Rows per parallel tile, rounded up to whole blocks of the SSIM map
+const int ssim_tile_rows = 32;
 
-    cv::Mat mu1_sq = mu1.mul(mu1);
-    cv::Mat mu2_sq = mu2.mul(mu2);
-    cv::Mat mu1_mu2 = mu1.mul(mu2);
+struct GaussianTaps {
+    GaussianTaps() {
+        const cv::Mat kernel = cv::getGaussianKernel(ssim_taps, ssim_sigma, CV_32F);
+        for (int i = 0; i < ssim_taps; ++i) taps[i] = kernel.at<float>(i);
+    }
+    float taps[ssim_taps];
+};
 
-    cv::Mat sigma1_sq, sigma2_sq, sigma12;
-    cv::GaussianBlur(img1f.mul(img1f), sigma1_sq, cv::Size(11, 11), 1.5);
-    sigma1_sq -= mu1_sq;
+const float* gaussianTaps() {
+    static const GaussianTaps instance;
+    return instance.taps;
+}
 
-    cv::GaussianBlur(img2f.mul(img2f), sigma2_sq, cv::Size(11, 11), 1.5);
-    sigma2_sq -= mu2_sq;
+cv::Mat padForWindow(const cv::Mat& image) {
+    cv::Mat floats, padded;
+    image.convertTo(floats, CV_32F);
+    cv::copyMakeBorder(floats, padded, ssim_radius, ssim_radius, ssim_radius, ssim_radius, cv::BORDER_REFLECT_101);
+    return padded;
+}
 
-    cv::GaussianBlur(img1f.mul(img2f), sigma12, cv::Size(11, 11), 1.5);
-    sigma12 -= mu1_mu2;
+} // namespace
 
-    cv::Mat t1 = 2 * mu1_mu2 + C1;
-    cv::Mat t2 = 2 * sigma12 + C2;
-    cv::Mat t3 = t1.mul(t2);
+ImageQuality MetricsEngine::compare(const cv::Mat& img1, const cv::Mat& img2, int metrics) {
+    if (img1.empty() || img1.size() != img2.size() || img1.type() != img2.type()) {
+        throw std::invalid_argument("MetricsEngine: images must be non-empty and of the same size and type");
+    }
+    if (img1.depth() != CV_8U || ((metrics & Ssim) && img1.channels() != 1)) {
+        throw std::invalid_argument("MetricsEngine: images must be 8-bit, single-channel for SSIM");
+    }
 
-    t1 = mu1_sq + mu2_sq + C1;
-    t2 = sigma1_sq + sigma2_sq + C2;
-    t1 = t1.mul(t2);
+    ImageQuality quality;
+    if (metrics & Pixel) {
+        const PixelSums sums = pixelSums(img1, img2);
+        const double n = static_cast<double>(img1.total()) * img1.channels();
+        quality.mse = static_cast<double>(sums.squared_diff) / n;
+        quality.psnr = psnrFromMse(quality.mse);
 
-    cv::Mat ssim_map;
-    cv::divide(t3, t1, ssim_map);
-    return cv::mean(ssim_map)[0];
+        // Centered sums; exact (hence 0 for a flat image) while n * 255^2 stays below 2^53
+        const double mean1 = static_cast<double>(sums.sum1) / n, mean2 = static_cast<double>(sums.sum2) / n;
+        const double covariance = static_cast<double>(sums.sum12) - mean1 * static_cast<double>(sums.sum2);
+        const double energy1 = static_cast<double>(sums.sum11) - mean1 * static_cast<double>(sums.sum1);
+        const double energy2 = static_cast<double>(sums.sum22) - mean2 * static_cast<double>(sums.sum2);
+        const double denominator = std::sqrt(std::max(0.0, energy1) * std::max(0.0, energy2));
+        quality.ncc = denominator == 0 ? 0.0 : covariance / denominator;
+    }
+    if (metrics & Ssim) {
+        quality.ssim = ssim(img1, img2);
+    }
+    return quality;
 }
 
-double computeNCC(const cv::Mat& img1, const cv::Mat& img2) {
-    CV_Assert(img1.size() == img2.size() && img1.type() == CV_8UC1 && img2.type() == CV_8UC1);
+double MetricsEngine::ssim(const cv::Mat& img1, const cv::Mat& img2) {
+    const cv::Size window(ssim_taps, ssim_taps);
+    const float c1 = static_cast<float>(ssim_c1), c2 = static_cast<float>(ssim_c2);
 
-    cv::Mat img1f, img2f;
-    img1.convertTo(img1f, CV_32F);
-    img2.convertTo(img2f, CV_32F);
+    // Every buffer keeps its size between calls on images of the same size
+    img1.convertTo(img1f_, CV_32F);
+    img2.convertTo(img2f_, CV_32F);
+    cv::GaussianBlur(img1f_, mu1_, window, ssim_sigma);
+    cv::GaussianBlur(img2f_, mu2_, window, ssim_sigma);
+    cv::multiply(img1f_, img1f_, product_);
+    cv::GaussianBlur(product_, sigma1_sq_, window, ssim_sigma);
+    cv::multiply(img2f_, img2f_, product_);
+    cv::GaussianBlur(product_, sigma2_sq_, window, ssim_sigma);
+    cv::multiply(img1f_, img2f_, product_);
+    cv::GaussianBlur(product_, sigma12_, window, ssim_sigma);
+
+    // The SSIM map is only ever averaged: sum it row by row instead of storing it
+    double sum = 0.0;
+    for (int y = 0; y < img1.rows; ++y) {
+        const float* mu1 = mu1_.ptr<float>(y);
+        const float* mu2 = mu2_.ptr<float>(y);
+        const float* s11 = sigma1_sq_.ptr<float>(y);
+        const float* s22 = sigma2_sq_.ptr<float>(y);
+        const float* s12 = sigma12_.ptr<float>(y);
+        double row = 0.0;
+        for (int x = 0; x < img1.cols; ++x) {
+            const float mu1_sq = mu1[x] * mu1[x], mu2_sq = mu2[x] * mu2[x], mu1_mu2 = mu1[x] * mu2[x];
+            const float numerator = (2.0f * mu1_mu2 + c1) * (2.0f * (s12[x] - mu1_mu2) + c2);
+            const float denominator = (mu1_sq + mu2_sq + c1) * ((s11[x] - mu1_sq) + (s22[x] - mu2_sq) + c2);
+            row += numerator / denominator;
+        }
+        sum += row;
+    }
+    return sum / static_cast<double>(img1.total());
+}
+
+ImageQuality computeImageQuality(const cv::Mat& img1, const cv::Mat& img2, int metrics) {
+    static thread_local MetricsEngine engine;
+    return engine.compare(img1, img2, metrics);
+}
+
+SsimReference::SsimReference(const cv::Mat& reference) {
+    if (reference.empty() || reference.type() != CV_8UC1 || reference.rows <= ssim_radius || reference.cols <= ssim_radius) {
+        throw std::invalid_argument("SsimReference: reference must be a CV_8UC1 image of at least 6x6 pixels");
+    }
+    image_ = reference.clone();
+    padded_ = padForWindow(image_);
+
+    cv::Mat floats, squares;
+    image_.convertTo(floats, CV_32F);
+    cv::GaussianBlur(floats, mu_, cv::Size(ssim_taps, ssim_taps), ssim_sigma);
+    cv::multiply(floats, floats, squares);
+    cv::GaussianBlur(squares, sigma_sq_, cv::Size(ssim_taps, ssim_taps), ssim_sigma);
+    sigma_sq_ -= mu_.mul(mu_);
+}
+
+double SsimReference::compare(const cv::Mat& test, int threads, cv::Mat* block_map, int block_size) const {
+    if (test.size() != image_.size() || test.type() != CV_8UC1) {
+        throw std::invalid_argument("SsimReference: test image must be CV_8UC1 of the reference's size");
+    }
+    if (block_size <= 0) {
+        throw std::invalid_argument("SsimReference: block size must be positive");
+    }
+    const int rows = image_.rows, cols = image_.cols, width = cols + 2 * ssim_radius;
+    const cv::Mat padded_test = padForWindow(test);
+    const float* taps = gaussianTaps();
+    if (block_map) {
+        block_map->create((rows + block_size - 1) / block_size, (cols + block_size - 1) / block_size, CV_64FC1);
+    }
+
+    // A tile holds whole block rows, so every map entry is written by one tile
+    const int tile_rows = (std::max(ssim_tile_rows, block_size) + block_size - 1) / block_size * block_size;
+    const size_t tiles = static_cast<size_t>((rows + tile_rows - 1) / tile_rows);
+    std::vector<double> tile_sums(tiles, 0.0);
+    parallelFor(tiles, resolveThreads(threads), [&](size_t t) {
+        const int y0 = static_cast<int>(t) * tile_rows, y1 = std::min(rows, y0 + tile_rows);
+        const int window_rows = y1 - y0 + 2 * ssim_radius;
+
+        // Horizontal pass over the tile and its halo: test mean, test square, product with the reference
+        std::vector<float> h_mu(static_cast<size_t>(window_rows) * cols), h_sq(h_mu.size()), h_cross(h_mu.size());
+        std::vector<float> squares(width), cross(width);
+        for (int r = 0; r < window_rows; ++r) {
+            const float* a = padded_.ptr<float>(y0 + r);
+            const float* b = padded_test.ptr<float>(y0 + r);
+            for (int x = 0; x < width; ++x) {
+                squares[x] = b[x] * b[x];
+                cross[x] = a[x] * b[x];
+            }
+            float* mu_row = &h_mu[static_cast<size_t>(r) * cols];
+            float* sq_row = &h_sq[static_cast<size_t>(r) * cols];
+            float* cross_row = &h_cross[static_cast<size_t>(r) * cols];
+            for (int x = 0; x < cols; ++x) {
+                float m = 0.0f, q = 0.0f, c = 0.0f;
+                for (int k = 0; k < ssim_taps; ++k) {
+                    m += taps[k] * b[x + k];
+                    q += taps[k] * squares[x + k];
+                    c += taps[k] * cross[x + k];
+                }
+                mu_row[x] = m;
+                sq_row[x] = q;
+                cross_row[x] = c;
+            }
+        }
+
+        // Vertical pass, then the SSIM of every pixel of the tile
+        std::vector<float> mu2(cols), sigma2_sq(cols), sigma12(cols);
+        std::vector<double> block_sums(block_map ? block_map->cols : 0, 0.0);
+        double tile_sum = 0.0;
+        for (int y = y0; y < y1; ++y) {
+            std::fill(mu2.begin(), mu2.end(), 0.0f);
+            std::fill(sigma2_sq.begin(), sigma2_sq.end(), 0.0f);
+            std::fill(sigma12.begin(), sigma12.end(), 0.0f);
+            for (int k = 0; k < ssim_taps; ++k) {
+                const size_t offset = static_cast<size_t>(y - y0 + k) * cols;
+                for (int x = 0; x < cols; ++x) {
+                    mu2[x] += taps[k] * h_mu[offset + x];
+                    sigma2_sq[x] += taps[k] * h_sq[offset + x];
+                    sigma12[x] += taps[k] * h_cross[offset + x];
+                }
+            }
+            const float* mu1 = mu_.ptr<float>(y);
+            const float* sigma1_sq = sigma_sq_.ptr<float>(y);
+            double row_sum = 0.0;
+            for (int x = 0; x < cols; ++x) {
+                const float mu2_sq = mu2[x] * mu2[x], mu1_mu2 = mu1[x] * mu2[x];
+                const float numerator = (2.0f * mu1_mu2 + static_cast<float>(ssim_c1)) *
+                                        (2.0f * (sigma12[x] - mu1_mu2) + static_cast<float>(ssim_c2));
+                const float denominator = (mu1[x] * mu1[x] + mu2_sq + static_cast<float>(ssim_c1)) *
+                                          (sigma1_sq[x] + (sigma2_sq[x] - mu2_sq) + static_cast<float>(ssim_c2));
+                const double value = numerator / denominator;
+                row_sum += value;
+                if (block_map) block_sums[x / block_size] += value;
+            }
+            tile_sum += row_sum;
+            if (block_map && ((y + 1) % block_size == 0 || y + 1 == rows)) {
+                const int block_rows = y % block_size + 1;
+                double* out = block_map->ptr<double>(y / block_size);
+                for (int bx = 0; bx < block_map->cols; ++bx) {
+                    const int block_cols = std::min(block_size, cols - bx * block_size);
+                    out[bx] = block_sums[bx] / (block_rows * block_cols);
+                }
+                std::fill(block_sums.begin(), block_sums.end(), 0.0);
+            }
+        }
+        tile_sums[t] = tile_sum;
+    });
+
+    // Summed in tile order: the result does not depend on the thread count
+    double sum = 0.0;
+    for (double tile_sum : tile_sums) sum += tile_sum;
+    return sum / static_cast<double>(image_.total());
+}
+
+ImageQuality computeImageQuality(const SsimReference& reference, const cv::Mat& test, int metrics, int threads) {
+    ImageQuality quality;
+    if (metrics & MetricsEngine::Pixel) {
+        quality = computeImageQuality(reference.image(), test, MetricsEngine::Pixel);
+    }
+    if (metrics & MetricsEngine::Ssim) {
+        quality.ssim = reference.compare(test, threads);
+    }
+    return quality;
+}
+
+double computeBER(const WatermarkBits& wm1, const WatermarkBits& wm2) {
+    if (wm1.size() != wm2.size())
+        throw std::invalid_argument("Watermark vectors must be the same size");
+
+    return static_cast<double>(wm1.differences(wm2)) / wm1.size();
+}
+
+double computeBER(const std::vector<unsigned char>& wm1, const std::vector<unsigned char>& wm2) {
+    if (wm1.size() != wm2.size())
+        throw std::invalid_argument("Watermark vectors must be the same size");
+
+    int errors = 0;
+    for (size_t i = 0; i < wm1.size(); ++i) {
+        if (wm1[i] != wm2[i])
+            ++errors;
+    }
+
+    return static_cast<double>(errors) / wm1.size();
+}
 
-    cv::Mat img1_zero_mean = img1f - cv::mean(img1f)[0];
-    cv::Mat img2_zero_mean = img2f - cv::mean(img2f)[0];
+double computePSNR(const cv::Mat& img1, const cv::Mat& img2) {
+    return psnrFromMse(computeMSE(img1, img2));
+}
 
-    double numerator = cv::sum(img1_zero_mean.mul(img2_zero_mean))[0];
-    double denominator = std::sqrt(cv::sum(img1_zero_mean.mul(img1_zero_mean))[0] *
-                                   cv::sum(img2_zero_mean.mul(img2_zero_mean))[0]);
+double computeSSIM(const cv::Mat& img1, const cv::Mat& img2) {
+    CV_Assert(img1.size() == img2.size() && img1.type() == CV_8UC1 && img2.type() == CV_8UC1);
+    return computeImageQuality(img1, img2, MetricsEngine::Ssim).ssim;
+}
 
-    if (denominator == 0) return 0.0;
-    return numerator / denominator;
+double computeNCC(const cv::Mat& img1, const cv::Mat& img2) {
+    CV_Assert(img1.size() == img2.size() && img1.type() == CV_8UC1 && img2.type() == CV_8UC1);
+    return computeImageQuality(img1, img2, MetricsEngine::Pixel).ncc;
 }
 
 double computeMSE(const cv::Mat& img1, const cv::Mat& img2) {
@@ -87,23 +343,8 @@ double computeMSE(const cv::Mat& img1, const cv::Mat& img2) {
         std::cerr << "Error: Images must have the same size and type." << std::endl;
         return -1;
     }
-
-    cv::Mat diff;
-    cv::Mat img1f, img2f;
-    img1.convertTo(img1f, CV_32F);
-    img2.convertTo(img2f, CV_32F);
-    cv::absdiff(img1f, img2f, diff);
-    diff = diff.mul(diff);
-
-    cv::Scalar mse_scalar = cv::mean(diff);
-    int channels = img1.channels();
-    double mse;
-    if (channels == 1) {
-        mse = mse_scalar[0];
-    } else {
-        // Assume 3-channel RGB
-        mse = (mse_scalar[0] + mse_scalar[1] + mse_scalar[2]) / 3.0;
+    if (img1.empty() || img1.depth() != CV_8U) {
+        return floatMse(img1, img2);
     }
-
-    return mse;
-}
\ No newline at end of file
+    return computeImageQuality(img1, img2, MetricsEngine::Pixel).mse;
+}
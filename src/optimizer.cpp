@@ -0,0 +1,305 @@
+#include "../include/optimizer.h"
+#include "../include/block_arena.h"
+#include "../include/gbo.h"
+#include "../include/random_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+void validateProblem(const OptimizerProblem& problem, const std::string& backend) {
+    const std::string prefix = backend + ": ";
+    if (problem.dimension <= 0) {
+        throw std::invalid_argument(prefix + "dimension must be positive");
+    }
+    if (!(problem.lower < problem.upper)) {
+        throw std::invalid_argument(prefix + "lower bound must be below the upper bound");
+    }
+    if (problem.max_evaluations == 0) {
+        throw std::invalid_argument(prefix + "evaluation budget must be positive");
+    }
+    if (!problem.fitness) {
+        throw std::invalid_argument(prefix + "empty fitness function");
+    }
+    for (const arma::vec& seed : problem.seeds) {
+        if (seed.n_elem != static_cast<arma::uword>(problem.dimension)) {
+            throw std::invalid_argument(prefix + "seed vector size does not match");
+        }
+    }
+}
+
+// Every fitness call of a backend goes through here: counts the budget and keeps the best point
+class Evaluation {
+public:
+    explicit Evaluation(const OptimizerProblem& problem) : problem(problem) {}
+
+    // Budget spent, or stopped by problem.stop (never before the first evaluation)
+    bool exhausted() {
+        if (result.evaluations + result.screened >= problem.max_evaluations) {
+            return true;
+        }
+        return result.evaluations > 0 && stopped();
+    }
+
+    bool stopped() {
+        if (problem.stop && problem.stop()) {
+            result.interrupted = true;
+        }
+        return result.interrupted;
+    }
+
+    // Surrogate value of x, 0 without a surrogate
+    double estimate(const arma::vec& x) const { return problem.surrogate ? problem.surrogate(x) : 0.0; }
+
+    // False, and counted as screened, when the surrogate rejects a candidate against its reference point
+    bool promising(double candidate_estimate, double reference_estimate) {
+        if (problem.surrogate && candidate_estimate > reference_estimate + problem.surrogate_tolerance) {
+            result.screened++;
+            return false;
+        }
+        return true;
+    }
+
+    double operator()(const arma::vec& x) {
+        const double value = problem.fitness(x);
+        result.evaluations++;
+        if (value < result.best_fitness) {
+            result.best_fitness = value;
+            result.best = x;
+        }
+        return value;
+    }
+
+    const OptimizerProblem& problem;
+    OptimizerResult result;
+};
+
+// Starting point i: the i-th seed, or uniform in the box once the seeds run out
+arma::vec initialPoint(const OptimizerProblem& problem, size_t i) {
+    if (i < problem.seeds.size()) {
+        return arma::clamp(problem.seeds[i], problem.lower, problem.upper);
+    }
+    arma::vec x;
+    x.randu(problem.dimension);
+    return problem.lower + (problem.upper - problem.lower) * x;
+}
+
+} // namespace
+
+/**
+ * @brief Runs GBO with as many iterations as the budget pays for.
+ * An iteration evaluates every individual once, so the budget buys
+ * (max_evaluations - population_size) / population_size iterations; the remainder is not spent.
+ * With the default box [-th, th] and a budget of population_size * (iterations + 1) this is
+ * exactly the embedder's GBO run. With a surrogate the population screens its candidates
+ * (Population::setSurrogate) and the iteration count stays the same.
+ */
+OptimizerResult GboOptimizer::minimize(const OptimizerProblem& problem) {
+    validateProblem(problem, "GboOptimizer");
+    const size_t population_size = static_cast<size_t>(Population().get_population_size());
+    if (problem.max_evaluations < population_size) {
+        throw std::invalid_argument("GboOptimizer: evaluation budget is smaller than the population");
+    }
+
+    // GBO searches [-th, th]; an affine map puts that onto the problem's box
+    const double th = Population().get_th();
+    const double center = 0.5 * (problem.lower + problem.upper);
+    const double scale = 0.5 * (problem.upper - problem.lower) / th;
+    std::vector<arma::vec> seeds;
+    for (const arma::vec& seed : problem.seeds) seeds.push_back((seed - center) / scale);
+
+    Evaluation evaluation(problem);
+    GBO optimizer(static_cast<int>((problem.max_evaluations - population_size) / population_size));
+    // The mapped vector is scratch memory: the objectives copy what they keep
+    auto mapped = [&](const arma::vec& x, const FitnessOracle& objective) {
+        ArenaScope scope;
+        arma::vec y = BlockArena::local().vec(x.n_elem);
+        y = center + scale * x;
+        return objective(y);
+    };
+    const FitnessOracle evaluate = [&](const arma::vec& y) { return evaluation(y); };
+    Population population(problem.dimension, [&](const arma::vec& x) {
+        return mapped(x, evaluate);
+    }, seeds);
+    if (problem.surrogate) {
+        population.setSurrogate([&](const arma::vec& x) {
+            return mapped(x, problem.surrogate);
+        }, problem.surrogate_tolerance);
+    }
+    optimizer.stop = [&] { return evaluation.stopped(); };
+    optimizer.evolve(population);
+    evaluation.result.screened = population.screened;
+    return evaluation.result;
+}
+
+/**
+ * @brief DE/rand/1/bin: every individual competes with a trial vector mixed from the
+ * difference of two random individuals added to a third; the trial replaces it when not worse.
+ * Trial vectors are clamped to the box, like GBO's candidates. With a surrogate, a trial
+ * predicted worse than its target is dropped without an exact evaluation.
+ */
+OptimizerResult DifferentialEvolution::minimize(const OptimizerProblem& problem) {
+    validateProblem(problem, "DifferentialEvolution");
+    if (population_size < 4) {
+        throw std::invalid_argument("DifferentialEvolution: population_size must be at least 4");
+    }
+    Evaluation evaluation(problem);
+    std::vector<arma::vec> individuals;
+    std::vector<double> fitness, estimates;
+    for (int i = 0; i < population_size && !evaluation.exhausted(); ++i) {
+        individuals.push_back(initialPoint(problem, i));
+        fitness.push_back(evaluation(individuals.back()));
+        estimates.push_back(evaluation.estimate(individuals.back()));
+    }
+
+    const int size = static_cast<int>(individuals.size());
+    const int n = problem.dimension;
+    while (size >= 4 && !evaluation.exhausted()) {
+        for (int i = 0; i < size && !evaluation.exhausted(); ++i) {
+            int r1, r2, r3;
+            do r1 = random_index(size); while (r1 == i);
+            do r2 = random_index(size); while (r2 == i || r2 == r1);
+            do r3 = random_index(size); while (r3 == i || r3 == r1 || r3 == r2);
+
+            // At least one coordinate always comes from the mutant
+            arma::vec trial = individuals[i];
+            const int forced = random_index(n);
+            for (int j = 0; j < n; ++j) {
+                if (j == forced || uniform_random_0_1() < crossover) {
+                    trial(j) = individuals[r1](j) + weight * (individuals[r2](j) - individuals[r3](j));
+                }
+            }
+            trial = arma::clamp(trial, problem.lower, problem.upper);
+            const double estimate = evaluation.estimate(trial);
+            if (!evaluation.promising(estimate, estimates[i])) {
+                continue;
+            }
+            const double value = evaluation(trial);
+            if (value <= fitness[i]) {
+                individuals[i] = trial;
+                fitness[i] = value;
+                estimates[i] = estimate;
+            }
+        }
+    }
+    return evaluation.result;
+}
+
+/**
+ * @brief Standard CMA-ES (Hansen's tutorial settings): rank-one and rank-mu covariance
+ * updates with cumulative step-size adaptation. Samples are clamped to the box and the
+ * clamped points drive the update. The seeds are evaluated first and the best one is the
+ * initial mean (the box center without seeds). The run ends early when the step size collapses.
+ */
+OptimizerResult CmaEs::minimize(const OptimizerProblem& problem) {
+    validateProblem(problem, "CmaEs");
+    const int n = problem.dimension;
+    const double dim = static_cast<double>(n);
+    const int offspring = lambda > 0 ? lambda : 4 + static_cast<int>(3.0 * std::log(dim));
+    if (offspring < 2) {
+        throw std::invalid_argument("CmaEs: lambda must be at least 2");
+    }
+    const int mu = offspring / 2;
+
+    arma::vec weights(mu);
+    for (int i = 0; i < mu; ++i) weights(i) = std::log(mu + 0.5) - std::log(i + 1.0);
+    weights /= arma::accu(weights);
+    const double mueff = 1.0 / arma::dot(weights, weights);
+    const double cc = (4.0 + mueff / dim) / (dim + 4.0 + 2.0 * mueff / dim);
+    const double cs = (mueff + 2.0) / (dim + mueff + 5.0);
+    const double c1 = 2.0 / ((dim + 1.3) * (dim + 1.3) + mueff);
+    const double cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((dim + 2.0) * (dim + 2.0) + mueff));
+    const double damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (dim + 1.0)) - 1.0) + cs;
+    const double chi_n = std::sqrt(dim) * (1.0 - 1.0 / (4.0 * dim) + 1.0 / (21.0 * dim * dim));
+
+    Evaluation evaluation(problem);
+    arma::vec mean = arma::zeros<arma::vec>(n) + 0.5 * (problem.lower + problem.upper);
+    double best_seed = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < problem.seeds.size() && !evaluation.exhausted(); ++i) {
+        const arma::vec seed = initialPoint(problem, i);
+        const double value = evaluation(seed);
+        if (value < best_seed) {
+            best_seed = value;
+            mean = seed;
+        }
+    }
+
+    double sigma = initial_step * (problem.upper - problem.lower);
+    arma::mat covariance = arma::eye<arma::mat>(n, n);
+    arma::mat basis = arma::eye<arma::mat>(n, n);   // eigenvectors of the covariance
+    arma::vec scales = arma::ones<arma::vec>(n);    // square roots of its eigenvalues
+    arma::vec path_c = arma::zeros<arma::vec>(n), path_s = arma::zeros<arma::vec>(n);
+    std::vector<arma::vec> samples(offspring);
+    std::vector<double> values(offspring);
+    std::vector<int> order(offspring);
+
+    for (int generation = 1; !evaluation.exhausted(); ++generation) {
+        int produced = 0;
+        for (; produced < offspring && !evaluation.exhausted(); ++produced) {
+            const arma::vec z = arma::randn<arma::vec>(n);
+            samples[produced] = arma::clamp(arma::vec(mean + sigma * (basis * (scales % z))), problem.lower, problem.upper);
+            values[produced] = evaluation(samples[produced]);
+        }
+        if (produced < offspring) {
+            break;  // the budget ran out inside the generation
+        }
+
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b) { return values[a] < values[b]; });
+        const arma::vec old_mean = mean;
+        mean.zeros(n);
+        for (int i = 0; i < mu; ++i) mean += weights(i) * samples[order[i]];
+
+        const arma::vec step = (mean - old_mean) / sigma;
+        // C^(-1/2) * step through the eigendecomposition C = B diag(D^2) B^T
+        const arma::vec whitened = basis * ((basis.t() * step) / scales);
+        path_s = (1.0 - cs) * path_s + std::sqrt(cs * (2.0 - cs) * mueff) * whitened;
+        const double ps_norm = arma::norm(path_s);
+        const bool hsig = ps_norm / std::sqrt(1.0 - std::pow(1.0 - cs, 2.0 * generation)) / chi_n < 1.4 + 2.0 / (dim + 1.0);
+        path_c = (1.0 - cc) * path_c + (hsig ? std::sqrt(cc * (2.0 - cc) * mueff) : 0.0) * step;
+
+        arma::mat rank_mu = arma::zeros<arma::mat>(n, n);
+        for (int i = 0; i < mu; ++i) {
+            const arma::vec y = (samples[order[i]] - old_mean) / sigma;
+            rank_mu += weights(i) * (y * y.t());
+        }
+        covariance = (1.0 - c1 - cmu) * covariance
+                     + c1 * (path_c * path_c.t() + (hsig ? 0.0 : cc * (2.0 - cc)) * covariance)
+                     + cmu * rank_mu;
+        covariance = arma::symmatu(covariance);
+        sigma *= std::exp((cs / damps) * (ps_norm / chi_n - 1.0));
+
+        arma::vec eigenvalues;
+        if (!arma::eig_sym(eigenvalues, basis, covariance)) {
+            break;
+        }
+        scales = arma::sqrt(arma::clamp(eigenvalues, 1e-20, arma::datum::inf));
+        if (sigma * scales.max() < 1e-12 * (problem.upper - problem.lower)) {
+            break;
+        }
+    }
+    return evaluation.result;
+}
+
+const std::vector<std::string>& optimizerNames() {
+    static const std::vector<std::string> names = {"gbo", "de", "cmaes"};
+    return names;
+}
+
+std::unique_ptr<Optimizer> makeOptimizer(const std::string& name) {
+    if (name == "gbo") return std::make_unique<GboOptimizer>();
+    if (name == "de") return std::make_unique<DifferentialEvolution>();
+    if (name == "cmaes") return std::make_unique<CmaEs>();
+    throw std::invalid_argument("unknown optimizer '" + name + "' (expected gbo, de or cmaes)");
+}
+
+Optimizer& threadOptimizer(const std::string& name) {
+    // minimize() keeps its state in locals, so one backend per name and thread serves every block
+    static thread_local std::unordered_map<std::string, std::unique_ptr<Optimizer>> backends;
+    std::unique_ptr<Optimizer>& backend = backends[name];
+    if (!backend) backend = makeOptimizer(name);
+    return *backend;
+}
@@ -0,0 +1,293 @@
+#include "../include/parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsBetween(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+std::atomic<Schedule> current_schedule{Schedule::Stealing};
+
+std::mutex stats_mutex;
+SchedulerStats totals;
+
+// Indices [begin, end) of one chunk; its thread takes them from the front, thieves from the back
+struct Chunk {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+    bool claimed = false;   // Static: some thread runs this chunk
+};
+
+// One parallelFor call. Participant p starts on chunk p; the caller is participant 0.
+struct Job {
+    Job(size_t count, size_t slots, Schedule schedule, const std::function<void(size_t)>& fn)
+        : fn(fn), schedule(schedule), chunks(slots) {
+        const size_t size = (count + slots - 1) / slots;
+        for (size_t p = 0; p < slots; ++p) {
+            chunks[p].begin = std::min(count, p * size);
+            chunks[p].end = std::min(count, (p + 1) * size);
+        }
+    }
+
+    const std::function<void(size_t)>& fn;
+    const Schedule schedule;
+    std::vector<Chunk> chunks;
+    std::atomic<bool> failed{false};
+    std::atomic<size_t> tasks{0}, steals{0};
+    std::atomic<double> busy_ms{0.0};
+
+    std::mutex mutex;               // guards everything below
+    std::condition_variable done;
+    size_t joined = 1;              // participants so far, the caller included
+    size_t active = 1;              // participants that have not left yet
+    std::exception_ptr error;
+    std::vector<Clock::time_point> ran_dry;     // when each participant found no more work
+    Clock::time_point finished;
+};
+
+bool takeFront(Job& job, Chunk& chunk, size_t* index) {
+    std::lock_guard<std::mutex> lock(chunk.mutex);
+    if (job.failed || chunk.begin >= chunk.end) {
+        return false;
+    }
+    *index = chunk.begin++;
+    return true;
+}
+
+// Moves the back half of the fullest chunk into `home`; false when no work is left anywhere
+bool steal(Job& job, Chunk& home) {
+    while (!job.failed) {
+        Chunk* victim = nullptr;
+        size_t most = 0;
+        for (Chunk& chunk : job.chunks) {
+            std::lock_guard<std::mutex> lock(chunk.mutex);
+            if (chunk.begin < chunk.end && chunk.end - chunk.begin > most) {
+                most = chunk.end - chunk.begin;
+                victim = &chunk;
+            }
+        }
+        if (victim == nullptr) {
+            return false;
+        }
+        size_t begin = 0, end = 0;
+        {
+            std::lock_guard<std::mutex> lock(victim->mutex);
+            if (victim->begin >= victim->end) {
+                continue;   // emptied meanwhile, look again
+            }
+            end = victim->end;
+            begin = end - (end - victim->begin + 1) / 2;
+            victim->end = begin;
+        }
+        std::lock_guard<std::mutex> lock(home.mutex);
+        home.begin = begin;
+        home.end = end;
+        job.steals++;
+        return true;
+    }
+    return false;
+}
+
+void runChunk(Job& job, Chunk& chunk) {
+    size_t index;
+    while (takeFront(job, chunk, &index)) {
+        const Clock::time_point start = Clock::now();
+        try {
+            job.fn(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (!job.error) job.error = std::current_exception();
+            job.failed = true;
+        }
+        // No fetch_add for atomic<double> before C++20
+        const double ms = millisecondsBetween(start, Clock::now());
+        double busy = job.busy_ms.load();
+        while (!job.busy_ms.compare_exchange_weak(busy, busy + ms)) {}
+        job.tasks++;
+    }
+}
+
+bool claim(Chunk& chunk) {
+    std::lock_guard<std::mutex> lock(chunk.mutex);
+    if (chunk.claimed) {
+        return false;
+    }
+    chunk.claimed = true;
+    return true;
+}
+
+void participate(Job& job, size_t p) {
+    Chunk& home = job.chunks[p];
+    if (job.schedule == Schedule::Static) {
+        // The own chunk, then whole chunks of participants that have not arrived
+        if (claim(home)) runChunk(job, home);
+        for (Chunk& chunk : job.chunks) {
+            if (claim(chunk)) runChunk(job, chunk);
+        }
+    } else {
+        do {
+            runChunk(job, home);
+        } while (steal(job, home));
+    }
+}
+
+void leave(Job& job) {
+    std::lock_guard<std::mutex> lock(job.mutex);
+    const Clock::time_point now = Clock::now();
+    job.ran_dry.push_back(now);
+    if (--job.active == 0) {
+        job.finished = now;
+        job.done.notify_all();
+    }
+}
+
+// hardware_concurrency - 1 persistent workers; a parallelFor caller is the remaining thread
+class Pool {
+public:
+    Pool() {
+        const int workers = resolveThreads(0) - 1;
+        for (int t = 0; t < workers; ++t) threads_.emplace_back([this] { workerLoop(); });
+    }
+
+    ~Pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_) thread.join();
+    }
+
+    void run(Job& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(&job);
+        }
+        for (size_t p = 1; p < job.chunks.size(); ++p) wake_.notify_one();
+
+        participate(job, 0);
+        {
+            // No one joins after this; the participants already in still have to leave
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.erase(std::remove(jobs_.begin(), jobs_.end(), &job), jobs_.end());
+        }
+        leave(job);
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.done.wait(lock, [&] { return job.active == 0; });
+    }
+
+private:
+    void workerLoop() {
+        while (true) {
+            Job* job = nullptr;
+            size_t p = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()) {
+                    return;
+                }
+                // Newest first: a nested call blocks the thread that made it until it is done
+                job = jobs_.back();
+                std::lock_guard<std::mutex> job_lock(job->mutex);
+                p = job->joined++;
+                job->active++;
+                if (job->joined == job->chunks.size()) jobs_.pop_back();
+            }
+            participate(*job, p);
+            leave(*job);
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::vector<Job*> jobs_;    // calls that still take participants
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
+
+Pool& pool() {
+    static Pool instance;
+    return instance;
+}
+
+// OpenCV's pool would compete with ours for the same cores: keep it at one thread while
+// any multi-threaded parallelFor runs
+class OpenCvThreadsGuard {
+public:
+    OpenCvThreadsGuard() {
+        std::lock_guard<std::mutex> lock(mutex());
+        if (active()++ == 0) {
+            saved() = cv::getNumThreads();
+            cv::setNumThreads(1);
+        }
+    }
+    ~OpenCvThreadsGuard() {
+        std::lock_guard<std::mutex> lock(mutex());
+        if (--active() == 0) cv::setNumThreads(saved());
+    }
+
+private:
+    static std::mutex& mutex() { static std::mutex m; return m; }
+    static int& active() { static int count = 0; return count; }
+    static int& saved() { static int threads = 0; return threads; }
+};
+
+} // namespace
+
+int resolveThreads(int threads) {
+    if (threads > 0) return threads;
+    return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+void parallelFor(size_t count, int threads, const std::function<void(size_t)>& fn) {
+    const size_t slots = std::min(static_cast<size_t>(std::max(1, threads)), count);
+    if (slots <= 1) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    OpenCvThreadsGuard opencv_threads;
+    Job job(count, slots, schedule(), fn);
+    pool().run(job);
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        totals.jobs++;
+        totals.tasks += job.tasks;
+        totals.steals += job.steals;
+        totals.busy_ms += job.busy_ms;
+        for (Clock::time_point dry : job.ran_dry) totals.tail_idle_ms += millisecondsBetween(dry, job.finished);
+    }
+    if (job.error) std::rethrow_exception(job.error);
+}
+
+void setSchedule(Schedule value) {
+    current_schedule = value;
+}
+
+Schedule schedule() {
+    return current_schedule;
+}
+
+SchedulerStats schedulerStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return totals;
+}
+
+void resetSchedulerStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    totals = SchedulerStats();
+}
@@ -0,0 +1,228 @@
+#include "../include/pipeline.h"
+#include "../include/launch.h"
+#include "../include/parallel.h"
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct PipelineItem {
+    size_t index = 0;
+    cv::Mat image;
+    std::string error;
+};
+
+enum Stage { DECODE = 0, PROCESS = 1, ENCODE = 2 };
+
+// Shared, mutex-protected view of the stage counters so that snapshots can be taken mid-run
+class StageMonitor {
+public:
+    StageMonitor(size_t total, const BoundedQueue<PipelineItem>& decoded, const BoundedQueue<PipelineItem>& processed)
+        : decoded_(decoded), processed_(processed) {
+        report_.total = total;
+        report_.stages.resize(3);
+        report_.stages[DECODE].name = "decode";
+        report_.stages[PROCESS].name = "process";
+        report_.stages[ENCODE].name = "encode";
+        report_.stages[PROCESS].queue_capacity = decoded.capacity();
+        report_.stages[ENCODE].queue_capacity = processed.capacity();
+    }
+
+    void addBusy(Stage stage, double seconds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        report_.stages[stage].busy_seconds += seconds;
+    }
+    void addWait(Stage stage, double seconds) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        report_.stages[stage].wait_seconds += seconds;
+    }
+    void finishItem(Stage stage, const std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        report_.stages[stage].items++;
+        if (!error.empty()) {
+            report_.stages[stage].failures++;
+        }
+    }
+    void complete(const std::string& error) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error.empty()) {
+            report_.completed++;
+        } else {
+            report_.errors.push_back(error);
+        }
+    }
+
+    PipelineReport snapshot(double wall_seconds) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PipelineReport copy = report_;
+        copy.wall_seconds = wall_seconds;
+        fillQueue(copy.stages[PROCESS], decoded_);
+        fillQueue(copy.stages[ENCODE], processed_);
+        return copy;
+    }
+
+private:
+    static void fillQueue(StageStats& stats, const BoundedQueue<PipelineItem>& queue) {
+        stats.queue_depth = queue.size();
+        stats.queue_max_depth = queue.maxDepth();
+        stats.queue_mean_depth = queue.meanDepth();
+    }
+
+    mutable std::mutex mutex_;
+    PipelineReport report_;
+    const BoundedQueue<PipelineItem>& decoded_;
+    const BoundedQueue<PipelineItem>& processed_;
+};
+
+} // namespace
+
+void PipelineReport::print(std::ostream& os) const {
+    os << "Pipeline: " << completed << "/" << total << " images in "
+       << std::fixed << std::setprecision(2) << wall_seconds << " s" << std::endl;
+    for (const auto& st : stages) {
+        os << "  " << std::left << std::setw(8) << st.name << std::right
+           << " items=" << st.items
+           << " failed=" << st.failures
+           << " busy=" << std::setprecision(2) << st.busy_seconds << "s"
+           << " wait=" << st.wait_seconds << "s"
+           << " throughput=" << std::setprecision(3) << st.throughput() << " img/s";
+        if (st.queue_capacity > 0) {
+            os << " queue=" << st.queue_depth << "/" << st.queue_capacity
+               << " max=" << st.queue_max_depth
+               << " mean=" << std::setprecision(2) << st.queue_mean_depth;
+        }
+        os << std::endl;
+    }
+    for (const auto& err : errors) {
+        os << "  error: " << err << std::endl;
+    }
+}
+
+PipelineReport runImagePipeline(const std::vector<PipelineJob>& jobs,
+                                const std::function<cv::Mat(const cv::Mat&)>& process,
+                                const PipelineOptions& options) {
+    BoundedQueue<PipelineItem> decoded(options.queue_capacity);
+    BoundedQueue<PipelineItem> processed(options.queue_capacity);
+    StageMonitor monitor(jobs.size(), decoded, processed);
+    const Clock::time_point start = Clock::now();
+
+    // Stage 1: read and decode images in job order
+    std::thread decoder([&] {
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            Clock::time_point t0 = Clock::now();
+            PipelineItem item;
+            item.index = i;
+            item.image = cv::imread(jobs[i].input_path, cv::IMREAD_GRAYSCALE);
+            if (item.image.empty()) {
+                item.error = "Could not open or find the image: " + jobs[i].input_path;
+            }
+            monitor.addBusy(DECODE, secondsSince(t0));
+            monitor.finishItem(DECODE, item.error);
+
+            t0 = Clock::now();
+            bool accepted = decoded.push(std::move(item));
+            monitor.addWait(DECODE, secondsSince(t0));
+            if (!accepted) break;
+        }
+        decoded.close();
+    });
+
+    // Stage 2: the expensive per-image work (GBO for embedding); every image in flight runs
+    // this loop as one task of the shared pool
+    std::thread worker([&] {
+        const int in_flight = std::max(1, options.images_in_flight);
+        parallelFor(static_cast<size_t>(in_flight), in_flight, [&](size_t) {
+            PipelineItem item;
+            while (true) {
+                Clock::time_point t0 = Clock::now();
+                if (!decoded.pop(item)) break;
+                monitor.addWait(PROCESS, secondsSince(t0));
+
+                t0 = Clock::now();
+                if (item.error.empty()) {
+                    try {
+                        item.image = process(item.image);
+                    } catch (const std::exception& e) {
+                        item.error = jobs[item.index].input_path + ": " + e.what();
+                        item.image.release();
+                    }
+                }
+                monitor.addBusy(PROCESS, secondsSince(t0));
+                monitor.finishItem(PROCESS, item.error);
+
+                t0 = Clock::now();
+                bool accepted = processed.push(std::move(item));
+                monitor.addWait(PROCESS, secondsSince(t0));
+                if (!accepted) break;
+            }
+        });
+        processed.close();
+    });
+
+    // Stage 3 runs on the calling thread: encode and write results. An exception here (from
+    // on_progress) stops the other stages, which finish the items they hold, before it reaches the caller.
+    try {
+        PipelineItem item;
+        while (true) {
+            Clock::time_point t0 = Clock::now();
+            if (!processed.pop(item)) break;
+            monitor.addWait(ENCODE, secondsSince(t0));
+
+            t0 = Clock::now();
+            if (item.error.empty()) {
+                try {
+                    if (!cv::imwrite(jobs[item.index].output_path, item.image)) {
+                        item.error = "Could not write image: " + jobs[item.index].output_path;
+                    }
+                } catch (const cv::Exception& e) {
+                    item.error = jobs[item.index].output_path + ": " + e.what();
+                }
+            }
+            monitor.addBusy(ENCODE, secondsSince(t0));
+            monitor.finishItem(ENCODE, item.error);
+            monitor.complete(item.error);
+
+            if (options.on_progress) {
+                options.on_progress(monitor.snapshot(secondsSince(start)));
+            }
+        }
+    } catch (...) {
+        decoded.close();
+        processed.close();
+        decoder.join();
+        worker.join();
+        throw;
+    }
+
+    decoder.join();
+    worker.join();
+    return monitor.snapshot(secondsSince(start));
+}
+
+PipelineReport runEmbedPipeline(const std::vector<PipelineJob>& jobs,
+                                const std::string& watermark_path,
+                                const gbo::Config& config,
+                                const PipelineOptions& options) {
+    cv::Mat watermark = cv::imread(watermark_path, cv::IMREAD_GRAYSCALE);
+    if (watermark.empty()) {
+        throw std::runtime_error("Could not open or find the watermark: " + watermark_path);
+    }
+    return runImagePipeline(jobs, [&](const cv::Mat& image) {
+        return embedWatermarkMat(image, watermark, config);
+    }, options);
+}
+
+PipelineReport runExtractPipeline(const std::vector<PipelineJob>& jobs,
+                                  const gbo::Config& config,
+                                  const PipelineOptions& options) {
+    return runImagePipeline(jobs, [&config](const cv::Mat& image) {
+        return extractWatermarkMat(image, config);
+    }, options);
+}
@@ -1,4 +1,5 @@
 #include "../include/population.h"
+#include "../include/random_utils.h"
 
 /**
  * 
@@ -7,7 +8,8 @@
     * @param vec Input vector of size 22, containing the values to be applied to the block.
     * @param bit The bit to be used in the fitness calculation (0 or
  */
-Population::Population(int vector_size, const cv::Mat& block, unsigned char bit, int scheme) : vector_size(vector_size), block(block), bit(bit), scheme(scheme) {
+Population::Population(int vector_size, const cv::Mat& block, unsigned char bit, int scheme,
+                       const std::vector<arma::vec>& seeds) : vector_size(vector_size), block(block), bit(bit), scheme(scheme) {
     if (block.empty()) {
         throw std::invalid_argument("Population: empty block");
     }
@@ -18,13 +20,46 @@ Population::Population(int vector_size, const cv::Mat& block, unsigned char bit,
         throw std::invalid_argument("Population: block must be CV_8UC1");
     }
 
+    fitness = [block, bit, scheme](const arma::vec& vec) { return calcFitnessValue(block, vec, bit, scheme); };
+    initialize(seeds);
+}
+
+/**
+ * @brief Creates a population for an arbitrary objective, e.g. one evaluated in the JPEG coefficient domain.
+ * @param vector_size Dimension of the candidate vectors.
+ * @param fitness Objective to minimise.
+ * @param seeds Warm-start vectors for the first individuals.
+ */
+Population::Population(int vector_size, FitnessFunction fitness, const std::vector<arma::vec>& seeds)
+    : vector_size(vector_size), bit(0), scheme(0), fitness(std::move(fitness)) {
+    if (!this->fitness) {
+        throw std::invalid_argument("Population: empty fitness function");
+    }
+    initialize(seeds);
+}
+
+/**
+ * @brief Fills the population: warm-start seeds first (at most population_size), the rest uniformly in [-th, th].
+ */
+void Population::initialize(const std::vector<arma::vec>& seeds) {
     individuals.resize(population_size, arma::vec(vector_size));
     fitness_values.resize(population_size, 0.0);
+    auto create = [&](int i) {
+        if (static_cast<size_t>(i) < seeds.size()) {
+            if (seeds[i].n_elem != static_cast<arma::uword>(vector_size)) {
+                throw std::invalid_argument("Population: seed vector size does not match");
+            }
+            individuals[i] = arma::clamp(seeds[i], -th, th);
+        } else {
+            // From the thread's RandomStream, like every other draw of GBO
+            RandomStream& random = threadRandom();
+            for (int idx = 0; idx < vector_size; ++idx) individuals[i](idx) = 2.0 * th * random.uniform() - th;
+        }
+    };
 
     // Initialize the first individual
-    individuals[0].randu(vector_size);
-    individuals[0] = 2.0 * th * individuals[0] - th;
-    fitness_values[0] = calcFitnessValue(block, individuals[0], bit, scheme);
+    create(0);
+    fitness_values[0] = fitness(individuals[0]);
 
     // Set initial best and worst
     indexOfBestIndividual = 0;
@@ -33,9 +68,8 @@ Population::Population(int vector_size, const cv::Mat& block, unsigned char bit,
 
     // Iterate through the rest of the population
     for (int i = 1; i < population_size; ++i) {
-        individuals[i].randu(vector_size); 
-        individuals[i] = 2.0 * th * individuals[i] - th;
-        fitness_values[i] = calcFitnessValue(block, individuals[i], bit, scheme);
+        create(i);
+        fitness_values[i] = fitness(individuals[i]);
         if (fitness_values[i] < fitness_values[indexOfBestIndividual]) {
             indexOfBestIndividual = i;
         }
@@ -54,10 +88,28 @@ Population::Population(int vector_size, const cv::Mat& block, unsigned char bit,
  * @param index The index of the individual to be updated.
  */
 void Population::update(arma::vec& vec, int index) {
-    double fitness_value = calcFitnessValue(block, vec, bit, scheme);
+    double surrogate_value = 0.0;
+    if (surrogate) {
+        surrogate_value = surrogate(vec);
+        if (surrogate_value > surrogate_values[index] + surrogate_tolerance) {
+            screened++;
+            // The candidate still counts for the worst individual, with its fitness estimated
+            // from the individual's exact value and the surrogate difference
+            const double estimate = fitness_values[index] + (surrogate_value - surrogate_values[index]);
+            if (estimate > worstFitnessValue) {
+                worstIndividual = vec;
+                worstFitnessValue = estimate;
+            }
+            return;
+        }
+    }
+    double fitness_value = fitness(vec);
     if (fitness_value < fitness_values[index]) {
         individuals[index] = vec;
         fitness_values[index] = fitness_value;
+        if (surrogate) {
+            surrogate_values[index] = surrogate_value;
+        }
         if (fitness_value < fitness_values[indexOfBestIndividual]) {
             indexOfBestIndividual = index;
         }
@@ -66,4 +118,18 @@ void Population::update(arma::vec& vec, int index) {
         worstIndividual = vec;
         worstFitnessValue = fitness_value;
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Enables candidate screening with a surrogate model of the fitness.
+ * @param surrogate Cheap estimate of the fitness; only differences between its values are used.
+ * @param tolerance How much worse than the current individual a candidate may look and still be evaluated.
+ */
+void Population::setSurrogate(FitnessFunction surrogate, double tolerance) {
+    this->surrogate = std::move(surrogate);
+    surrogate_tolerance = tolerance;
+    surrogate_values.resize(individuals.size());
+    for (size_t i = 0; i < individuals.size(); ++i) {
+        surrogate_values[i] = this->surrogate ? this->surrogate(individuals[i]) : 0.0;
+    }
+}
@@ -1,4 +1,6 @@
 #include "../include/process_block.h"
+#include "../include/block_arena.h"
+#include "../include/robust_fitness.h"
 
 
 arma::vec matToZigzag(const cv::Mat& block) {
@@ -25,25 +27,30 @@ cv::Mat zigzagToMat(const arma::vec& zz) {
     return block;
 }
 
-double getRegionSum(const cv::Mat& block, std::vector<int> region) {
-    arma::vec zzBlock = matToZigzag(block);
+double getRegionSum(const cv::Mat& block, const std::vector<int>& region) {
+    CV_Assert(!block.empty() && block.rows == 8 && block.cols == 8 && block.type() == CV_64FC1);
+
     double sum = 0.0;
     for (int i : region) {
-        sum += std::fabs(zzBlock(i));
+        sum += std::fabs(block.at<double>(jpeg_zigzag[i] / 8, jpeg_zigzag[i] % 8));
     }
     return sum > 0.001 ? sum : 0.001; // Avoid division by zero
 }
 
 double compute_psnr(const cv::Mat& orig, const cv::Mat& test) {
-    cv::Mat orig_f(8, 8, CV_64FC1), test_f(8, 8, CV_64FC1);
+    ArenaScope scope;
+    BlockArena& arena = BlockArena::local();
+    cv::Mat orig_f = arena.mat(orig.rows, orig.cols, CV_64FC1), test_f = arena.mat(test.rows, test.cols, CV_64FC1);
     orig.convertTo(orig_f, CV_64FC1);
     test.convertTo(test_f, CV_64FC1);
 
-    cv::Mat diff;
-    cv::absdiff(orig_f, test_f, diff);
-    diff = diff.mul(diff);
-
-    double mse = cv::sum(diff)[0] / (orig.total()); 
+    double sum = 0.0;
+    for (int y = 0; y < orig_f.rows; ++y) {
+        const double* a = orig_f.ptr<double>(y);
+        const double* b = test_f.ptr<double>(y);
+        for (int x = 0; x < orig_f.cols; ++x) sum += (a[x] - b[x]) * (a[x] - b[x]);
+    }
+    double mse = sum / (orig.total());
     if (mse == 0.0) {
         return 100.0;
     }
@@ -53,6 +60,25 @@ double compute_psnr(const cv::Mat& orig, const cv::Mat& test) {
 }
 
 
+// applyVectorToBlock into `out` (8x8 CV_8UC1); the transforms run on arena buffers
+static void writeVectorToBlock(const arma::vec& vec, const cv::Mat& block, int scheme, cv::Mat& out) {
+    ArenaScope scope;
+    BlockArena& arena = BlockArena::local();
+    cv::Mat floatBlock = arena.mat(8, 8, CV_64FC1), dctBlock = arena.mat(8, 8, CV_64FC1);
+    block.convertTo(floatBlock, CV_64FC1);
+    cv::dct(floatBlock, dctBlock);
+
+    for (size_t idx = 0; idx < embeding_region[scheme].size(); ++idx) {
+        const int pos = jpeg_zigzag[embeding_region[scheme][idx]];
+        double& coefficient = dctBlock.at<double>(pos / 8, pos % 8);
+        double sign = (coefficient >= 0.0) ? 1.0 : -1.0;
+        coefficient = sign * std::fabs(std::fabs(coefficient) + vec(idx));
+    }
+
+    cv::dct(dctBlock, dctBlock, cv::DCT_INVERSE);
+    dctBlock.convertTo(out, CV_8UC1);
+}
+
 /**
  * @brief Applies a vector to an 8x8 block using DCT and zigzag transformation.
  * @param vec Input vector of size 22, containing the values to be applied to the block.
@@ -70,22 +96,8 @@ cv::Mat applyVectorToBlock(const arma::vec& vec, const cv::Mat& block, int schem
     if (block.type() != CV_8UC1) {
         throw std::invalid_argument("applyVectorToBlock: block must be CV_8UC1");
     }
-    cv::Mat floatBlock(8, 8, CV_64FC1);
-    block.convertTo(floatBlock, CV_64FC1); 
-    cv::Mat dctBlock(8, 8, CV_64FC1);
-    cv::dct(floatBlock, dctBlock);
-    arma::vec zzBlock = matToZigzag(dctBlock);
-
-    for (int idx = 0; idx < embeding_region[scheme].size(); ++idx) {
-        int coeff = embeding_region[scheme][idx];
-        double sign = (zzBlock(coeff) >= 0.0) ? 1.0 : -1.0;
-        zzBlock(coeff) = sign * std::fabs(std::fabs(zzBlock(coeff)) + vec(idx));
-    }
-
-    cv::Mat modifiedBlock = zigzagToMat(zzBlock);
-    cv::dct(modifiedBlock, modifiedBlock, cv::DCT_INVERSE);
     cv::Mat modifiedBlock8U(8, 8, CV_8UC1);
-    modifiedBlock.convertTo(modifiedBlock8U, CV_8UC1);
+    writeVectorToBlock(vec, block, scheme, modifiedBlock8U);
     return modifiedBlock8U;
 }
 
@@ -95,7 +107,9 @@ cv::Mat applyVectorToBlock(const arma::vec& vec, const cv::Mat& block, int schem
  * @return unsigned char The extracted bit, either 0 or 1, based on the comparison of sums from two regions.
  */
 unsigned char getBitFromBlock(const cv::Mat& block, int scheme){
-    cv::Mat dctBlock(8, 8, CV_64FC1), floatBlock(8, 8, CV_64FC1);
+    ArenaScope scope;
+    BlockArena& arena = BlockArena::local();
+    cv::Mat dctBlock = arena.mat(8, 8, CV_64FC1), floatBlock = arena.mat(8, 8, CV_64FC1);
     block.convertTo(floatBlock, CV_64FC1);
     cv::dct(floatBlock, dctBlock);
     double s1 = getRegionSum(dctBlock, s1_region[scheme]);
@@ -103,14 +117,44 @@ unsigned char getBitFromBlock(const cv::Mat& block, int scheme){
     return (s1 >= s0) ? 1 : 0;
 }
 
+/**
+ * @brief Region sums of both schemes from one DCT of the block.
+ * Equivalent to calling getRegionSum for every scheme, but the transform and the
+ * zig-zag reordering are done once.
+ * @param block Input OpenCV block of size 8x8, type CV_8UC1.
+ */
+SchemeRegionSums getSchemeRegionSums(const cv::Mat& block) {
+    ArenaScope scope;
+    BlockArena& arena = BlockArena::local();
+    cv::Mat dctBlock = arena.mat(8, 8, CV_64FC1), floatBlock = arena.mat(8, 8, CV_64FC1);
+    block.convertTo(floatBlock, CV_64FC1);
+    cv::dct(floatBlock, dctBlock);
+
+    auto regionSum = [&](const std::vector<int>& region) {
+        double sum = 0.0;
+        for (int k : region) {
+            sum += std::fabs(dctBlock.at<double>(jpeg_zigzag[k] / 8, jpeg_zigzag[k] % 8));
+        }
+        return sum > 0.001 ? sum : 0.001;
+    };
+    SchemeRegionSums sums;
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        sums.s1[scheme] = regionSum(s1_region[scheme]);
+        sums.s0[scheme] = regionSum(s0_region[scheme]);
+    }
+    return sums;
+}
+
 /**
  * @brief Calculates the fitness value for a given block and vector, based on PSNR and region sums.
  * @param block Input OpenCV block of size 8x8, type CV_8UC1.
  * @param vec Input vector of size 22, containing the values to be applied to the block.
  * @param bit The bit to be used in the fitness calculation (0 or 1).
+ * @param robustness Optional attack penalty of the marked block (robust_fitness.h).
  * @return double The calculated fitness value.
  */
-double calcFitnessValue(const cv::Mat& block, const arma::vec& vec, unsigned char bit, int scheme) {
+double calcFitnessValue(const cv::Mat& block, const arma::vec& vec, unsigned char bit, int scheme,
+                        const BlockRobustness* robustness) {
     if (block.empty()) {
         throw std::invalid_argument("calcFitnessValue: empty block");
     }
@@ -122,13 +166,122 @@ double calcFitnessValue(const cv::Mat& block, const arma::vec& vec, unsigned cha
         throw std::invalid_argument("calcFitnessValue: block must be CV_8UC1");
     }
 
-    cv::Mat modifiedBlock = applyVectorToBlock(vec, block, scheme);
-    cv::Mat modifiedFloatBlock(8, 8, CV_64FC1);
+    // All intermediate blocks live in the thread's arena
+    ArenaScope scope;
+    BlockArena& arena = BlockArena::local();
+    cv::Mat modifiedBlock = arena.mat(8, 8, CV_8UC1);
+    writeVectorToBlock(vec, block, scheme, modifiedBlock);
+    cv::Mat modifiedFloatBlock = arena.mat(8, 8, CV_64FC1);
     modifiedBlock.convertTo(modifiedFloatBlock, CV_64FC1);
     double psnr = compute_psnr(block, modifiedBlock);
-    cv::Mat modifiedBlockDCT(8, 8, CV_64FC1);
+    cv::Mat modifiedBlockDCT = arena.mat(8, 8, CV_64FC1);
     cv::dct(modifiedFloatBlock, modifiedBlockDCT);
     double s1 = getRegionSum(modifiedBlockDCT, s1_region[scheme]);
     double s0 = getRegionSum(modifiedBlockDCT, s0_region[scheme]);
+    double fitness = (bit == 0 ? s1 / s0 : s0 / s1) - 0.01 * psnr;
+    if (robustness) {
+        fitness += robustness->penalty(modifiedFloatBlock.ptr<double>(0), modifiedBlockDCT.ptr<double>(0), bit);
+    }
+    return fitness;
+}
+
+// JPEG baseline limit for quantized AC coefficients of 8-bit images
+static const int max_quantized_coefficient = 1023;
+
+/**
+ * @brief Region sum of dequantized JPEG coefficients.
+ * JPEG coefficients use the same orthonormal DCT scaling as cv::dct (the DC only differs by the
+ * level shift), so the sums match getRegionSum on the decoded block up to quantization.
+ * @param coefs Quantized coefficients of one block, natural order.
+ * @param quant Quantization table, natural order.
+ * @param region Zig-zag indices to sum.
+ * @return double Sum of absolute dequantized values, at least 0.001.
+ */
+double getCoefficientRegionSum(const int16_t* coefs, const uint16_t* quant, const std::vector<int>& region) {
+    double sum = 0.0;
+    for (int i : region) {
+        int pos = jpeg_zigzag[i];
+        sum += std::fabs(static_cast<double>(coefs[pos]) * quant[pos]);
+    }
+    return sum > 0.001 ? sum : 0.001; // Avoid division by zero
+}
+
+/**
+ * @brief Extracts a bit from a block of quantized JPEG coefficients without decoding it.
+ * @param coefs Quantized coefficients of one block, natural order.
+ * @param quant Quantization table, natural order.
+ * @return unsigned char The extracted bit, either 0 or 1.
+ */
+unsigned char getBitFromCoefficients(const int16_t* coefs, const uint16_t* quant, int scheme) {
+    double s1 = getCoefficientRegionSum(coefs, quant, s1_region[scheme]);
+    double s0 = getCoefficientRegionSum(coefs, quant, s0_region[scheme]);
+    return (s1 >= s0) ? 1 : 0;
+}
+
+/**
+ * @brief Region sums of both schemes for a block of quantized JPEG coefficients.
+ * @param coefs Quantized coefficients of one block, natural order.
+ * @param quant Quantization table, natural order.
+ */
+SchemeRegionSums getSchemeRegionSumsFromCoefficients(const int16_t* coefs, const uint16_t* quant) {
+    SchemeRegionSums sums;
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        sums.s1[scheme] = getCoefficientRegionSum(coefs, quant, s1_region[scheme]);
+        sums.s0[scheme] = getCoefficientRegionSum(coefs, quant, s0_region[scheme]);
+    }
+    return sums;
+}
+
+/**
+ * @brief Coefficient-domain version of applyVectorToBlock: the vector changes the dequantized
+ * magnitudes of the embedding region and the result is re-quantized with the block's table.
+ * @param vec Vector with one value per coefficient of the embedding region.
+ * @param coefs Quantized coefficients of one block, natural order.
+ * @param quant Quantization table, natural order.
+ * @param out Output block of 64 quantized coefficients (may alias coefs).
+ */
+void applyVectorToCoefficients(const arma::vec& vec, const int16_t* coefs, const uint16_t* quant, int16_t* out, int scheme) {
+    if (vec.n_elem != embeding_region[scheme].size()) {
+        throw std::invalid_argument("applyVectorToCoefficients: vector size does not match the embedding region");
+    }
+    if (out != coefs) {
+        std::copy(coefs, coefs + 64, out);
+    }
+    for (size_t idx = 0; idx < embeding_region[scheme].size(); ++idx) {
+        int pos = jpeg_zigzag[embeding_region[scheme][idx]];
+        double value = static_cast<double>(coefs[pos]) * quant[pos];
+        double sign = (value >= 0.0) ? 1.0 : -1.0;
+        double magnitude = std::fabs(std::fabs(value) + vec(idx));
+        long q = std::lround(magnitude / quant[pos]);
+        q = std::min<long>(q, max_quantized_coefficient);
+        out[pos] = static_cast<int16_t>(sign * q);
+    }
+}
+
+/**
+ * @brief Coefficient-domain version of calcFitnessValue.
+ * The DCT is orthonormal, so the pixel MSE is the mean of the squared coefficient changes
+ * (Parseval) and PSNR needs no inverse transform; clipping of decoded pixels is ignored.
+ * @param coefs Quantized coefficients of one block, natural order.
+ * @param quant Quantization table, natural order.
+ * @param vec Candidate vector.
+ * @param bit The bit to embed (0 or 1).
+ * @return double The fitness value, lower is better.
+ */
+double calcCoefficientFitnessValue(const int16_t* coefs, const uint16_t* quant, const arma::vec& vec, unsigned char bit, int scheme) {
+    int16_t modified[64];
+    applyVectorToCoefficients(vec, coefs, quant, modified, scheme);
+
+    double squared_error = 0.0;
+    for (int i : embeding_region[scheme]) {
+        int pos = jpeg_zigzag[i];
+        double delta = static_cast<double>(modified[pos] - coefs[pos]) * quant[pos];
+        squared_error += delta * delta;
+    }
+    double mse = squared_error / 64.0;
+    double psnr = mse == 0.0 ? 100.0 : 10.0 * std::log10((255.0 * 255.0) / mse);
+
+    double s1 = getCoefficientRegionSum(modified, quant, s1_region[scheme]);
+    double s0 = getCoefficientRegionSum(modified, quant, s0_region[scheme]);
     return (bit == 0 ? s1 / s0 : s0 / s1) - 0.01 * psnr;
 }
\ No newline at end of file
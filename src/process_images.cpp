@@ -82,25 +82,23 @@ cv::Mat assembleImageFrom8x8Blocks(const std::vector<cv::Mat>& blocks) {
 }
 
 /**
- * @brief Extracts watermark bits from a 32x32 grayscale image.
+ * @brief Extracts watermark bits from a square grayscale image, row by row.
  * 
- * @param image Input image of size 32x32 pixels, type CV_8UC1 (8-bit single channel).
- * @return std::vector<unsigned char> A vector containing the extracted watermark bits.
- * @throws std::runtime_error If the input image is not of size 32x32 or not of type CV_8UC1.
+ * @param image Input image of size side x side pixels, type CV_8UC1 (8-bit single channel).
+ * @param side Watermark side, 32 by default.
+ * @return WatermarkBits The binarized pixels (above 127 is 1), side * side bits.
+ * @throws std::runtime_error If the input image is not of size side x side or not of type CV_8UC1.
  */
-std::vector<unsigned char> extract_watermark_bits(const cv::Mat& image) {
-    const int wm_size = 32;
-    if (image.rows != wm_size || image.cols != wm_size || image.type() != CV_8UC1) {
-        throw std::runtime_error("Input must be 32x32 grayscale image");
+WatermarkBits extract_watermark_bits(const cv::Mat& image, int side) {
+    if (side <= 0 || image.rows != side || image.cols != side || image.type() != CV_8UC1) {
+        throw std::runtime_error("Input must be " + std::to_string(side) + "x" + std::to_string(side) + " grayscale image");
     }
 
-    std::vector<unsigned char> bits;
-    bits.reserve(wm_size * wm_size);
-
-    for (int i = 0; i < wm_size; ++i) {
-        for (int j = 0; j < wm_size; ++j) {
-            unsigned char pixel = image.at<uchar>(i, j);
-            bits.push_back(pixel > 127 ? 1 : 0); // бинаризация
+    WatermarkBits bits(static_cast<size_t>(side) * side);
+    for (int i = 0; i < side; ++i) {
+        const uchar* row = image.ptr<uchar>(i);
+        for (int j = 0; j < side; ++j) {
+            bits.set(static_cast<size_t>(i) * side + j, row[j] > 127); // бинаризация
         }
     }
 
@@ -108,26 +106,26 @@ std::vector<unsigned char> extract_watermark_bits(const cv::Mat& image) {
 }
 
 /**
- * @brief Reconstructs a 32x32 grayscale image from a vector of watermark bits.
+ * @brief Reconstructs a square grayscale image from watermark bits.
  * 
- * @param bits A vector containing the watermark bits (0 or 1).
- * @return cv::Mat The reconstructed image of size 32x32 pixels, type CV_8UC1.
- * @throws std::runtime_error If the size of the bit vector is not 1024 (32x32).
+ * @param bits The watermark bits, side * side of them.
+ * @param side Watermark side, 32 by default.
+ * @return cv::Mat The reconstructed image of size side x side pixels, type CV_8UC1.
+ * @throws std::runtime_error If the number of bits is not side * side.
  */
-cv::Mat reconstruct_watermark_image(const std::vector<unsigned char>& bits) {
-    const int wm_size = 32;
-    if (bits.size() != wm_size * wm_size) {
-        throw std::runtime_error("Bit vector size must be 1024");
+cv::Mat reconstruct_watermark_image(const WatermarkBits& bits, int side) {
+    if (side <= 0 || bits.size() != static_cast<size_t>(side) * side) {
+        throw std::runtime_error("Bit vector size must be " + std::to_string(side) + "x" + std::to_string(side));
     }
 
-    cv::Mat image(wm_size, wm_size, CV_8UC1);
+    cv::Mat image(side, side, CV_8UC1);
 
-    for (int i = 0; i < wm_size; ++i) {
-        for (int j = 0; j < wm_size; ++j) {
-            int idx = i * wm_size + j;
-            image.at<uchar>(i, j) = bits[idx] ? 255 : 0; // 1 → белый, 0 → чёрный
+    for (int i = 0; i < side; ++i) {
+        uchar* row = image.ptr<uchar>(i);
+        for (int j = 0; j < side; ++j) {
+            row[j] = bits.get(static_cast<size_t>(i) * side + j) ? 255 : 0; // 1 → белый, 0 → чёрный
         }
     }
 
     return image;
-}
\ No newline at end of file
+}
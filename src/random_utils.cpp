@@ -1,61 +1,86 @@
 // random_utils.cpp
 #include "../include/random_utils.h"
+#include <armadillo>
 
-// Global RNG initialized once at program start
-static std::mt19937 generator([]{
-    std::random_device rd;
-    return rd();
-}());
+void RandomStream::seed(uint64_t seed) {
+    engine_.seed(static_cast<std::mt19937::result_type>(seed ^ (seed >> 32)));
+    // Drop the cached second value of the Box-Muller pair
+    normal_.reset();
+}
 
-// Generates a random double in [0, 1]
-double uniform_random_0_1() {
-    static std::uniform_real_distribution<double> dist(
-        std::nextafter(0.0, 1.0), 1.0);
-    return dist(generator);
+double RandomStream::gaussian() {
+    // Fast path - 99.7% values will be within 3 sigma (0.05-0.95)
+    double value = normal_(engine_);
+    if (value >= 0.0 && value <= 1.0) {
+        return value;
+    }
+
+    // Slow path for out-of-range values (should occur ~0.3% of time)
+    return std::clamp(value, 0.0, 1.0);
 }
 
-// Generates a random integer in [0, N-1]
-int random_index(int N) {
-    if (N <= 0) {
+int RandomStream::index(int n) {
+    if (n <= 0) {
         throw std::invalid_argument("N must be positive");
     }
-    std::uniform_int_distribution<int> dist(0, N - 1);
-    return dist(generator);
+    std::uniform_int_distribution<int> dist(0, n - 1);
+    return dist(engine_);
 }
 
-// Generates 4 unique random indices excluding specified indices
-std::vector<int> generate_random_indices(int N, int best_index, int current_index) {
-    if (N < 6) {
+void RandomStream::indices(int n, int best, int current, int* out) {
+    if (n < 6) {
         throw std::invalid_argument(
             "N must be at least 6 to generate 4 unique indices excluding best_index and current_index"
         );
     }
 
-    std::set<int> excluded = {best_index, current_index};
-    std::vector<int> indices;
-    indices.reserve(4);
-
-    while (indices.size() < 4) {
-        int candidate = random_index(N);
-        if (excluded.count(candidate) == 0 &&
-            std::find(indices.begin(), indices.end(), candidate) == indices.end()) {
-            indices.push_back(candidate);
+    int found = 0;
+    while (found < 4) {
+        int candidate = index(n);
+        if (candidate != best && candidate != current &&
+            std::find(out, out + found, candidate) == out + found) {
+            out[found++] = candidate;
         }
     }
+}
+
+// Per-thread stream initialized on first use in each thread, so that blocks can be
+// optimized concurrently (daemon workers, parallel embedding) without data races
+RandomStream& threadRandom() {
+    static thread_local RandomStream stream([]{
+        std::random_device rd;
+        return rd();
+    }());
+    return stream;
+}
+
+// Generates a random double in [0, 1]
+double uniform_random_0_1() {
+    return threadRandom().uniform();
+}
+
+// Generates a random integer in [0, N-1]
+int random_index(int N) {
+    return threadRandom().index(N);
+}
 
+// Generates 4 unique random indices excluding specified indices
+std::vector<int> generate_random_indices(int N, int best_index, int current_index) {
+    std::vector<int> indices(4);
+    generate_random_indices(N, best_index, current_index, indices.data());
     return indices;
 }
 
+void generate_random_indices(int N, int best_index, int current_index, int* out) {
+    threadRandom().indices(N, best_index, current_index, out);
+}
+
 // Generates Gaussian random number in [0, 1] with clamping
 double gaussian_random_0_1() {
-    static std::normal_distribution<> dist(0.5, 0.15);
-    
-    // Fast path - 99.7% values will be within 3 sigma (0.05-0.95)
-    double value = dist(generator);
-    if (value >= 0.0 && value <= 1.0) {
-        return value;
-    }
+    return threadRandom().gaussian();
+}
 
-    // Slow path for out-of-range values (should occur ~0.3% of time)
-    return std::clamp(value, 0.0, 1.0);
-}
\ No newline at end of file
+void seed_thread_random(uint64_t seed) {
+    threadRandom().seed(seed);
+    arma::arma_rng::set_seed(static_cast<arma::arma_rng::seed_type>(seed));
+}
@@ -0,0 +1,207 @@
+#include "../include/robust_fitness.h"
+#include "../include/jpeg_simulator.h"
+#include "../include/process_block.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// Rounds to the nearest integer, ties to even, like the 8-bit conversions (see lockstep_gbo.cpp)
+const double round_magic = 6755399441055744.0;
+
+// Orthonormal 8x8 DCT-II basis, the transform cv::dct applies along each axis
+struct DctBasis {
+    double forward[8][8];
+
+    DctBasis() {
+        const double pi = 3.14159265358979323846;
+        for (int u = 0; u < 8; ++u) {
+            const double scale = u == 0 ? std::sqrt(1.0 / 8.0) : std::sqrt(2.0 / 8.0);
+            for (int x = 0; x < 8; ++x) forward[u][x] = scale * std::cos((2 * x + 1) * u * pi / 16.0);
+        }
+    }
+};
+
+const DctBasis& dctBasis() {
+    static const DctBasis basis;
+    return basis;
+}
+
+const double average_kernel[3][3] = {{1.0 / 9, 1.0 / 9, 1.0 / 9}, {1.0 / 9, 1.0 / 9, 1.0 / 9}, {1.0 / 9, 1.0 / 9, 1.0 / 9}};
+const double gaussian_kernel[3][3] = {{1.0 / 16, 2.0 / 16, 1.0 / 16}, {2.0 / 16, 4.0 / 16, 2.0 / 16}, {1.0 / 16, 2.0 / 16, 1.0 / 16}};
+const double sharpen_kernel[3][3] = {{0.0, -1.0, 0.0}, {-1.0, 5.0, -1.0}, {0.0, -1.0, 0.0}};
+
+inline double clampRound(double value) {
+    const double clamped = std::min(255.0, std::max(0.0, value));
+    return (clamped + round_magic) - round_magic;
+}
+
+// Mirrored index past the block edge (BORDER_REFLECT_101)
+inline int reflect(int i) {
+    return i < 0 ? -i : (i > 7 ? 14 - i : i);
+}
+
+template <int N>
+void filter3x3(const double (*in)[N], const double (&kernel)[3][3], double (*out)[N]) {
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            double acc[N] = {};
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const double w = kernel[dy + 1][dx + 1];
+                    if (w == 0.0) continue;
+                    const double* src = in[reflect(y + dy) * 8 + reflect(x + dx)];
+                    for (int l = 0; l < N; ++l) acc[l] += w * src[l];
+                }
+            }
+            for (int l = 0; l < N; ++l) out[y * 8 + x][l] = clampRound(acc[l]);
+        }
+    }
+}
+
+// DCT of the pixels at the given positions only: the row pass in full, the column pass per position
+template <int N>
+void regionDct(const double (*pixels)[N], const std::vector<int>& positions, double (*coefs)[N]) {
+    const DctBasis& basis = dctBasis();
+    alignas(64) double rows[64][N];
+    for (int y = 0; y < 8; ++y) {
+        for (int v = 0; v < 8; ++v) {
+            double* dst = rows[y * 8 + v];
+            for (int l = 0; l < N; ++l) dst[l] = 0.0;
+            for (int x = 0; x < 8; ++x) {
+                const double w = basis.forward[v][x];
+                const double* src = pixels[y * 8 + x];
+                for (int l = 0; l < N; ++l) dst[l] += w * src[l];
+            }
+        }
+    }
+    for (int pos : positions) {
+        const int u = pos / 8, v = pos % 8;
+        double* dst = coefs[pos];
+        for (int l = 0; l < N; ++l) dst[l] = 0.0;
+        for (int y = 0; y < 8; ++y) {
+            const double w = basis.forward[u][y];
+            const double* src = rows[y * 8 + v];
+            for (int l = 0; l < N; ++l) dst[l] += w * src[l];
+        }
+    }
+}
+
+// Sum of |coefficient| over a region, floored like getRegionSum
+template <int N>
+void regionSums(const double (*coefs)[N], const std::vector<int>& region, double* sums) {
+    for (int l = 0; l < N; ++l) sums[l] = 0.0;
+    for (int k : region) {
+        const double* c = coefs[jpeg_zigzag[k]];
+        for (int l = 0; l < N; ++l) sums[l] += std::fabs(c[l]);
+    }
+    for (int l = 0; l < N; ++l) sums[l] = sums[l] > 0.001 ? sums[l] : 0.001;
+}
+
+/**
+ * @brief Worst losing/winning region-sum ratio of N marked blocks over the attacks.
+ * Every attack is applied to all N blocks before the next one, so the lane loops stay long.
+ */
+template <int N>
+void worstRatios(const std::vector<BlockAttack>& attacks, const std::vector<std::array<double, 64>>& jpeg_steps,
+                 const std::vector<int>& positions, int scheme, const double (*pixels)[N], const double (*coefs)[N],
+                 const double* bits, double* worst) {
+    for (int l = 0; l < N; ++l) worst[l] = 0.0;
+    alignas(64) double attacked[64][N];
+    alignas(64) double attacked_coefs[64][N];
+    size_t jpeg = 0;
+    for (const BlockAttack& attack : attacks) {
+        switch (attack.kind) {
+        case BlockAttack::Kind::Jpeg: {
+            // Quantized and dequantized in place of the encoder/decoder pair, rounding half away from zero
+            const std::array<double, 64>& steps = jpeg_steps[jpeg++];
+            for (int pos : positions) {
+                const double q = steps[pos];
+                for (int l = 0; l < N; ++l) {
+                    const double c = coefs[pos][l];
+                    const double level = q * std::floor(std::fabs(c) / q + 0.5);
+                    attacked_coefs[pos][l] = c < 0.0 ? -level : level;
+                }
+            }
+            break;
+        }
+        case BlockAttack::Kind::Gain:
+        case BlockAttack::Kind::Offset: {
+            const double gain = attack.kind == BlockAttack::Kind::Gain ? attack.param : 1.0;
+            const double offset = attack.kind == BlockAttack::Kind::Offset ? attack.param : 0.0;
+            for (int p = 0; p < 64; ++p) {
+                for (int l = 0; l < N; ++l) attacked[p][l] = clampRound(pixels[p][l] * gain + offset);
+            }
+            regionDct<N>(attacked, positions, attacked_coefs);
+            break;
+        }
+        case BlockAttack::Kind::Average:
+        case BlockAttack::Kind::Gaussian:
+        case BlockAttack::Kind::Sharpen: {
+            const double (&kernel)[3][3] = attack.kind == BlockAttack::Kind::Average    ? average_kernel
+                                           : attack.kind == BlockAttack::Kind::Gaussian ? gaussian_kernel
+                                                                                        : sharpen_kernel;
+            filter3x3<N>(pixels, kernel, attacked);
+            regionDct<N>(attacked, positions, attacked_coefs);
+            break;
+        }
+        }
+        double s1[N], s0[N];
+        regionSums<N>(attacked_coefs, s1_region[scheme], s1);
+        regionSums<N>(attacked_coefs, s0_region[scheme], s0);
+        for (int l = 0; l < N; ++l) {
+            const double ratio = bits[l] != 0.0 ? s0[l] / s1[l] : s1[l] / s0[l];
+            worst[l] = std::max(worst[l], ratio);
+        }
+    }
+}
+
+} // namespace
+
+BlockRobustness::BlockRobustness(const std::vector<BlockAttack>& attacks, double weight, int scheme)
+    : attacks_(attacks), weight_(weight), scheme_(scheme) {
+    validateBlockAttacks(attacks, "BlockRobustness: ");
+    if (!(weight >= 0.0)) {
+        throw std::invalid_argument("BlockRobustness: weight must be non-negative");
+    }
+    if (scheme < 0 || scheme >= static_cast<int>(embeding_region.size())) {
+        throw std::invalid_argument("BlockRobustness: invalid scheme index");
+    }
+    for (const BlockAttack& attack : attacks_) {
+        if (attack.kind != BlockAttack::Kind::Jpeg) continue;
+        const std::array<uint16_t, 64> table = jpegLuminanceTable(static_cast<int>(std::lround(attack.param)));
+        std::array<double, 64> steps{};
+        std::copy(table.begin(), table.end(), steps.begin());
+        jpeg_steps_.push_back(steps);
+    }
+    for (int k : embeding_region[scheme]) positions_.push_back(jpeg_zigzag[k]);
+}
+
+double BlockRobustness::penalty(const double* pixels, const double* coefs, unsigned char bit) const {
+    const double bits = bit ? 1.0 : 0.0;
+    double worst = 0.0;
+    worstRatios<1>(attacks_, jpeg_steps_, positions_, scheme_, reinterpret_cast<const double (*)[1]>(pixels),
+                   reinterpret_cast<const double (*)[1]>(coefs), &bits, &worst);
+    return weight_ * worst;
+}
+
+void BlockRobustness::penalties(const double (*pixels)[lockstep_lanes], const double (*coefs)[lockstep_lanes],
+                                const double* bits, double* out) const {
+    worstRatios<lockstep_lanes>(attacks_, jpeg_steps_, positions_, scheme_, pixels, coefs, bits, out);
+    for (int l = 0; l < lockstep_lanes; ++l) out[l] *= weight_;
+}
+
+double BlockRobustness::worstRatio(const cv::Mat& marked_block, unsigned char bit) const {
+    if (marked_block.rows != 8 || marked_block.cols != 8 || marked_block.type() != CV_8UC1) {
+        throw std::invalid_argument("BlockRobustness::worstRatio: expected an 8x8 CV_8UC1 block");
+    }
+    cv::Mat pixels, coefs;
+    marked_block.convertTo(pixels, CV_64FC1);
+    cv::dct(pixels, coefs);
+    const double bits = bit ? 1.0 : 0.0;
+    double worst = 0.0;
+    worstRatios<1>(attacks_, jpeg_steps_, positions_, scheme_, reinterpret_cast<const double (*)[1]>(pixels.ptr<double>(0)),
+                   reinterpret_cast<const double (*)[1]>(coefs.ptr<double>(0)), &bits, &worst);
+    return worst;
+}
@@ -0,0 +1,380 @@
+#include "../include/scheme_classifier.h"
+#include "../include/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+
+const char model_magic[4] = {'G', 'B', 'O', 'C'};
+const uint32_t model_version = 1;
+
+// Bounds-checked little-endian reader over the exported model
+class ModelReader {
+public:
+    explicit ModelReader(const std::vector<unsigned char>& bytes) : bytes_(bytes) {}
+
+    void bytes(void* out, size_t n) {
+        if (pos_ + n > bytes_.size()) {
+            throw std::runtime_error("SchemeClassifier: truncated model file");
+        }
+        std::memcpy(out, bytes_.data() + pos_, n);
+        pos_ += n;
+    }
+    uint32_t u32() {
+        unsigned char b[4];
+        bytes(b, 4);
+        return static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) |
+               (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+    }
+    float f32() {
+        uint32_t bits = u32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    void floats(std::vector<float>& out, size_t n) {
+        out.resize(n);
+        for (size_t i = 0; i < n; ++i) out[i] = f32();
+    }
+    bool done() const { return pos_ == bytes_.size(); }
+
+private:
+    const std::vector<unsigned char>& bytes_;
+    size_t pos_ = 0;
+};
+
+// Activation shape while walking the layers
+struct Shape {
+    int channels;
+    int height;
+    int width;
+    size_t size() const { return static_cast<size_t>(channels) * height * width; }
+};
+
+Shape outputShape(const SchemeClassifier::Layer& layer, const Shape& in) {
+    switch (layer.type) {
+        case SchemeClassifier::Layer::Conv3x3:
+            return {layer.out, in.height, in.width};
+        case SchemeClassifier::Layer::MaxPool2:
+            return {in.channels, in.height / 2, in.width / 2};
+        case SchemeClassifier::Layer::AdaptiveAvgPool:
+            return {in.channels, layer.out, layer.out};
+        case SchemeClassifier::Layer::Linear:
+            return {layer.out, 1, 1};
+    }
+    return in;
+}
+
+// One output row of a 3x3 convolution for four output channels at once: each input value
+// loaded is used four times. Plain restrict-qualified loop over x, so it vectorizes.
+inline void conv3x3Row4(float* __restrict o0, float* __restrict o1, float* __restrict o2, float* __restrict o3,
+                        const float* __restrict r0, const float* __restrict r1, const float* __restrict r2,
+                        const float* __restrict k, int w) {
+    for (int x = 0; x < w; ++x) {
+        const float a0 = r0[x], a1 = r0[x + 1], a2 = r0[x + 2];
+        const float b0 = r1[x], b1 = r1[x + 1], b2 = r1[x + 2];
+        const float c0 = r2[x], c1 = r2[x + 1], c2 = r2[x + 2];
+        o0[x] += k[0] * a0 + k[1] * a1 + k[2] * a2 + k[3] * b0 + k[4] * b1 + k[5] * b2 + k[6] * c0 + k[7] * c1 + k[8] * c2;
+        o1[x] += k[9] * a0 + k[10] * a1 + k[11] * a2 + k[12] * b0 + k[13] * b1 + k[14] * b2 + k[15] * c0 + k[16] * c1 + k[17] * c2;
+        o2[x] += k[18] * a0 + k[19] * a1 + k[20] * a2 + k[21] * b0 + k[22] * b1 + k[23] * b2 + k[24] * c0 + k[25] * c1 + k[26] * c2;
+        o3[x] += k[27] * a0 + k[28] * a1 + k[29] * a2 + k[30] * b0 + k[31] * b1 + k[32] * b2 + k[33] * c0 + k[34] * c1 + k[35] * c2;
+    }
+}
+
+inline void conv3x3Row(float* __restrict o, const float* __restrict r0, const float* __restrict r1,
+                       const float* __restrict r2, const float* __restrict k, int w) {
+    for (int x = 0; x < w; ++x) {
+        o[x] += k[0] * r0[x] + k[1] * r0[x + 1] + k[2] * r0[x + 2] + k[3] * r1[x] + k[4] * r1[x + 1]
+              + k[5] * r1[x + 2] + k[6] * r2[x] + k[7] * r2[x + 1] + k[8] * r2[x + 2];
+    }
+}
+
+// 3x3 convolution with zero padding 1. `padded` holds the input with a one-pixel zero border.
+void conv3x3(const SchemeClassifier::Layer& layer, const float* padded, const Shape& in, float* out) {
+    const int h = in.height, w = in.width, pw = w + 2;
+    const size_t plane = static_cast<size_t>(h) * w;
+    const size_t padded_plane = static_cast<size_t>(h + 2) * pw;
+    for (int o = 0; o < layer.out; ++o) {
+        std::fill(out + o * plane, out + (o + 1) * plane, layer.bias[o]);
+    }
+
+    int o = 0;
+    float k[36];
+    for (; o + 4 <= layer.out; o += 4) {
+        float* d = out + o * plane;
+        for (int c = 0; c < layer.in; ++c) {
+            for (int j = 0; j < 4; ++j) {
+                const float* src_k = &layer.weight[(static_cast<size_t>(o + j) * layer.in + c) * 9];
+                std::copy(src_k, src_k + 9, k + 9 * j);
+            }
+            const float* src = padded + c * padded_plane;
+            for (int y = 0; y < h; ++y) {
+                const float* r0 = src + y * pw;
+                conv3x3Row4(d + y * w, d + plane + y * w, d + 2 * plane + y * w, d + 3 * plane + y * w,
+                            r0, r0 + pw, r0 + 2 * pw, k, w);
+            }
+        }
+    }
+    for (; o < layer.out; ++o) {
+        float* d = out + o * plane;
+        for (int c = 0; c < layer.in; ++c) {
+            const float* src_k = &layer.weight[(static_cast<size_t>(o) * layer.in + c) * 9];
+            const float* src = padded + c * padded_plane;
+            for (int y = 0; y < h; ++y) {
+                const float* r0 = src + y * pw;
+                conv3x3Row(d + y * w, r0, r0 + pw, r0 + 2 * pw, src_k, w);
+            }
+        }
+    }
+
+    if (layer.relu) {
+        const size_t total = plane * layer.out;
+        for (size_t i = 0; i < total; ++i) out[i] = std::max(out[i], 0.0f);
+    }
+}
+
+void pad(const float* in, const Shape& shape, float* out) {
+    const int pw = shape.width + 2;
+    std::fill(out, out + static_cast<size_t>(shape.channels) * (shape.height + 2) * pw, 0.0f);
+    for (int c = 0; c < shape.channels; ++c) {
+        for (int y = 0; y < shape.height; ++y) {
+            const float* src = in + (static_cast<size_t>(c) * shape.height + y) * shape.width;
+            float* dst = out + (static_cast<size_t>(c) * (shape.height + 2) + y + 1) * pw + 1;
+            std::copy(src, src + shape.width, dst);
+        }
+    }
+}
+
+void maxPool2(const float* in, const Shape& shape, float* out) {
+    const int oh = shape.height / 2, ow = shape.width / 2;
+    for (int c = 0; c < shape.channels; ++c) {
+        const float* src = in + static_cast<size_t>(c) * shape.height * shape.width;
+        float* dst = out + static_cast<size_t>(c) * oh * ow;
+        for (int y = 0; y < oh; ++y) {
+            const float* r0 = src + 2 * y * shape.width;
+            const float* r1 = r0 + shape.width;
+            for (int x = 0; x < ow; ++x) {
+                dst[y * ow + x] = std::max(std::max(r0[2 * x], r0[2 * x + 1]), std::max(r1[2 * x], r1[2 * x + 1]));
+            }
+        }
+    }
+}
+
+// Same bins as torch.nn.AdaptiveAvgPool2d: [floor(i*n/g), ceil((i+1)*n/g))
+void adaptiveAvgPool(const float* in, const Shape& shape, int grid, float* out) {
+    for (int c = 0; c < shape.channels; ++c) {
+        const float* src = in + static_cast<size_t>(c) * shape.height * shape.width;
+        for (int gy = 0; gy < grid; ++gy) {
+            const int y0 = gy * shape.height / grid, y1 = ((gy + 1) * shape.height + grid - 1) / grid;
+            for (int gx = 0; gx < grid; ++gx) {
+                const int x0 = gx * shape.width / grid, x1 = ((gx + 1) * shape.width + grid - 1) / grid;
+                float sum = 0.0f;
+                for (int y = y0; y < y1; ++y) {
+                    for (int x = x0; x < x1; ++x) sum += src[y * shape.width + x];
+                }
+                out[(static_cast<size_t>(c) * grid + gy) * grid + gx] = sum / static_cast<float>((y1 - y0) * (x1 - x0));
+            }
+        }
+    }
+}
+
+void linear(const SchemeClassifier::Layer& layer, const float* in, float* out) {
+    for (int o = 0; o < layer.out; ++o) {
+        const float* __restrict w = &layer.weight[static_cast<size_t>(o) * layer.in];
+        float sum = 0.0f;
+        for (int i = 0; i < layer.in; ++i) sum += w[i] * in[i];
+        sum += layer.bias[o];
+        out[o] = layer.relu ? std::max(sum, 0.0f) : sum;
+    }
+}
+
+} // namespace
+
+// Per-thread activation buffers, reused across blocks and calls
+struct SchemeClassifier::Scratch {
+    std::vector<float> input;
+    std::vector<float> a;
+    std::vector<float> b;
+    std::vector<float> padded;
+};
+
+/**
+ * @brief Loads a model exported by tools/export_classifier.py.
+ * @throws std::runtime_error if the file is missing or malformed.
+ */
+SchemeClassifier SchemeClassifier::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("SchemeClassifier: could not open model file: " + path);
+    }
+    return fromBytes(std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+}
+
+SchemeClassifier SchemeClassifier::fromBytes(const std::vector<unsigned char>& bytes) {
+    ModelReader reader(bytes);
+    char magic[4];
+    reader.bytes(magic, 4);
+    if (std::memcmp(magic, model_magic, 4) != 0) {
+        throw std::runtime_error("SchemeClassifier: not a classifier model file");
+    }
+    if (reader.u32() != model_version) {
+        throw std::runtime_error("SchemeClassifier: unsupported model version");
+    }
+
+    SchemeClassifier model;
+    model.setInputSize(static_cast<int>(reader.u32()));
+    model.mean_ = reader.f32();
+    model.std_ = reader.f32();
+    model.threshold_ = reader.f32();
+    if (!(model.std_ > 0.0f)) {
+        throw std::runtime_error("SchemeClassifier: invalid normalization");
+    }
+
+    const uint32_t count = reader.u32();
+    Shape shape{1, model.input_size_, model.input_size_};
+    for (uint32_t i = 0; i < count; ++i) {
+        Layer layer;
+        layer.type = static_cast<Layer::Type>(reader.u32());
+        switch (layer.type) {
+            case Layer::Conv3x3:
+            case Layer::Linear: {
+                layer.in = static_cast<int>(reader.u32());
+                layer.out = static_cast<int>(reader.u32());
+                layer.relu = reader.u32() != 0;
+                const size_t expected_in = layer.type == Layer::Conv3x3 ? static_cast<size_t>(shape.channels) : shape.size();
+                if (layer.in <= 0 || layer.out <= 0 || static_cast<size_t>(layer.in) != expected_in) {
+                    throw std::runtime_error("SchemeClassifier: layer " + std::to_string(i) + " does not match its input");
+                }
+                reader.floats(layer.weight, static_cast<size_t>(layer.out) * layer.in * (layer.type == Layer::Conv3x3 ? 9 : 1));
+                reader.floats(layer.bias, layer.out);
+                break;
+            }
+            case Layer::MaxPool2:
+                break;
+            case Layer::AdaptiveAvgPool:
+                layer.out = static_cast<int>(reader.u32());
+                if (reader.u32() != static_cast<uint32_t>(layer.out) || layer.out <= 0) {
+                    throw std::runtime_error("SchemeClassifier: only square pooling grids are supported");
+                }
+                break;
+            default:
+                throw std::runtime_error("SchemeClassifier: unknown layer type " + std::to_string(layer.type));
+        }
+        shape = outputShape(layer, shape);
+        model.layers_.push_back(std::move(layer));
+    }
+    if (!reader.done()) {
+        throw std::runtime_error("SchemeClassifier: trailing data in model file");
+    }
+    if (model.layers_.empty() || model.layers_.back().type != Layer::Linear || model.layers_.back().out != 2) {
+        throw std::runtime_error("SchemeClassifier: the model must end with a 2-way linear layer");
+    }
+    return model;
+}
+
+void SchemeClassifier::setInputSize(int size) {
+    if (size < 8) {
+        throw std::invalid_argument("SchemeClassifier: input size must be at least 8");
+    }
+    input_size_ = size;
+}
+
+uint64_t SchemeClassifier::macsPerBlock() const {
+    uint64_t macs = 0;
+    Shape shape{1, input_size_, input_size_};
+    for (const Layer& layer : layers_) {
+        if (layer.type == Layer::Conv3x3) {
+            macs += static_cast<uint64_t>(shape.height) * shape.width * layer.in * layer.out * 9;
+        } else if (layer.type == Layer::Linear) {
+            macs += static_cast<uint64_t>(layer.in) * layer.out;
+        }
+        shape = outputShape(layer, shape);
+    }
+    return macs;
+}
+
+// Bilinear (half-pixel centres, edge clamp) resize of the 8x8 block to the input size,
+// rounded to 8 bits like the PIL resize used in training, then ToTensor + Normalize
+void SchemeClassifier::preprocess(const unsigned char* block, size_t stride, std::vector<float>& out) const {
+    const int n = input_size_;
+    const float scale = 8.0f / static_cast<float>(n);
+    std::vector<int> idx0(n), idx1(n);
+    std::vector<float> frac(n);
+    for (int i = 0; i < n; ++i) {
+        float src = std::min(std::max((static_cast<float>(i) + 0.5f) * scale - 0.5f, 0.0f), 7.0f);
+        idx0[i] = static_cast<int>(src);
+        idx1[i] = std::min(idx0[i] + 1, 7);
+        frac[i] = src - static_cast<float>(idx0[i]);
+    }
+
+    out.resize(static_cast<size_t>(n) * n);
+    for (int y = 0; y < n; ++y) {
+        const unsigned char* top = block + idx0[y] * stride;
+        const unsigned char* bottom = block + idx1[y] * stride;
+        for (int x = 0; x < n; ++x) {
+            const float t = top[idx0[x]] + (top[idx1[x]] - top[idx0[x]]) * frac[x];
+            const float b = bottom[idx0[x]] + (bottom[idx1[x]] - bottom[idx0[x]]) * frac[x];
+            const float pixel = std::round(t + (b - t) * frac[y]);
+            out[static_cast<size_t>(y) * n + x] = (pixel / 255.0f - mean_) / std_;
+        }
+    }
+}
+
+float SchemeClassifier::predictOne(const unsigned char* block, size_t stride, Scratch& scratch) const {
+    preprocess(block, stride, scratch.input);
+    Shape shape{1, input_size_, input_size_};
+    const float* current = scratch.input.data();
+    std::vector<float>* next = &scratch.a;
+    for (const Layer& layer : layers_) {
+        const Shape out_shape = outputShape(layer, shape);
+        if (next->size() < out_shape.size()) next->resize(out_shape.size());
+        switch (layer.type) {
+            case Layer::Conv3x3: {
+                const size_t padded_size = static_cast<size_t>(shape.channels) * (shape.height + 2) * (shape.width + 2);
+                if (scratch.padded.size() < padded_size) scratch.padded.resize(padded_size);
+                pad(current, shape, scratch.padded.data());
+                conv3x3(layer, scratch.padded.data(), shape, next->data());
+                break;
+            }
+            case Layer::MaxPool2:
+                maxPool2(current, shape, next->data());
+                break;
+            case Layer::AdaptiveAvgPool:
+                adaptiveAvgPool(current, shape, layer.out, next->data());
+                break;
+            case Layer::Linear:
+                linear(layer, current, next->data());
+                break;
+        }
+        current = next->data();
+        next = (next == &scratch.a) ? &scratch.b : &scratch.a;
+        shape = out_shape;
+    }
+    // Softmax over the two logits, probability of class 1 (scheme 1)
+    return 1.0f / (1.0f + std::exp(current[0] - current[1]));
+}
+
+std::vector<float> SchemeClassifier::predict(const std::vector<const unsigned char*>& blocks, size_t stride, int threads) const {
+    if (layers_.empty()) {
+        throw std::logic_error("SchemeClassifier: no model loaded");
+    }
+    std::vector<float> probabilities(blocks.size());
+    parallelFor(blocks.size(), resolveThreads(threads), [&](size_t i) {
+        thread_local Scratch scratch;
+        probabilities[i] = predictOne(blocks[i], stride, scratch);
+    });
+    return probabilities;
+}
+
+std::vector<int> SchemeClassifier::classify(const std::vector<const unsigned char*>& blocks, size_t stride, int threads) const {
+    std::vector<float> probabilities = predict(blocks, stride, threads);
+    std::vector<int> schemes(probabilities.size());
+    for (size_t i = 0; i < probabilities.size(); ++i) {
+        schemes[i] = probabilities[i] >= threshold_ ? 1 : 0;
+    }
+    return schemes;
+}
@@ -0,0 +1,135 @@
+#include "../include/watermark_bits.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+size_t wordCount(size_t bits) {
+    return (bits + 63) / 64;
+}
+
+// Mask of the bits of word w that lie below `size`
+uint64_t validMask(size_t size, size_t w) {
+    const size_t used = size - std::min(size, w * 64);
+    return used >= 64 ? ~uint64_t(0) : (uint64_t(1) << used) - 1;
+}
+
+int popcount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word != 0; word &= word - 1) count++;
+    return count;
+#endif
+}
+
+// Adds the 1-bits of `carry` to the sliced counters of word w
+void addSliced(std::vector<std::vector<uint64_t>>& planes, size_t words, size_t w, uint64_t carry) {
+    for (size_t k = 0; carry != 0; ++k) {
+        if (k == planes.size()) planes.emplace_back(words, 0);
+        const uint64_t next = planes[k][w] & carry;
+        planes[k][w] ^= carry;
+        carry = next;
+    }
+}
+
+} // namespace
+
+WatermarkBits::WatermarkBits(size_t size) : size_(size), words_(wordCount(size), 0) {}
+
+WatermarkBits WatermarkBits::fromBytes(const unsigned char* bytes, size_t count) {
+    WatermarkBits bits(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (bytes[i] != 0) bits.words_[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    return bits;
+}
+
+void WatermarkBits::setWord(size_t w, uint64_t word) {
+    words_[w] = word & validMask(size_, w);
+}
+
+WatermarkBits WatermarkBits::slice(size_t begin, size_t count) const {
+    if (begin > size_ || count > size_ - begin) {
+        throw std::out_of_range("WatermarkBits::slice: range past the end");
+    }
+    WatermarkBits out(count);
+    const size_t shift = begin % 64;
+    for (size_t w = 0; w < out.words_.size(); ++w) {
+        const size_t q = begin / 64 + w;
+        uint64_t word = words_[q] >> shift;
+        if (shift != 0 && q + 1 < words_.size()) word |= words_[q + 1] << (64 - shift);
+        out.setWord(w, word);
+    }
+    return out;
+}
+
+std::vector<unsigned char> WatermarkBits::toBytes() const {
+    std::vector<unsigned char> bytes(size_);
+    toBytes(bytes.data());
+    return bytes;
+}
+
+void WatermarkBits::toBytes(unsigned char* bytes) const {
+    for (size_t i = 0; i < size_; ++i) bytes[i] = get(i) ? 1 : 0;
+}
+
+size_t WatermarkBits::ones() const {
+    size_t count = 0;
+    for (uint64_t word : words_) count += popcount(word);
+    return count;
+}
+
+size_t WatermarkBits::differences(const WatermarkBits& other) const {
+    if (size_ != other.size_) {
+        throw std::invalid_argument("WatermarkBits: watermarks must be the same size");
+    }
+    size_t count = 0;
+    for (size_t w = 0; w < words_.size(); ++w) count += popcount(words_[w] ^ other.words_[w]);
+    return count;
+}
+
+BitVoter::BitVoter(size_t size) : size_(size) {}
+
+void BitVoter::add(const WatermarkBits& copy) {
+    if (copy.size() > size_) {
+        throw std::invalid_argument("BitVoter: copy is longer than the watermark");
+    }
+    const size_t words = wordCount(size_);
+    for (size_t w = 0; w < wordCount(copy.size()); ++w) {
+        addSliced(ones_, words, w, copy.words()[w]);
+        addSliced(copies_, words, w, validMask(copy.size(), w));
+    }
+}
+
+WatermarkBits BitVoter::majority(WatermarkBits* ties) const {
+    WatermarkBits result(size_), tied(size_);
+    // 2 * ones against copies, from the top plane down: the first plane where they differ decides
+    const size_t levels = std::max(ones_.size() + 1, copies_.size());
+    for (size_t w = 0; w < result.words().size(); ++w) {
+        uint64_t greater = 0, less = 0;
+        for (size_t k = levels; k-- > 0;) {
+            const uint64_t doubled = k >= 1 && k - 1 < ones_.size() ? ones_[k - 1][w] : 0;
+            const uint64_t copies = k < copies_.size() ? copies_[k][w] : 0;
+            const uint64_t undecided = ~(greater | less);
+            greater |= undecided & doubled & ~copies;
+            less |= undecided & ~doubled & copies;
+        }
+        result.setWord(w, greater);
+        tied.setWord(w, ~(greater | less));
+    }
+    if (ties != nullptr) *ties = std::move(tied);
+    return result;
+}
+
+std::vector<WatermarkBits> watermarkCopies(const WatermarkBits& block_bits, size_t bit_count) {
+    if (bit_count == 0) {
+        throw std::invalid_argument("watermarkCopies: bit_count must be positive");
+    }
+    std::vector<WatermarkBits> copies;
+    for (size_t begin = 0; begin < block_bits.size(); begin += bit_count) {
+        copies.push_back(block_bits.slice(begin, std::min(bit_count, block_bits.size() - begin)));
+    }
+    return copies;
+}
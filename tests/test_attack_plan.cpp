@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "attack_plan.h"
+#include "attack_sweep.h"
+#include "attacks.h"
+#include <vector>
+
+namespace {
+
+cv::Mat texturedImage(int rows, int cols) {
+    cv::Mat image(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            image.at<unsigned char>(y, x) = static_cast<unsigned char>(30 + (x * 11 + y * 5 + x * y) % 190);
+        }
+    }
+    return image;
+}
+
+const char* chained_plan =
+    "# contrast, then two JPEG qualities and noise on top of it\n"
+    "contrast  contrast 1.2\n"
+    "jpeg70    jpeg 70\n"
+    "c_jpeg70  jpeg 70      <- contrast\n"
+    "c_jpeg90  jpeg 90      <- contrast   # same prefix\n"
+    "c_noise   saltpepper 0.02 <- c_jpeg70\n"
+    "tau copy jpeg70 c_jpeg90 c_noise\n";
+
+} // namespace
+
+// Тест: разбор плана - входы, глубины, узлы tau и ошибки с номером строки
+TEST(AttackPlan, ParsePlan) {
+    const AttackPlan plan = AttackPlan::parse(chained_plan);
+    ASSERT_EQ(plan.nodes().size(), 5u);
+    EXPECT_EQ(plan.nodes()[2].input, 0);
+    EXPECT_EQ(plan.nodes()[4].input, 2);
+    EXPECT_EQ(plan.depths(), (std::vector<int>{1, 1, 2, 2, 3}));
+    EXPECT_EQ(plan.tauNodes(), (std::vector<int>{AttackPlan::copy, 1, 3, 4}));
+
+    const AttackPlan defaults = AttackPlan::defaultPlan();
+    EXPECT_EQ(defaults.nodes().size(), 2u);
+    EXPECT_EQ(defaults.tauNodes(), (std::vector<int>{AttackPlan::copy, 0, 1}));
+
+    EXPECT_THROW(AttackPlan::parse("a blur 3\n"), std::invalid_argument);
+    EXPECT_THROW(AttackPlan::parse("a jpeg\n"), std::invalid_argument);
+    EXPECT_THROW(AttackPlan::parse("a jpeg 70\na median 3\n"), std::invalid_argument);
+    EXPECT_THROW(AttackPlan::parse("a jpeg 70 <- b\nb median 3\n"), std::invalid_argument);
+    EXPECT_THROW(AttackPlan::parse("a sharpen 1\n"), std::invalid_argument);
+    EXPECT_THROW(AttackPlan::parse("a jpeg 70\ntau a b\n"), std::invalid_argument);
+    try {
+        AttackPlan::parse("a jpeg 70\n\nb median 4\n");
+        FAIL();
+    } catch (const std::invalid_argument& e) {
+        EXPECT_NE(std::string(e.what()).find("line 3"), std::string::npos);
+    }
+}
+
+// Тест: общий DAG дает те же изображения, что и каждая цепочка атак отдельно, при любом числе потоков
+TEST(AttackPlan, EvaluateMatchesChains) {
+    const cv::Mat copy = texturedImage(48, 64);
+    const AttackPlan plan = AttackPlan::parse(chained_plan);
+    const std::vector<cv::Mat> serial = plan.evaluate(copy, 1, 5);
+    const std::vector<cv::Mat> parallel = plan.evaluate(copy, 4, 5);
+    ASSERT_EQ(serial.size(), 4u);
+
+    const cv::Mat contrast = contrastIncrease(copy, 1.2);
+    const cv::Mat c_jpeg70 = jpegCompression(contrast, 70);
+    const cv::Mat expected[] = {copy, jpegCompression(copy, 70), jpegCompression(contrast, 90),
+                                saltPepperNoise(c_jpeg70, 0.02, 5 + 4)};
+    for (size_t k = 0; k < serial.size(); ++k) {
+        EXPECT_EQ(cv::countNonZero(serial[k] != expected[k]), 0) << k;
+        EXPECT_EQ(cv::countNonZero(parallel[k] != serial[k]), 0) << k;
+    }
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include "attack_sweep.h"
+#include "attacks.h"
+#include "jpeg_simulator.h"
+#include "launch.h"
+#include <sstream>
+#include <vector>
+
+namespace {
+
+cv::Mat texturedImage(int rows, int cols) {
+    cv::Mat image(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            image.at<unsigned char>(y, x) = static_cast<unsigned char>(50 + (x * 13 + y * 7 + x * y) % 150);
+        }
+    }
+    return image;
+}
+
+} // namespace
+
+// Тест: разбор сетки атак - списки, диапазоны с включенной границей и ошибки
+TEST(AttackSweep, ParseGrid) {
+    const std::vector<SweepAxis> grid = parseSweepGrid("jpeg=10:100:10;median=3,5;sharpen;contrast=0.5:0.8:0.1");
+    ASSERT_EQ(grid.size(), 4u);
+    ASSERT_EQ(grid[0].params.size(), 10u);
+    EXPECT_DOUBLE_EQ(grid[0].params.back(), 100.0);
+    EXPECT_EQ(grid[1].params, (std::vector<double>{3.0, 5.0}));
+    EXPECT_EQ(grid[2].params, std::vector<double>{0.0});
+    EXPECT_EQ(grid[3].params.size(), 4u);
+    EXPECT_NO_THROW(parseSweepGrid(default_sweep_grid));
+
+    EXPECT_THROW(parseSweepGrid("blur=3"), std::invalid_argument);
+    EXPECT_THROW(parseSweepGrid("jpeg"), std::invalid_argument);
+    EXPECT_THROW(parseSweepGrid("sharpen=1"), std::invalid_argument);
+    EXPECT_THROW(parseSweepGrid("jpeg=0:50:10"), std::invalid_argument);
+    EXPECT_THROW(parseSweepGrid("median=4"), std::invalid_argument);
+    EXPECT_THROW(parseSweepGrid("jpeg=90:10:10"), std::invalid_argument);
+}
+
+// Тест: сжатие по сохраненному ДКП изображения совпадает с JpegSimulator::compress
+TEST(AttackSweep, CachedDctMatchesSimulator) {
+    const cv::Mat image = texturedImage(37, 45);
+    const JpegImageDct dct(image, 2);
+    for (int quality : {10, 50, 75, 100}) {
+        const JpegSimulator simulator(quality);
+        EXPECT_EQ(cv::countNonZero(dct.compress(simulator, 3) != simulator.compress(image)), 0) << quality;
+    }
+}
+
+// Тест: точки развертки совпадают с поточечной атакой и не зависят от числа потоков
+TEST(AttackSweep, PointsMatchDirectEvaluation) {
+    const cv::Mat image = texturedImage(128, 128);
+    cv::Mat watermark(16, 16, CV_8UC1);
+    for (int i = 0; i < 256; ++i) watermark.at<unsigned char>(i / 16, i % 16) = static_cast<unsigned char>(((i * 7) % 3 == 0) * 255);
+    gbo::Config config;
+    config.method = gbo::Method::Analytic;
+    const cv::Mat marked = embedWatermarkMat(image, watermark, config);
+    const WatermarkBits bits = extract_watermark_bits(watermark, 16);
+
+    const AttackSweep sweep(image, marked, bits, config);
+    const std::vector<SweepAxis> grid = parseSweepGrid("none;jpeg=30,90;saltpepper=0.05;median=3;brightness=-20,20");
+    SweepOptions options;
+    options.seed = 7;
+    options.threads = 1;
+    const std::vector<SweepPoint> serial = sweep.run(grid, options);
+    options.threads = 4;
+    const std::vector<SweepPoint> parallel = sweep.run(grid, options);
+    ASSERT_EQ(serial.size(), 7u);
+    ASSERT_EQ(parallel.size(), serial.size());
+    EXPECT_DOUBLE_EQ(serial[0].ber, 0.0);
+
+    const cv::Mat direct[] = {marked, jpegCompression(marked, 30), jpegCompression(marked, 90), saltPepperNoise(marked, 0.05, 7),
+                              medianFiltering(marked, 3), brightnessDecrease(marked, 20), brightnessIncrease(marked, 20)};
+    for (size_t k = 0; k < serial.size(); ++k) {
+        const double ber = computeBER(bits, extract_watermark_bits(extractWatermarkMat(direct[k], config, 16), 16));
+        EXPECT_DOUBLE_EQ(serial[k].ber, ber) << serial[k].attack << " " << serial[k].param;
+        EXPECT_NEAR(serial[k].quality.psnr, computePSNR(image, direct[k]), 1e-9);
+        EXPECT_DOUBLE_EQ(parallel[k].ber, serial[k].ber);
+        EXPECT_DOUBLE_EQ(parallel[k].quality.ssim, serial[k].quality.ssim);
+    }
+
+    std::ostringstream csv;
+    writeSweepCsv(csv, serial);
+    EXPECT_EQ(csv.str().rfind("attack,param,ber,psnr,ssim,ncc,mse\nnone,0,0,", 0), 0u);
+}
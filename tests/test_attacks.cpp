@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include "attacks.h"
+#include "parallel.h"
+#include <cmath>
+#include <vector>
+
+// Тест: значения потока не зависят от разбиения на пакеты, разные seed дают разные потоки
+TEST(Attacks, NoiseStreamIsCounterBased) {
+    std::vector<uint64_t> whole(100), split(100), other(100);
+    NoiseStream a(7), b(7), c(8);
+    a.fill(whole.data(), 100);
+    b.fill(split.data(), 33);
+    b.fill(split.data() + 33, 67);
+    c.fill(other.data(), 100);
+    EXPECT_EQ(whole, split);
+    EXPECT_NE(whole, other);
+    EXPECT_EQ(b.position(), 100u);
+}
+
+// Тест: шум воспроизводим по seed и не зависит от потока, в котором выполняется атака
+TEST(Attacks, NoiseIsSeededAndThreadIndependent) {
+    const cv::Mat image(37, 45, CV_8UC1, cv::Scalar(128));
+    std::vector<cv::Mat> serial(8), parallel(8);
+    for (size_t i = 0; i < serial.size(); ++i) serial[i] = speckleNoise(saltPepperNoise(image, 0.1, i), 15.0, i);
+    parallelFor(parallel.size(), 4, [&](size_t i) {
+        parallel[i] = speckleNoise(saltPepperNoise(image, 0.1, i), 15.0, i);
+    });
+    for (size_t i = 0; i < serial.size(); ++i) {
+        EXPECT_EQ(cv::countNonZero(serial[i] != parallel[i]), 0);
+    }
+    EXPECT_GT(cv::countNonZero(serial[0] != serial[1]), 0);
+
+    // Перегрузка с потоком продолжает его: две атаки подряд берут разные значения
+    NoiseStream rng(3);
+    const cv::Mat first = saltPepperNoise(image, 0.5, rng);
+    EXPECT_EQ(rng.position(), image.total());
+    EXPECT_GT(cv::countNonZero(first != saltPepperNoise(image, 0.5, rng)), 0);
+    EXPECT_EQ(cv::countNonZero(first != saltPepperNoise(image, 0.5, 3)), 0);
+
+    EXPECT_THROW(saltPepperNoise(cv::Mat(8, 8, CV_32FC1), 0.1), std::invalid_argument);
+}
+
+// Тест: статистика шума — доля и баланс соли/перца, среднее и отклонение спекл-шума
+TEST(Attacks, NoiseStatistics) {
+    const cv::Mat image(256, 256, CV_8UC1, cv::Scalar(128));
+    const cv::Mat salted = saltPepperNoise(image, 0.05, 11);
+    const int zeros = cv::countNonZero(salted == 0), whites = cv::countNonZero(salted == 255);
+    EXPECT_NEAR((zeros + whites) / static_cast<double>(image.total()), 0.05, 0.005);
+    EXPECT_NEAR(zeros / static_cast<double>(zeros + whites), 0.5, 0.05);
+    EXPECT_EQ(cv::countNonZero(saltPepperNoise(image, 0.0, 11) != image), 0);
+
+    const cv::Mat speckled = speckleNoise(image, 20.0, 11);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(speckled, mean, stddev);
+    EXPECT_NEAR(mean[0], 128.0, 0.5);
+    EXPECT_NEAR(stddev[0], 20.0, 0.5);
+}
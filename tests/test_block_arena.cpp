@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include "block_arena.h"
+#include "process_block.h"
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+cv::Mat texturedBlock() {
+    cv::Mat block(8, 8, CV_8UC1);
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            block.at<unsigned char>(y, x) = static_cast<unsigned char>(30 + (x * 23 + y * 41 + x * y * 7) % 190);
+        }
+    }
+    return block;
+}
+
+} // namespace
+
+// Тест: после закрытия области память арены выдается повторно, буферы выровнены по 64 байта
+TEST(BlockArena, ScopeRewindsMemory) {
+    ASSERT_TRUE(arenaEnabled());
+    BlockArena& arena = BlockArena::local();
+    void* first = nullptr;
+    {
+        ArenaScope scope;
+        first = arena.allocate(100);
+        void* second = arena.allocate(8);
+        EXPECT_NE(first, second);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % 64, 0u);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(second) % 64, 0u);
+    }
+    {
+        ArenaScope scope;
+        EXPECT_EQ(arena.allocate(100), first);
+        cv::Mat mat = arena.mat(8, 8, CV_64FC1);
+        arma::vec vec = arena.vec(25);
+        EXPECT_TRUE(mat.isContinuous());
+        EXPECT_EQ(vec.n_elem, 25u);
+    }
+}
+
+// Тест: сброс арены засчитывается один раз на внешнюю область, вложенные области не считаются
+TEST(BlockArena, StatsCountOuterScopes) {
+    const ArenaStats before = arenaStats();
+    {
+        ArenaScope outer;
+        BlockArena::local().allocate(64);
+        {
+            ArenaScope inner;
+            BlockArena::local().allocate(64);
+        }
+    }
+    const ArenaStats after = arenaStats();
+    EXPECT_EQ(after.resets - before.resets, 1u);
+    EXPECT_EQ(after.allocations - before.allocations, 2u);
+    EXPECT_GT(after.reserved_bytes, 0u);
+}
+
+// Тест: значение приспособленности не зависит от того, включена ли арена
+TEST(BlockArena, FitnessSameWithoutArena) {
+    const cv::Mat block = texturedBlock();
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        arma::vec vec(embeding_region[scheme].size());
+        for (arma::uword idx = 0; idx < vec.n_elem; ++idx) vec(idx) = 8.0 * std::sin(0.7 * idx + scheme);
+        const double with_arena = calcFitnessValue(block, vec, 1, scheme);
+        setArenaEnabled(false);
+        const double without_arena = calcFitnessValue(block, vec, 1, scheme);
+        setArenaEnabled(true);
+        EXPECT_DOUBLE_EQ(with_arena, without_arena);
+    }
+}
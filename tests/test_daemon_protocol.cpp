@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "../include/daemon.h"
+#include <sys/socket.h>
+#include <unistd.h>
+
+TEST(DaemonProtocol, RequestRoundTrip) {
+    DaemonRequest request;
+    request.id = 0x0123456789abcdefULL;
+    request.op = DaemonOp::Evaluate;
+    request.scheme = 1;
+    request.deadline_ms = 2500;
+    request.blobs = {{1, 2, 3}, {}, {255, 0, 128, 7}};
+
+    DaemonRequest decoded;
+    ASSERT_TRUE(decodeDaemonRequest(encodeDaemonRequest(request), decoded));
+    EXPECT_EQ(decoded.id, request.id);
+    EXPECT_EQ(decoded.op, request.op);
+    EXPECT_EQ(decoded.scheme, request.scheme);
+    EXPECT_EQ(decoded.deadline_ms, request.deadline_ms);
+    EXPECT_EQ(decoded.blobs, request.blobs);
+}
+
+TEST(DaemonProtocol, ResponseRoundTrip) {
+    DaemonResponse response;
+    response.id = 42;
+    response.status = DaemonStatus::DeadlineExceeded;
+    response.queue_us = 1500;
+    response.service_us = 123456;
+    response.message = "deadline expired while queued";
+    response.image = {9, 8, 7};
+    response.values = {0.0, 42.5, 0.99, -1.0, 3.25};
+
+    DaemonResponse decoded;
+    ASSERT_TRUE(decodeDaemonResponse(encodeDaemonResponse(response), decoded));
+    EXPECT_EQ(decoded.id, response.id);
+    EXPECT_EQ(decoded.status, response.status);
+    EXPECT_EQ(decoded.queue_us, response.queue_us);
+    EXPECT_EQ(decoded.service_us, response.service_us);
+    EXPECT_EQ(decoded.message, response.message);
+    EXPECT_EQ(decoded.image, response.image);
+    EXPECT_EQ(decoded.values, response.values);
+}
+
+TEST(DaemonProtocol, RejectsTruncatedPayload) {
+    DaemonRequest request;
+    request.op = DaemonOp::Embed;
+    request.blobs = {{1, 2, 3, 4, 5}, {6, 7}};
+    std::vector<unsigned char> payload = encodeDaemonRequest(request);
+    payload.pop_back();
+
+    DaemonRequest decoded;
+    EXPECT_FALSE(decodeDaemonRequest(payload, decoded));
+}
+
+TEST(DaemonProtocol, FramesOverSocketPair) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    std::vector<unsigned char> sent = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    ASSERT_TRUE(writeDaemonFrame(fds[0], sent));
+    ASSERT_TRUE(writeDaemonFrame(fds[0], {}));
+
+    std::vector<unsigned char> received;
+    ASSERT_TRUE(readDaemonFrame(fds[1], received));
+    EXPECT_EQ(received, sent);
+    ASSERT_TRUE(readDaemonFrame(fds[1], received));
+    EXPECT_TRUE(received.empty());
+
+    close(fds[0]);
+    EXPECT_FALSE(readDaemonFrame(fds[1], received));
+    close(fds[1]);
+}
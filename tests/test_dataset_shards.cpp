@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+#include "dataset_builder.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace {
+
+void writeFile(const std::filesystem::path& path, const std::string& text) {
+    std::filesystem::create_directories(path.parent_path());
+    std::ofstream(path) << text;
+}
+
+std::string readFile(const std::filesystem::path& path) {
+    std::ifstream in(path);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Runs a test in an empty temporary directory. The image list does not resolve there, so a build
+// goes through its checkpoint and cleanup steps without embedding anything.
+class ScratchDir {
+public:
+    explicit ScratchDir(const std::string& name)
+        : root_(std::filesystem::temp_directory_path() / name), previous_(std::filesystem::current_path()) {
+        std::filesystem::remove_all(root_);
+        std::filesystem::create_directories(root_);
+        std::filesystem::current_path(root_);
+    }
+    ~ScratchDir() {
+        std::filesystem::current_path(previous_);
+        std::filesystem::remove_all(root_);
+    }
+
+private:
+    std::filesystem::path root_, previous_;
+};
+
+// The checkpoint header of a finished build with these settings
+std::string manifestHeader(const AttackPlan& plan, int tau_max, const DatasetShard& shard, uint64_t seed) {
+    buildDatasetShard(plan, tau_max, shard, "header", seed);
+    const std::string manifest = readFile("header/shard.txt");
+    std::filesystem::remove_all("header");
+    return manifest.substr(0, manifest.find("image "));
+}
+
+DatasetShard secondHalf() {
+    DatasetShard shard;
+    shard.index = 1;
+    shard.count = 2;    // images 4-7 of the list
+    return shard;
+}
+
+} // namespace
+
+// Тест: разбор "k/n" и "hash:k/n"; при любом числе шардов каждое изображение попадает ровно в один
+TEST(DatasetShards, PartitionCoversEveryImageOnce) {
+    const DatasetShard hashed = parseDatasetShard("hash:2/3");
+    EXPECT_TRUE(hashed.hash);
+    EXPECT_EQ(hashed.index, 2);
+    EXPECT_EQ(hashed.count, 3);
+    EXPECT_THROW(parseDatasetShard("3/3"), std::invalid_argument);
+    EXPECT_THROW(parseDatasetShard("1/0"), std::invalid_argument);
+    EXPECT_THROW(parseDatasetShard("1-2"), std::invalid_argument);
+
+    for (int count : {1, 3, 8, 11}) {
+        for (bool hash : {false, true}) {
+            for (size_t image = 0; image < images.size(); ++image) {
+                int owners = 0;
+                for (int index = 0; index < count; ++index) {
+                    DatasetShard shard;
+                    shard.index = index;
+                    shard.count = count;
+                    shard.hash = hash;
+                    owners += shard.contains(image) ? 1 : 0;
+                }
+                EXPECT_EQ(owners, 1) << count << " shards, hash " << hash << ", image " << image;
+            }
+        }
+    }
+}
+
+// Тест: слияние нумерует блоки по изображению и блоку, независимо от порядка шардов,
+// и отклоняет неполный набор шардов и файлы, которых нет в shard.txt
+TEST(DatasetShards, MergeRenumbersInImageOrder) {
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "gbo_dataset_shards_test";
+    std::filesystem::remove_all(root);
+    const std::string settings = "corpus 8 0123\ntau_max 2\nseed 7\nplan 4567\n";
+    writeFile(root / "s0/shard.txt", "shard 0 2 range\n" + settings + "image 1 1 1 0\n");
+    writeFile(root / "s0/Dir1/0001_000003.png", "a");
+    writeFile(root / "s0/Dir2/0001_000000.png", "b");
+    std::filesystem::create_directories(root / "s0/Dirrand");
+    writeFile(root / "s0/tau/0001.txt", "1 0\n");
+    writeFile(root / "s1/shard.txt", "shard 1 2 range\n" + settings + "image 5 2 0 0\n");
+    writeFile(root / "s1/Dir1/0005_000001.png", "d");
+    writeFile(root / "s1/Dir1/0005_000000.png", "c");
+    std::filesystem::create_directories(root / "s1/Dir2");
+    std::filesystem::create_directories(root / "s1/Dirrand");
+    writeFile(root / "s1/tau/0005.txt", "0 1\n");
+
+    const DatasetCounts counts = mergeDatasetShards({(root / "s1").string(), (root / "s0").string()}, (root / "out").string());
+    EXPECT_EQ(counts.dir1, 3);
+    EXPECT_EQ(counts.dir2, 1);
+    EXPECT_EQ(counts.dirrand, 0);
+    EXPECT_EQ(readFile(root / "out/Dir1/block_0.png"), "a");
+    EXPECT_EQ(readFile(root / "out/Dir1/block_1.png"), "c");
+    EXPECT_EQ(readFile(root / "out/Dir1/block_2.png"), "d");
+    EXPECT_EQ(readFile(root / "out/Dir2/block_0.png"), "b");
+    EXPECT_EQ(readFile(root / "out/tau/0001.txt"), "1 0\n");
+    EXPECT_EQ(readFile(root / "out/tau/0005.txt"), "0 1\n");
+
+    EXPECT_THROW(mergeDatasetShards({(root / "s0").string()}, (root / "out").string()), std::runtime_error);
+    writeFile(root / "s1/Dirrand/0007_000000.png", "e");
+    EXPECT_THROW(mergeDatasetShards({(root / "s0").string(), (root / "s1").string()}, (root / "out").string()),
+                 std::runtime_error);
+    std::filesystem::remove_all(root);
+}
+
+// Тест: слияние в каталог с прежним набором заменяет его блоки и tau целиком;
+// отклонённое слияние (нет файла tau) каталог не трогает
+TEST(DatasetShards, MergeReplacesPopulatedOutput) {
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "gbo_dataset_merge_test";
+    std::filesystem::remove_all(root);
+    const std::string settings = "corpus 8 0123\ntau_max 2\nseed 7\nplan 4567\n";
+    writeFile(root / "s0/shard.txt", "shard 0 1 range\n" + settings + "image 2 1 0 0\n");
+    writeFile(root / "s0/Dir1/0002_000004.png", "new");
+    std::filesystem::create_directories(root / "s0/Dir2");
+    std::filesystem::create_directories(root / "s0/Dirrand");
+    writeFile(root / "s0/tau/0002.txt", "0 0\n");
+    for (const char* file : {"Dir1/block_0.png", "Dir1/block_1.png", "Dir2/block_0.png", "Dirrand/block_0.png",
+                             "tau/0000.txt", "tau/0002.txt"}) {
+        writeFile(root / "out" / file, "old");
+    }
+    writeFile(root / "out/readme.txt", "kept");
+
+    std::filesystem::rename(root / "s0/tau/0002.txt", root / "s0/tau/0003.txt");
+    EXPECT_THROW(mergeDatasetShards({(root / "s0").string()}, (root / "out").string()), std::runtime_error);
+    EXPECT_EQ(readFile(root / "out/Dir1/block_1.png"), "old");
+    std::filesystem::rename(root / "s0/tau/0003.txt", root / "s0/tau/0002.txt");
+
+    const DatasetCounts counts = mergeDatasetShards({(root / "s0").string()}, (root / "out").string());
+    EXPECT_EQ(counts.dir1, 1);
+    EXPECT_EQ(readFile(root / "out/Dir1/block_0.png"), "new");
+    EXPECT_FALSE(std::filesystem::exists(root / "out/Dir1/block_1.png"));
+    EXPECT_TRUE(std::filesystem::is_empty(root / "out/Dir2"));
+    EXPECT_TRUE(std::filesystem::is_empty(root / "out/Dirrand"));
+    EXPECT_FALSE(std::filesystem::exists(root / "out/tau/0000.txt"));
+    EXPECT_EQ(readFile(root / "out/tau/0002.txt"), "0 0\n");
+    EXPECT_EQ(readFile(root / "out/readme.txt"), "kept");
+
+    EXPECT_THROW(mergeDatasetShards({(root / "s0").string()}, (root / "s0").string()), std::runtime_error);
+    std::filesystem::remove_all(root);
+}
+
+// Тест: возобновление шарда отбрасывает строку журнала, оборванную сбоем, удаляет блоки
+// незакоммиченных изображений и промежуточный каталог; готовый шард возобновляется повторно
+TEST(DatasetShards, ResumeDropsCutOffImageAndStaleBlocks) {
+    ScratchDir scratch("gbo_dataset_resume_test");
+    const AttackPlan plan = AttackPlan::defaultPlan();
+    const std::string header = manifestHeader(plan, 2, secondHalf(), 9);
+    writeFile("s/checkpoint.txt", header + "image 5 1 0 0\nimage 6 1");
+    writeFile("s/Dir1/0005_000000.png", "kept");
+    writeFile("s/Dir1/0006_000000.png", "cut off");
+    writeFile("s/Dir2/0006_000001.png", "cut off");
+    writeFile("s/.staging/Dir1/0007_000000.png", "staged");
+
+    buildDatasetShard(plan, 2, secondHalf(), "s", 0, true);
+    EXPECT_EQ(readFile("s/shard.txt"), header + "image 5 1 0 0\n");
+    EXPECT_TRUE(std::filesystem::exists("s/Dir1/0005_000000.png"));
+    EXPECT_FALSE(std::filesystem::exists("s/Dir1/0006_000000.png"));
+    EXPECT_FALSE(std::filesystem::exists("s/Dir2/0006_000001.png"));
+    EXPECT_FALSE(std::filesystem::exists("s/.staging"));
+
+    // shard.txt -> checkpoint.txt -> shard.txt
+    buildDatasetShard(plan, 2, secondHalf(), "s", 9, true);
+    EXPECT_EQ(readFile("s/shard.txt"), header + "image 5 1 0 0\n");
+    EXPECT_FALSE(std::filesystem::exists("s/checkpoint.txt"));
+}
+
+// Тест: в одиночном запуске сохраняются block_N с N меньше закоммиченного счетчика класса,
+// остальные удаляются; контрольная точка убирается после завершения
+TEST(DatasetShards, ResumeKeepsCommittedNumbering) {
+    ScratchDir scratch("gbo_dataset_numbering_test");
+    const AttackPlan plan = AttackPlan::defaultPlan();
+    writeFile("dataset/checkpoint.txt", manifestHeader(plan, 2, DatasetShard(), 9) + "image 0 2 0 1\n");
+    for (const char* block : {"Dir1/block_0", "Dir1/block_1", "Dir1/block_2", "Dirrand/block_0", "Dirrand/block_1"}) {
+        writeFile(std::string("dataset/") + block + ".png", block);
+    }
+
+    buildDataset(plan, 2, 0, true);
+    EXPECT_TRUE(std::filesystem::exists("dataset/Dir1/block_0.png"));
+    EXPECT_TRUE(std::filesystem::exists("dataset/Dir1/block_1.png"));
+    EXPECT_FALSE(std::filesystem::exists("dataset/Dir1/block_2.png"));
+    EXPECT_TRUE(std::filesystem::exists("dataset/Dirrand/block_0.png"));
+    EXPECT_FALSE(std::filesystem::exists("dataset/Dirrand/block_1.png"));
+    EXPECT_FALSE(std::filesystem::exists("dataset/checkpoint.txt"));
+}
+
+// Тест: возобновление с другими tau_max, планом или seed отклоняется, без контрольной точки - тоже;
+// новый запуск без --resume удаляет блоки и tau предыдущего
+TEST(DatasetShards, ResumeRejectsOtherSettingsAndFreshRunClears) {
+    ScratchDir scratch("gbo_dataset_settings_test");
+    const AttackPlan plan = AttackPlan::defaultPlan();
+    EXPECT_THROW(buildDatasetShard(plan, 2, secondHalf(), "s", 9, true), std::runtime_error);
+
+    writeFile("s/checkpoint.txt", manifestHeader(plan, 2, secondHalf(), 9) + "image 4 0 1 0\n");
+    writeFile("s/Dir2/0004_000000.png", "committed");
+    EXPECT_THROW(buildDatasetShard(plan, 3, secondHalf(), "s", 0, true), std::runtime_error);
+    EXPECT_THROW(buildDatasetShard(AttackPlan::parse("jpeg50 jpeg 50\n"), 2, secondHalf(), "s", 0, true), std::runtime_error);
+    EXPECT_THROW(buildDatasetShard(plan, 2, secondHalf(), "s", 5, true), std::runtime_error);
+    EXPECT_TRUE(std::filesystem::exists("s/Dir2/0004_000000.png"));
+
+    writeFile("s/tau/0004.txt", "0 3\n");
+    buildDatasetShard(plan, 2, secondHalf(), "s", 5);
+    EXPECT_FALSE(std::filesystem::exists("s/Dir2/0004_000000.png"));
+    EXPECT_FALSE(std::filesystem::exists("s/tau/0004.txt"));
+    EXPECT_EQ(readFile("s/shard.txt"), manifestHeader(plan, 2, secondHalf(), 5));
+}
+
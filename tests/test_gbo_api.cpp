@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+#include "gbo_api.h"
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+std::vector<unsigned char> makeImage(int width, int height, size_t stride) {
+    std::vector<unsigned char> pixels(stride * height, 0);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            pixels[y * stride + x] = static_cast<unsigned char>(60 + (7 * x + 13 * y) % 120);
+        }
+    }
+    return pixels;
+}
+
+} // namespace
+
+// Тест: при фиксированном seed результат не зависит от числа потоков
+TEST(GboApi, SeededEmbedIsThreadCountIndependent) {
+    const int size = 32;
+    const unsigned char bits[4] = {1, 0, 1, 1};
+    std::vector<unsigned char> a = makeImage(size, size, size);
+    std::vector<unsigned char> b = a;
+
+    gbo::Config config;
+    config.seed = 42;
+    config.iterations = 5;
+    config.threads = 1;
+    gbo::embed({a.data(), size, size, static_cast<size_t>(size)}, bits, 4, config);
+    config.threads = 4;
+    gbo::embed({b.data(), size, size, static_cast<size_t>(size)}, bits, 4, config);
+
+    ASSERT_EQ(a, b);
+}
+
+// Тест: изображение с выравниванием строк (stride > width) обрабатывается так же, как плотное
+TEST(GboApi, StridedBufferMatchesContiguous) {
+    const int size = 16;
+    const size_t stride = 24;
+    const unsigned char bits[2] = {1, 0};
+    std::vector<unsigned char> dense = makeImage(size, size, size);
+    std::vector<unsigned char> padded = makeImage(size, size, stride);
+
+    gbo::Config config;
+    config.seed = 7;
+    config.iterations = 5;
+    gbo::embed({dense.data(), size, size, static_cast<size_t>(size)}, bits, 2, config);
+    gbo::embed({padded.data(), size, size, stride}, bits, 2, config);
+
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            ASSERT_EQ(dense[y * size + x], padded[y * stride + x]);
+        }
+        // Байты выравнивания не должны изменяться
+        for (size_t x = size; x < stride; ++x) {
+            ASSERT_EQ(padded[y * stride + x], 0);
+        }
+    }
+}
+
+// Тест: встроенные биты извлекаются обратно
+TEST(GboApi, EmbedExtractRoundTrip) {
+    const int size = 32;
+    const unsigned char bits[4] = {1, 0, 0, 1};
+    std::vector<unsigned char> pixels = makeImage(size, size, size);
+    gbo::ImageView view{pixels.data(), size, size, static_cast<size_t>(size)};
+
+    gbo::Config config;
+    config.seed = 1;
+    gbo::embed(view, bits, 4, config);
+
+    unsigned char extracted[4] = {};
+    gbo::extract(view, extracted, 4, config);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(extracted[i], bits[i]);
+    }
+}
+
+// Тест: слепое извлечение определяет схему встраивания и восстанавливает биты
+TEST(GboApi, BlindExtractionDetectsScheme) {
+    const int size = 64;
+    unsigned char bits[16];
+    for (int i = 0; i < 16; ++i) bits[i] = static_cast<unsigned char>((i * 5 + 1) % 3 == 0);
+
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        std::vector<unsigned char> pixels = makeImage(size, size, size);
+        gbo::ImageView view{pixels.data(), size, size, static_cast<size_t>(size)};
+        gbo::Config config;
+        config.seed = 11;
+        config.scheme = scheme;
+        gbo::embed(view, bits, 16, config);
+
+        gbo::Config blind;
+        blind.seed = 11;
+        blind.scheme = 1 - scheme;  // игнорируется
+        unsigned char extracted[16] = {};
+        gbo::BlindExtraction result = gbo::extractBlind(view, extracted, 16, blind);
+        EXPECT_EQ(result.scheme, scheme);
+        EXPECT_GT(result.confidence, 0.0);
+        EXPECT_GT(result.consistency[scheme], result.consistency[1 - scheme]);
+        for (int i = 0; i < 16; ++i) {
+            EXPECT_EQ(extracted[i], bits[i]);
+        }
+    }
+}
+
+// Тест: тёплый старт от соседей (волновой фронт) не зависит от числа потоков и сохраняет биты
+TEST(GboApi, WavefrontWarmStartIsDeterministic) {
+    const int size = 32;
+    const unsigned char bits[4] = {0, 1, 1, 0};
+    std::vector<unsigned char> a = makeImage(size, size, size);
+    std::vector<unsigned char> b = a;
+
+    gbo::Config config;
+    config.seed = 5;
+    config.iterations = 10;
+    config.warm_start = gbo::WarmStart::Wavefront;
+    config.threads = 1;
+    gbo::embed({a.data(), size, size, static_cast<size_t>(size)}, bits, 4, config);
+    config.threads = 3;
+    gbo::embed({b.data(), size, size, static_cast<size_t>(size)}, bits, 4, config);
+    ASSERT_EQ(a, b);
+
+    unsigned char extracted[4] = {};
+    gbo::extract({a.data(), size, size, static_cast<size_t>(size)}, extracted, 4, config);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(extracted[i], bits[i]);
+    }
+}
+
+// Тест: отменённое встраивание всё равно записывает все биты и сообщает о каждом блоке
+TEST(GboApi, CancelledEmbedFallsBackAndReports) {
+    const int size = 32;
+    const unsigned char bits[4] = {1, 1, 0, 1};
+    std::vector<unsigned char> pixels = makeImage(size, size, size);
+    gbo::ImageView view{pixels.data(), size, size, static_cast<size_t>(size)};
+
+    auto token = std::make_shared<gbo::CancellationToken>();
+    token->cancel();
+    std::vector<size_t> done;
+    gbo::Config config;
+    config.seed = 3;
+    config.threads = 2;
+    config.cancellation = token;
+    config.progress = [&](const gbo::EmbedProgress& progress) {
+        EXPECT_EQ(progress.blocks, 16u);
+        done.push_back(progress.blocks_done);
+    };
+    const gbo::EmbedStats stats = gbo::embed(view, bits, 4, config);
+
+    EXPECT_TRUE(stats.cancelled);
+    EXPECT_EQ(stats.evaluations, 0u);
+    ASSERT_EQ(stats.out_of_budget.size(), 16u);
+    for (size_t i = 0; i < stats.out_of_budget.size(); ++i) {
+        EXPECT_EQ(stats.out_of_budget[i].block, i);
+        EXPECT_FALSE(stats.out_of_budget[i].searched);
+        EXPECT_GT(stats.out_of_budget[i].margin, 0.0);
+    }
+    ASSERT_EQ(done.size(), 16u);
+    EXPECT_EQ(*std::max_element(done.begin(), done.end()), 16u);
+
+    // Извлечению не на что отступить: отменённый вызов бросает исключение
+    unsigned char extracted[4] = {};
+    EXPECT_THROW(gbo::extract(view, extracted, 4, config), std::runtime_error);
+    EXPECT_THROW(gbo::extractBlind(view, extracted, 4, config), std::runtime_error);
+    config.cancellation.reset();
+    gbo::extract(view, extracted, 4, config);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(extracted[i], bits[i]);
+    }
+}
+
+// Тест: исчерпанный бюджет блока останавливает поиск после начальной популяции
+TEST(GboApi, BlockTimeBudgetStopsSearch) {
+    const int size = 16;
+    const unsigned char bits[2] = {0, 1};
+    std::vector<unsigned char> pixels = makeImage(size, size, size);
+
+    gbo::Config config;
+    config.seed = 11;
+    config.block_time_budget_ms = 1e-6;
+    const gbo::EmbedStats stats = gbo::embed({pixels.data(), size, size, static_cast<size_t>(size)}, bits, 2, config);
+
+    EXPECT_FALSE(stats.cancelled);
+    ASSERT_EQ(stats.out_of_budget.size(), stats.blocks);
+    for (const gbo::BudgetOverrun& overrun : stats.out_of_budget) {
+        EXPECT_TRUE(overrun.searched);
+    }
+    // Только начальная популяция из 30 особей на блок
+    EXPECT_EQ(stats.evaluations, 30u * stats.blocks);
+}
+
+// Тест: размеры, не кратные 8, отклоняются
+TEST(GboApi, RejectsInvalidSize) {
+    std::vector<unsigned char> pixels(12 * 12, 128);
+    unsigned char bit = 1;
+    gbo::ImageView view{pixels.data(), 12, 12, 12};
+    ASSERT_THROW(gbo::embed(view, &bit, 1), std::invalid_argument);
+    ASSERT_THROW(gbo::extract(view, &bit, 1), std::invalid_argument);
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+#include "jpeg_coefficients.h"
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include <jpeglib.h>
+
+namespace {
+
+// Encodes a synthetic grayscale gradient with libjpeg at the given quality
+std::vector<unsigned char> makeGrayJpeg(int width, int height, int quality) {
+    std::vector<unsigned char> pixels(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            pixels[y * width + x] = static_cast<unsigned char>((x * 5 + y * 3 + (x * y) % 17) % 256);
+        }
+    }
+
+    jpeg_compress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_compress(&cinfo);
+    unsigned char* buffer = nullptr;
+    unsigned long size = 0;
+    jpeg_mem_dest(&cinfo, &buffer, &size);
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = 1;
+    cinfo.in_color_space = JCS_GRAYSCALE;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        JSAMPROW row = &pixels[cinfo.next_scanline * width];
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    std::vector<unsigned char> out(buffer, buffer + size);
+    jpeg_destroy_compress(&cinfo);
+    std::free(buffer);
+    return out;
+}
+
+} // namespace
+
+// Тест: коэффициенты читаются без декодирования, размеры в блоках корректны
+TEST(JpegCoefficients, ReadsGrayscaleLayout) {
+    JpegCoefficientImage image = JpegCoefficientImage::fromBytes(makeGrayJpeg(64, 40, 75));
+    ASSERT_EQ(image.width(), 64);
+    ASSERT_EQ(image.height(), 40);
+    ASSERT_EQ(image.components.size(), 1u);
+    EXPECT_EQ(image.components[0].width_in_blocks, 8);
+    EXPECT_EQ(image.components[0].height_in_blocks, 5);
+    EXPECT_GT(image.components[0].quant[0], 0);
+}
+
+// Тест: запись без изменений сохраняет все коэффициенты без потерь
+TEST(JpegCoefficients, RoundTripIsLossless) {
+    JpegCoefficientImage image = JpegCoefficientImage::fromBytes(makeGrayJpeg(64, 64, 80));
+    JpegCoefficientImage copy = JpegCoefficientImage::fromBytes(image.encode());
+    ASSERT_EQ(copy.components[0].coefficients, image.components[0].coefficients);
+    ASSERT_EQ(copy.components[0].quant, image.components[0].quant);
+}
+
+// Тест: изменённые коэффициенты записываются точно
+TEST(JpegCoefficients, WritesModifiedCoefficients) {
+    JpegCoefficientImage image = JpegCoefficientImage::fromBytes(makeGrayJpeg(32, 32, 90));
+    int16_t* block = image.components[0].block(1, 2);
+    block[9] = static_cast<int16_t>(block[9] + 5);
+    block[17] = -3;
+
+    JpegCoefficientImage copy = JpegCoefficientImage::fromBytes(image.encode());
+    ASSERT_EQ(copy.components[0].coefficients, image.components[0].coefficients);
+}
+
+// Тест: повреждённые данные приводят к исключению, а не к завершению процесса
+TEST(JpegCoefficients, RejectsInvalidData) {
+    std::vector<unsigned char> garbage(100, 0x42);
+    ASSERT_THROW(JpegCoefficientImage::fromBytes(garbage), std::runtime_error);
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include "jpeg_coefficients.h"
+#include "jpeg_simulator.h"
+#include <vector>
+
+namespace {
+
+cv::Mat texturedImage(int rows, int cols) {
+    cv::Mat image(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            const int edge = ((x / 5 + y / 3) % 2) * 90;
+            image.at<unsigned char>(y, x) = static_cast<unsigned char>((x * 13 + y * 7 + x * y + edge) % 256);
+        }
+    }
+    return image;
+}
+
+std::vector<unsigned char> encode(const cv::Mat& image, int quality) {
+    std::vector<unsigned char> bytes;
+    cv::imencode(".jpg", image, bytes, {cv::IMWRITE_JPEG_QUALITY, quality});
+    return bytes;
+}
+
+} // namespace
+
+// Тест: таблица квантования совпадает с jpeg_set_quality
+TEST(JpegSimulator, LuminanceTable) {
+    const std::array<uint16_t, 64> q50 = jpegLuminanceTable(50);
+    EXPECT_EQ(q50[0], 16);
+    EXPECT_EQ(q50[63], 99);
+    EXPECT_EQ(jpegLuminanceTable(90)[0], 3);
+    EXPECT_EQ(jpegLuminanceTable(100)[17], 1);
+    EXPECT_EQ(jpegLuminanceTable(1)[63], 255);
+    EXPECT_THROW(jpegLuminanceTable(0), std::invalid_argument);
+}
+
+// Тест: изображение после симулятора совпадает с кодированием и декодированием через OpenCV, включая края
+TEST(JpegSimulator, MatchesCodecRoundTrip) {
+    // Размеры не кратны 8: края дополняются, как в кодере
+    const cv::Mat image = texturedImage(45, 61);
+    for (int quality : {10, 50, 70, 90, 100}) {
+        const cv::Mat decoded = cv::imdecode(encode(image, quality), cv::IMREAD_GRAYSCALE);
+        const cv::Mat simulated = simulateJpeg(image, quality);
+        EXPECT_EQ(cv::countNonZero(decoded != simulated), 0) << "quality " << quality;
+        EXPECT_EQ(cv::countNonZero(JpegSimulator(quality).compress(image, 3) != simulated), 0);
+    }
+}
+
+// Тест: квантованные коэффициенты блока совпадают с записанными в файл, блок обрабатывается так же, как в изображении
+TEST(JpegSimulator, BlockMatchesStoredCoefficients) {
+    const cv::Mat image = texturedImage(32, 40);
+    const JpegSimulator simulator(75);
+    const JpegCoefficientImage jpeg = JpegCoefficientImage::fromBytes(encode(image, 75));
+    const JpegComponent& luma = jpeg.components[0];
+    ASSERT_EQ(std::vector<uint16_t>(luma.quant.begin(), luma.quant.end()),
+              std::vector<uint16_t>(simulator.table().begin(), simulator.table().end()));
+
+    const cv::Mat whole = simulator.compress(image);
+    for (int by = 0; by < 4; ++by) {
+        for (int bx = 0; bx < 5; ++bx) {
+            const cv::Mat block = image(cv::Rect(bx * 8, by * 8, 8, 8));
+            int16_t coefs[64];
+            simulator.quantizeBlock(block.ptr<uint8_t>(0), block.step, coefs);
+            const int16_t* stored = luma.block(by, bx);
+            for (int i = 0; i < 64; ++i) EXPECT_EQ(coefs[i], stored[i]);
+            EXPECT_EQ(cv::countNonZero(simulator.compressBlock(block) != whole(cv::Rect(bx * 8, by * 8, 8, 8))), 0);
+        }
+    }
+    EXPECT_THROW(simulator.compressBlock(image), std::invalid_argument);
+}
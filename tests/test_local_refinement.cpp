@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include "analytic_embed.h"
+#include "gbo_api.h"
+#include "local_refinement.h"
+#include "process_block.h"
+#include "random_utils.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const int refine_steps = 50;
+
+cv::Mat texturedBlock() {
+    cv::Mat block(8, 8, CV_8UC1);
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) block.at<unsigned char>(y, x) = static_cast<unsigned char>(70 + (x * 23 + y * 11 + x * y * 3) % 110);
+    }
+    return block;
+}
+
+} // namespace
+
+// Тест: аналитический градиент релаксации совпадает с конечными разностями
+TEST(LocalRefinement, GradientMatchesFiniteDifferences) {
+    double magnitudes[64];
+    blockMagnitudes(texturedBlock(), magnitudes);
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        for (unsigned char bit = 0; bit < 2; ++bit) {
+            const size_t n = embeding_region[scheme].size();
+            arma::vec vec(n);
+            for (size_t idx = 0; idx < n; ++idx) vec(idx) = 0.5 + 0.25 * static_cast<double>(idx % 7);
+            arma::vec gradient;
+            relaxedFitness(magnitudes, bit, scheme, pixel_rounding_mse, vec, &gradient);
+            ASSERT_EQ(gradient.n_elem, n);
+
+            const double h = 1e-6;
+            for (size_t idx = 0; idx < n; ++idx) {
+                arma::vec plus = vec, minus = vec;
+                plus(idx) += h;
+                minus(idx) -= h;
+                const double numeric = (relaxedFitness(magnitudes, bit, scheme, pixel_rounding_mse, plus) -
+                                        relaxedFitness(magnitudes, bit, scheme, pixel_rounding_mse, minus)) / (2.0 * h);
+                EXPECT_NEAR(gradient(idx), numeric, 1e-6);
+            }
+        }
+    }
+}
+
+// Тест: уточнение не ухудшает точную приспособленность и тратит не больше трёх точных вычислений
+TEST(LocalRefinement, RefinementNeverWorsensExactFitness) {
+    const cv::Mat block = texturedBlock();
+    double magnitudes[64];
+    blockMagnitudes(block, magnitudes);
+    for (unsigned char bit = 0; bit < 2; ++bit) {
+        const size_t n = embeding_region[0].size();
+        auto fitness = [&](const arma::vec& vec) { return calcFitnessValue(block, vec, bit, 0); };
+
+        OptimizerResult start;
+        start.best = arma::zeros<arma::vec>(n);
+        start.best_fitness = fitness(start.best);
+        start.evaluations = 1;
+
+        const arma::vec relaxed = refineRelaxed(magnitudes, bit, 0, pixel_rounding_mse, start.best, 10.0, refine_steps);
+        EXPECT_LT(relaxedFitness(magnitudes, bit, 0, pixel_rounding_mse, relaxed),
+                  relaxedFitness(magnitudes, bit, 0, pixel_rounding_mse, start.best));
+
+        const OptimizerResult refined = refineVector(magnitudes, bit, 0, pixel_rounding_mse, start, 10.0,
+                                                     refine_steps, fitness);
+        EXPECT_LE(refined.best_fitness, start.best_fitness);
+        EXPECT_LE(refined.evaluations, start.evaluations + 3);
+        EXPECT_DOUBLE_EQ(refined.best_fitness, fitness(refined.best));
+    }
+}
+
+// Тест: короткий поиск с уточнением встраивает и извлекает все биты
+TEST(LocalRefinement, ApiRoundTripWithShortSearch) {
+    const int size = 32;
+    std::vector<unsigned char> pixels(size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) pixels[y * size + x] = static_cast<unsigned char>(60 + (7 * x + 13 * y) % 120);
+    }
+    const unsigned char bits[4] = {0, 1, 0, 1};
+    gbo::ImageView view{pixels.data(), size, size, static_cast<size_t>(size)};
+
+    gbo::Config config;
+    config.seed = 6;
+    config.iterations = 1;
+    config.refine_steps = refine_steps;
+    gbo::embed(view, bits, 4, config);
+
+    unsigned char extracted[4] = {};
+    gbo::extract(view, extracted, 4, config);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(extracted[i], bits[i]);
+    }
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "gbo.h"
+#include "gbo_api.h"
+#include "lockstep_gbo.h"
+#include "process_block.h"
+#include "random_utils.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+cv::Mat texturedBlock(int variant) {
+    cv::Mat block(8, 8, CV_8UC1);
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            block.at<unsigned char>(y, x) = static_cast<unsigned char>(40 + (x * (17 + variant) + y * 29 + x * y * variant) % 180);
+        }
+    }
+    return block;
+}
+
+} // namespace
+
+// Тест: пакетная приспособленность совпадает с calcFitnessValue в каждой полосе, в том числе для неполной группы
+TEST(LockstepGbo, BatchFitnessMatchesScalar) {
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        std::vector<cv::Mat> blocks;
+        std::vector<unsigned char> bits;
+        for (int k = 0; k < lockstep_lanes - 3; ++k) {
+            blocks.push_back(texturedBlock(k));
+            bits.push_back(static_cast<unsigned char>(k % 2));
+        }
+        const BlockBatch batch(blocks, bits, scheme);
+        const int n = batch.dimension();
+        std::vector<double> vectors(static_cast<size_t>(n) * lockstep_lanes);
+        std::vector<arma::vec> candidates(blocks.size(), arma::vec(n));
+        for (size_t k = 0; k < blocks.size(); ++k) {
+            for (int idx = 0; idx < n; ++idx) {
+                candidates[k](idx) = 9.0 * std::sin(1.3 * idx + 2.1 * k);
+                vectors[idx * lockstep_lanes + k] = candidates[k](idx);
+            }
+        }
+        double fitness[lockstep_lanes];
+        batch.evaluate(vectors.data(), fitness);
+        for (size_t k = 0; k < blocks.size(); ++k) {
+            EXPECT_NEAR(fitness[k], calcFitnessValue(blocks[k], candidates[k], bits[k], scheme), 1e-9);
+        }
+    }
+}
+
+// Тест: результат полосы зависит только от её блока и seed, а не от соседних полос
+TEST(LockstepGbo, LaneResultIndependentOfGroup) {
+    std::vector<LockstepLane> group(lockstep_lanes);
+    for (int k = 0; k < lockstep_lanes; ++k) {
+        group[k].block = texturedBlock(k);
+        group[k].bit = static_cast<unsigned char>(k % 2);
+        group[k].seed = 100 + k;
+    }
+    const LockstepGbo engine(3);
+    const std::vector<OptimizerResult> together = engine.run(group, 0);
+    ASSERT_EQ(together.size(), group.size());
+
+    for (int k : {0, 5}) {
+        const std::vector<OptimizerResult> alone = engine.run({group[k]}, 0);
+        ASSERT_EQ(alone.size(), 1u);
+        ASSERT_EQ(alone[0].best.n_elem, together[k].best.n_elem);
+        for (arma::uword idx = 0; idx < alone[0].best.n_elem; ++idx) {
+            EXPECT_EQ(alone[0].best(idx), together[k].best(idx));
+        }
+        EXPECT_DOUBLE_EQ(alone[0].best_fitness, together[k].best_fitness);
+        EXPECT_NEAR(alone[0].best_fitness, calcFitnessValue(group[k].block, alone[0].best, group[k].bit, 0), 1e-9);
+    }
+}
+
+// Тест: одна полоса с тем же seed повторяет GBO::main_loop и GBO::optimize: тот же вектор и то же число вычислений
+TEST(LockstepGbo, SingleLaneMatchesGbo) {
+    const int iterations = 4;
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        for (unsigned char bit = 0; bit < 2; ++bit) {
+            LockstepLane lane;
+            lane.block = texturedBlock(3 + scheme);
+            lane.bit = bit;
+            lane.seed = 40 + 2 * scheme + bit;
+            const int n = static_cast<int>(embeding_region[scheme].size());
+            if (bit == 1) {
+                arma::vec seed(n);
+                for (int idx = 0; idx < n; ++idx) seed(idx) = 3.0 * std::cos(0.7 * idx);
+                lane.seeds.push_back(seed);
+            }
+
+            const std::vector<OptimizerResult> lockstep = LockstepGbo(iterations).run({lane}, scheme);
+            ASSERT_EQ(lockstep.size(), 1u);
+
+            seed_thread_random(lane.seed);
+            GBO gbo(iterations);
+            gbo.seeds = lane.seeds;
+            cv::Mat block = lane.block.clone();
+            const cv::Mat marked = gbo.main_loop(block, n, bit, scheme);
+            ASSERT_EQ(gbo.best.n_elem, lockstep[0].best.n_elem);
+            for (int idx = 0; idx < n; ++idx) {
+                EXPECT_EQ(gbo.best(idx), lockstep[0].best(idx));
+            }
+            EXPECT_EQ(cv::countNonZero(marked != applyVectorToBlock(lockstep[0].best, lane.block, scheme)), 0);
+
+            size_t evaluations = 0;
+            seed_thread_random(lane.seed);
+            GBO counted(iterations);
+            counted.seeds = lane.seeds;
+            const arma::vec best = counted.optimize(n, [&](const arma::vec& vec) {
+                evaluations++;
+                return calcFitnessValue(lane.block, vec, bit, scheme);
+            });
+            EXPECT_EQ(evaluations, lockstep[0].evaluations);
+            for (int idx = 0; idx < n; ++idx) {
+                EXPECT_EQ(best(idx), lockstep[0].best(idx));
+            }
+            EXPECT_NEAR(lockstep[0].best_fitness, calcFitnessValue(lane.block, best, bit, scheme), 1e-9);
+        }
+    }
+}
+
+// Тест: встраивание через API в режиме lockstep извлекается без ошибок и воспроизводимо
+TEST(LockstepGbo, ApiRoundTrip) {
+    const int size = 32;
+    std::vector<unsigned char> pixels(size * size);
+    for (int i = 0; i < size * size; ++i) pixels[i] = static_cast<unsigned char>(50 + (i * 37) % 150);
+    std::vector<unsigned char> copy = pixels;
+    const unsigned char bits[4] = {1, 0, 0, 1};
+
+    gbo::Config config;
+    config.seed = 11;
+    config.iterations = 5;
+    config.lockstep = true;
+    config.warm_start = gbo::WarmStart::Analytic;
+    const gbo::EmbedStats stats = gbo::embed({pixels.data(), size, size, static_cast<size_t>(size)}, bits, 4, config);
+    EXPECT_EQ(stats.evaluations, stats.blocks * 30 * 6);
+    config.threads = 3;
+    gbo::embed({copy.data(), size, size, static_cast<size_t>(size)}, bits, 4, config);
+    EXPECT_EQ(pixels, copy);
+
+    unsigned char extracted[4] = {};
+    gbo::extract(gbo::ConstImageView(pixels.data(), size, size, size), extracted, 4, config);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(extracted[i], bits[i]);
+    }
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+cv::Mat patternImage(int rows, int cols, int variant) {
+    cv::Mat image(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            image.at<unsigned char>(y, x) = static_cast<unsigned char>((x * (7 + variant) + y * 13 + x * y * variant) % 256);
+        }
+    }
+    return image;
+}
+
+// SSIM по формуле с промежуточными матрицами OpenCV
+double referenceSsim(const cv::Mat& img1, const cv::Mat& img2) {
+    const double C1 = 6.5025, C2 = 58.5225;
+    cv::Mat a, b, mu1, mu2, s11, s22, s12;
+    img1.convertTo(a, CV_32F);
+    img2.convertTo(b, CV_32F);
+    cv::GaussianBlur(a, mu1, cv::Size(11, 11), 1.5);
+    cv::GaussianBlur(b, mu2, cv::Size(11, 11), 1.5);
+    cv::GaussianBlur(a.mul(a), s11, cv::Size(11, 11), 1.5);
+    cv::GaussianBlur(b.mul(b), s22, cv::Size(11, 11), 1.5);
+    cv::GaussianBlur(a.mul(b), s12, cv::Size(11, 11), 1.5);
+    cv::Mat mu1_mu2 = mu1.mul(mu2), mu1_sq = mu1.mul(mu1), mu2_sq = mu2.mul(mu2);
+    cv::Mat numerator = (2 * mu1_mu2 + C1).mul(2 * (s12 - mu1_mu2) + C2);
+    cv::Mat denominator = (mu1_sq + mu2_sq + C1).mul(s11 - mu1_sq + s22 - mu2_sq + C2);
+    cv::Mat map;
+    cv::divide(numerator, denominator, map);
+    return cv::mean(map)[0];
+}
+
+} // namespace
+
+// Тест: MSE, PSNR и NCC за один проход совпадают с прямым расчетом в double, SSIM — с расчетом через матрицы
+TEST(Metrics, FusedMatchesReference) {
+    const cv::Mat img1 = patternImage(40, 56, 1);
+    // Несплошная матрица: проход по строкам
+    const cv::Mat img2 = patternImage(48, 64, 3)(cv::Rect(4, 4, 56, 40));
+
+    double sum1 = 0.0, sum2 = 0.0, squared = 0.0;
+    for (int y = 0; y < img1.rows; ++y) {
+        for (int x = 0; x < img1.cols; ++x) {
+            const double a = img1.at<unsigned char>(y, x), b = img2.at<unsigned char>(y, x);
+            sum1 += a;
+            sum2 += b;
+            squared += (a - b) * (a - b);
+        }
+    }
+    const double n = static_cast<double>(img1.total());
+    double covariance = 0.0, energy1 = 0.0, energy2 = 0.0;
+    for (int y = 0; y < img1.rows; ++y) {
+        for (int x = 0; x < img1.cols; ++x) {
+            const double a = img1.at<unsigned char>(y, x) - sum1 / n, b = img2.at<unsigned char>(y, x) - sum2 / n;
+            covariance += a * b;
+            energy1 += a * a;
+            energy2 += b * b;
+        }
+    }
+
+    const ImageQuality quality = computeImageQuality(img1, img2);
+    EXPECT_NEAR(quality.mse, squared / n, 1e-9);
+    EXPECT_NEAR(quality.psnr, 10.0 * std::log10(255.0 * 255.0 / (squared / n)), 1e-9);
+    EXPECT_NEAR(quality.ncc, covariance / std::sqrt(energy1 * energy2), 1e-9);
+    EXPECT_NEAR(quality.ssim, referenceSsim(img1, img2), 1e-5);
+
+    EXPECT_DOUBLE_EQ(computeMSE(img1, img2), quality.mse);
+    EXPECT_DOUBLE_EQ(computePSNR(img1, img2), quality.psnr);
+    EXPECT_DOUBLE_EQ(computeNCC(img1, img2), quality.ncc);
+    EXPECT_DOUBLE_EQ(computeSSIM(img1, img2), quality.ssim);
+}
+
+// Тест: одинаковые изображения, однотонное изображение и несовпадающие размеры
+TEST(Metrics, EdgeCases) {
+    const cv::Mat image = patternImage(32, 32, 2);
+    const ImageQuality same = computeImageQuality(image, image);
+    EXPECT_EQ(same.mse, 0.0);
+    EXPECT_EQ(same.psnr, 0.0);
+    EXPECT_NEAR(same.ncc, 1.0, 1e-12);
+    EXPECT_NEAR(same.ssim, 1.0, 1e-6);
+
+    const cv::Mat flat(32, 32, CV_8UC1, cv::Scalar(90));
+    EXPECT_EQ(computeImageQuality(image, flat, MetricsEngine::Pixel).ncc, 0.0);
+
+    const cv::Mat smaller = patternImage(16, 32, 2);
+    EXPECT_THROW(computeImageQuality(image, smaller), std::invalid_argument);
+    EXPECT_EQ(computeMSE(image, smaller), -1.0);
+}
+
+// Тест: SSIM с кэшированной статистикой эталона совпадает с computeSSIM при любом числе потоков
+TEST(Metrics, CachedSsimMatchesComputeSsim) {
+    // Размеры не кратны ни плитке, ни блоку
+    const cv::Mat original = patternImage(75, 51, 1);
+    const cv::Mat test = patternImage(75, 51, 4);
+    const SsimReference reference(original);
+    const double expected = computeSSIM(original, test);
+    for (int threads : {1, 3, 0}) {
+        EXPECT_NEAR(reference.compare(test, threads), expected, 1e-5);
+    }
+    EXPECT_DOUBLE_EQ(reference.compare(test, 1), reference.compare(test, 4));
+    EXPECT_NEAR(reference.compare(original), 1.0, 1e-6);
+
+    const ImageQuality quality = computeImageQuality(reference, test);
+    EXPECT_DOUBLE_EQ(quality.mse, computeMSE(original, test));
+    EXPECT_NEAR(quality.ssim, expected, 1e-5);
+
+    EXPECT_THROW(reference.compare(patternImage(74, 51, 4)), std::invalid_argument);
+    EXPECT_THROW(SsimReference(cv::Mat(4, 4, CV_8UC1, cv::Scalar(0))), std::invalid_argument);
+}
+
+// Тест: карта SSIM по блокам; среднее по карте с весами размеров блоков равно общему SSIM
+TEST(Metrics, SsimBlockMap) {
+    const cv::Mat original = patternImage(44, 36, 2);
+    const cv::Mat test = patternImage(44, 36, 5);
+    const SsimReference reference(original);
+    cv::Mat map;
+    const double ssim = reference.compare(test, 2, &map, 8);
+    ASSERT_EQ(map.rows, 6);
+    ASSERT_EQ(map.cols, 5);
+    ASSERT_EQ(map.type(), CV_64FC1);
+
+    double weighted = 0.0;
+    for (int by = 0; by < map.rows; ++by) {
+        for (int bx = 0; bx < map.cols; ++bx) {
+            const int h = std::min(8, 44 - by * 8), w = std::min(8, 36 - bx * 8);
+            weighted += map.at<double>(by, bx) * h * w;
+        }
+    }
+    EXPECT_NEAR(weighted / (44 * 36), ssim, 1e-9);
+}
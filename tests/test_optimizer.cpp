@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "gbo_api.h"
+#include "optimizer.h"
+#include "random_utils.h"
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Сфера со сдвинутым минимумом в точке (1.5, ..., 1.5)
+OptimizerProblem sphereProblem(size_t* calls) {
+    OptimizerProblem problem;
+    problem.dimension = 5;
+    problem.lower = -4.0;
+    problem.upper = 4.0;
+    problem.max_evaluations = 600;
+    problem.fitness = [calls](const arma::vec& x) {
+        ++*calls;
+        double sum = 0.0;
+        for (arma::uword j = 0; j < x.n_elem; ++j) sum += (x(j) - 1.5) * (x(j) - 1.5);
+        return sum;
+    };
+    return problem;
+}
+
+} // namespace
+
+// Тест: каждый бэкенд укладывается в бюджет, остаётся в границах и улучшает значение в центре
+TEST(Optimizer, BackendsRespectBudgetAndImprove) {
+    for (const std::string& name : optimizerNames()) {
+        seed_thread_random(5);
+        size_t calls = 0;
+        OptimizerProblem problem = sphereProblem(&calls);
+        OptimizerResult result = makeOptimizer(name)->minimize(problem);
+
+        EXPECT_LE(calls, problem.max_evaluations) << name;
+        EXPECT_EQ(result.evaluations, calls) << name;
+        ASSERT_EQ(result.best.n_elem, 5u) << name;
+        for (arma::uword j = 0; j < result.best.n_elem; ++j) {
+            EXPECT_GE(result.best(j), problem.lower) << name;
+            EXPECT_LE(result.best(j), problem.upper) << name;
+        }
+        // В центре (0, ..., 0) значение равно 5 * 1.5^2 = 11.25
+        EXPECT_LT(result.best_fitness, 1.0) << name;
+    }
+}
+
+// Тест: начальная точка из seeds вычисляется и не теряется
+TEST(Optimizer, SeedIsEvaluated) {
+    for (const std::string& name : optimizerNames()) {
+        seed_thread_random(9);
+        size_t calls = 0;
+        OptimizerProblem problem = sphereProblem(&calls);
+        arma::vec optimum(5);
+        for (arma::uword j = 0; j < optimum.n_elem; ++j) optimum(j) = 1.5;
+        problem.seeds.push_back(optimum);
+        EXPECT_NEAR(makeOptimizer(name)->minimize(problem).best_fitness, 0.0, 1e-12) << name;
+    }
+}
+
+// Тест: неизвестное имя, пустая задача и бюджет меньше популяции GBO отклоняются
+TEST(Optimizer, RejectsInvalidProblems) {
+    ASSERT_THROW(makeOptimizer("annealing"), std::invalid_argument);
+
+    size_t calls = 0;
+    OptimizerProblem problem = sphereProblem(&calls);
+    problem.max_evaluations = 10;
+    ASSERT_THROW(GboOptimizer().minimize(problem), std::invalid_argument);
+    problem.max_evaluations = 100;
+    problem.upper = problem.lower;
+    ASSERT_THROW(CmaEs().minimize(problem), std::invalid_argument);
+
+    gbo::Config config;
+    config.optimizer = "annealing";
+    std::vector<unsigned char> pixels(64, 128);
+    const unsigned char bit = 1;
+    gbo::ImageView view{pixels.data(), 8, 8, 8};
+    ASSERT_THROW(gbo::embed(view, &bit, 1, config), std::invalid_argument);
+}
+
+// Тест: встраивание через API с бэкендами DE и CMA-ES извлекается без ошибок
+TEST(Optimizer, ApiRoundTripWithOtherBackends) {
+    const int size = 32;
+    const unsigned char bits[4] = {1, 0, 0, 1};
+    for (const char* name : {"de", "cmaes"}) {
+        std::vector<unsigned char> pixels(size * size);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) pixels[y * size + x] = static_cast<unsigned char>(60 + (7 * x + 13 * y) % 120);
+        }
+        gbo::ImageView view{pixels.data(), size, size, static_cast<size_t>(size)};
+
+        gbo::Config config;
+        config.seed = 4;
+        config.optimizer = name;
+        config.evaluations = 400;
+        gbo::embed(view, bits, 4, config);
+
+        unsigned char extracted[4] = {};
+        gbo::extract(view, extracted, 4, config);
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_EQ(extracted[i], bits[i]) << name;
+        }
+    }
+}
+
+// Тест: суррогат отсеивает кандидатов без точного вычисления, а бюджет кандидатов не превышается
+TEST(Optimizer, SurrogateScreensCandidates) {
+    for (const char* name : {"gbo", "de"}) {
+        seed_thread_random(5);
+        size_t calls = 0;
+        OptimizerProblem problem = sphereProblem(&calls);
+        problem.surrogate = [](const arma::vec& x) { return arma::accu(arma::square(x - 1.5)); };
+        problem.surrogate_tolerance = 0.0;
+        OptimizerResult result = makeOptimizer(name)->minimize(problem);
+
+        EXPECT_EQ(result.evaluations, calls) << name;
+        EXPECT_GT(result.screened, 0u) << name;
+        EXPECT_LE(result.evaluations + result.screened, problem.max_evaluations) << name;
+        EXPECT_LT(result.best_fitness, 1.0) << name;
+    }
+}
+
+// Тест: встраивание с суррогатом экономит точные вычисления и извлекается без ошибок
+TEST(Optimizer, ApiRoundTripWithSurrogate) {
+    const int size = 32;
+    const unsigned char bits[4] = {0, 1, 1, 0};
+    std::vector<unsigned char> pixels(size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) pixels[y * size + x] = static_cast<unsigned char>(60 + (7 * x + 13 * y) % 120);
+    }
+    gbo::ImageView view{pixels.data(), size, size, static_cast<size_t>(size)};
+
+    gbo::Config config;
+    config.seed = 8;
+    config.iterations = 10;
+    config.surrogate = true;
+    const gbo::EmbedStats stats = gbo::embed(view, bits, 4, config);
+    EXPECT_GT(stats.screened, 0u);
+    EXPECT_LE(stats.evaluations + stats.screened, stats.blocks * 30 * (config.iterations + 1));
+
+    unsigned char extracted[4] = {};
+    gbo::extract(view, extracted, 4, config);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(extracted[i], bits[i]);
+    }
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include "parallel.h"
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Восстанавливает режим планировщика после теста
+class ScheduleGuard {
+public:
+    explicit ScheduleGuard(Schedule mode) : previous_(schedule()) { setSchedule(mode); }
+    ~ScheduleGuard() { setSchedule(previous_); }
+
+private:
+    Schedule previous_;
+};
+
+} // namespace
+
+// Тест: каждый индекс выполняется ровно один раз при любом режиме и числе потоков
+TEST(Parallel, EveryIndexRunsOnce) {
+    for (Schedule mode : {Schedule::Static, Schedule::Stealing}) {
+        ScheduleGuard guard(mode);
+        for (int threads : {1, 2, 3, 8}) {
+            std::vector<std::atomic<int>> hits(257);
+            parallelFor(hits.size(), threads, [&](size_t i) { hits[i]++; });
+            for (size_t i = 0; i < hits.size(); ++i) {
+                EXPECT_EQ(hits[i].load(), 1) << "index " << i << ", threads " << threads;
+            }
+        }
+    }
+}
+
+// Тест: вложенные циклы (изображения -> блоки) покрывают все пары индексов
+TEST(Parallel, NestedLoopsCoverAllPairs) {
+    ScheduleGuard guard(Schedule::Stealing);
+    const size_t outer = 6, inner = 45;
+    std::vector<std::atomic<int>> hits(outer * inner);
+    parallelFor(outer, 0, [&](size_t a) {
+        parallelFor(inner, 0, [&](size_t b) { hits[a * inner + b]++; });
+    });
+    for (size_t i = 0; i < hits.size(); ++i) {
+        EXPECT_EQ(hits[i].load(), 1) << "pair " << i;
+    }
+}
+
+// Тест: исключение из задачи передаётся вызывающему потоку
+TEST(Parallel, RethrowsFirstException) {
+    ScheduleGuard guard(Schedule::Stealing);
+    EXPECT_THROW(parallelFor(100, 4, [](size_t i) {
+        if (i == 37) throw std::runtime_error("task failed");
+    }), std::runtime_error);
+    // Пул остаётся рабочим после ошибки
+    std::atomic<size_t> sum{0};
+    parallelFor(10, 4, [&](size_t i) { sum += i; });
+    EXPECT_EQ(sum.load(), 45u);
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+#include "pipeline.h"
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Каталог с входными изображениями 16x16; изображение i залито значением 10 * i
+class PipelineDir {
+public:
+    PipelineDir(const std::string& name, size_t count) : root_(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(root_);
+        std::filesystem::create_directories(root_);
+        for (size_t i = 0; i < count; ++i) {
+            const std::string input = (root_ / ("in_" + std::to_string(i) + ".png")).string();
+            cv::imwrite(input, cv::Mat(16, 16, CV_8UC1, cv::Scalar(10.0 * i)));
+            jobs_.push_back({input, (root_ / ("out_" + std::to_string(i) + ".png")).string()});
+        }
+    }
+    ~PipelineDir() { std::filesystem::remove_all(root_); }
+
+    const std::vector<PipelineJob>& jobs() const { return jobs_; }
+
+private:
+    std::filesystem::path root_;
+    std::vector<PipelineJob> jobs_;
+};
+
+// Значение первого пикселя изображения, -1 если его нет
+int firstPixel(const std::string& path) {
+    const cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    return image.empty() ? -1 : image.at<unsigned char>(0, 0);
+}
+
+} // namespace
+
+// Тест: очередь отдаёт элементы в порядке поступления, tryPush не превышает ёмкость,
+// а статистика глубины считается после каждого push
+TEST(BoundedQueue, FifoWithinCapacity) {
+    BoundedQueue<int> queue(2);
+    EXPECT_EQ(queue.capacity(), 2u);
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.tryPush(2));
+    EXPECT_FALSE(queue.tryPush(3));
+    EXPECT_EQ(queue.size(), 2u);
+    EXPECT_EQ(queue.maxDepth(), 2u);
+    EXPECT_DOUBLE_EQ(queue.meanDepth(), 1.5);
+
+    int item = 0;
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 1);
+    EXPECT_TRUE(queue.push(3));
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 2);
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 3);
+    EXPECT_EQ(queue.size(), 0u);
+    EXPECT_EQ(BoundedQueue<int>(0).capacity(), 1u);
+}
+
+// Тест: push ждёт, пока потребитель освободит место
+TEST(BoundedQueue, PushBlocksWhileFull) {
+    BoundedQueue<int> queue(1);
+    ASSERT_TRUE(queue.push(1));
+    std::thread producer([&] { EXPECT_TRUE(queue.push(2)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(queue.size(), 1u);
+
+    int item = 0;
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 1);
+    producer.join();
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 2);
+}
+
+// Тест: после close новые элементы не принимаются, оставшиеся вычитываются,
+// затем pop возвращает false; заблокированные push и pop просыпаются
+TEST(BoundedQueue, CloseDrainsThenStops) {
+    BoundedQueue<int> queue(2);
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+    std::thread blocked_producer([&] { EXPECT_FALSE(queue.push(3)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    queue.close();
+    blocked_producer.join();
+    EXPECT_FALSE(queue.push(4));
+    EXPECT_FALSE(queue.tryPush(4));
+
+    int item = 0;
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 1);
+    ASSERT_TRUE(queue.pop(item));
+    EXPECT_EQ(item, 2);
+    EXPECT_FALSE(queue.pop(item));
+
+    BoundedQueue<int> empty(1);
+    std::thread blocked_consumer([&] {
+        int value = 0;
+        EXPECT_FALSE(empty.pop(value));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    empty.close();
+    blocked_consumer.join();
+}
+
+// Тест: при одном изображении в работе изображения обрабатываются и записываются в порядке заданий
+TEST(Pipeline, WritesResultsInJobOrder) {
+    PipelineDir dir("gbo_pipeline_order_test", 6);
+    const std::vector<PipelineJob>& jobs = dir.jobs();
+    std::vector<int> processed;
+    std::vector<bool> in_order;
+
+    PipelineOptions options;
+    options.queue_capacity = 2;
+    options.on_progress = [&](const PipelineReport& report) {
+        // Written so far: exactly the first `completed` jobs
+        const size_t done = report.completed;
+        in_order.push_back(std::filesystem::exists(jobs[done - 1].output_path) &&
+                           (done == jobs.size() || !std::filesystem::exists(jobs[done].output_path)));
+    };
+    const PipelineReport report = runImagePipeline(jobs, [&](const cv::Mat& image) {
+        processed.push_back(image.at<unsigned char>(0, 0));
+        return cv::Mat(image + 1);
+    }, options);
+
+    EXPECT_EQ(report.completed, jobs.size());
+    EXPECT_EQ(report.total, jobs.size());
+    EXPECT_TRUE(report.errors.empty());
+    EXPECT_EQ(processed, std::vector<int>({0, 10, 20, 30, 40, 50}));
+    EXPECT_EQ(in_order, std::vector<bool>(jobs.size(), true));
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        EXPECT_EQ(firstPixel(jobs[i].output_path), static_cast<int>(10 * i + 1)) << "job " << i;
+    }
+}
+
+// Тест: исключение в обработке и нечитаемый вход проваливают только своё задание
+// и попадают в отчёт; остальные изображения записываются
+TEST(Pipeline, StageFailuresReachTheReport) {
+    PipelineDir dir("gbo_pipeline_errors_test", 4);
+    std::vector<PipelineJob> jobs = dir.jobs();
+    jobs[3].input_path += ".missing";
+
+    for (int in_flight : {1, 3}) {
+        PipelineOptions options;
+        options.images_in_flight = in_flight;
+        const PipelineReport report = runImagePipeline(jobs, [](const cv::Mat& image) {
+            if (image.at<unsigned char>(0, 0) == 10) throw std::runtime_error("stage failed");
+            return image.clone();
+        }, options);
+
+        EXPECT_EQ(report.completed, 2u);
+        ASSERT_EQ(report.errors.size(), 2u);
+        const std::string errors = report.errors[0] + "\n" + report.errors[1];
+        EXPECT_NE(errors.find(jobs[1].input_path + ": stage failed"), std::string::npos) << errors;
+        EXPECT_NE(errors.find("Could not open or find the image: " + jobs[3].input_path), std::string::npos) << errors;
+        EXPECT_EQ(report.stages[0].failures, 1u);
+        EXPECT_EQ(report.stages[1].failures, 2u);
+        EXPECT_EQ(report.stages[2].failures, 2u);
+        EXPECT_EQ(firstPixel(jobs[0].output_path), 0);
+        EXPECT_EQ(firstPixel(jobs[2].output_path), 20);
+        EXPECT_FALSE(std::filesystem::exists(jobs[1].output_path));
+        std::filesystem::remove(jobs[0].output_path);
+        std::filesystem::remove(jobs[2].output_path);
+    }
+}
+
+// Тест: исключение из on_progress (стадия записи) останавливает конвейер и доходит до вызывающего
+TEST(Pipeline, ProgressExceptionReachesCaller) {
+    PipelineDir dir("gbo_pipeline_throw_test", 8);
+    PipelineOptions options;
+    options.queue_capacity = 1;
+    size_t calls = 0;
+    options.on_progress = [&](const PipelineReport&) {
+        if (++calls == 2) throw std::runtime_error("observer failed");
+    };
+    EXPECT_THROW(runImagePipeline(dir.jobs(), [](const cv::Mat& image) { return image.clone(); }, options),
+                 std::runtime_error);
+    EXPECT_EQ(calls, 2u);
+    EXPECT_FALSE(std::filesystem::exists(dir.jobs().back().output_path));
+}
+
+// Тест: счётчики стадий — число элементов, время работы и ожидания, глубина очередей
+TEST(Pipeline, StageCountersTrackWorkAndQueues) {
+    const size_t count = 4;
+    const double step = 0.02;
+    PipelineDir dir("gbo_pipeline_stats_test", count);
+    PipelineOptions options;
+    options.queue_capacity = 1;
+    size_t snapshots = 0;
+    options.on_progress = [&](const PipelineReport& report) {
+        ++snapshots;
+        EXPECT_EQ(report.completed, snapshots);
+        EXPECT_LE(report.stages[1].queue_depth, 1u);
+        EXPECT_LE(report.stages[2].queue_depth, 1u);
+    };
+    const PipelineReport report = runImagePipeline(dir.jobs(), [&](const cv::Mat& image) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(step));
+        return image.clone();
+    }, options);
+
+    EXPECT_EQ(snapshots, count);
+    ASSERT_EQ(report.stages.size(), 3u);
+    EXPECT_EQ(report.stages[0].name, "decode");
+    EXPECT_EQ(report.stages[1].name, "process");
+    EXPECT_EQ(report.stages[2].name, "encode");
+    for (const StageStats& stage : report.stages) {
+        EXPECT_EQ(stage.items, count) << stage.name;
+        EXPECT_EQ(stage.failures, 0u) << stage.name;
+        EXPECT_GT(stage.throughput(), 0.0) << stage.name;
+    }
+    EXPECT_EQ(report.stages[0].queue_capacity, 0u);
+    EXPECT_EQ(report.stages[1].queue_capacity, 1u);
+    EXPECT_EQ(report.stages[2].queue_capacity, 1u);
+
+    // Processing is the slow stage: it is busy for every image, the encoder waits for it,
+    // and the decoder waits for room in the one-slot queue
+    EXPECT_GE(report.stages[1].busy_seconds, count * step * 0.9);
+    EXPECT_GE(report.stages[2].wait_seconds, (count - 1) * step * 0.9);
+    EXPECT_GE(report.stages[0].wait_seconds, step * 0.9);
+    for (int stage : {1, 2}) {
+        EXPECT_EQ(report.stages[stage].queue_depth, 0u);
+        EXPECT_EQ(report.stages[stage].queue_max_depth, 1u);
+        EXPECT_DOUBLE_EQ(report.stages[stage].queue_mean_depth, 1.0);
+    }
+}
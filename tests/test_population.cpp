@@ -50,3 +50,23 @@ TEST(PopulationClass, UpdateImprovesBest) {
     // После апдейта индекс лучшего индивидуума может измениться на 0, если fitness улучшилась
     ASSERT_TRUE(pop.indexOfBestIndividual == old_best || pop.indexOfBestIndividual == 0);
 }
+
+// Тест тёплого старта: начальные векторы попадают в популяцию с ограничением [-th, th]
+TEST(PopulationClass, WarmStartSeeds) {
+    cv::Mat block(8, 8, CV_8UC1, cv::Scalar(128));
+    const int vec_size = 22;
+    arma::vec inside(vec_size);
+    inside.fill(1.0);
+    arma::vec outside(vec_size);
+    outside.fill(50.0);
+    Population pop(vec_size, block, 1, 0, {inside, outside});
+
+    ASSERT_EQ(pop.individuals.size(), 30);
+    for (int j = 0; j < vec_size; ++j) {
+        EXPECT_DOUBLE_EQ(pop.individuals[0](j), 1.0);
+        EXPECT_DOUBLE_EQ(pop.individuals[1](j), pop.get_th());
+    }
+    EXPECT_DOUBLE_EQ(pop.fitness_values[0], calcFitnessValue(block, inside, 1, 0));
+
+    ASSERT_THROW(Population(vec_size, block, 1, 0, {arma::zeros<arma::vec>(5)}), std::invalid_argument);
+}
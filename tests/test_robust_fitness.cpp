@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include "gbo_api.h"
+#include "lockstep_gbo.h"
+#include "process_block.h"
+#include "robust_fitness.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+cv::Mat texturedBlock(int variant) {
+    cv::Mat block(8, 8, CV_8UC1);
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < 8; ++x) {
+            block.at<unsigned char>(y, x) = static_cast<unsigned char>(40 + (x * (17 + variant) + y * 29 + x * y * variant) % 180);
+        }
+    }
+    return block;
+}
+
+arma::vec candidate(int n, int variant) {
+    arma::vec vec(n);
+    for (int idx = 0; idx < n; ++idx) vec(idx) = 9.0 * std::sin(1.3 * idx + 2.1 * variant);
+    return vec;
+}
+
+} // namespace
+
+// Тест: разбор списка атак, проверка параметров и обратное форматирование
+TEST(RobustFitness, ParseAndValidateAttacks) {
+    const std::vector<BlockAttack> attacks = parseBlockAttacks("jpeg:70,gain:1.2,offset:-30,sharpen");
+    ASSERT_EQ(attacks.size(), 4u);
+    EXPECT_EQ(attacks[0].kind, BlockAttack::Kind::Jpeg);
+    EXPECT_DOUBLE_EQ(attacks[1].param, 1.2);
+    EXPECT_EQ(blockAttackName(attacks[2]), "offset:-30");
+    EXPECT_EQ(attacks[3].kind, BlockAttack::Kind::Sharpen);
+    EXPECT_TRUE(parseBlockAttacks("").empty());
+
+    EXPECT_THROW(parseBlockAttacks("blur"), std::invalid_argument);
+    EXPECT_THROW(parseBlockAttacks("jpeg"), std::invalid_argument);
+    EXPECT_THROW(parseBlockAttacks("jpeg:101"), std::invalid_argument);
+    EXPECT_THROW(parseBlockAttacks("gain:0"), std::invalid_argument);
+    EXPECT_THROW(parseBlockAttacks("average,gaussian,sharpen,jpeg:50,gain:2"), std::invalid_argument);
+    EXPECT_THROW(BlockRobustness(attacks, -1.0), std::invalid_argument);
+
+    gbo::Config config;
+    config.robustness_attacks = attacks;
+    config.robustness_attacks.push_back(attacks[0]);
+    std::vector<unsigned char> pixels(64, 128);
+    const unsigned char bit = 1;
+    EXPECT_THROW(gbo::embed({pixels.data(), 8, 8, 8}, &bit, 1, config), std::invalid_argument);
+}
+
+// Тест: штраф в calcFitnessValue равен весу на худшее отношение атакованного блока; пакетный путь совпадает
+TEST(RobustFitness, PenaltyMatchesScalarAndBatch) {
+    for (int scheme = 0; scheme < 2; ++scheme) {
+        const BlockRobustness robustness(parseBlockAttacks("jpeg:50,gain:1.3,gaussian,sharpen"), 0.5, scheme);
+        const int n = static_cast<int>(embeding_region[scheme].size());
+        std::vector<cv::Mat> blocks;
+        std::vector<unsigned char> bits;
+        for (int k = 0; k < lockstep_lanes; ++k) {
+            blocks.push_back(texturedBlock(k));
+            bits.push_back(static_cast<unsigned char>(k % 2));
+        }
+        const BlockBatch batch(blocks, bits, scheme, &robustness);
+        std::vector<double> vectors(static_cast<size_t>(n) * lockstep_lanes);
+        for (int k = 0; k < lockstep_lanes; ++k) {
+            const arma::vec vec = candidate(n, k);
+            for (int idx = 0; idx < n; ++idx) vectors[idx * lockstep_lanes + k] = vec(idx);
+        }
+        double fitness[lockstep_lanes];
+        batch.evaluate(vectors.data(), fitness);
+
+        for (int k = 0; k < lockstep_lanes; ++k) {
+            const arma::vec vec = candidate(n, k);
+            const double clean = calcFitnessValue(blocks[k], vec, bits[k], scheme);
+            const double robust = calcFitnessValue(blocks[k], vec, bits[k], scheme, &robustness);
+            const double worst = robustness.worstRatio(applyVectorToBlock(vec, blocks[k], scheme), bits[k]);
+            EXPECT_GT(worst, 0.0);
+            EXPECT_NEAR(robust, clean + 0.5 * worst, 1e-9);
+            EXPECT_NEAR(fitness[k], robust, 1e-9);
+        }
+    }
+    const BlockRobustness other_scheme(parseBlockAttacks("jpeg:50"), 1.0, 1);
+    EXPECT_THROW(BlockBatch({texturedBlock(0)}, {0}, 0, &other_scheme), std::invalid_argument);
+}
+
+// Тест: встраивание с учетом атаки дает блоки, которые после нее декодируются с большим запасом
+TEST(RobustFitness, EmbeddingImprovesAttackedRatio) {
+    const int size = 32;
+    std::vector<unsigned char> original(size * size);
+    for (int i = 0; i < size * size; ++i) original[i] = static_cast<unsigned char>(60 + (7 * (i % size) + 13 * (i / size) + (i % 5) * 9) % 120);
+    const std::vector<unsigned char> bits = {1, 0, 1, 1, 0};
+    const std::vector<BlockAttack> attacks = parseBlockAttacks("jpeg:50");
+    const BlockRobustness robustness(attacks, 1.0, 0);
+
+    double mean_ratio[2] = {0.0, 0.0};
+    for (int robust = 0; robust < 2; ++robust) {
+        gbo::Config config;
+        config.seed = 11;
+        config.iterations = 10;
+        if (robust) config.robustness_attacks = attacks;
+        std::vector<unsigned char> pixels = original;
+        gbo::embed({pixels.data(), size, size, static_cast<size_t>(size)}, bits.data(), bits.size(), config);
+        const cv::Mat image(size, size, CV_8UC1, pixels.data());
+        for (int i = 0; i < 16; ++i) {
+            const cv::Mat block = image(cv::Rect((i % 4) * 8, (i / 4) * 8, 8, 8)).clone();
+            mean_ratio[robust] += robustness.worstRatio(block, bits[i % bits.size()]) / 16.0;
+        }
+    }
+    EXPECT_LT(mean_ratio[1], mean_ratio[0]);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include "gbo_api.h"
+#include "scheme_classifier.h"
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+void putU32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+void putF32(std::vector<unsigned char>& out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU32(out, bits);
+}
+
+// Minimal model in the export format: global average brightness -> Linear(1 -> 2).
+// Logit difference is 2 * mean - 1, so bright blocks get scheme 1 and dark blocks scheme 0.
+std::vector<unsigned char> makeBrightnessModel() {
+    std::vector<unsigned char> bytes = {'G', 'B', 'O', 'C'};
+    putU32(bytes, 1);       // version
+    putU32(bytes, 8);       // input size
+    putF32(bytes, 0.0f);    // mean
+    putF32(bytes, 1.0f);    // std
+    putF32(bytes, 0.5f);    // threshold
+    putU32(bytes, 2);       // layers
+    putU32(bytes, 3);       // adaptive average pool to 1x1
+    putU32(bytes, 1);
+    putU32(bytes, 1);
+    putU32(bytes, 4);       // linear 1 -> 2 without ReLU
+    putU32(bytes, 1);
+    putU32(bytes, 2);
+    putU32(bytes, 0);
+    putF32(bytes, -1.0f);
+    putF32(bytes, 1.0f);
+    putF32(bytes, 0.5f);
+    putF32(bytes, -0.5f);
+    return bytes;
+}
+
+} // namespace
+
+// Тест: светлые блоки получают схему 1, тёмные — схему 0
+TEST(SchemeClassifier, ClassifiesBatchOfBlocks) {
+    SchemeClassifier classifier = SchemeClassifier::fromBytes(makeBrightnessModel());
+    ASSERT_EQ(classifier.inputSize(), 8);
+    ASSERT_FLOAT_EQ(classifier.threshold(), 0.5f);
+
+    // Две строки блоков 8x8 по ширине 16: светлый, тёмный / тёмный, светлый
+    const int width = 16;
+    std::vector<unsigned char> pixels(width * 16);
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const bool bright = (x < 8) == (y < 8);
+            pixels[y * width + x] = bright ? 230 : 20;
+        }
+    }
+    std::vector<const unsigned char*> blocks = {&pixels[0], &pixels[8], &pixels[8 * width], &pixels[8 * width + 8]};
+
+    EXPECT_EQ(classifier.classify(blocks, width), (std::vector<int>{1, 0, 0, 1}));
+    // Результат не зависит от числа потоков и разрешения входа
+    EXPECT_EQ(classifier.predict(blocks, width, 4), classifier.predict(blocks, width, 1));
+    classifier.setInputSize(16);
+    EXPECT_EQ(classifier.classify(blocks, width, 2), (std::vector<int>{1, 0, 0, 1}));
+}
+
+// Тест: повреждённый или усечённый файл модели отклоняется
+TEST(SchemeClassifier, RejectsInvalidModel) {
+    std::vector<unsigned char> bytes = makeBrightnessModel();
+    std::vector<unsigned char> bad_magic = bytes;
+    bad_magic[0] = 'X';
+    ASSERT_THROW(SchemeClassifier::fromBytes(bad_magic), std::runtime_error);
+
+    std::vector<unsigned char> truncated(bytes.begin(), bytes.end() - 3);
+    ASSERT_THROW(SchemeClassifier::fromBytes(truncated), std::runtime_error);
+
+    SchemeClassifier classifier = SchemeClassifier::fromBytes(bytes);
+    ASSERT_THROW(classifier.setInputSize(4), std::invalid_argument);
+}
+
+// Тест: при адаптивном выборе схемы извлечение восстанавливает ту же схему и биты
+TEST(SchemeClassifier, AdaptiveEmbedExtractRoundTrip) {
+    const int size = 32;
+    std::vector<unsigned char> pixels(size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const int base = x < size / 2 ? 190 : 50;
+            pixels[y * size + x] = static_cast<unsigned char>(base + (7 * x + 13 * y) % 30);
+        }
+    }
+    const unsigned char bits[4] = {1, 0, 0, 1};
+    gbo::ImageView view{pixels.data(), size, size, static_cast<size_t>(size)};
+
+    gbo::Config config;
+    config.seed = 3;
+    config.classifier = std::make_shared<const SchemeClassifier>(SchemeClassifier::fromBytes(makeBrightnessModel()));
+    gbo::EmbedStats stats = gbo::embed(view, bits, 4, config);
+    EXPECT_EQ(stats.blocks, 16u);
+    EXPECT_EQ(stats.scheme_blocks[0], 8u);
+    EXPECT_EQ(stats.scheme_blocks[1], 8u);
+    EXPECT_EQ(stats.inconsistent, 0u);
+
+    unsigned char extracted[4] = {};
+    gbo::extract(view, extracted, 4, config);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(extracted[i], bits[i]);
+    }
+}
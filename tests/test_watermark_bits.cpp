@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "gbo_api.h"
+#include "metrics.h"
+#include "process_images.h"
+#include "watermark_bits.h"
+#include <vector>
+
+namespace {
+
+std::vector<unsigned char> patternBytes(size_t count, unsigned seed) {
+    std::vector<unsigned char> bytes(count);
+    for (size_t i = 0; i < count; ++i) bytes[i] = static_cast<unsigned char>(((i * 7 + seed) * 2654435761u >> 13) & 1u);
+    return bytes;
+}
+
+} // namespace
+
+// Тест: упаковка, срез и подсчет отличий совпадают с побайтовым представлением
+TEST(WatermarkBits, PackSliceAndDifferences) {
+    const std::vector<unsigned char> a = patternBytes(1000, 1), b = patternBytes(1000, 2);
+    const WatermarkBits packed_a = WatermarkBits::fromBytes(a), packed_b = WatermarkBits::fromBytes(b);
+    EXPECT_EQ(packed_a.toBytes(), a);
+    EXPECT_DOUBLE_EQ(computeBER(packed_a, packed_b), computeBER(a, b));
+
+    const WatermarkBits slice = packed_a.slice(61, 130);
+    ASSERT_EQ(slice.size(), 130u);
+    for (size_t i = 0; i < slice.size(); ++i) EXPECT_EQ(slice.get(i), a[61 + i] != 0);
+    EXPECT_THROW(packed_a.slice(900, 101), std::out_of_range);
+    EXPECT_THROW(packed_a.differences(slice), std::invalid_argument);
+}
+
+// Тест: побитовое голосование совпадает с подсчетом голосов по байтам, включая неполную последнюю копию
+TEST(WatermarkBits, SlicedVoteMatchesCounts) {
+    const size_t bit_count = 70, blocks = 5 * bit_count + 33;
+    const std::vector<unsigned char> block_bytes = patternBytes(blocks, 3);
+    BitVoter voter(bit_count);
+    for (const WatermarkBits& copy : watermarkCopies(WatermarkBits::fromBytes(block_bytes), bit_count)) voter.add(copy);
+    WatermarkBits ties;
+    const WatermarkBits majority = voter.majority(&ties);
+
+    for (size_t j = 0; j < bit_count; ++j) {
+        int ones = 0, copies = 0;
+        for (size_t i = j; i < blocks; i += bit_count) {
+            ones += block_bytes[i];
+            copies++;
+        }
+        EXPECT_EQ(majority.get(j), 2 * ones > copies) << j;
+        EXPECT_EQ(ties.get(j), 2 * ones == copies) << j;
+    }
+}
+
+// Тест: размер водяного знака задается параметром; упакованное извлечение совпадает с побайтовым
+TEST(WatermarkBits, SideParameterAndPackedApi) {
+    cv::Mat image(16, 16, CV_8UC1);
+    for (int y = 0; y < 16; ++y) {
+        for (int x = 0; x < 16; ++x) image.at<unsigned char>(y, x) = static_cast<unsigned char>(((x ^ y) & 1) * 255);
+    }
+    const WatermarkBits bits = extract_watermark_bits(image, 16);
+    ASSERT_EQ(bits.size(), 256u);
+    EXPECT_EQ(cv::countNonZero(reconstruct_watermark_image(bits, 16) != image), 0);
+    EXPECT_THROW(extract_watermark_bits(image), std::runtime_error);
+
+    const int size = 32;
+    std::vector<unsigned char> pixels(size * size);
+    for (int i = 0; i < size * size; ++i) pixels[i] = static_cast<unsigned char>(60 + (7 * (i % size) + 13 * (i / size)) % 120);
+    gbo::Config config;
+    config.seed = 5;
+    config.method = gbo::Method::Analytic;
+    const WatermarkBits embedded = WatermarkBits::fromBytes(patternBytes(5, 4));
+    gbo::embed({pixels.data(), size, size, static_cast<size_t>(size)}, embedded, config);
+
+    const gbo::ConstImageView view(pixels.data(), size, size, size);
+    WatermarkBits extracted(5);
+    gbo::extract(view, extracted, config);
+    unsigned char bytes[5] = {};
+    gbo::extract(view, bytes, 5, config);
+    EXPECT_EQ(extracted, WatermarkBits::fromBytes(bytes, 5));
+    EXPECT_EQ(extracted, embedded);
+}
@@ -0,0 +1,225 @@
+#!/usr/bin/env python3
+"""Export best_scheme_classifier.pth to the flat binary read by SchemeClassifier.
+
+The checkpoint is parsed directly (zip + pickle), so neither PyTorch nor NumPy is
+needed. BatchNorm layers are folded into the preceding convolution / linear layer.
+
+Network layout (the state_dict stores no architecture, it is inferred from the keys):
+  features:   [conv3x3(pad 1) -> BN -> ReLU] x2 -> MaxPool2d(2) -> Dropout, three stages
+  pooling:    AdaptiveAvgPool2d to the grid implied by the first linear layer
+  classifier: Dropout -> Linear -> BN -> ReLU -> Dropout -> Linear -> BN -> ReLU -> Dropout -> Linear
+Preprocessing assumed by the training script: 8x8 block -> bilinear resize to
+config.image_size -> ToTensor -> Normalize(mean, std).
+
+The engine upscales to the input size stored in the file, 32 by default: it agrees with
+the 112x112 training resolution on 84-96% of the blocks of the bundled images at about
+a twelfth of the cost (README). Embedder and extractor read the same file, so they
+always classify alike. --input-size 0 writes config.image_size instead.
+
+Binary format (little endian):
+  char[4] "GBOC", u32 version, u32 input_size, f32 mean, f32 std, f32 threshold, u32 layer_count
+  layers: u32 type, then
+    1 conv3x3:  u32 in, u32 out, u32 relu, f32 weight[out][in][3][3], f32 bias[out]
+    2 maxpool2: (no payload)
+    3 avgpool:  u32 out_h, u32 out_w (adaptive)
+    4 linear:   u32 in, u32 out, u32 relu, f32 weight[out][in], f32 bias[out]
+
+Usage: python3 tools/export_classifier.py [model.pth] [out.bin] [--mean 0.5] [--std 0.5] [--input-size N]
+"""
+import argparse
+import codecs
+import math
+import pickle
+import struct
+import sys
+import zipfile
+
+BN_EPS = 1e-5
+LAYER_CONV, LAYER_MAXPOOL, LAYER_AVGPOOL, LAYER_LINEAR = 1, 2, 3, 4
+
+
+class Tensor:
+    def __init__(self, storage, offset, size, stride):
+        self.storage, self.offset, self.size, self.stride = storage, offset, tuple(size), tuple(stride)
+
+    def numel(self):
+        n = 1
+        for s in self.size:
+            n *= s
+        return n
+
+    def values(self):
+        """Elements in row-major order as floats."""
+        data = self.storage.floats()
+        out = []
+        index = [0] * len(self.size)
+        for _ in range(self.numel()):
+            pos = self.offset + sum(i * s for i, s in zip(index, self.stride))
+            out.append(data[pos])
+            for d in reversed(range(len(index))):
+                index[d] += 1
+                if index[d] < self.size[d]:
+                    break
+                index[d] = 0
+        return out
+
+
+class Storage:
+    def __init__(self, archive, prefix, dtype, key):
+        self.archive, self.prefix, self.dtype, self.key = archive, prefix, dtype, key
+        self._floats = None
+
+    def floats(self):
+        if self._floats is None:
+            raw = self.archive.read(f"{self.prefix}data/{self.key}")
+            if self.dtype != "FloatStorage":
+                raise ValueError(f"unsupported storage type {self.dtype}")
+            self._floats = struct.unpack(f"<{len(raw) // 4}f", raw)
+        return self._floats
+
+
+class _Opaque:
+    """Placeholder for pickled objects whose contents are not needed (numpy dtypes)."""
+
+    def __init__(self, *args, **kwargs):
+        pass
+
+    def __setstate__(self, state):
+        pass
+
+
+class CheckpointUnpickler(pickle.Unpickler):
+    def __init__(self, archive, prefix):
+        super().__init__(archive.open(prefix + "data.pkl"))
+        self.archive, self.prefix = archive, prefix
+
+    def find_class(self, module, name):
+        if name == "_rebuild_tensor_v2":
+            return lambda storage, offset, size, stride, *rest: Tensor(storage, offset, size, stride)
+        if module == "collections" and name == "OrderedDict":
+            import collections
+            return collections.OrderedDict
+        if module == "torch" and name.endswith("Storage"):
+            return name
+        if module == "_codecs" and name == "encode":
+            return codecs.encode
+        if name == "scalar":  # numpy scalar: (dtype, raw bytes)
+            return lambda dtype, data: struct.unpack("<d", data)[0] if len(data) == 8 else struct.unpack("<f", data)[0]
+        if name == "dtype":
+            return _Opaque
+        raise pickle.UnpicklingError(f"unexpected class {module}.{name} in checkpoint")
+
+    def persistent_load(self, pid):
+        # ('storage', storage_type, key, location, numel)
+        return Storage(self.archive, self.prefix, pid[1], pid[2])
+
+
+def load_checkpoint(path):
+    archive = zipfile.ZipFile(path)
+    prefix = archive.namelist()[0].split("/")[0] + "/"
+    return CheckpointUnpickler(archive, prefix).load()
+
+
+def fold_bn(weight, bias, state, bn, per_output):
+    """Folds y = gamma * (x - mean) / sqrt(var + eps) + beta into the previous layer."""
+    gamma = state[bn + ".weight"].values()
+    beta = state[bn + ".bias"].values()
+    mean = state[bn + ".running_mean"].values()
+    var = state[bn + ".running_var"].values()
+    out_weight, out_bias = [], []
+    for o in range(len(bias)):
+        scale = gamma[o] / math.sqrt(var[o] + BN_EPS)
+        out_weight.extend(w * scale for w in weight[o * per_output:(o + 1) * per_output])
+        out_bias.append((bias[o] - mean[o]) * scale + beta[o])
+    return out_weight, out_bias
+
+
+def indexed(state, prefix):
+    """Sequential indices of modules with a weight under prefix (e.g. 'features.')."""
+    return sorted({int(k[len(prefix):].split(".")[0]) for k in state if k.startswith(prefix) and k.endswith(".weight")})
+
+
+def build_layers(state):
+    layers = []
+    feature_idx = indexed(state, "features.")
+    convs = [i for i in feature_idx if len(state[f"features.{i}.weight"].size) == 4]
+    channels = 1
+    for n, i in enumerate(convs):
+        w = state[f"features.{i}.weight"]
+        out_c, in_c, kh, kw = w.size
+        if (kh, kw) != (3, 3):
+            raise ValueError("only 3x3 convolutions are supported")
+        weight, bias = w.values(), state[f"features.{i}.bias"].values()
+        bn = f"features.{i + 1}"
+        if bn + ".running_mean" in state:
+            weight, bias = fold_bn(weight, bias, state, bn, in_c * 9)
+        layers.append((LAYER_CONV, in_c, out_c, weight, bias))
+        channels = out_c
+        # conv, bn, relu take three slots; a wider gap means MaxPool2d + Dropout follow
+        nxt = convs[n + 1] if n + 1 < len(convs) else None
+        if nxt is None or nxt - i > 3:
+            layers.append((LAYER_MAXPOOL,))
+
+    linears = [i for i in indexed(state, "classifier.") if len(state[f"classifier.{i}.weight"].size) == 2]
+    first_in = state[f"classifier.{linears[0]}.weight"].size[1]
+    grid = int(round(math.sqrt(first_in / channels)))
+    if grid * grid * channels != first_in:
+        raise ValueError("cannot infer the pooling grid from the first linear layer")
+    layers.append((LAYER_AVGPOOL, grid, grid))
+
+    for n, i in enumerate(linears):
+        w = state[f"classifier.{i}.weight"]
+        out_f, in_f = w.size
+        weight, bias = w.values(), state[f"classifier.{i}.bias"].values()
+        bn = f"classifier.{i + 1}"
+        if bn + ".running_mean" in state:
+            weight, bias = fold_bn(weight, bias, state, bn, in_f)
+        layers.append((LAYER_LINEAR, in_f, out_f, weight, bias, n + 1 < len(linears)))
+    return layers
+
+
+def write_model(path, layers, input_size, mean, std, threshold):
+    with open(path, "wb") as f:
+        f.write(b"GBOC")
+        f.write(struct.pack("<IIfffI", 1, input_size, mean, std, threshold, len(layers)))
+        for layer in layers:
+            kind = layer[0]
+            f.write(struct.pack("<I", kind))
+            if kind == LAYER_CONV:
+                _, in_c, out_c, weight, bias = layer
+                f.write(struct.pack("<III", in_c, out_c, 1))
+                f.write(struct.pack(f"<{len(weight)}f", *weight))
+                f.write(struct.pack(f"<{len(bias)}f", *bias))
+            elif kind == LAYER_AVGPOOL:
+                f.write(struct.pack("<II", layer[1], layer[2]))
+            elif kind == LAYER_LINEAR:
+                _, in_f, out_f, weight, bias, relu = layer
+                f.write(struct.pack("<III", in_f, out_f, 1 if relu else 0))
+                f.write(struct.pack(f"<{len(weight)}f", *weight))
+                f.write(struct.pack(f"<{len(bias)}f", *bias))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("model", nargs="?", default="best_scheme_classifier.pth")
+    parser.add_argument("output", nargs="?", default="best_scheme_classifier.bin")
+    parser.add_argument("--mean", type=float, default=0.5, help="Normalize() mean used in training")
+    parser.add_argument("--std", type=float, default=0.5, help="Normalize() std used in training")
+    parser.add_argument("--input-size", type=int, default=32, help="upscale stored in the file; 0 = config.image_size")
+    args = parser.parse_args()
+
+    checkpoint = load_checkpoint(args.model)
+    state = checkpoint["model_state_dict"] if "model_state_dict" in checkpoint else checkpoint
+    config = checkpoint.get("config", {}) if isinstance(checkpoint, dict) else {}
+    input_size = args.input_size or int(config.get("image_size", (112, 112))[0])
+    threshold = float(checkpoint.get("threshold", 0.5))
+
+    layers = build_layers(state)
+    write_model(args.output, layers, input_size, args.mean, args.std, threshold)
+    names = {LAYER_CONV: "conv", LAYER_MAXPOOL: "maxpool", LAYER_AVGPOOL: "avgpool", LAYER_LINEAR: "linear"}
+    print(f"Exported {len(layers)} layers ({', '.join(names[l[0]] for l in layers)}) to {args.output}")
+    print(f"input {input_size}x{input_size}, threshold {threshold:.3f}, accuracy {checkpoint.get('accuracy', float('nan')):.3f}")
+
+
+if __name__ == "__main__":
+    sys.exit(main())